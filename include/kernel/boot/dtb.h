@@ -23,6 +23,34 @@ struct MemInfo {
 
 extern struct MemInfo memInfo;
 
+// 串口（ns16550a）信息，设备树中没有找到时保留 QEMU virt 的默认值
+struct UartInfo {
+	uint64 base;
+	uint64 size;
+	uint32 irq;
+	uint32 clock;
+};
+
+extern struct UartInfo uartInfo;
+
+// PLIC 信息，设备树中没有找到时保留 QEMU virt 的默认值
+struct PlicInfo {
+	uint64 base;
+	uint64 size;
+	uint32 ndev; // 中断源个数（riscv,ndev），中断号为 1..ndev
+};
+
+extern struct PlicInfo plicInfo;
+
+// /cpus 下 device_type 为 "cpu" 且未被禁用的 hart，reg 即 hartid
+struct CpuInfo {
+	uint32 nr;        // 设备树中的 hart 个数（包括 hartid 超出 NCPU 的）
+	uint64 hart_mask; // hartid < 64 的 hart 位图
+	uint64 timebase;  // time CSR 的频率（timebase-frequency），没有找到时为 0
+};
+
+extern struct CpuInfo cpuInfo;
+
 void parseDtb(uint64 dtbEntry);
 
 #define FDT_BEGIN_NODE 0x00000001
@@ -0,0 +1,50 @@
+#ifndef _CLOCKSOURCE_H_
+#define _CLOCKSOURCE_H_
+
+#include <kernel/riscv.h>
+#include <kernel/types.h>
+
+/*
+ * 时钟源：一个单调递增的硬件计数器和它的频率
+ *
+ * 计数值换算成纳秒用 ns = (cycles * mult) >> shift，避免在读时钟的路径上做除法。
+ * mult 取 64 位，乘法用 128 位中间结果，任何计数值都不会溢出，
+ * 所以不需要像 Linux 那样周期性地把基准往前推。
+ * 这些字段只在 clocksource_init 中写一次，之后所有 hart 只读，不需要加锁。
+ */
+struct clocksource {
+	const char* name;
+	uint64 (*read)(void);
+	uint64 freq;  // 计数频率（Hz）
+	uint64 mult;  // 每个计数对应的纳秒数，左移 shift 位
+	uint32 shift;
+};
+
+extern struct clocksource riscv_clocksource;
+
+static inline uint64 clocksource_cyc2ns(uint64 cycles, uint64 mult, uint32 shift) {
+	return (uint64)(((unsigned __int128)cycles * mult) >> shift);
+}
+
+// time CSR 的计数值换算成纳秒
+static inline uint64 cycles_to_ns(uint64 cycles) {
+	return clocksource_cyc2ns(cycles, riscv_clocksource.mult, riscv_clocksource.shift);
+}
+
+// 以 time CSR 为准的纳秒数，从 hart 上电开始计，不经过函数指针
+static inline uint64 clocksource_read_ns(void) { return cycles_to_ns(read_csr(time)); }
+
+/**
+ * ns_to_cycles - 纳秒数换算成 time CSR 的计数值，用于编程定时比较器
+ *
+ * 向上取整：返回的计数值 c 满足 cycles_to_ns(c) >= ns，比较器触发时读到的时间不会早于 ns。
+ */
+uint64 ns_to_cycles(uint64 ns);
+
+/**
+ * clocksource_init - 按设备树给出的频率初始化 time CSR 时钟源
+ * @freq: /cpus 的 timebase-frequency，为 0 时使用 config.h 中的 TIMEBASE_FREQUENCY
+ */
+void clocksource_init(uint64 freq);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _COMPLETION_H_
+#define _COMPLETION_H_
+
+#include <kernel/sched/wait.h>
+#include <kernel/types.h>
+
+/*
+ * 完成量：一方等待另一方通知某件事已经做完
+ *
+ * done 记录还没有被等待者取走的 complete() 次数，COMPLETION_ALL 表示 complete_all()
+ * 之后所有等待都立即返回。done 由 wait.lock 保护，complete() 在同一次持锁中
+ * 完成计数和唤醒，等待者返回后就可以释放完成量（例如放在栈上的 vfork_done）。
+ */
+struct completion {
+	uint32 done;
+	struct wait_queue_head wait;
+};
+
+#define COMPLETION_ALL UINT32_MAX
+
+#define COMPLETION_INITIALIZER(name) {.done = 0, .wait = __WAIT_QUEUE_HEAD_INITIALIZER((name).wait)}
+#define DECLARE_COMPLETION(name) struct completion name = COMPLETION_INITIALIZER(name)
+
+static inline void init_completion(struct completion* x) {
+	x->done = 0;
+	init_waitqueue_head(&x->wait);
+}
+
+// 重新使用之前调用，调用者保证此时没有等待者
+static inline void reinit_completion(struct completion* x) { x->done = 0; }
+
+void wait_for_completion(struct completion* x);
+int32 wait_for_completion_interruptible(struct completion* x);
+int64 wait_for_completion_timeout(struct completion* x, int64 timeout);
+int32 try_wait_for_completion(struct completion* x);
+int32 completion_done(struct completion* x);
+void complete(struct completion* x);
+void complete_all(struct completion* x);
+
+#endif
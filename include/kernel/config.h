@@ -1,11 +1,18 @@
 #ifndef _CONFIG_H_
 #define _CONFIG_H_
 
-// we use two HART (cpu) in challenge3
-#define NCPU 1
+// 支持的最大 hart 数，也是 hart 编号的上限。实际启动的 hart 由设备树的 /cpus 决定
+#define NCPU 4
 
-//interval of timer interrupt. added @lab1_3
-#define TIMER_INTERVAL 1000000
+// 缓存行大小，各 hart 频繁写入的数据按它隔开，避免伪共享
+#define L1_CACHE_BYTES 64
+
+// frequency of the time CSR, qemu virt runs it at 10MHz.
+// 只在设备树没有 timebase-frequency 时使用
+#define TIMEBASE_FREQUENCY 10000000
+
+// 时钟节拍频率，忙碌的 hart 每秒 HZ 个节拍，空闲的 hart 停掉节拍（见 include/kernel/tick.h）
+#define HZ 100
 
 // the maximum memory space that PKE is allowed to manage. added @lab2_1
 #define PKE_MAX_ALLOWABLE_RAM 128 * 1024 * 1024
@@ -19,6 +26,9 @@
 // virtual address of stack top of user process
 #define USER_STACK_TOP 0x80000000
 
+// vDSO 映射在栈顶下方 16MB 处，给栈留出增长空间
+#define USER_VDSO_BASE (USER_STACK_TOP - 0x1000000)
+
 // start virtual address (4MB) of our simple heap. added @lab2_2
 #define USER_FREE_ADDRESS_START 0x00000000 + PAGE_SIZE * 1024
 
@@ -27,4 +37,49 @@
 // the ending physical address that PKE observes. added @lab2_1
 #define PHYS_TOP (DRAM_BASE + PKE_MAX_ALLOWABLE_RAM)
 
+// 编译期日志阈值，取值见 kernel/util/log.h 中的 LOG_LEVEL_*。
+// 默认只保留 INFO 及以上级别，DEBUG/TRACE 日志在编译期被消除
+#ifndef CONFIG_LOG_LEVEL
+#define CONFIG_LOG_LEVEL 3
+#endif
+
+// warn()/unwrap() 的告警输出，与 CONFIG_LOG_LEVEL 无关，默认和以前一样关闭
+#ifndef CONFIG_WARN
+#define CONFIG_WARN 0
+#endif
+
+// 系统调用计数与耗时直方图（/dev/syscall_stat），关闭后 do_syscall 中的埋点被编译器消除
+#ifndef CONFIG_SYSCALL_STAT
+#define CONFIG_SYSCALL_STAT 1
+#endif
+
+// 自旋锁竞争统计（/dev/lockstat），每个 spinlock_t 多出两个字段，加解锁各多读两次 time CSR
+#ifndef CONFIG_LOCKSTAT
+#define CONFIG_LOCKSTAT 0
+#endif
+
+// 公平调度的时间片参数（纳秒）：调度周期、单次最少运行时间、唤醒抢占的门槛。
+// 可运行任务不超过 LATENCY / MIN_GRANULARITY 个时，每个任务在一个周期内按权重分到时间片；
+// 更多时周期被拉长为 nr * MIN_GRANULARITY。实际抢占只在时钟节拍处发生。
+#ifndef CONFIG_SCHED_LATENCY_NS
+#define CONFIG_SCHED_LATENCY_NS 6000000ULL
+#endif
+#ifndef CONFIG_SCHED_MIN_GRANULARITY_NS
+#define CONFIG_SCHED_MIN_GRANULARITY_NS 750000ULL
+#endif
+#ifndef CONFIG_SCHED_WAKEUP_GRANULARITY_NS
+#define CONFIG_SCHED_WAKEUP_GRANULARITY_NS 1000000ULL
+#endif
+
+// SCHED_RR 任务在同优先级之间轮转的时间片（纳秒）
+#ifndef CONFIG_SCHED_RR_TIMESLICE_NS
+#define CONFIG_SCHED_RR_TIMESLICE_NS 100000000ULL
+#endif
+
+// 可抢占内核：系统调用期间开中断，时钟节拍设置的 need_resched 在 preempt_count
+// 回到 0 或中断返回内核时生效。关闭后只在返回用户态和 cond_resched() 处切换
+#ifndef CONFIG_PREEMPT
+#define CONFIG_PREEMPT 1
+#endif
+
 #endif
@@ -3,6 +3,7 @@
 #include <kernel/device/block_device.h>
 #include <kernel/util/list.h>
 #include <kernel/util/spinlock.h>
+#include <kernel/sched/wait.h>
 #include <kernel/types.h>
 #include <kernel/util/atomic.h>
 
@@ -35,7 +36,7 @@ struct buffer_head {
     char               *b_data;        /* Pointer to data block */
     
     struct list_head    b_lru;         /* LRU list entry */
-    spinlock_t          b_lock;        /* Buffer lock */
+    struct wait_queue_head b_wait;     /* Waiters for BH_Lock to clear */
     
     /* 以下成员是可选的，如果需要，可以稍后实现 */
     
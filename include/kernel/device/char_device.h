@@ -3,8 +3,10 @@
 
 #include <kernel/types.h>
 #include <kernel/util/atomic.h>
+#include <kernel/util/list.h>
 
 struct file;
+struct dentry;
 
 
 
@@ -13,6 +15,8 @@ struct char_device {
     const struct char_device_operations* ops;  /* Device operations */
     atomic_t cd_count;                 /* Reference count */
     void* private_data;                /* Driver private data */
+    const char* cd_name;               /* /dev 下的节点名，为 NULL 时不自动创建节点 */
+    struct list_head cd_list;          /* 全局字符设备链表 */
 };
 
 struct char_device_operations {
@@ -25,7 +29,23 @@ struct char_device_operations {
 };
 
 /* Character device management functions */
+int32 cdev_register(struct char_device* cdev);
+void cdev_unregister(struct char_device* cdev);
 struct char_device* cdev_get(dev_t dev);
 void cdev_put(struct char_device* cdev);
+int32 cdev_create_nodes(struct dentry* dev_dir);
+
+/* 字符设备节点的默认文件操作，按 inode->i_rdev 分发到驱动 */
+extern const struct file_operations chFile_operations;
+
+/* /dev/console */
+#define CONSOLE_DEV MKDEV(TTYAUX_MAJOR, 1)
+
+/* 内核统计类设备（misc 主设备号） */
+#define SYSCALL_STAT_DEV MKDEV(MISC_MAJOR, 1)
+#define LOCKSTAT_DEV MKDEV(MISC_MAJOR, 2)
+#define IRQ_STAT_DEV MKDEV(MISC_MAJOR, 3)
+#define LOG_MASK_DEV MKDEV(MISC_MAJOR, 4)
+void console_init(void);
 
 #endif /* _CHAR_DEVICE_H */
\ No newline at end of file
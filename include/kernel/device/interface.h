@@ -1,10 +1,13 @@
 #ifndef _DEV_INTERFACE_H_
 #define _DEV_INTERFACE_H_
 
+#include <kernel/types.h>
+
 void cons_init();
 void dev_init();
 
 void cons_putc(int c);
+void cons_write(const char *buf, size_t len);
 int cons_getc();
 int cons_test_getc();
 
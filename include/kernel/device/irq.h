@@ -0,0 +1,42 @@
+#ifndef _IRQ_H_
+#define _IRQ_H_
+
+#include <kernel/config.h>
+#include <kernel/types.h>
+#include <kernel/util/spinlock.h>
+
+/*
+ * 外部中断管理
+ *
+ * 驱动通过 request_irq 挂接处理函数，PLIC 在 S 态外部中断中 claim 到中断号后
+ * 经 generic_handle_irq 分发。每个中断源可以设置亲和性（允许接收它的 hart 集合），
+ * 并按 hart 统计触发次数。计数和亲和性通过 /dev/interrupts 读出和设置。
+ */
+
+#define NR_IRQS 128 // 支持的最大中断号（不含），PLIC 的 0 号中断源保留不用
+
+#define IRQ_AFFINITY_ALL ((1UL << NCPU) - 1)
+#define IRQ_AFFINITY_DEFAULT (1UL << 0) // 默认只路由到 0 号核，避免多个 hart 争抢 claim
+
+typedef void (*irq_handler_t)(int32 irq, void* dev_id);
+
+struct irq_desc {
+	irq_handler_t handler;
+	void* dev_id;
+	const char* name;
+	uint64 affinity;      // 允许接收该中断的 hart 掩码
+	uint64 count[NCPU];   // 每个 hart 上的触发次数
+	uint64 unhandled;     // 没有处理函数时被 claim 到的次数
+};
+
+int32 request_irq(uint32 irq, irq_handler_t handler, const char* name, void* dev_id);
+void free_irq(uint32 irq, void* dev_id);
+
+int32 irq_set_affinity(uint32 irq, uint64 mask);
+uint64 irq_get_affinity(uint32 irq);
+uint64 irq_get_count(uint32 irq, int32 cpu);
+void irq_stat_init(void);
+
+void generic_handle_irq(uint32 irq);
+
+#endif // _IRQ_H_
@@ -0,0 +1,36 @@
+#ifndef _PLIC_H_
+#define _PLIC_H_
+
+#include <kernel/types.h>
+
+/*
+ * PLIC（平台级中断控制器）
+ *
+ * 每个 hart 的 S 态是一个独立的 context：QEMU virt 上 hart h 的 S 态 context 为 2h+1。
+ * 寄存器基址和中断源个数取自设备树。
+ */
+
+#define PLIC_PRIORITY_OFF 0x0
+#define PLIC_PENDING_OFF 0x1000
+#define PLIC_ENABLE_OFF(ctx) (0x2000 + (ctx) * 0x80)
+#define PLIC_THRESHOLD_OFF(ctx) (0x200000 + (ctx) * 0x1000)
+#define PLIC_CLAIM_OFF(ctx) (0x200004 + (ctx) * 0x1000)
+
+#define PLIC_SCONTEXT(hart) (2 * (hart) + 1)
+
+#define PLIC_PRIORITY_MAX 7
+
+void plic_init(void);
+void plic_init_hart(void);
+
+void plic_set_priority(uint32 irq, uint32 priority);
+void plic_set_threshold(int32 hart, uint32 threshold);
+void plic_enable_hart(uint32 irq, int32 hart);
+void plic_disable_hart(uint32 irq, int32 hart);
+
+uint32 plic_claim(void);
+void plic_complete(uint32 irq);
+
+void plic_handle_irq(void);
+
+#endif // _PLIC_H_
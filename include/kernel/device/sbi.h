@@ -98,7 +98,7 @@ struct sbiret {
 		  start_addr, size, 0)
 
 #define SBI_RFENCE_SFENCE_VMA_ASID(hart_mask, hart_mask_base, start_addr, size, asid)              \
-	SBI_ECALL(SBI_RFENCE_EID, SBI_RFENCE_SFENCE_VMA_FID, hart_mask, hart_mask_base,            \
+	SBI_ECALL(SBI_RFENCE_EID, SBI_RFENCE_SFENCE_VMA_ASID_FID, hart_mask, hart_mask_base,       \
 		  start_addr, size, asid)
 
 // 启动hartid。start_addr是该hart在S态启动时的初始地址，opaque是传递给hart的第二个参数（a1）
@@ -0,0 +1,77 @@
+#ifndef _UART_H_
+#define _UART_H_
+
+#include <kernel/types.h>
+#include <kernel/sched/wait.h>
+#include <kernel/util/spinlock.h>
+
+/*
+ * NS16550A 串口驱动
+ *
+ * 发送和接收各有一个软件环形缓冲区：
+ * 写者只把字节放进发送环，由 THR 空中断（或写者自己顺手）把环里的数据灌进硬件 FIFO；
+ * 接收中断把 RBR 中的数据搬进接收环，读者从接收环里取。
+ * 在挂上 PLIC 中断之前，驱动退化为轮询模式。
+ */
+
+// 寄存器偏移（QEMU virt 上 reg-shift 为 0）
+#define UART_RHR 0 // receive holding register (读)
+#define UART_THR 0 // transmit holding register (写)
+#define UART_IER 1 // interrupt enable register
+#define UART_FCR 2 // FIFO control register (写)
+#define UART_ISR 2 // interrupt status register (读)
+#define UART_LCR 3 // line control register
+#define UART_MCR 4 // modem control register
+#define UART_LSR 5 // line status register
+
+#define UART_IER_RX_ENABLE (1 << 0)
+#define UART_IER_TX_ENABLE (1 << 1)
+#define UART_FCR_FIFO_ENABLE (1 << 0)
+#define UART_FCR_FIFO_CLEAR (3 << 1) // 同时清空收发 FIFO
+#define UART_LCR_EIGHT_BITS (3 << 0)
+#define UART_LCR_BAUD_LATCH (1 << 7) // 置位后 0/1 号寄存器为波特率除数
+#define UART_MCR_OUT2 (1 << 3)       // 部分实现需要 OUT2 才会向外送出中断
+#define UART_LSR_RX_READY (1 << 0)
+#define UART_LSR_TX_IDLE (1 << 5) // THR 为空，可以再写入一批字节
+
+#define UART_FIFO_DEPTH 16
+#define UART_TX_BUF_SIZE 2048 // 必须是 2 的幂
+#define UART_RX_BUF_SIZE 256  // 必须是 2 的幂
+
+struct uart_port {
+	spinlock_t lock;
+	uint64 base;
+	uint32 irq;
+	volatile int32 ready;    // 寄存器已初始化，可以代替 SBI 输出
+	volatile int32 irq_mode; // 已经挂上中断，发送可以异步完成
+
+	char tx_buf[UART_TX_BUF_SIZE];
+	uint64 tx_r; // 下一个要送进硬件的位置
+	uint64 tx_w; // 下一个写入位置
+
+	char rx_buf[UART_RX_BUF_SIZE];
+	uint64 rx_r;
+	uint64 rx_w;
+	struct wait_queue_head rx_wait; // 等待接收环中有数据的读者
+
+	uint64 tx_bytes;
+	uint64 rx_bytes;
+	uint64 rx_overruns; // 接收环满时丢弃的字节数
+};
+
+extern struct uart_port uart0;
+
+void uart_init(void);
+void uart_enable_irq(void);
+
+void uart_putc(int32 c);
+void uart_putc_sync(int32 c);
+void uart_panic_flush(void);
+size_t uart_write(const char* buf, size_t len);
+int32 uart_getc(void);
+size_t uart_read(char* buf, size_t len);
+int32 uart_rx_pending(void);
+
+void uart_intr(void);
+
+#endif // _UART_H_
@@ -55,6 +55,18 @@ typedef struct __attribute__((packed)) {
 } debug_header;
 #define ELF_MAGIC 0x464C457FU  // "\x7FELF" in little endian
 #define ELF_PROG_LOAD 1
+#define ELF_PROG_PHDR 6
+
+// 辅助向量（auxv）的类型，放在初始用户栈上 envp 之后
+#define AT_NULL 0
+#define AT_PHDR 3          // 程序头表的用户地址
+#define AT_PHENT 4         // 程序头表项大小
+#define AT_PHNUM 5         // 程序头表项个数
+#define AT_PAGESZ 6
+#define AT_ENTRY 9
+#define AT_CLKTCK 17       // times() 的时钟频率
+#define AT_EXECFN 31       // 可执行文件路径
+#define AT_SYSINFO_EHDR 33 // vDSO 映像的用户地址
 
 typedef enum elf_status_t {
   EL_OK = 0,
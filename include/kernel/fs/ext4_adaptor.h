@@ -28,6 +28,7 @@
 #include <kernel/fs/lwext4/ext4_types.h>
 #include <kernel/fs/lwext4/ext4_xattr.h>
 
+#include <kernel/mutex.h>
 #include <kernel/vfs.h>
 #include <kernel/types.h>
 /*helper functions*/
@@ -38,9 +39,14 @@ void make_fsid_from_uuid(const uint8_t uuid[16], fsid_t *fsid);
 
 
 /*global ext4 superblock lock*/
-extern spinlock_t ext4_spinlock;
-static inline void ext4_lock(void) { spinlock_lock(&ext4_spinlock); }
-static inline void ext4_unlock(void) { spinlock_unlock(&ext4_spinlock); }
+/*
+ * lwext4 的块分配、块缓存和挂载点表都没有自己的锁，适配层的每个入口
+ * （inode/file/superblock 操作）都持这把锁串行化。lwext4 的调用会读写磁盘，用睡眠锁。
+ * 持锁的入口会经 inode_acquire 重入 read_inode，所以同一任务可以嵌套加锁。
+ */
+extern struct mutex ext4_mutex;
+void ext4_lock(void);
+void ext4_unlock(void);
 
 int32 ext4_sync_inode(struct ext4_inode_ref* inode_ref);
 int32 ext4_fs_sync(struct ext4_fs* fs);
@@ -3,6 +3,7 @@
 // #include <kernel/vfs.h>
 #include "forward_declarations.h"
 #include <kernel/mm/vma.h>
+#include <kernel/rwsem.h>
 #include <kernel/util.h>
 
 extern struct hashtable inode_hashtable;
@@ -104,6 +105,7 @@ struct inode {
 	/* Reference counting and locking */
 	atomic_t i_refcount;  /* Reference count */
 	spinlock_t i_lock; /* Protects changes to inode */
+	struct rw_semaphore i_rwsem; /* Held across file data and directory I/O, may sleep */
 
 	/* State tracking */
 	uint64 i_state; /* Inode state flags */
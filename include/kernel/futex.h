@@ -0,0 +1,71 @@
+#ifndef _FUTEX_H_
+#define _FUTEX_H_
+
+#include <kernel/types.h>
+#include <kernel/util/list.h>
+#include <kernel/util/spinlock.h>
+
+/*
+ * 用户态快速互斥（futex）
+ *
+ * 用户态在无竞争时只用原子指令操作一个 32 位整数，竞争时才进入内核：
+ * FUTEX_WAIT 在 *uaddr 仍等于 val 时睡眠，FUTEX_WAKE 唤醒在同一个地址上等待的任务。
+ * 等待者按 futex_key 散列到全局的桶中，检查 *uaddr 与挂入桶在同一把桶锁内完成，
+ * 不会错过检查之后、睡眠之前发出的唤醒。
+ *
+ * 带 FUTEX_PRIVATE_FLAG 的 futex 只在本进程的线程之间使用，键为 (mm, 虚拟地址)，
+ * 不需要查页表；否则地址在共享映射中时键为物理地址，映射同一页的不同进程也能互相唤醒，
+ * 在私有映射中时同样用 (mm, 虚拟地址)。
+ */
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_FD 2
+#define FUTEX_REQUEUE 3
+#define FUTEX_CMP_REQUEUE 4
+#define FUTEX_WAKE_OP 5
+#define FUTEX_LOCK_PI 6
+#define FUTEX_UNLOCK_PI 7
+#define FUTEX_TRYLOCK_PI 8
+#define FUTEX_WAIT_BITSET 9
+#define FUTEX_WAKE_BITSET 10
+
+#define FUTEX_PRIVATE_FLAG 128
+#define FUTEX_CLOCK_REALTIME 256
+#define FUTEX_CMD_MASK (~(FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME))
+
+#define FUTEX_BITSET_MATCH_ANY 0xffffffff
+
+struct mm_struct;
+struct task_struct;
+
+union futex_key {
+	struct {
+		struct mm_struct* mm; // 私有 futex
+		uint64 address;       // 用户虚拟地址
+	} private;
+	struct {
+		void* zero;     // 恒为 NULL，与私有键区分
+		uint64 address; // 物理地址
+	} shared;
+	struct {
+		uint64 word;
+		uint64 address;
+	} both; // 比较与散列用
+};
+
+// 一个等待者，位于等待者的内核栈上
+struct futex_q {
+	struct list_head list;
+	struct task_struct* task;
+	union futex_key key;
+	uint32 bitset;
+	// 所在桶的锁，被唤醒者摘下后置为 NULL；requeue 会把它换成新桶的锁
+	spinlock_t* lock_ptr;
+};
+
+void futex_init(void);
+int64 do_futex(uint32* uaddr, int32 op, uint32 val, const struct timespec* timeout, uint32* uaddr2, uint32 val2, uint32 val3);
+int32 futex_wake(uint32* uaddr, uint32 flags, int32 nr_wake, uint32 bitset);
+
+#endif
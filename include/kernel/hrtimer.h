@@ -0,0 +1,82 @@
+#ifndef _KERNEL_HRTIMER_H
+#define _KERNEL_HRTIMER_H
+
+#include <kernel/percpu.h>
+#include <kernel/types.h>
+#include <kernel/util/rbtree.h>
+#include <kernel/util/spinlock.h>
+
+/*
+ * 高精度定时器
+ *
+ * 到期时间是 CLOCK_MONOTONIC 的纳秒数。每个 hart 一个按到期时间排序的红黑树，
+ * 本 hart 的定时比较器总是编程为树中最早的到期时间，中断只在真正有定时器到期时才来；
+ * 周期时钟节拍也只是其中一个定时器，见 include/kernel/tick.h。
+ *
+ * hrtimer_start 把定时器挂到调用者所在的 hart 上。回调在时钟中断中执行，不能睡眠；
+ * 返回 HRTIMER_RESTART 时由回调自己用 hrtimer_forward 推后到期时间。
+ * 对同一个定时器的 start/cancel 由调用者串行化。
+ */
+
+enum hrtimer_restart {
+	HRTIMER_NORESTART,
+	HRTIMER_RESTART,
+};
+
+enum hrtimer_mode {
+	HRTIMER_MODE_ABS, // 到期时间是所属时钟上的绝对时间
+	HRTIMER_MODE_REL, // 到期时间是相对现在的间隔
+};
+
+struct hrtimer_cpu_base;
+
+struct hrtimer {
+	struct rb_node node; // 未挂入时 RB_EMPTY_NODE
+	uint64 expires;      // CLOCK_MONOTONIC 纳秒
+	enum hrtimer_restart (*function)(struct hrtimer* timer);
+	struct hrtimer_cpu_base* base; // 最近一次挂入的 hart 队列
+	clockid_t clockid;             // 绝对到期时间所属的时钟
+};
+
+/*
+ * 每个 hart 的定时器队列
+ */
+struct hrtimer_cpu_base {
+	spinlock_t lock;
+	struct rb_root_cached active;    // 按 expires 排序
+	uint64 next_event;               // 比较器当前编程的时间，KTIME_MAX 表示没有
+	struct hrtimer* volatile running; // 正在执行回调的定时器
+	int32 in_hrtirq;                  // 正在 hrtimer_interrupt 中，退出时统一编程比较器
+};
+
+DECLARE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases);
+
+/*
+ * 到期后唤醒一个任务，用于 nanosleep
+ */
+struct hrtimer_sleeper {
+	struct hrtimer timer;
+	struct task_struct* task; // 到期时清空
+};
+
+void hrtimer_init(struct hrtimer* timer, clockid_t clockid, enum hrtimer_restart (*function)(struct hrtimer*));
+void hrtimer_start(struct hrtimer* timer, uint64 expires, enum hrtimer_mode mode);
+int32 hrtimer_try_to_cancel(struct hrtimer* timer);
+int32 hrtimer_cancel(struct hrtimer* timer);
+uint64 hrtimer_forward(struct hrtimer* timer, uint64 now, uint64 interval);
+int64 hrtimer_get_remaining(const struct hrtimer* timer);
+
+static inline int32 hrtimer_is_queued(const struct hrtimer* timer) { return !RB_EMPTY_NODE(&timer->node); }
+
+// 已挂入或者回调正在执行
+static inline int32 hrtimer_active(const struct hrtimer* timer) {
+	return hrtimer_is_queued(timer) || (timer->base && timer->base->running == timer);
+}
+
+void hrtimer_init_sleeper(struct hrtimer_sleeper* sl, clockid_t clockid);
+int32 hrtimer_nanosleep(uint64 expires, enum hrtimer_mode mode, clockid_t clockid, struct timespec* rem);
+
+void hrtimer_init_cpu(void);
+void hrtimer_interrupt(void);
+
+#endif
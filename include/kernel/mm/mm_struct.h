@@ -6,6 +6,7 @@
 #include <kernel/mm/pagetable.h>
 #include <kernel/mm/vma.h>
 #include <kernel/riscv.h>
+#include <kernel/rwsem.h>
 #include <kernel/sched/process.h>
 #include <kernel/types.h>
 #include <kernel/util/list.h>
@@ -41,7 +42,7 @@ struct mm_struct {
   uint64 end_stack; // 栈范围
 
   // 锁和引用计数
-  spinlock_t mm_lock; // mm锁
+  struct rw_semaphore mmap_lock; // 保护 VMA 链表：修改映射时写，缺页时读
   atomic_t mm_users;  // 用户数量
   atomic_t mm_count;  // 引用计数
 };
@@ -50,8 +51,13 @@ struct mm_struct {
 void create_init_mm();
 
 struct mm_struct *user_alloc_mm(void);
+struct mm_struct *dup_mm(struct mm_struct *oldmm);
 void free_mm(struct mm_struct *mm);
 
+// 地址空间的使用者计数，CLONE_VM 的线程共用同一个 mm_struct
+static inline void mmget(struct mm_struct *mm) { atomic_inc(&mm->mm_users); }
+void mmput(struct mm_struct *mm);
+
 uint64 prot_to_type(int32 prot, int32 user);
 
 /**
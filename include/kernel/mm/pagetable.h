@@ -76,6 +76,7 @@ int32 pgt_map_page(pagetable_t pagetable, vaddr_t va, paddr_t pa, int32 perm);
 int32 pgt_map_pages(pagetable_t pagetable, vaddr_t va, paddr_t pa, uint64 size,  int32 perm);
 
 int32 pgt_unmap(pagetable_t pagetable, vaddr_t va, uint64 size, int32 free_phys);
+int32 pgt_unmap_noflush(pagetable_t pagetable, vaddr_t va, uint64 size);
 
 pte_t *page_walk(pagetable_t pagetable, vaddr_t va, int32 alloc);
 paddr_t lookup_pa(pagetable_t pagetable, vaddr_t va);
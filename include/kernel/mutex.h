@@ -0,0 +1,30 @@
+#ifndef _MUTEX_H_
+#define _MUTEX_H_
+
+#include <kernel/sched/wait.h>
+#include <kernel/types.h>
+
+/*
+ * 睡眠互斥锁
+ *
+ * 用于可能长时间持有（例如跨越磁盘 I/O）的临界区。owner 为 NULL 表示空闲；
+ * 加锁失败时，如果持有者正在其他 hart 上运行就先自旋等待，否则在 wait 上睡眠。
+ * 只能在进程上下文中使用，持有期间可以睡眠，必须由加锁的任务解锁。
+ */
+struct mutex {
+	struct task_struct* owner;
+	struct wait_queue_head wait; // 排他等待者，解锁时唤醒一个
+};
+
+#define __MUTEX_INITIALIZER(name) {.owner = NULL, .wait = __WAIT_QUEUE_HEAD_INITIALIZER((name).wait)}
+#define DEFINE_MUTEX(name) struct mutex name = __MUTEX_INITIALIZER(name)
+
+void mutex_init(struct mutex* lock);
+void mutex_lock(struct mutex* lock);
+int32 mutex_lock_interruptible(struct mutex* lock);
+int32 mutex_trylock(struct mutex* lock);
+void mutex_unlock(struct mutex* lock);
+
+static inline int32 mutex_is_locked(struct mutex* lock) { return __atomic_load_n(&lock->owner, __ATOMIC_RELAXED) != NULL; }
+
+#endif
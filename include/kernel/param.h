@@ -2,7 +2,7 @@
 #ifndef _PARAM_H
 #define _PARAM_H
 #include <kernel/feature.h>
-#define NCPU 1
+#include <kernel/config.h>
 #ifndef NCPU
 #error NCPU not defined
 #endif	       // !NCPU
@@ -13,7 +13,6 @@
 #define MAX_PROC_NAME_LEN (MAXPATH + 1)
 
 // FarmOS 参数
-#define NTHREAD NPROC       // FarmOS 支持的最大线程数
 #define NPROCSIGNALS 128     // FarmOS 支持的最大信号数
 #define NSIGEVENTS 512      // FarmOS 支持的最大信号事件数
 
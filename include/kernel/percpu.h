@@ -0,0 +1,83 @@
+#ifndef _PERCPU_H_
+#define _PERCPU_H_
+
+#include <kernel/config.h>
+#include <kernel/riscv.h>
+#include <kernel/types.h>
+#include <kernel/util/atomic.h>
+
+/*
+ * per-CPU 变量
+ *
+ * DEFINE_PER_CPU 定义的变量放在 .data..percpu 节中，只作为模板。setup_per_cpu_areas
+ * 给每个 hart 复制一份，每份按缓存行对齐、大小取缓存行的整数倍，不同 hart 的数据
+ * 不会落在同一个缓存行里。
+ *
+ * 内核态的 tp 存放本 hart 的副本相对模板的偏移，变量地址加上 tp 就是本 hart 的副本，
+ * 不需要先取 hartid 再查表。用户态的 tp 是线程指针，陷入时从 trapframe->kernel_tp
+ * 换回来，见 strap_vector.S。
+ *
+ * 任务可能在算出地址之后、访存之前被抢占并迁移到别的 hart：
+ * - this_cpu_read/write/add 关中断完成整次访问，可以在任何上下文中使用；
+ * - raw_cpu_* 和 this_cpu_ptr 由调用者保证不会中途换 hart（关中断、关抢占或持有自旋锁）。
+ */
+
+#define PER_CPU_SECTION ".data..percpu"
+
+#define DECLARE_PER_CPU(type, name) extern __typeof__(type) name
+#define DEFINE_PER_CPU(type, name) __attribute__((section(PER_CPU_SECTION))) __typeof__(type) name
+
+// 由链接脚本给出的模板范围
+extern char __per_cpu_start[], __per_cpu_end[];
+// 每个 hart 的副本相对模板的偏移，setup_per_cpu_areas 之前全为 0
+extern uint64 __per_cpu_offset[NCPU];
+
+#define SHIFT_PERCPU_PTR(ptr, offset) ((__typeof__(ptr))((uint64)(ptr) + (offset)))
+
+#define per_cpu_ptr(ptr, cpu) SHIFT_PERCPU_PTR(ptr, __per_cpu_offset[(cpu)])
+#define per_cpu(var, cpu) (*per_cpu_ptr(&(var), cpu))
+
+#define raw_cpu_ptr(ptr) SHIFT_PERCPU_PTR(ptr, read_tp())
+#define this_cpu_ptr(ptr) raw_cpu_ptr(ptr)
+
+#define raw_cpu_read(var) (*raw_cpu_ptr(&(var)))
+#define raw_cpu_write(var, val) (*raw_cpu_ptr(&(var)) = (val))
+#define raw_cpu_add(var, val) (*raw_cpu_ptr(&(var)) += (val))
+
+#define this_cpu_read(var)                                 \
+	({                                                 \
+		uint64 __flags = disable_irqsave();        \
+		__typeof__(var) __val = raw_cpu_read(var); \
+		enable_irqrestore(__flags);                \
+		__val;                                     \
+	})
+
+#define this_cpu_write(var, val)                    \
+	do {                                        \
+		uint64 __flags = disable_irqsave(); \
+		raw_cpu_write(var, val);            \
+		enable_irqrestore(__flags);         \
+	} while (0)
+
+#define this_cpu_add(var, val)                      \
+	do {                                        \
+		uint64 __flags = disable_irqsave(); \
+		raw_cpu_add(var, val);              \
+		enable_irqrestore(__flags);         \
+	} while (0)
+
+#define this_cpu_inc(var) this_cpu_add(var, 1)
+#define this_cpu_dec(var) this_cpu_add(var, -1)
+
+// 本 hart 的编号（即 hartid）。结果只在不会换 hart 时才保持有效
+DECLARE_PER_CPU(int32, cpu_number);
+#define smp_processor_id() raw_cpu_read(cpu_number)
+
+/*
+ * 启动 hart 在 kmalloc 可用之前使用模板本身（tp 为 0）
+ */
+void setup_per_cpu_areas(void);
+// 从核在 secondary_start 中换上自己的副本
+void percpu_init_hart(int32 cpu);
+
+#endif
@@ -55,7 +55,10 @@
 
 // irqs (interrupts). added @lab1_3
 #define CAUSE_MTIMER 0x8000000000000007
+// S 模式软件中断，早期由 M 态转发时钟中断，现在用于核间中断
 #define CAUSE_MTIMER_S_TRAP 0x8000000000000001
+#define CAUSE_STIMER_S_TRAP 0x8000000000000005
+#define CAUSE_SEXT_S_TRAP 0x8000000000000009
 
 //Supervisor interrupt-pending register
 #define SIP_SSIP (1L << 1)
@@ -73,12 +76,20 @@
 #define SSTATUS_UIE (1L << 0)   // User Interrupt Enable
 #define SSTATUS_SUM 0x00040000
 #define SSTATUS_FS 0x00006000
+// sstatus.FS 的四种状态，硬件在写浮点寄存器或 fcsr 后自动置为 Dirty
+#define SSTATUS_FS_OFF 0x00000000     // 任何浮点指令都触发非法指令异常
+#define SSTATUS_FS_INITIAL 0x00002000
+#define SSTATUS_FS_CLEAN 0x00004000
+#define SSTATUS_FS_DIRTY 0x00006000
 
 // Supervisor Interrupt Enable
 #define SIE_SEIE (1L << 9)  // external
 #define SIE_STIE (1L << 5)  // timer
 #define SIE_SSIE (1L << 1)  // software
 
+// Supervisor Counter Enable：允许用户态读取的计数器
+#define SCOUNTEREN_TM (1L << 1)  // time，vDSO 在用户态读取
+
 // Machine-mode Interrupt Enable
 #define MIE_MEIE (1L << 11)  // external
 #define MIE_MTIE (1L << 7)   // timer
@@ -144,14 +155,14 @@ static inline uint64 read_sp(void) {
   return x;
 }
 
-// read tp, the thread pointer, holding hartid (core number), the index into cpus[].
+// read tp, the thread pointer. in the kernel it holds this hart's per-CPU offset, see percpu.h
 static inline uint64 read_tp(void) {
   uint64 x;
   asm volatile("mv %0, tp" : "=r"(x));
   return x;
 }
 
-// write tp, the thread pointer, holding hartid (core number), the index into cpus[].
+// write tp, the thread pointer. only percpu_init_hart() sets it in the kernel
 static inline void write_tp(uint64 x) { asm volatile("mv tp, %0" : : "r"(x)); }
 
 typedef struct riscv_regs_t {
@@ -190,6 +201,10 @@ typedef struct riscv_regs_t {
 
 // following lines are added @lab2_1
 static inline void flush_tlb(void) { asm volatile("sfence.vma zero, zero"); }
+static inline void flush_tlb_page(uint64 va) { asm volatile("sfence.vma %0, zero" : : "r"(va) : "memory"); }
+// 需要通知其他 hart 的 TLB 刷新，见 kernel/sched/smp.c
+void flush_tlb_all(void);
+void flush_tlb_range(uint64* pagetable, uint64 start, uint64 end);
 #define PAGE_SIZE 4096  // bytes per page
 /* 
  * Mark parameters that must be page-aligned.
@@ -0,0 +1,34 @@
+#ifndef _RWSEM_H_
+#define _RWSEM_H_
+
+#include <kernel/sched/wait.h>
+#include <kernel/types.h>
+#include <kernel/util/spinlock.h>
+
+/*
+ * 读写信号量
+ *
+ * 允许多个读者同时持有，写者独占。有写者在等待时新的读者不再进入，避免写者饿死。
+ * 和 mutex 一样只能在进程上下文中使用，持有期间可以睡眠。
+ */
+struct rw_semaphore {
+	spinlock_t lock;             // 保护 count 和 writers_waiting
+	int32 count;                 // >0 为读者个数，-1 为写者持有，0 为空闲
+	int32 writers_waiting;
+	struct wait_queue_head wait; // 读者非排他等待，写者排他等待
+};
+
+#define __RWSEM_INITIALIZER(name) \
+	{.lock = {SPINLOCK_INIT}, .count = 0, .writers_waiting = 0, .wait = __WAIT_QUEUE_HEAD_INITIALIZER((name).wait)}
+#define DECLARE_RWSEM(name) struct rw_semaphore name = __RWSEM_INITIALIZER(name)
+
+void init_rwsem(struct rw_semaphore* sem);
+void down_read(struct rw_semaphore* sem);
+int32 down_read_trylock(struct rw_semaphore* sem);
+void up_read(struct rw_semaphore* sem);
+void down_write(struct rw_semaphore* sem);
+int32 down_write_trylock(struct rw_semaphore* sem);
+void up_write(struct rw_semaphore* sem);
+void downgrade_write(struct rw_semaphore* sem);
+
+#endif
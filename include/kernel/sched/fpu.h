@@ -0,0 +1,38 @@
+#ifndef _FPU_H_
+#define _FPU_H_
+
+#include <kernel/types.h>
+
+/*
+ * 用户态浮点现场的惰性保存与恢复
+ *
+ * 内核不使用浮点寄存器，在内核中 sstatus.FS 始终为 Off。
+ * - 陷入内核时记下用户态的 FS，切换走时只有 FS 为 Dirty 才保存 f0-f31/fcsr；
+ * - 返回用户态时，如果本 hart 的浮点寄存器里仍是该任务的现场就直接沿用，
+ *   否则以 FS=Off 返回，等任务第一次执行浮点指令触发非法指令异常时再恢复。
+ * 不使用浮点的任务在切换时没有任何额外开销。
+ */
+
+struct task_struct;
+
+/* 布局与 fpu.S 一致 */
+struct fp_state {
+	uint64 f[32];
+	uint64 fcsr;
+	uint64 fs;  // 用户态的 sstatus.FS，陷入内核时记录
+	int32 cpu;  // 浮点寄存器中装载着本任务现场的 hart，-1 表示没有
+};
+
+void __fpu_save(struct fp_state* state);
+void __fpu_restore(const struct fp_state* state);
+
+void fpu_init_hart(void);
+void fpu_init_task(struct task_struct* p);
+void fpu_copy_task(struct task_struct* dst, struct task_struct* src);
+void fpu_enter_kernel(struct task_struct* p);
+uint64 fpu_return_fs(struct task_struct* p);
+void fpu_flush(struct task_struct* p);
+int32 fpu_handle_first_use(struct task_struct* p);
+void fpu_release(struct task_struct* p);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef _KTHREAD_H_
+#define _KTHREAD_H_
+
+#include <kernel/sched/process.h>
+
+/*
+ * 内核线程：只在内核态运行，使用 init_mm 和自己的内核栈，
+ * 可以在任意位置调用 schedule() 睡眠，唤醒后从原处继续执行。
+ */
+
+typedef int32 (*kthread_fn_t)(void* arg);
+
+struct task_struct* kthread_create(kthread_fn_t fn, void* arg);
+struct task_struct* kthread_run(kthread_fn_t fn, void* arg);
+void kthread_init_context(struct task_struct* p, kthread_fn_t fn, void* arg);
+void kthread_exit(int32 ret) __attribute__((noreturn));
+void kthread_free(struct task_struct* p);
+
+#endif
@@ -5,13 +5,16 @@
 #include <kernel/util/spinlock.h>    // 自旋锁支持
 #include <kernel/types.h>
 
-#define PID_MAX 8192    // 最大PID值
+#define PID_MAX 32768   // 最大PID值（不含）
+#define PIDHASH_SHIFT 8 // pid 散列表 256 个桶
+#define PIDHASH_SIZE (1 << PIDHASH_SHIFT)
 
+struct task_struct;
 
 struct pid_manager {
     spinlock_t lock;   // 自旋锁
-    int32_t next_pid;          // 下一个待分配的PID
-    uint8_t pid_map[PID_MAX/8];// PID位图（含位操作对齐）
+    int32_t next_pid;          // 下一次从这里开始查找空闲 PID
+    uint64 pid_map[PID_MAX / 64]; // PID位图，按 64 位字查找
 };
 
 // 初始化PID管理器（需检查返回值）
@@ -23,4 +26,9 @@ pid_t pid_alloc(void);
 // 释放PID（返回错误码）
 void pid_free(pid_t pid);
 
-#endif
\ No newline at end of file
+// 把任务按 pid 挂入散列表，之后才能被 find_process_by_pid 找到
+void attach_pid(struct task_struct* p);
+// 从散列表中摘下，没有挂入时什么也不做
+void detach_pid(struct task_struct* p);
+
+#endif
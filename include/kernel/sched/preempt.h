@@ -0,0 +1,40 @@
+#ifndef _PREEMPT_H_
+#define _PREEMPT_H_
+
+#include <kernel/types.h>
+
+/*
+ * 抢占计数
+ *
+ * task_struct->preempt_count 不为 0 时当前任务不会被抢占。
+ * 低 8 位是 preempt_disable() 的嵌套深度，持有自旋锁期间也计入；
+ * HARDIRQ 部分在处理中断期间加上。计数回到 0 时检查 need_resched，
+ * 这是内核中让出 CPU 的安全点。
+ *
+ * 这里只能依赖 types.h：spinlock.h 会包含本文件，而 task_struct 的定义又依赖自旋锁。
+ */
+
+#define PREEMPT_OFFSET 0x00000001
+#define PREEMPT_MASK 0x000000ff
+#define HARDIRQ_OFFSET 0x00010000
+#define HARDIRQ_MASK 0x00ff0000
+
+int32 preempt_count(void);
+void preempt_count_add(int32 val);
+void preempt_count_sub(int32 val);
+
+void preempt_disable(void);
+void preempt_enable(void);
+void preempt_enable_no_resched(void);
+
+int32 need_resched(void);
+void preempt_schedule(void);
+void cond_resched(void);
+
+#define in_interrupt() (preempt_count() & HARDIRQ_MASK)
+#define in_atomic() (preempt_count() != 0)
+
+#define irq_enter() preempt_count_add(HARDIRQ_OFFSET)
+#define irq_exit() preempt_count_sub(HARDIRQ_OFFSET)
+
+#endif
@@ -3,11 +3,17 @@
 
 #include <kernel/riscv.h>
 #include <kernel/trapframe.h>
+#include <kernel/sched/fpu.h>
 #include <kernel/sched/signal.h>
+#include <kernel/sched/wait.h>
+#include <kernel/syscall/syscall_stat.h>
 #include <kernel/util/list.h>
+#include <kernel/util/rbtree.h>
 
 struct fdtable;
 struct fs_struct;
+struct sighand_struct;
+struct completion;
 
 /* Linux内核进程flags定义表 */
 
@@ -41,6 +47,26 @@ struct fs_struct;
 #define PF_FREEZER_SKIP 0x40000000   // 跳过冻结
 #define PF_SUSPEND_TASK 0x80000000   // 系统挂起任务
 
+/* clone 标志，低 8 位是子进程退出时发给父进程的信号 */
+#define CSIGNAL 0x000000ff
+#define CLONE_VM 0x00000100             // 共享地址空间
+#define CLONE_FS 0x00000200             // 共享根目录、当前目录和 umask
+#define CLONE_FILES 0x00000400          // 共享文件描述符表
+#define CLONE_SIGHAND 0x00000800        // 共享信号处理函数表
+#define CLONE_PIDFD 0x00001000
+#define CLONE_PTRACE 0x00002000
+#define CLONE_VFORK 0x00004000
+#define CLONE_PARENT 0x00008000         // 与调用者有相同的父进程
+#define CLONE_THREAD 0x00010000         // 加入调用者的线程组
+#define CLONE_NEWNS 0x00020000
+#define CLONE_SYSVSEM 0x00040000
+#define CLONE_SETTLS 0x00080000         // tp 设为 tls 参数
+#define CLONE_PARENT_SETTID 0x00100000  // 把子线程 tid 写到父进程的 *ptid
+#define CLONE_CHILD_CLEARTID 0x00200000 // 子线程退出时清零 *ctid 并 futex 唤醒
+#define CLONE_DETACHED 0x00400000
+#define CLONE_UNTRACED 0x00800000
+#define CLONE_CHILD_SETTID 0x01000000   // 把子线程 tid 写到子进程的 *ctid
+
 /* 组合标志 */
 #define PF_MEMALLOC_FLAGS (PF_MEMALLOC | PF_MEMALLOC_NOFS) // 内存分配相关标志
 
@@ -95,6 +121,53 @@ struct fs_struct;
 /* 状态掩码 */
 #define TASK_STATE_TO_CHAR_STR "RSDTtXZPI" // 状态显示字符
 
+/* task->signal_flags */
+#define SIGNAL_GROUP_EXIT 0x00000004 // 线程组正在整体退出，记在主线程上，见 do_group_exit
+
+/* wait4/waitid 的 options，与 Linux 一致 */
+#define WNOHANG 0x00000001     // 没有可回收的子进程时立即返回
+#define WUNTRACED 0x00000002
+#define WSTOPPED WUNTRACED
+#define WEXITED 0x00000004     // 等待已退出的子进程，wait4 总是带上
+#define WCONTINUED 0x00000008
+#define WNOWAIT 0x01000000     // 只取状态，子进程留给下一次 wait
+#define __WNOTHREAD 0x20000000 // 只等调用线程自己的子进程
+#define __WALL 0x40000000      // 不论退出信号是什么都等
+#define __WCLONE 0x80000000    // 只等退出信号不是 SIGCHLD 的子进程
+
+/* waitid 的 idtype */
+#define P_ALL 0
+#define P_PID 1
+#define P_PGID 2
+
+/* SIGCHLD 的 si_code */
+#define CLD_EXITED 1 // 正常退出
+#define CLD_KILLED 2 // 被信号杀死
+#define CLD_DUMPED 3
+
+/*
+ * wait4 返回的资源使用情况，布局与用户态的 struct rusage 一致。
+ * 目前只统计运行时间，其余字段为 0。
+ */
+struct rusage {
+	struct timeval ru_utime;
+	struct timeval ru_stime;
+	int64 ru_maxrss;
+	int64 ru_ixrss;
+	int64 ru_idrss;
+	int64 ru_isrss;
+	int64 ru_minflt;
+	int64 ru_majflt;
+	int64 ru_nswap;
+	int64 ru_inblock;
+	int64 ru_oublock;
+	int64 ru_msgsnd;
+	int64 ru_msgrcv;
+	int64 ru_nsignals;
+	int64 ru_nvcsw;
+	int64 ru_nivcsw;
+};
+
 // types of a segment
 enum fork_choice {
 	FORK_MAP = 0, // 直接映射代码段
@@ -102,11 +175,37 @@ enum fork_choice {
 	FORK_COW,
 };
 
+/*
+ * 调度实体：公平调度类按 vruntime 排序，运行时间记账对所有调度类都有效。
+ * 时间单位均为纳秒。
+ */
+struct sched_entity {
+	struct rb_node run_node;      // cfs_rq->tasks_timeline 中的节点
+	uint32 weight;                // 由 nice 值换算的权重，nice 0 为 NICE_0_LOAD
+	uint64 vruntime;              // 按权重缩放后的虚拟运行时间
+	uint64 exec_start;            // 上一次记账的时刻
+	uint64 sum_exec_runtime;      // 累计实际运行时间
+	uint64 prev_sum_exec_runtime; // 本次被选中运行时的 sum_exec_runtime
+	uint64 nr_switches;           // 被调度运行的次数
+};
+
+/*
+ * 内核态切换时保存的寄存器，只有 callee-saved 的部分，布局与 switch.S 一致
+ */
+struct context {
+	uint64 ra;
+	uint64 sp;
+	uint64 s[12];
+};
+
+struct sched_class;
+
 struct task_struct {
 	uint64 kstack; // 分配一个页面当内核栈，注意内核栈的范围是[kstack-PAGE_SIZE,
 	               // kstack)
-	struct trapframe* trapframe;
-	struct trapframe* ktrapframe;
+	struct trapframe* trapframe; // 用户态现场，内核线程为 NULL
+	struct context context;      // 内核态现场，由 __switch_to 保存和恢复
+	struct fp_state fpstate;     // 用户态浮点现场，惰性保存和恢复
 
 	struct mm_struct* mm;
 	// struct mm_struct *active_mm;
@@ -115,20 +214,45 @@ struct task_struct {
 	struct fs_struct* fs;
 	struct fdtable* fdtable;
 
+	atomic_t usage;             // 引用计数，见 get_task_struct
+	struct list_head tasks;     // task_list 中的节点
+	struct list_head pid_chain; // pid 散列桶中的节点，见 attach_pid
+
 	// process id
-	pid_t pid;
+	pid_t pid;  // 线程 id
+	pid_t tgid; // 线程组 id，即主线程的 pid，getpid() 返回它
+	struct task_struct* group_leader;
+	struct list_head thread_group; // 同一线程组的线程，表头在 group_leader 中
+	int32* set_child_tid;          // CLONE_CHILD_SETTID 的用户地址
+	int32* clear_child_tid;        // 退出时清零并 futex 唤醒，见 set_tid_address
+	struct completion* vfork_done; // CLONE_VFORK 的父进程在上面等待，exec 或退出时完成
 	// process state
 	uint32 state;
 	uint32 flags;
+	int32 preempt_count; // 不为 0 时不可抢占，见 preempt.h
 	// parent process
 	struct task_struct* parent;
 	struct list_head children;
 	struct list_head sibling;
+	struct wait_queue_head wait_chldexit; // wait4/waitid 在主线程的这个队列上等待子进程退出
 	// ready queue
 	struct list_head ready_queue_node;
+	int32 prio;        // 调度优先级，见 sched.h 中的 MAX_PRIO
+	int32 static_prio; // nice 值对应的优先级
+	int32 policy;      // SCHED_NORMAL/SCHED_FIFO/...
+	int32 rt_priority; // 实时优先级 1..99，非实时任务为 0
+	int32 cpu;    // 所在（或最近一次所在）的运行队列
+	int32 on_rq;  // 是否在运行队列中等待
+	int32 on_cpu; // 正在某个 hart 上运行，或者还没有完成切换出去
+	const struct sched_class* sched_class;
+	struct sched_entity se;
 
 	// accounting. added @lab3_3
 	int32 tick_count;
+	// 本进程的系统调用次数与耗时汇总
+	struct syscall_stat syscall_stat;
+	// 按系统调用号的次数与耗时，只由本任务写入，task_struct 释放时一并释放
+	struct syscall_count* syscall_counts;
 
 	// int32 sem_index;
 
@@ -138,10 +262,14 @@ struct task_struct {
 	sigset_t pending;                // Pending signals
 	sigset_t blocked;                // Blocked signals (signal mask)
 	sigset_t saved_sigmask;          // Saved signal mask for sigsuspend
-	struct sigaction sighand[_NSIG]; // Signal handlers
+	struct sighand_struct* sighand;  // Signal handlers, shared with CLONE_SIGHAND
 
 	uint64 signal_flags; // Signal-related flags
-	int32 exit_signal;            // Signal delivered to parent on exit
+	int32 exit_signal;            // Signal delivered to parent on exit, -1 for threads
+	int32 exit_state;             // EXIT_ZOMBIE/EXIT_DEAD，由 tasklist_lock 保护
+	int32 exit_code;              // wait 状态：正常退出为 (status & 0xff) << 8，被信号杀死为信号值
+	uint64 exit_runtime;          // 已退出线程的运行时间，累加在主线程上（纳秒）
+	uint64 children_runtime;      // 已回收的子进程及其后代的运行时间（纳秒）
 
 	uid_t uid;
 	uid_t euid;
@@ -149,15 +277,35 @@ struct task_struct {
 	gid_t egid;
 	// 目前还用不上这些字段
 };
+// 保护 task_list、pid 散列表以及 children/sibling 与 thread_group 链表
+extern spinlock_t tasklist_lock;
+extern struct list_head task_list;
+// 孤儿进程过继给它，即 init
+extern struct task_struct* child_reaper;
+
+// 遍历所有任务，调用者持有 tasklist_lock
+#define for_each_process(p) list_for_each_entry(p, &task_list, tasks)
+
+static inline int32 thread_group_leader(struct task_struct* p) { return p->group_leader == p; }
+// 线程组中除主线程外没有其他线程，调用者持有 tasklist_lock
+static inline int32 thread_group_empty(struct task_struct* p) { return list_empty(&p->group_leader->thread_group); }
+// 线程组中的下一个线程，绕回到主线程时表头就是主线程自己的 thread_group
+static inline struct task_struct* next_thread(struct task_struct* p) {
+	return list_entry(p->thread_group.next, struct task_struct, thread_group);
+}
+
 struct task_struct* alloc_init_task();
 
 struct task_struct* alloc_process();
 int32 free_process(struct task_struct* proc);
+void release_task(struct task_struct* p);
+void mm_release(struct task_struct* tsk);
+void exec_mmap(struct mm_struct* mm);
 
 // fork a child from parent
 int32 do_fork(struct task_struct* parent);
 int32 do_exec(uint64 path);
-ssize_t do_wait(int32 pid);
+int64 kernel_wait4(pid_t pid, int32* wstatus, int32 options, struct rusage* ru);
 int32 current_is_in_group(gid_t gid);
 
 /**
@@ -1,14 +1,151 @@
 #ifndef _SCHED_H_
 #define _SCHED_H_
 
+#include <kernel/clocksource.h>
+#include <kernel/percpu.h>
 #include <kernel/sched/process.h>
-// riscv-pke kernel supports at most 32 processes
-#define NPROC 32
-#define TIME_SLICE_LEN  2
-extern struct task_struct* current_percpu[NCPU];
-#define CURRENT (current_percpu[read_tp()])
+#include <kernel/sched/smp.h>
+#include <kernel/util/list.h>
+#include <kernel/util/spinlock.h>
+DECLARE_PER_CPU(struct task_struct*, current_percpu);
+#define CURRENT this_cpu_read(current_percpu)
 #define current current_task()
 
+/*
+ * 优先级：数值越小优先级越高。
+ * [0, MAX_RT_PRIO) 由实时调度类按优先级 FIFO 运行；
+ * [MAX_RT_PRIO, MAX_PRIO) 对应 nice -20..19，由公平调度类按 vruntime 运行。
+ */
+#define MAX_RT_PRIO 100
+#define MAX_PRIO 140
+#define DEFAULT_PRIO 120
+#define MIN_NICE -20
+#define MAX_NICE 19
+#define NICE_TO_PRIO(nice) ((nice) + DEFAULT_PRIO)
+#define PRIO_TO_NICE(prio) ((prio) - DEFAULT_PRIO)
+#define rt_prio(prio) ((prio) < MAX_RT_PRIO)
+#define task_nice(p) PRIO_TO_NICE((p)->static_prio)
+
+/* 调度策略 */
+#define SCHED_NORMAL 0
+#define SCHED_FIFO 1 // 同优先级先来先运行，直到阻塞、让出或被更高优先级抢占
+#define SCHED_RR 2   // 同优先级之间按 sysctl_sched_rr_timeslice 轮转
+#define SCHED_BATCH 3
+#define SCHED_IDLE 5 // 公平调度类中权重最低
+#define rt_policy(policy) ((policy) == SCHED_FIFO || (policy) == SCHED_RR)
+
+#define MAX_USER_RT_PRIO 100 // 用户可见的实时优先级为 1..99，数值越大越优先
+#define WEIGHT_IDLEPRIO 3
+
+struct sched_param {
+	int32 sched_priority;
+};
+
+/* setpriority/getpriority 的 which 参数 */
+#define PRIO_PROCESS 0
+#define PRIO_PGRP 1
+#define PRIO_USER 2
+
+#define NICE_0_LOAD 1024 // nice 0 任务的权重
+
+#define SCHED_LB_INTERVAL 4 // 每隔多少个时钟节拍做一次周期性负载均衡
+#define RT_BITMAP_WORDS ((MAX_RT_PRIO + 63) / 64)
+
+// 调度器时钟，单位纳秒
+static inline uint64 sched_clock(void) { return clocksource_read_ns(); }
+
+/*
+ * 公平调度的时间片参数（纳秒），见 config.h 中的 CONFIG_SCHED_*
+ */
+extern uint64 sysctl_sched_latency;
+extern uint64 sysctl_sched_min_granularity;
+extern uint64 sysctl_sched_wakeup_granularity;
+extern uint64 sysctl_sched_rr_timeslice;
+
+struct rt_rq {
+	uint32 nr_running;
+	uint64 bitmap[RT_BITMAP_WORDS]; // 第 i 位表示 queue[i] 非空
+	struct list_head queue[MAX_RT_PRIO];
+};
+
+struct cfs_rq {
+	uint32 nr_running;
+	uint64 load;                          // 队列中任务的权重之和
+	uint64 min_vruntime;                  // 单调不减，唤醒和新建任务以它为基准放置
+	struct rb_root_cached tasks_timeline; // 按 vruntime 排序
+};
+
+/*
+ * 每个 hart 一个运行队列，正在运行的任务 (curr) 不在队列中
+ */
+struct rq {
+	spinlock_t lock;
+	int32 cpu;
+	uint32 nr_running; // 队列中等待运行的任务数（各调度类之和）
+	struct rt_rq rt;
+	struct cfs_rq cfs;
+	struct task_struct* curr;
+	struct task_struct* idle;
+	int32 need_resched; // 在下一个调度点让出 curr
+
+	uint64 tick;          // 本 hart 的时钟节拍数
+	uint64 next_balance;  // 下一次周期性负载均衡的节拍
+	uint64 nr_switches;
+	uint64 nr_migrations; // 被迁入本队列的任务数
+} __attribute__((aligned(64)));
+
+DECLARE_PER_CPU(struct rq, runqueues);
+#define cpu_rq(cpu) per_cpu_ptr(&runqueues, cpu)
+#define this_rq() this_cpu_ptr(&runqueues)
+
+/* enqueue_task 的 flags */
+#define ENQUEUE_WAKEUP 0x01   // 睡眠后被唤醒
+#define ENQUEUE_INITIAL 0x02  // 新创建的任务
+#define ENQUEUE_MIGRATED 0x04 // 从其他 hart 迁入
+#define ENQUEUE_PREEMPTED 0x08 // 正在运行时被抢占
+/* dequeue_task 的 flags */
+#define DEQUEUE_MIGRATE 0x01
+
+/*
+ * 调度类：各回调都在持有 rq->lock 时调用。
+ * 运行队列只保存等待运行的任务，pick_next_task 只选不出队。
+ */
+struct sched_class {
+	void (*enqueue_task)(struct rq* rq, struct task_struct* p, int32 flags);
+	void (*dequeue_task)(struct rq* rq, struct task_struct* p, int32 flags);
+	struct task_struct* (*pick_next_task)(struct rq* rq);
+	// 负载均衡时选出最适合迁走的任务（仍在队列中）
+	struct task_struct* (*pick_migrate_task)(struct rq* rq);
+	// 给 rq->curr 记账
+	void (*update_curr)(struct rq* rq);
+	void (*task_tick)(struct rq* rq, struct task_struct* curr);
+	// 同一调度类的 p 入队后，判断它是否应抢占 rq->curr
+	void (*check_preempt_curr)(struct rq* rq, struct task_struct* p);
+};
+
+extern const struct sched_class rt_sched_class;
+extern const struct sched_class fair_sched_class;
+extern const struct sched_class idle_sched_class;
+
+// 其他 hart 上的 curr 要等它自己到达调度点，用核间中断催它
+static inline void resched_curr(struct rq* rq) {
+	WRITE_ONCE(rq->need_resched, 1);
+	if (rq->cpu != smp_processor_id()) smp_send_reschedule(rq->cpu);
+}
+
+/*
+ * p 正在 rq 所在的 hart 上运行，或者已被换下但还在使用自己的内核栈。
+ * 这样的任务即使在队列中也不能迁移，调用者持有 rq->lock
+ */
+static inline int32 task_running(struct rq* rq, struct task_struct* p) {
+	return p == rq->curr || READ_ONCE(p->on_cpu);
+}
+
+void init_rt_rq(struct rt_rq* rt_rq);
+void init_cfs_rq(struct cfs_rq* cfs_rq);
+uint32 sched_prio_to_weight(int32 prio);
+uint64 account_exec_runtime(struct task_struct* curr);
+
 static inline struct task_struct* current_task() {
 		return CURRENT;
 }
@@ -16,12 +153,32 @@ static inline struct task_struct* current_task() {
 void init_scheduler();
 void insert_to_ready_queue( struct task_struct* proc );
 struct task_struct *alloc_empty_process();
+void free_empty_process(struct task_struct* p);
 
-void switch_to(struct task_struct*);
+void ret_to_user(struct task_struct* proc);
+struct context* __switch_to(struct context* prev, struct context* next);
+struct task_struct* schedule_tail(struct context* prev);
 
 void schedule();
+void scheduler_tick(void);
+void sched_fork(struct task_struct* p, struct task_struct* parent);
+void wake_up_new_task(struct task_struct* p);
+int32 wake_up_process(struct task_struct* p);
+int32 wake_up_state(struct task_struct* p, uint32 state);
+int32 set_user_nice(struct task_struct* p, int32 nice);
+int32 sched_setscheduler(struct task_struct* p, int32 policy, const struct sched_param* param);
+void preempt_schedule(void);
+void sched_yield(void);
 struct task_struct *find_process_by_pid(pid_t pid);
 
+/*
+ * task_struct 的引用计数：find_process_by_pid 返回的任务带着一个引用，
+ * 用完后 put_task_struct。任务被回收时只摘下 pid 并放弃创建时的引用，
+ * 结构本身在最后一个引用放弃时释放
+ */
+static inline void get_task_struct(struct task_struct *p) { atomic_inc(&p->usage); }
+void put_task_struct(struct task_struct *p);
+
 /**
  * set_current_task - Explicitly set the current task for the calling CPU
  * @task: Task to set as current
@@ -31,8 +188,7 @@ struct task_struct *find_process_by_pid(pid_t pid);
  * initialization or special operations like setting up the init task.
  */
 static inline void set_current_task(struct task_struct* task) {
-    int32 hartid = read_tp();
-    current_percpu[hartid] = task;
+    this_cpu_write(current_percpu, task);
 }
 
 
@@ -2,6 +2,8 @@
 #define _SIGNAL_H
 
 #include <kernel/types.h>
+#include <kernel/util/atomic.h>
+#include <kernel/util/spinlock.h>
 
 /* Standard POSIX signal numbers */
 #define SIGHUP     1  // Hangup
@@ -100,6 +102,16 @@ struct sigaction {
     void    (*sa_restorer)(void); /* Obsolete field for ABI compatibility */
 };
 
+/*
+ * Signal handler table, shared by CLONE_SIGHAND tasks.
+ * count is the number of tasks using it; action[] is protected by siglock.
+ */
+struct sighand_struct {
+    atomic_t count;
+    spinlock_t siglock;
+    struct sigaction action[_NSIG];
+};
+
 /* Stack for alternate signal handling */
 typedef struct sigaltstack {
     void *ss_sp;     /* Stack base or pointer */
@@ -136,6 +148,12 @@ struct sigevent {
 
 
 
+/* Signal handler tables */
+struct sighand_struct *sighand_alloc(void);
+struct sighand_struct *sighand_copy(struct sighand_struct *old);
+void sighand_get(struct sighand_struct *sighand);
+void sighand_put(struct sighand_struct *sighand);
+
 /* Core signal operations */
 int32 do_send_signal(pid_t pid, int32 sig);
 int32 do_sigaction(int32 sig, const struct sigaction *act, struct sigaction *oldact);
@@ -144,6 +162,12 @@ int32 do_kill(pid_t pid, int32 sig);
 int32 do_sigsuspend(const sigset_t *mask);
 void do_signal_delivery(void);
 
+struct task_struct;
+/* Nonzero if p has a pending signal that is not blocked */
+int32 signal_pending(struct task_struct *p);
+/* Queue sig on a known task, callable with tasklist_lock held */
+int32 send_sig(int32 sig, struct task_struct *p);
+
 /* Signal set operations */
 int32 sigemptyset(sigset_t *set);
 int32 sigfillset(sigset_t *set);
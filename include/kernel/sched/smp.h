@@ -0,0 +1,43 @@
+#ifndef _SMP_H_
+#define _SMP_H_
+
+#include <kernel/config.h>
+#include <kernel/types.h>
+
+/*
+ * 多核启动与核间中断 (IPI)
+ *
+ * hartid 直接作为 cpu 编号使用，只有设备树中 hartid < NCPU 的 hart 会通过 SBI HSM 启动。
+ * IPI 经 SBI IPI 扩展设置目标 hart 的 SSIP，目标在软件中断中按待处理位分发：
+ * - IPI_RESCHEDULE：目标 rq 的 need_resched 已经置位，只需要让它尽快到达调度点；
+ * - IPI_CALL_FUNC：在目标 hart 的中断上下文中执行函数，TLB 击落也通过它完成。
+ *
+ * sched.h 会包含本文件，这里不能依赖调度器的头文件。
+ */
+
+#define IPI_RESCHEDULE 0
+#define IPI_CALL_FUNC 1
+
+typedef void (*smp_call_func_t)(void* info);
+
+extern volatile uint64 cpu_online_mask;
+extern int32 boot_hartid;
+
+#define cpu_online(cpu) ((cpu_online_mask >> (cpu)) & 1)
+#define for_each_online_cpu(cpu) \
+	for ((cpu) = 0; (cpu) < NCPU; (cpu)++) \
+		if (!cpu_online(cpu)) {} else
+
+int32 smp_claim_boot_hart(int32 hartid);
+void smp_boot_secondary_harts(uint64 dtb);
+void set_cpu_online(int32 cpu);
+int32 num_online_cpus(void);
+
+void smp_send_reschedule(int32 cpu);
+int32 smp_call_function_single(int32 cpu, smp_call_func_t func, void* info, int32 wait);
+void smp_call_function_many(uint64 mask, smp_call_func_t func, void* info, int32 wait);
+void smp_call_function(smp_call_func_t func, void* info, int32 wait);
+void on_each_cpu(smp_call_func_t func, void* info, int32 wait);
+void handle_ipi(void);
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef _WAIT_H_
+#define _WAIT_H_
+
+#include <kernel/timer.h>
+#include <kernel/types.h>
+#include <kernel/util/list.h>
+#include <kernel/util/spinlock.h>
+
+/*
+ * 等待队列
+ *
+ * 等待者把自己挂到 wait_queue_head 上、设置好睡眠状态后再检查条件，条件不成立才调用 schedule()；
+ * 唤醒者先让条件成立再 wake_up()，两边都在队列锁内操作，不会丢失唤醒。
+ * 排他等待者挂在队尾，一次 wake_up() 只唤醒一个，非排他等待者全部唤醒。
+ *
+ * 这里不能包含 sched.h：task_struct 中嵌有 wait_queue_head。
+ */
+
+struct task_struct;
+struct wait_queue_entry;
+
+typedef int32 (*wait_queue_func_t)(struct wait_queue_entry* wq_entry, uint32 mode, int32 flags, void* key);
+
+#define WQ_FLAG_EXCLUSIVE 0x01
+
+struct wait_queue_entry {
+	uint32 flags;
+	struct task_struct* private;
+	wait_queue_func_t func;
+	struct list_head entry;
+};
+
+struct wait_queue_head {
+	spinlock_t lock;
+	struct list_head head;
+};
+
+typedef struct wait_queue_head wait_queue_head_t;
+typedef struct wait_queue_entry wait_queue_entry_t;
+
+#define __WAIT_QUEUE_HEAD_INITIALIZER(name) {.lock = {SPINLOCK_INIT}, .head = {&(name).head, &(name).head}}
+#define DECLARE_WAIT_QUEUE_HEAD(name) struct wait_queue_head name = __WAIT_QUEUE_HEAD_INITIALIZER(name)
+
+// 唤醒时的状态掩码
+#define TASK_NORMAL (TASK_INTERRUPTIBLE | TASK_UNINTERRUPTIBLE)
+
+static inline void init_waitqueue_head(struct wait_queue_head* wq_head) {
+	spinlock_init(&wq_head->lock);
+	INIT_LIST_HEAD(&wq_head->head);
+}
+
+// 不加锁的快速检查，调用者需要保证条件的修改对等待者可见
+static inline int32 waitqueue_active(struct wait_queue_head* wq_head) { return !list_empty(&wq_head->head); }
+
+int32 default_wake_function(struct wait_queue_entry* wq_entry, uint32 mode, int32 flags, void* key);
+int32 autoremove_wake_function(struct wait_queue_entry* wq_entry, uint32 mode, int32 flags, void* key);
+
+void init_wait_entry(struct wait_queue_entry* wq_entry, int32 flags);
+void add_wait_queue(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry);
+void add_wait_queue_exclusive(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry);
+void remove_wait_queue(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry);
+
+void prepare_to_wait(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry, int32 state);
+void prepare_to_wait_exclusive(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry, int32 state);
+int64 prepare_to_wait_event(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry, int32 state);
+void finish_wait(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry);
+
+void __wake_up(struct wait_queue_head* wq_head, uint32 mode, int32 nr_exclusive, void* key);
+void __wake_up_locked(struct wait_queue_head* wq_head, uint32 mode, int32 nr_exclusive, void* key);
+
+#define wake_up(x) __wake_up(x, TASK_NORMAL, 1, NULL)
+#define wake_up_nr(x, nr) __wake_up(x, TASK_NORMAL, nr, NULL)
+#define wake_up_all(x) __wake_up(x, TASK_NORMAL, 0, NULL)
+#define wake_up_interruptible(x) __wake_up(x, TASK_INTERRUPTIBLE, 1, NULL)
+#define wake_up_interruptible_all(x) __wake_up(x, TASK_INTERRUPTIBLE, 0, NULL)
+
+/*
+ * 等待 condition 成立。timeout 以节拍为单位，MAX_SCHEDULE_TIMEOUT 表示不限时。
+ * 结果：条件成立时为剩余节拍数（至少为 1），超时为 0，可中断的等待被信号打断为 -EINTR。
+ */
+#define ___wait_event(wq_head, condition, state, exclusive, timeout)                       \
+	({                                                                                 \
+		struct wait_queue_entry __wq_entry;                                        \
+		int64 __ret = (timeout);                                                   \
+		init_wait_entry(&__wq_entry, (exclusive) ? WQ_FLAG_EXCLUSIVE : 0);         \
+		for (;;) {                                                                 \
+			int64 __intr = prepare_to_wait_event(&(wq_head), &__wq_entry, state); \
+			if (condition) {                                                   \
+				if (!__ret) __ret = 1;                                     \
+				break;                                                     \
+			}                                                                  \
+			if (__intr) {                                                      \
+				__ret = __intr;                                            \
+				break;                                                     \
+			}                                                                  \
+			if (!__ret) break;                                                 \
+			__ret = schedule_timeout(__ret);                                   \
+		}                                                                          \
+		finish_wait(&(wq_head), &__wq_entry);                                      \
+		__ret;                                                                     \
+	})
+
+#define wait_event(wq_head, condition)                                                     \
+	do {                                                                               \
+		if (condition) break;                                                      \
+		___wait_event(wq_head, condition, TASK_UNINTERRUPTIBLE, 0, MAX_SCHEDULE_TIMEOUT); \
+	} while (0)
+
+#define wait_event_exclusive(wq_head, condition)                                           \
+	do {                                                                               \
+		if (condition) break;                                                      \
+		___wait_event(wq_head, condition, TASK_UNINTERRUPTIBLE, 1, MAX_SCHEDULE_TIMEOUT); \
+	} while (0)
+
+// 返回 0 表示条件成立，-EINTR 表示被信号打断
+#define wait_event_interruptible(wq_head, condition)                                       \
+	({                                                                                 \
+		int64 __r = 0;                                                             \
+		if (!(condition))                                                          \
+			__r = ___wait_event(wq_head, condition, TASK_INTERRUPTIBLE, 0,      \
+					    MAX_SCHEDULE_TIMEOUT);                          \
+		__r < 0 ? __r : 0;                                                         \
+	})
+
+#define wait_event_interruptible_exclusive(wq_head, condition)                             \
+	({                                                                                 \
+		int64 __r = 0;                                                             \
+		if (!(condition))                                                          \
+			__r = ___wait_event(wq_head, condition, TASK_INTERRUPTIBLE, 1,      \
+					    MAX_SCHEDULE_TIMEOUT);                          \
+		__r < 0 ? __r : 0;                                                         \
+	})
+
+// 返回剩余节拍数（条件成立时至少为 1），超时返回 0
+#define wait_event_timeout(wq_head, condition, timeout)                                    \
+	({                                                                                 \
+		int64 __r = (timeout);                                                     \
+		if (condition)                                                             \
+			__r = __r ? __r : 1;                                               \
+		else                                                                       \
+			__r = ___wait_event(wq_head, condition, TASK_UNINTERRUPTIBLE, 0, __r); \
+		__r;                                                                       \
+	})
+
+// 在 wait_event_timeout 的基础上，被信号打断时返回 -EINTR
+#define wait_event_interruptible_timeout(wq_head, condition, timeout)                      \
+	({                                                                                 \
+		int64 __r = (timeout);                                                     \
+		if (condition)                                                             \
+			__r = __r ? __r : 1;                                               \
+		else                                                                       \
+			__r = ___wait_event(wq_head, condition, TASK_INTERRUPTIBLE, 0, __r);  \
+		__r;                                                                       \
+	})
+
+#endif
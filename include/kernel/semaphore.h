@@ -7,8 +7,9 @@
 
 typedef struct semaphore_t {
   int32 isActive;
-  int32 value;
-  struct task_struct *wait_queue;
+  int32 value;     // 由 lock 保护
+  spinlock_t lock;
+  struct wait_queue_head wait; // 等待 value > 0 的任务
   int32 pid; // 系统信号量为-1
 } semaphore;
 
@@ -3,4 +3,6 @@
 struct linux_dirent;
 struct dir_context;
 struct file;
-struct vfsmount;
\ No newline at end of file
+struct vfsmount;
+struct sched_param;
+struct rusage;
\ No newline at end of file
@@ -23,6 +23,7 @@ struct syscall_entry {
 
 /* Syscall dispatcher */
 long do_syscall(long syscall_num, long a0, long a1, long a2, long a3, long a4, long a5);
+const char* syscall_name(int64 syscall_num);
 
 /* File-related syscalls */
 int64 sys_openat(int32 dirfd, const char* pathname, int32 flags, mode_t mode);
@@ -35,11 +36,27 @@ int64 sys_getdents64(int32 fd, void* user_buf, size_t count);
 
 /* Process-related syscalls */
 int64 sys_exit(int32 status);
+int64 sys_exit_group(int32 status);
 int64 sys_getpid(void);
+int64 sys_gettid(void);
+int64 sys_set_tid_address(int32* tidptr);
 int64 sys_getppid(void);
 int64 sys_clone(uint64 flags, uint64 stack, uint64 ptid, uint64 tls, uint64 ctid);
 int64 sys_execve(const char* filename, const char* const argv[], const char* const envp[]);
-//int64 sys_wait4(pid_t pid, int32* wstatus, int32 options, struct rusage* rusage);
+int64 sys_setpriority(int32 which, int32 who, int32 niceval);
+int64 sys_getpriority(int32 which, int32 who);
+int64 sys_sched_setparam(pid_t pid, const struct sched_param* param);
+int64 sys_sched_setscheduler(pid_t pid, int32 policy, const struct sched_param* param);
+int64 sys_sched_getscheduler(pid_t pid);
+int64 sys_sched_getparam(pid_t pid, struct sched_param* param);
+int64 sys_sched_yield(void);
+int64 sys_sched_get_priority_max(int32 policy);
+int64 sys_sched_get_priority_min(int32 policy);
+int64 sys_sched_rr_get_interval(pid_t pid, struct timespec* interval);
+int64 sys_getcpu(uint32* cpu, uint32* node, void* unused);
+int64 sys_futex(uint32* uaddr, int32 op, uint32 val, uint64 timeout_or_val2, uint32* uaddr2, uint32 val3);
+int64 sys_wait4(pid_t pid, int32* wstatus, int32 options, struct rusage* rusage);
+int64 sys_waitid(int32 idtype, pid_t id, void* infop, int32 options, struct rusage* rusage);
 
 /* Memory-related syscalls */
 int64 sys_brk(void* addr);
@@ -53,8 +70,15 @@ int64 sys_time(time_t* tloc);
 int64 sys_nanosleep(const struct timespec* req, struct timespec* rem);
 int64 sys_gettimeofday(struct timeval* tv, struct timezone* tz);
 int64 sys_clock_gettime(clockid_t clk_id, struct timespec* tp);
+int64 sys_clock_getres(clockid_t clk_id, struct timespec* res);
+int64 sys_clock_settime(clockid_t clk_id, const struct timespec* tp);
+int64 sys_clock_nanosleep(clockid_t clk_id, int32 flags, const struct timespec* req, struct timespec* rem);
+int64 sys_timerfd_create(clockid_t clockid, int32 flags);
+int64 sys_timerfd_settime(int32 fd, int32 flags, const struct itimerspec* new_value, struct itimerspec* old_value);
+int64 sys_timerfd_gettime(int32 fd, struct itimerspec* curr_value);
 
 /* Misc syscalls */
+int64 sys_syslog(int32 type, char* buf, int32 len);
 int64 sys_getrandom(void* buf, size_t buflen, uint32 flags);
 int64 sys_yield(void);
 int64 sys_time(time_t* tloc);
@@ -66,13 +90,20 @@ int32 do_getdents64(int32 fd, struct linux_dirent* dirp, size_t count);
 int32 do_mount(const char* dev_name, const char* path, const char* fstype, uint64 flags,const void* data);
 /* Unmount operations */
 int32 do_umount(struct vfsmount* mnt, int32 flags);
-int64 do_exit(int32 status);
+void do_exit(int32 code) __attribute__((noreturn));
+void do_group_exit(int32 code) __attribute__((noreturn));
+int64 do_setpriority(int32 which, int32 who, int32 niceval);
+int64 do_getpriority(int32 which, int32 who);
+int64 do_sched_setscheduler(pid_t pid, int32 policy, const struct sched_param* param);
 int64 do_clone(uint64 flags, uint64 stack, uint64 ptid, uint64 tls, uint64 ctid);
 int64 do_mmap(void* addr, size_t length, int32 prot, int32 flags, int32 fd, off_t offset);
 int64 do_time(time_t* tloc);
 int64 do_read(int32 fd, void *buf, size_t count);
 int32 do_gettimeofday(struct timeval* tv);
 int32 do_clock_gettime(clockid_t which_clock, struct timespec* tp);
+int32 do_timerfd_create(clockid_t clockid, int32 flags);
+int32 do_timerfd_settime(int32 fd, int32 flags, const struct itimerspec* new, struct itimerspec* old);
+int32 do_timerfd_gettime(int32 fd, struct itimerspec* cur);
 ssize_t do_write(int32 fd, const void *buf, size_t count);
 
 
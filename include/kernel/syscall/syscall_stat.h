@@ -0,0 +1,56 @@
+#ifndef _SYSCALL_STAT_H_
+#define _SYSCALL_STAT_H_
+
+#include <kernel/config.h>
+#include <kernel/riscv.h>
+#include <kernel/types.h>
+
+/*
+ * 系统调用统计
+ *
+ * do_syscall 在调用前后各读一次 time CSR，按系统调用号累计次数、总耗时、最大耗时，
+ * 并把耗时按 log2(ns) 放进直方图。全局统计每个 hart 一份，只由本 hart 写入，
+ * 读者汇总。每个进程另有一份带直方图的汇总，以及按系统调用号的次数和耗时，
+ * 后者在进程第一次被记账时分配，不带直方图。
+ *
+ * 通过 /dev/syscall_stat 读取，向其写入任意内容清零。
+ */
+
+#define SYSCALL_NR_MAX 300        // 统计覆盖的系统调用号上界（不含）
+#define SYSCALL_HIST_BUCKETS 32   // 第 i 格为耗时落在 [2^i, 2^(i+1)) ns 的调用次数
+
+struct syscall_stat {
+	uint64 count;
+	uint64 ticks;     // 累计耗时（time CSR 计数）
+	uint64 max_ticks; // 单次最大耗时
+	uint32 hist[SYSCALL_HIST_BUCKETS];
+};
+
+// 进程内按系统调用号的统计，数组长度 SYSCALL_NR_MAX
+struct syscall_count {
+	uint64 count;
+	uint64 ticks;
+};
+
+#if CONFIG_SYSCALL_STAT
+
+extern volatile int32 syscall_stat_enabled;
+
+/**
+ * 返回调用开始时刻，统计关闭时返回 0
+ */
+static inline uint64 syscall_stat_begin(void) { return syscall_stat_enabled ? read_csr(time) : 0; }
+
+void syscall_stat_end(int64 nr, uint64 start);
+
+#else
+
+static inline uint64 syscall_stat_begin(void) { return 0; }
+static inline void syscall_stat_end(int64 nr, uint64 start) {}
+
+#endif
+
+void syscall_stat_init(void);
+void syscall_stat_reset(void);
+
+#endif // _SYSCALL_STAT_H_
@@ -0,0 +1,26 @@
+#ifndef _KERNEL_TICK_H
+#define _KERNEL_TICK_H
+
+#include <kernel/config.h>
+#include <kernel/time.h>
+#include <kernel/types.h>
+
+/*
+ * 时钟节拍
+ *
+ * 每个 hart 的节拍是它自己的一个周期为 TICK_NSEC 的 hrtimer，负责调度器记账；
+ * jiffies 按 CLOCK_MONOTONIC 计算，哪个 hart 的节拍先到就由哪个 hart 推进，
+ * 并由它检查时间轮。所有 hart 的节拍对齐到同一组时刻。
+ *
+ * NO_HZ 空闲：hart 进入空闲时把节拍推迟到时间轮上下一个定时器的时刻，
+ * 其间只有本 hart 的 hrtimer、外部中断或核间中断能唤醒它；退出空闲时补上 jiffies 并恢复节拍。
+ */
+
+#define TICK_NSEC (NSEC_PER_SEC / HZ)
+
+void tick_init(void);
+void tick_setup_sched_timer(void);
+void tick_nohz_idle_enter(void);
+void tick_nohz_idle_exit(void);
+
+#endif
@@ -23,11 +23,21 @@ struct superblock;
 #define USEC_PER_SEC 1000000L
 #define NSEC_PER_USEC 1000L
 
-/* Clock identifiers */
+/* Largest nanosecond value, used as "never" by the timer code */
+#define KTIME_MAX ((uint64)INT64_MAX)
+
+/* clock_nanosleep() flags */
+#define TIMER_ABSTIME 1
+
+/* Clock identifiers, same numbering as Linux */
 #define CLOCK_REALTIME 0           /* System-wide real-time clock */
 #define CLOCK_MONOTONIC 1          /* Monotonic system-wide clock */
-#define CLOCK_BOOTTIME 2           /* Monotonic clock that includes time system was suspended */
-#define CLOCK_PROCESS_CPUTIME_ID 3 /* Per-process CPU time clock */
+#define CLOCK_PROCESS_CPUTIME_ID 2 /* Per-process CPU time clock */
+#define CLOCK_THREAD_CPUTIME_ID 3  /* Per-thread CPU time clock */
+#define CLOCK_MONOTONIC_RAW 4      /* Monotonic, not subject to frequency adjustment */
+#define CLOCK_REALTIME_COARSE 5
+#define CLOCK_MONOTONIC_COARSE 6
+#define CLOCK_BOOTTIME 7           /* Monotonic clock that includes time system was suspended */
 
 /* Filesystem time range capabilities */
 struct timerange {
@@ -53,6 +63,26 @@ static inline void timeval_to_timespec(struct timespec* ts, const struct timeval
 	ts->tv_nsec = tv->tv_usec * NSEC_PER_USEC;
 }
 
+static inline void ns_to_timespec(struct timespec* ts, uint64 ns) {
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+}
+
+/*
+ * A timespec accepted from user space: non-negative, nsec normalized
+ */
+static inline int32 timespec_valid(const struct timespec* ts) {
+	return ts->tv_sec >= 0 && ts->tv_nsec >= 0 && ts->tv_nsec < NSEC_PER_SEC;
+}
+
+/*
+ * Convert a valid timespec to nanoseconds, saturating at KTIME_MAX
+ */
+static inline uint64 timespec_to_ns(const struct timespec* ts) {
+	if ((uint64)ts->tv_sec >= KTIME_MAX / NSEC_PER_SEC) return KTIME_MAX;
+	return (uint64)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
 /**
  * current_time - Get current system time
  * @sb: Superblock (optional, can be NULL)
@@ -127,6 +157,11 @@ int32 do_clock_getres(clockid_t which_clock, struct timespec* tp);
  */
 int32 do_nanosleep(const struct timespec* req, struct timespec* rem);
 
+/*
+ * Suspend execution until a point on a clock, or for an interval of it
+ */
+int32 do_clock_nanosleep(clockid_t which_clock, int32 flags, const struct timespec* req, struct timespec* rem);
+
 /* Timer functions */
 
 /*
@@ -151,11 +186,29 @@ int32 timer_gettime(timer_t timerid, struct itimerspec* value);
 
 /* Internal kernel time management */
 
+/*
+ * Nanoseconds on CLOCK_MONOTONIC, CLOCK_REALTIME and CLOCK_BOOTTIME
+ */
+uint64 ktime_get_ns(void);
+uint64 ktime_get_real_ns(void);
+uint64 ktime_get_boot_ns(void);
+
+/*
+ * Offset of CLOCK_REALTIME or CLOCK_BOOTTIME from CLOCK_MONOTONIC,
+ * 0 for CLOCK_MONOTONIC
+ */
+int64 ktime_get_offset(clockid_t which_clock);
+
 /*
  * Convert jiffies to timespec
  */
 void jiffies_to_timespec(uint64 jiffies, struct timespec* value);
 
+/*
+ * Convert a time interval to jiffies, rounding up
+ */
+int64 timespec_to_jiffies(const struct timespec* value);
+
 /*
  * Update system time from hardware clock
  */
@@ -166,4 +219,9 @@ void update_sys_time_from_hw(void);
  */
 void time_init(void);
 
+/*
+ * Start the timer interrupt and the tick on the calling hart
+ */
+void timer_init_hart(void);
+
 #endif /* _KERNEL_TIME_H */
\ No newline at end of file
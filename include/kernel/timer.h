@@ -0,0 +1,41 @@
+#ifndef _KERNEL_TIMER_H
+#define _KERNEL_TIMER_H
+
+#include <kernel/types.h>
+#include <kernel/util/list.h>
+
+/*
+ * 以 jiffies 为单位的内核定时器
+ *
+ * 用于精度要求不高、大多在到期前就被取消的超时。定时器放在分级时间轮上，
+ * 挂入和取消都是 O(1)：第 n 级有 64 个槽，每槽跨 8^n 个 jiffy，
+ * 越远的定时器落在越粗的槽里，到期时间按所在槽的粒度向后取整，不会提前。
+ * 需要精确到期的场合用 hrtimer，见 include/kernel/hrtimer.h。
+ *
+ * 时间轮由推进 jiffies 的那个 hart 在时钟节拍中检查，
+ * 回调在中断上下文中执行，不能睡眠。
+ */
+
+struct timer_list {
+	struct list_head entry; // 未挂入时为空链表
+	uint64 expires;         // 到期的 jiffies
+	void (*function)(struct timer_list* timer);
+	uint32 idx; // 所在的槽
+};
+
+#define MAX_SCHEDULE_TIMEOUT INT64_MAX
+
+void timer_setup(struct timer_list* timer, void (*function)(struct timer_list*));
+void add_timer(struct timer_list* timer);
+int32 mod_timer(struct timer_list* timer, uint64 expires);
+int32 del_timer(struct timer_list* timer);
+int32 del_timer_sync(struct timer_list* timer);
+void run_timers(void);
+uint64 get_next_timer_interrupt(void);
+void init_timers(void);
+
+static inline int32 timer_pending(const struct timer_list* timer) { return !list_empty(&timer->entry); }
+
+int64 schedule_timeout(int64 timeout);
+
+#endif
@@ -19,6 +19,8 @@ struct trapframe {
   /* offset:272 */ uint64 kernel_satp;
 	// kernel scheduler, added @lab3_challenge2
 	/* offset:280 */ uint64 kernel_schedule;
+	// 本 hart 的 per-CPU 偏移，陷入时装进 tp，见 percpu.h
+	/* offset:288 */ uint64 kernel_tp;
 };
 
 #define store_all_registers(trapframe)                                                \
@@ -178,18 +178,35 @@ typedef unsigned short umode_t;
 static inline int test_bit(int nr, const volatile uint64* addr) { return (addr[nr / (8 * sizeof(uint64))] >> (nr % (8 * sizeof(uint64)))) & 1UL; }
 
 /**
- * 设置指定位置的位
+ * 设置指定位置的位（原子操作，同一个字中的其他位可能被并发修改）
  * @param nr 位编号（从0开始）
  * @param addr 位图指针
  */
-static inline void set_bit(int nr, volatile uint64* addr) { addr[nr / (8 * sizeof(uint64))] |= (1UL << (nr % (8 * sizeof(uint64)))); }
+static inline void set_bit(int nr, volatile uint64* addr) { __atomic_fetch_or(&addr[nr / (8 * sizeof(uint64))], 1UL << (nr % (8 * sizeof(uint64))), __ATOMIC_RELAXED); }
 
 /**
- * 清除指定位置的位
+ * 清除指定位置的位（原子操作）
  * @param nr 位编号（从0开始）
  * @param addr 位图指针
  */
-static inline void clear_bit(int nr, volatile uint64* addr) { addr[nr / (8 * sizeof(uint64))] &= ~(1UL << (nr % (8 * sizeof(uint64)))); }
+static inline void clear_bit(int nr, volatile uint64* addr) { __atomic_fetch_and(&addr[nr / (8 * sizeof(uint64))], ~(1UL << (nr % (8 * sizeof(uint64)))), __ATOMIC_RELAXED); }
+
+/**
+ * 原子地置位并返回原来的值，可以当作位锁的加锁操作（acquire 语义）
+ * @param nr 位编号（从0开始）
+ * @param addr 位图指针
+ */
+static inline int test_and_set_bit(int nr, volatile uint64* addr) {
+	uint64 mask = 1UL << (nr % (8 * sizeof(uint64)));
+	return (__atomic_fetch_or(&addr[nr / (8 * sizeof(uint64))], mask, __ATOMIC_ACQUIRE) & mask) != 0;
+}
+
+/**
+ * 清除位锁（release 语义）
+ * @param nr 位编号（从0开始）
+ * @param addr 位图指针
+ */
+static inline void clear_bit_unlock(int nr, volatile uint64* addr) { __atomic_fetch_and(&addr[nr / (8 * sizeof(uint64))], ~(1UL << (nr % (8 * sizeof(uint64)))), __ATOMIC_RELEASE); }
 
 /*device types*/
 /* Major/minor number manipulation macros */
@@ -227,6 +244,7 @@ static inline void clear_bit(int nr, volatile uint64* addr) { addr[nr / (8 * siz
 #define MEM_MAJOR 1 /* /dev/mem etc */
 #define TTY_MAJOR 4
 #define TTYAUX_MAJOR 5
+#define MISC_MAJOR 10
 #define RANDOM_MAJOR 1 /* /dev/random /dev/urandom */
 
 #define DYNAMIC_MAJOR_MIN 128 /* Reserve first 128 majors for fixed assignments */
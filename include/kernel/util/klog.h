@@ -0,0 +1,74 @@
+#ifndef _KLOG_H_
+#define _KLOG_H_
+
+#include <kernel/types.h>
+#include <kernel/config.h>
+
+/*
+ * 内核日志环形缓冲区（dmesg）
+ *
+ * 每个 hart 拥有一块独立的环形缓冲区，只有本 hart 会写入，
+ * 写入时关本地中断即可，不需要任何锁。
+ * 每条记录带有全局递增的序号、time CSR 时间戳和日志级别，
+ * 读者（控制台、syslog）按序号把各个 hart 的记录归并成全局顺序。
+ *
+ * 控制台输出由低优先级上下文（idle 循环、时钟节拍）异步排空，
+ * 只有 WARN 以上级别和缓冲区接近写满时才会在写者上下文中同步排空。
+ */
+
+#define KLOG_TEXT_MAX 224
+#define KLOG_SLOTS_PER_CPU 64 // 必须是 2 的幂
+#define KLOG_POS_INVALID (~0ULL)
+// 所有 hart 的环中正文的总容量，SYSLOG_ACTION_SIZE_BUFFER 返回它
+#define KLOG_BUF_SIZE ((int64)NCPU * KLOG_SLOTS_PER_CPU * KLOG_TEXT_MAX)
+
+struct klog_record {
+	volatile uint64 pos; // 记录在本 hart 环中的写入位置，写入过程中为 KLOG_POS_INVALID
+	uint64 seq;          // 全局序号
+	uint64 ts;           // time CSR 读数
+	uint16 len;          // text 有效长度
+	uint8 level;         // LOG_LEVEL_*
+	uint8 cpu;           // 写入的 hart
+	char text[KLOG_TEXT_MAX];
+};
+
+struct klog_cpu_buf {
+	volatile uint64 head; // 下一个写入位置（单调递增）
+	struct klog_record slots[KLOG_SLOTS_PER_CPU];
+} __attribute__((aligned(64)));
+
+/**
+ * 读游标：记录每个 hart 环上已经读到的位置
+ */
+struct klog_iter {
+	uint64 pos[NCPU];
+	uint64 dropped; // 因被覆盖而丢失的记录数
+};
+
+/* syslog(2) / klogctl(3) 动作 */
+#define SYSLOG_ACTION_CLOSE 0
+#define SYSLOG_ACTION_OPEN 1
+#define SYSLOG_ACTION_READ 2
+#define SYSLOG_ACTION_READ_ALL 3
+#define SYSLOG_ACTION_READ_CLEAR 4
+#define SYSLOG_ACTION_CLEAR 5
+#define SYSLOG_ACTION_CONSOLE_OFF 6
+#define SYSLOG_ACTION_CONSOLE_ON 7
+#define SYSLOG_ACTION_CONSOLE_LEVEL 8
+#define SYSLOG_ACTION_SIZE_UNREAD 9
+#define SYSLOG_ACTION_SIZE_BUFFER 10
+
+void klog_append(int32 level, const char* text, size_t len);
+
+void klog_iter_init(struct klog_iter* iter);
+int32 klog_iter_next(struct klog_iter* iter, struct klog_record* out);
+
+void klog_console_flush(void);
+void klog_console_flush_sync(void);
+void klog_set_async(int32 async);
+int32 klog_console_pending(void);
+void klog_wake_readers(void);
+
+int64 do_syslog(int32 type, char* buf, int32 len);
+
+#endif /* _KLOG_H_ */
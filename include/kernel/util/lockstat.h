@@ -0,0 +1,49 @@
+#ifndef _LOCKSTAT_H_
+#define _LOCKSTAT_H_
+
+#include <kernel/config.h>
+#include <kernel/types.h>
+
+/*
+ * 自旋锁竞争统计（CONFIG_LOCKSTAT）
+ *
+ * 以加锁位置（文件:行号）为锁类，累计获取次数、发生竞争的次数，以及等待和持有的
+ * 总时长与最大值（time CSR 计数）。加锁时先 trylock 一次，失败才算一次竞争。
+ * 持有时长记到加锁位置所在的类上。
+ *
+ * 通过 /dev/lockstat 读取，按竞争次数从高到低排序；写入 "off"/"on" 暂停或恢复统计，
+ * 其余任何内容清零。关闭 CONFIG_LOCKSTAT 时 spinlock_t 不带统计字段，加解锁路径不受影响。
+ */
+
+#define LOCKSTAT_CLASSES 512 // 锁类表的大小，超出后记到 "(overflow)" 上
+
+struct lock_class_stat {
+	const char* site; // 加锁位置，NULL 表示空槽
+	uint64 acquisitions;
+	uint64 contentions;
+	uint64 wait_ticks;
+	uint64 max_wait_ticks;
+	uint64 hold_ticks;
+	uint64 max_hold_ticks;
+};
+
+#define __LOCKSTAT_STR(x) #x
+#define LOCKSTAT_STR(x) __LOCKSTAT_STR(x)
+#define LOCKSTAT_SITE __FILE__ ":" LOCKSTAT_STR(__LINE__)
+
+static inline uint64 lockstat_clock(void) {
+	uint64 t;
+	__asm__ __volatile__("rdtime %0" : "=r"(t));
+	return t;
+}
+
+extern volatile int32 lockstat_enabled;
+
+struct lock_class_stat* lockstat_class(const char* site);
+void lockstat_account_wait(struct lock_class_stat* class, uint64 wait, int32 contended);
+void lockstat_account_hold(struct lock_class_stat* class, uint64 hold);
+
+void lockstat_init(void);
+void lockstat_reset(void);
+
+#endif
@@ -1,50 +1,112 @@
 #ifndef __LOG_H__
 #define __LOG_H__
 // copyright: farmos
-#include <kernel/util/error.h>
+#include <kernel/types.h>
+#include <kernel/config.h>
 
-// 日志级别定义（模块）
-#define DEFAULT 1
-#define LEVEL_MODULE 1
-
-#define MM_GLOBAL 10
-#define MM_MODULE 1
-
-#define BUF_MODULE 1
-#define FAT_MODULE 4
-
-#define FS_MODULE 1
-#define FS_GLOBAL 5
-
-#define PROC_MODULE 1
-#define PROC_GLOBAL 5
-
-#define MUTEX_SPIN 2
-#define MUTEX_SLEEP 10
-
-#define SLEEP_MODULE 9
-
-// 日志级别定义（全局）
-#define LEVEL_GLOBAL 11
-
-// 当前允许输出的日志级别
-#define LOG_LEVEL 1111
-#define DEBUG 11
-
-#define DISABLE_WARN 1
+/*
+ * 日志级别：数值越小越重要。
+ * 低于编译期阈值 CONFIG_LOG_LEVEL 的日志宏会被预处理器直接展开为空语句，
+ * 参数也不会被求值，热路径上不再留下任何调用。
+ */
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+// 当前允许输出的日志级别（构建时可通过 -DCONFIG_LOG_LEVEL=N 覆盖）
+#define LOG_LEVEL CONFIG_LOG_LEVEL
+
+/*
+ * 日志子系统编号。
+ * 通过编译期阈值的日志还要经过运行时的子系统掩码过滤，
+ * 可以在不重新编译的情况下单独打开某个子系统的调试输出，运行时通过 /dev/log_mask 修改。
+ */
+#define LOG_SUB_CORE 0
+#define LOG_SUB_BOOT 1
+#define LOG_SUB_MM 2
+#define LOG_SUB_SCHED 3
+#define LOG_SUB_TRAP 4
+#define LOG_SUB_SYSCALL 5
+#define LOG_SUB_FS 6
+#define LOG_SUB_DEV 7
+#define LOG_SUB_TIME 8
+#define LOG_SUB_MAX 9
+
+#define LOG_MASK(sub) (1U << (sub))
+#define LOG_MASK_ALL ((1U << LOG_SUB_MAX) - 1)
+
+// 运行时子系统开关掩码，定义在 print.c
+extern volatile uint32 log_subsys_mask;
+
+static inline int32 log_subsys_enabled(int32 sub) { return (log_subsys_mask & LOG_MASK(sub)) != 0; }
+void log_subsys_enable(int32 sub);
+void log_subsys_disable(int32 sub);
+void log_set_mask(uint32 mask);
+void log_mask_init(void);
+
+#define DISABLE_WARN (!CONFIG_WARN)
 
 // 日志输出函数
-void _log(const char *, int, const char *, const char *, ...);
+void _log(int32 level, int32 sub, const char *, int, const char *, const char *, ...);
 void _warn(const char *, int, const char *, const char *, ...);
 
+#define __log_emit(level, sub, ...)                                                                \
+	do {                                                                                       \
+		if (log_subsys_enabled(sub)) {                                                     \
+			_log((level), (sub), __FILE__, __LINE__, __func__, __VA_ARGS__);           \
+		}                                                                                  \
+	} while (0)
+
+#define __log_drop(...)                                                                            \
+	do {                                                                                       \
+	} while (0)
+
 // 外部接口
 /**
- * @brief 日志输出
+ * @brief 按级别输出日志，级别高于编译期阈值的宏展开为空
+ * @param sub 日志子系统 LOG_SUB_*
+ */
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define log_error(sub, ...) __log_emit(LOG_LEVEL_ERROR, sub, __VA_ARGS__)
+#else
+#define log_error(sub, ...) __log_drop()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define log_warn(sub, ...) __log_emit(LOG_LEVEL_WARN, sub, __VA_ARGS__)
+#else
+#define log_warn(sub, ...) __log_drop()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define log_info(sub, ...) __log_emit(LOG_LEVEL_INFO, sub, __VA_ARGS__)
+#else
+#define log_info(sub, ...) __log_drop()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define log_debug(sub, ...) __log_emit(LOG_LEVEL_DEBUG, sub, __VA_ARGS__)
+#else
+#define log_debug(sub, ...) __log_drop()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
+#define log_trace(sub, ...) __log_emit(LOG_LEVEL_TRACE, sub, __VA_ARGS__)
+#else
+#define log_trace(sub, ...) __log_drop()
+#endif
+
+/**
+ * @brief 通用日志输出，level 取 LOG_LEVEL_*，数值不大于 LOG_LEVEL 时输出。
+ * level 为编译期常量时未达阈值的分支会被编译器消除
  */
 #define log(level, ...)                                                                            \
 	do {                                                                                       \
-		if ((level) >= LOG_LEVEL) {                                                        \
-			_log(__FILE__, __LINE__, __func__, __VA_ARGS__);                           \
+		if ((level) <= LOG_LEVEL) {                                                        \
+			__log_emit(level, LOG_SUB_CORE, __VA_ARGS__);                              \
 		}                                                                                  \
 	} while (0)
 
@@ -52,9 +114,10 @@ void _warn(const char *, int, const char *, const char *, ...);
  * @brief 警告日志输出
  */
 #define warn(...)                                                                                  \
-	if (!DISABLE_WARN)                                                                         \
-		do {                                                                               \
+	do {                                                                                       \
+		if (!DISABLE_WARN) {                                                               \
 			_warn(__FILE__, __LINE__, __func__, __VA_ARGS__);                          \
+		}                                                                                  \
 	} while (0)
 
 #define unwrap(expr)                                                                               \
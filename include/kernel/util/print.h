@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdarg.h>
+#include <kernel/util/log.h>
 //#define kprintf(fmt, ...) kprintf(fmt, ##__VA_ARGS__)
 //#define kprintf(fmt, ...)
 
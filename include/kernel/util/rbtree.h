@@ -0,0 +1,87 @@
+#ifndef _RBTREE_H
+#define _RBTREE_H
+
+#include <kernel/types.h>
+#include <kernel/util/list.h> // container_of
+
+/*
+ * 侵入式红黑树
+ *
+ * 与 list_head 的用法相同：把 rb_node 嵌入到数据结构中，通过 rb_entry 取回外层结构。
+ * 查找和插入位置由调用者按自己的键比较完成，树只负责着色和旋转：
+ *
+ *	struct rb_node **link = &root->rb_node, *parent = NULL;
+ *	while (*link) {
+ *		parent = *link;
+ *		if (key < rb_entry(parent, struct foo, node)->key)
+ *			link = &parent->rb_left;
+ *		else
+ *			link = &parent->rb_right;
+ *	}
+ *	rb_link_node(&foo->node, parent, link);
+ *	rb_insert_color(&foo->node, root);
+ */
+
+#define RB_COLOR_RED 0
+#define RB_COLOR_BLACK 1
+
+struct rb_node {
+	struct rb_node* rb_parent;
+	struct rb_node* rb_left;
+	struct rb_node* rb_right;
+	int32 rb_color;
+};
+
+struct rb_root {
+	struct rb_node* rb_node;
+};
+
+/*
+ * 额外缓存最左（最小）节点，取最小值为 O(1)
+ */
+struct rb_root_cached {
+	struct rb_root rb_root;
+	struct rb_node* rb_leftmost;
+};
+
+#define RB_ROOT_CACHED \
+	(struct rb_root_cached) { {NULL}, NULL }
+
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+
+#define RB_EMPTY_ROOT(root) ((root)->rb_node == NULL)
+// 不在任何树中的节点把 parent 指向自己
+#define RB_EMPTY_NODE(node) ((node)->rb_parent == (node))
+#define RB_CLEAR_NODE(node) ((node)->rb_parent = (node))
+
+static inline void rb_link_node(struct rb_node* node, struct rb_node* parent, struct rb_node** link) {
+	node->rb_parent = parent;
+	node->rb_left = node->rb_right = NULL;
+	node->rb_color = RB_COLOR_RED;
+	*link = node;
+}
+
+void rb_insert_color(struct rb_node* node, struct rb_root* root);
+void rb_erase(struct rb_node* node, struct rb_root* root);
+
+struct rb_node* rb_first(const struct rb_root* root);
+struct rb_node* rb_last(const struct rb_root* root);
+struct rb_node* rb_next(const struct rb_node* node);
+struct rb_node* rb_prev(const struct rb_node* node);
+
+/**
+ * @leftmost: 调用者在查找插入位置时是否一直向左走
+ */
+static inline void rb_insert_color_cached(struct rb_node* node, struct rb_root_cached* root, int32 leftmost) {
+	if (leftmost) root->rb_leftmost = node;
+	rb_insert_color(node, &root->rb_root);
+}
+
+static inline void rb_erase_cached(struct rb_node* node, struct rb_root_cached* root) {
+	if (root->rb_leftmost == node) root->rb_leftmost = rb_next(node);
+	rb_erase(node, &root->rb_root);
+}
+
+#define rb_first_cached(root) ((root)->rb_leftmost)
+
+#endif /* _RBTREE_H */
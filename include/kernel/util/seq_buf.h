@@ -0,0 +1,24 @@
+#ifndef _SEQ_BUF_H_
+#define _SEQ_BUF_H_
+
+#include <kernel/types.h>
+
+/*
+ * 有界文本缓冲区
+ *
+ * 统计类设备文件在 read 时把内容渲染成文本，seq_buf 负责在写满时截断，
+ * 格式化支持与 kprintf 相同（宽度、l 修饰）。
+ */
+struct seq_buf {
+	char* buf;
+	size_t size;
+	size_t len;
+	int32 overflow; // 有内容因空间不足被丢弃
+};
+
+void seq_buf_init(struct seq_buf* s, char* buf, size_t size);
+void seq_buf_printf(struct seq_buf* s, const char* fmt, ...);
+
+ssize_t seq_buf_read(struct seq_buf* s, char* dst, size_t count, loff_t* ppos);
+
+#endif // _SEQ_BUF_H_
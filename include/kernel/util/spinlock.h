@@ -5,45 +5,182 @@
 #ifndef _RISCV_SPINLOCK_H_
 #define _RISCV_SPINLOCK_H_
 #include <stdint.h>
+#include <kernel/config.h>
 #include <kernel/util/atomic.h>
+#include <kernel/util/lockstat.h>
+#include <kernel/sched/preempt.h>
 
 
 
+/*
+ * 排队自旋锁（ticket lock）
+ *
+ * 加锁时用一次 amoadd 领取 next 号，等 owner 叫到自己的号；解锁只把 owner 加一。
+ * 等待者按到达顺序获得锁，不会出现某个 hart 一直抢不到的情况；
+ * 等待期间只读 owner，不会反复对锁所在的缓存行发起写操作。
+ *
+ * 持有自旋锁期间关闭抢占：被抢占的持锁者会让其他 hart 上的等待者一直空转
+ */
 typedef struct {
-  atomic_flag lock;
+    union {
+        uint32 val;
+        struct {
+            uint16 owner; // 当前持有者的号
+            uint16 next;  // 下一个领取的号
+        } tickets;
+    };
+#if CONFIG_LOCKSTAT
+    struct lock_class_stat* class; // 本次加锁位置的统计类，只由持有者读写
+    uint64 acquired_at;            // 获得锁的时刻
+#endif
 } spinlock_t;
 
-#define SPINLOCK_INIT  ATOMIC_FLAG_INIT 
+#define SPINLOCK_INIT {0}
+
+#define TICKET_SHIFT 16
+// 前面每多一个等待者多等这么多轮再去读 owner
+#define SPIN_BACKOFF_UNIT 32
+
+// Zihintpause 的 pause 指令，不支持的实现上按 FENCE 执行，没有副作用
+static inline void cpu_relax(void) {
+    __asm__ __volatile__(".4byte 0x0100000f" ::: "memory");
+}
 
 static inline void spinlock_init(spinlock_t* lock) {
-	atomic_flag_clear(&lock->lock);
+    __atomic_store_n(&lock->val, 0, __ATOMIC_RELAXED);
+}
+
+static inline int32 spin_is_locked(spinlock_t* lock) {
+    uint32 val = __atomic_load_n(&lock->val, __ATOMIC_RELAXED);
+    return (uint16)val != (uint16)(val >> TICKET_SHIFT);
+}
+
+/*
+ * 拿到号以后，按前面排队的人数成比例退避：
+ * 离 owner 越远，两次读锁之间等得越久，持有者解锁时只有排在最前面的几个 hart 在读这一行。
+ */
+static inline void __ticket_spin_wait(spinlock_t* lock, uint16 ticket) {
+    for (;;) {
+        uint16 owner = __atomic_load_n(&lock->tickets.owner, __ATOMIC_ACQUIRE);
+        if (owner == ticket) return;
+        for (uint32 i = (uint16)(ticket - owner) * SPIN_BACKOFF_UNIT; i > 0; i--) cpu_relax();
+    }
+}
+
+static inline void __ticket_lock(spinlock_t* lock) {
+    uint32 val = __atomic_fetch_add(&lock->val, 1U << TICKET_SHIFT, __ATOMIC_ACQUIRE);
+    uint16 ticket = val >> TICKET_SHIFT;
+    if ((uint16)val != ticket) __ticket_spin_wait(lock, ticket);
+}
+
+// 锁空闲且没有人排队时领号，否则不进入队列
+static inline int32 __ticket_trylock(spinlock_t* lock) {
+    uint32 val = __atomic_load_n(&lock->val, __ATOMIC_RELAXED);
+    return (uint16)val == (uint16)(val >> TICKET_SHIFT) &&
+           __atomic_compare_exchange_n(&lock->val, &val, val + (1U << TICKET_SHIFT), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void __ticket_unlock(spinlock_t* lock) {
+    // 只有持有者会写 owner，半字的 release 写即可
+    __atomic_store_n(&lock->tickets.owner, lock->tickets.owner + 1, __ATOMIC_RELEASE);
 }
 
 static inline int32 spinlock_trylock(spinlock_t* lock) {
-    return atomic_flag_test_and_set(&lock->lock) == 0;  // 成功返回 1
+    preempt_disable();
+    if (__ticket_trylock(lock)) return 1;  // 成功返回 1
+    preempt_enable();
+    return 0;
 }
 
 static inline void spinlock_lock(spinlock_t* lock) {
-    while (atomic_flag_test_and_set(&lock->lock)) {
-        // 自旋等待
-    }
+    preempt_disable();
+    __ticket_lock(lock);
 }
 
 static inline void spinlock_unlock(spinlock_t* lock) {
-    atomic_flag_clear(&lock->lock);
+    __ticket_unlock(lock);
+    preempt_enable();
 }
 
+// 先恢复中断再打开抢占，这样 preempt_enable 能看到中断已打开并处理 need_resched
 static inline void spinlock_unlock_irqrestore(spinlock_t* lock, int64 flags) {
-    atomic_flag_clear(&lock->lock);
+    __ticket_unlock(lock);
     enable_irqrestore(flags);
+    preempt_enable();
 }
 
 static inline int64 spinlock_lock_irqsave(spinlock_t* lock) {
 	int64 flags = disable_irqsave();
-	while (atomic_flag_test_and_set(&lock->lock)) {
-			// 自旋等待
-	}
+	preempt_disable();
+	__ticket_lock(lock);
 	return flags;
 }
 
+#if CONFIG_LOCKSTAT
+/*
+ * 统计版本的加解锁，用宏替换上面的接口以便记下调用位置。
+ * 先 trylock 一次，失败才排队并计为一次竞争；解锁时在释放之前结算持有时长。
+ */
+static inline void __lockstat_acquire(spinlock_t* lock, const char* site) {
+    uint64 start = lockstat_clock();
+    int32 contended = !__ticket_trylock(lock);
+    if (contended) __ticket_lock(lock);
+    uint64 now = lockstat_clock();
+    lock->class = NULL;
+    if (!lockstat_enabled) return;
+    lock->class = lockstat_class(site);
+    lock->acquired_at = now;
+    lockstat_account_wait(lock->class, now - start, contended);
+}
+
+static inline void __lockstat_release(spinlock_t* lock) {
+    if (lock->class) lockstat_account_hold(lock->class, lockstat_clock() - lock->acquired_at);
+    __ticket_unlock(lock);
+}
+
+static inline int32 __lockstat_spinlock_trylock(spinlock_t* lock, const char* site) {
+    preempt_disable();
+    if (!__ticket_trylock(lock)) {
+        preempt_enable();
+        return 0;
+    }
+    lock->class = NULL;
+    if (lockstat_enabled) {
+        lock->class = lockstat_class(site);
+        lock->acquired_at = lockstat_clock();
+        lockstat_account_wait(lock->class, 0, 0);
+    }
+    return 1;
+}
+
+static inline void __lockstat_spinlock_lock(spinlock_t* lock, const char* site) {
+    preempt_disable();
+    __lockstat_acquire(lock, site);
+}
+
+static inline void __lockstat_spinlock_unlock(spinlock_t* lock) {
+    __lockstat_release(lock);
+    preempt_enable();
+}
+
+static inline int64 __lockstat_spinlock_lock_irqsave(spinlock_t* lock, const char* site) {
+    int64 flags = disable_irqsave();
+    preempt_disable();
+    __lockstat_acquire(lock, site);
+    return flags;
+}
+
+static inline void __lockstat_spinlock_unlock_irqrestore(spinlock_t* lock, int64 flags) {
+    __lockstat_release(lock);
+    enable_irqrestore(flags);
+    preempt_enable();
+}
+
+#define spinlock_trylock(lock) __lockstat_spinlock_trylock(lock, LOCKSTAT_SITE)
+#define spinlock_lock(lock) __lockstat_spinlock_lock(lock, LOCKSTAT_SITE)
+#define spinlock_unlock(lock) __lockstat_spinlock_unlock(lock)
+#define spinlock_lock_irqsave(lock) __lockstat_spinlock_lock_irqsave(lock, LOCKSTAT_SITE)
+#define spinlock_unlock_irqrestore(lock, flags) __lockstat_spinlock_unlock_irqrestore(lock, flags)
+#endif
+
 #endif
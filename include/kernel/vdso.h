@@ -0,0 +1,76 @@
+#ifndef _VDSO_H_
+#define _VDSO_H_
+
+#include <kernel/types.h>
+#include <kernel/util/atomic.h>
+
+/*
+ * vDSO：内核映射进每个进程的一个小共享库，clock_gettime/gettimeofday 不用陷入内核
+ *
+ * 用户地址空间中从 USER_VDSO_BASE 开始，先是 VDSO_DATA_PAGES 页只读的时间数据，
+ * 紧接着是 vdso.so 的映像，AT_SYSINFO_EHDR 指向后者。vdso.so 按位置无关代码编译，
+ * 用 PC 相对寻址访问它前面的 _vdso_data。
+ *
+ * 这个头文件同时被内核和 kernel/arch/riscv/vdso/ 下运行在用户态的代码包含，
+ * 后者编译时定义 __VDSO__。
+ */
+
+#define VDSO_DATA_PAGES 1
+
+/*
+ * 时间数据页
+ *
+ * 内核以 seqcount 的方式整体更新：seq 为奇数表示正在写，读者看到奇数，
+ * 或者读完之后 seq 变了，就重新读一遍。
+ * 各时钟都是 CLOCK_MONOTONIC 加上一个偏移，MONOTONIC 本身由 time CSR 按 mult/shift 换算。
+ */
+struct vdso_data {
+	uint32 seq;
+	uint32 shift;
+	uint64 mult;
+	int64 offs_real; // CLOCK_REALTIME - CLOCK_MONOTONIC（纳秒）
+	int64 offs_boot; // CLOCK_BOOTTIME - CLOCK_MONOTONIC（纳秒）
+	uint64 res;      // 读 time CSR 的时钟的分辨率（纳秒）
+};
+
+static inline uint32 vdso_read_begin(const struct vdso_data* vd) {
+	uint32 seq;
+	while ((seq = READ_ONCE(vd->seq)) & 1)
+		;
+	smp_rmb();
+	return seq;
+}
+
+static inline int32 vdso_read_retry(const struct vdso_data* vd, uint32 start) {
+	smp_rmb();
+	return READ_ONCE(vd->seq) != start;
+}
+
+#ifndef __VDSO__
+
+struct mm_struct;
+struct clocksource;
+
+// 时间数据在内核中的唯一一份，映射给所有进程
+extern struct vdso_data* vdso_data;
+
+void vdso_init(void);
+
+/**
+ * vdso_map - 把 vDSO 映射进一个新的地址空间
+ * @mm: 正在由 ELF 加载器建立的地址空间
+ *
+ * Returns: vdso.so 映像的用户地址（即 AT_SYSINFO_EHDR），失败返回 0
+ */
+uint64 vdso_map(struct mm_struct* mm);
+
+/**
+ * update_vsyscall - 时钟源或者各时钟的偏移改变后，刷新时间数据页
+ *
+ * 调用者负责串行化，见 kernel/time.c 中的 timekeeper_lock。
+ */
+void update_vsyscall(const struct clocksource* cs, int64 offs_real, int64 offs_boot);
+
+#endif
+
+#endif
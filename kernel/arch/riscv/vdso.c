@@ -0,0 +1,101 @@
+/*
+ * vDSO 的内核部分：时间数据页、映像页和映射，见 include/kernel/vdso.h
+ */
+
+#include <kernel/clocksource.h>
+#include <kernel/mm/kmalloc.h>
+#include <kernel/mm/mm_struct.h>
+#include <kernel/mm/page.h>
+#include <kernel/mm/vma.h>
+#include <kernel/mmu.h>
+#include <kernel/util.h>
+#include <kernel/vdso.h>
+
+// vdso.so 由 vdso/vdso.S 嵌入内核镜像，起止都按页对齐
+extern char vdso_start[], vdso_end[];
+
+// 数据页放在内核镜像里，time_init 在页分配器初始化之前就会更新它
+static union {
+	struct vdso_data data;
+	uint8 page[VDSO_DATA_PAGES * PAGE_SIZE];
+} vdso_data_store __attribute__((aligned(PAGE_SIZE)));
+
+struct vdso_data* vdso_data = &vdso_data_store.data;
+
+static struct page* vdso_data_pages[VDSO_DATA_PAGES];
+static struct page** vdso_text_pages;
+static int32 vdso_text_count;
+
+void update_vsyscall(const struct clocksource* cs, int64 offs_real, int64 offs_boot) {
+	struct vdso_data* vd = vdso_data;
+
+	WRITE_ONCE(vd->seq, vd->seq + 1);
+	smp_wmb();
+	vd->mult = cs->mult;
+	vd->shift = cs->shift;
+	vd->res = (1000000000ULL + cs->freq - 1) / cs->freq;
+	vd->offs_real = offs_real;
+	vd->offs_boot = offs_boot;
+	smp_wmb();
+	WRITE_ONCE(vd->seq, vd->seq + 1);
+}
+
+/*
+ * 内核镜像中的页不归页分配器管，这里补上 page 结构，并一直持有一个引用，
+ * 进程退出时 free_vma 放回的引用不会让它们被当作空闲页回收
+ */
+static struct page* vdso_kernel_page(void* kva) {
+	struct page* page = addr_to_page((paddr_t)kva);
+	if (!page) panic("vdso: no page struct for 0x%lx\n", (uint64)kva);
+	page->paddr = (paddr_t)kva;
+	page->flags |= PAGE_RESERVED;
+	atomic_set(&page->_refcount, 1);
+	return page;
+}
+
+/**
+ * vdso_init - 为数据页和 vdso.so 映像准备 page 结构，在页分配器初始化之后调用
+ */
+void vdso_init(void) {
+	for (int32 i = 0; i < VDSO_DATA_PAGES; i++)
+		vdso_data_pages[i] = vdso_kernel_page(vdso_data_store.page + i * PAGE_SIZE);
+
+	vdso_text_count = (vdso_end - vdso_start) / PAGE_SIZE;
+	vdso_text_pages = kmalloc(sizeof(struct page*) * vdso_text_count);
+	if (!vdso_text_pages) panic("vdso: out of memory\n");
+	for (int32 i = 0; i < vdso_text_count; i++)
+		vdso_text_pages[i] = vdso_kernel_page(vdso_start + i * PAGE_SIZE);
+
+	kprintf("vdso: %d text pages at 0x%lx\n", vdso_text_count, (uint64)vdso_start);
+}
+
+/*
+ * 建立一段 VMA 并装入给定的页。VM_SHARED 让 dup_mm 共用这些页而不是复制，
+ * 否则子进程得到的是数据页的一份过时的快照
+ */
+static int32 vdso_install(struct mm_struct* mm, uint64 addr, struct page** pages, int32 count, int32 prot,
+                          uint64 flags) {
+	struct vm_area_struct* vma = vm_area_setup(mm, addr, (uint64)count * PAGE_SIZE, VMA_VDSO, prot,
+	                                           flags | VM_USER | VM_SHARED | VM_DONTEXPAND);
+	if (!vma) return -ENOMEM;
+
+	for (int32 i = 0; i < count; i++) {
+		get_page(pages[i]);
+		vma->pages[i] = pages[i];
+		if (pgt_map_page(mm->pagetable, addr + (uint64)i * PAGE_SIZE, pages[i]->paddr, prot_to_type(prot, 1)))
+			return -ENOMEM;
+	}
+	return 0;
+}
+
+uint64 vdso_map(struct mm_struct* mm) {
+	uint64 base = USER_VDSO_BASE;
+	uint64 text = base + VDSO_DATA_PAGES * PAGE_SIZE;
+
+	if (!vdso_text_count) return 0;
+	if (vdso_install(mm, base, vdso_data_pages, VDSO_DATA_PAGES, PROT_READ, VM_READ | VM_MAYREAD)) return 0;
+	if (vdso_install(mm, text, vdso_text_pages, vdso_text_count, PROT_READ | PROT_EXEC,
+	                 VM_READ | VM_EXEC | VM_MAYREAD | VM_MAYEXEC))
+		return 0;
+	return text;
+}
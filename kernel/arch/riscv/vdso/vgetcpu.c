@@ -0,0 +1,19 @@
+/*
+ * vDSO 的 getcpu，运行在用户态
+ *
+ * RISC-V 的用户态读不到 hartid，也没有像 x86 RDPID 那样可以由内核预先填好的寄存器，
+ * 所以和 Linux 一样直接发起系统调用；提供这个符号是为了让 libc 可以统一走 vDSO。
+ */
+
+#include <syscall.h>
+
+struct getcpu_cache;
+
+int __vdso_getcpu(unsigned* cpu, unsigned* node, struct getcpu_cache* unused) {
+	register long a7 asm("a7") = SYS_getcpu;
+	register long a0 asm("a0") = (long)cpu;
+	register long a1 asm("a1") = (long)node;
+	register long a2 asm("a2") = (long)unused;
+	asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a2), "r"(a7) : "memory");
+	return a0;
+}
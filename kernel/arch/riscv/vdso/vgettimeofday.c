@@ -0,0 +1,100 @@
+/*
+ * vDSO 的时间函数，运行在用户态，见 include/kernel/vdso.h
+ *
+ * 这里的代码被映射进每个进程：只能用 PC 相对寻址访问 _vdso_data，
+ * 不能调用内核或 libc 中的任何函数。读不了的时钟退回真正的系统调用。
+ */
+
+#include <kernel/clocksource.h>
+#include <kernel/time.h>
+#include <kernel/vdso.h>
+#include <syscall.h>
+
+extern const struct vdso_data _vdso_data __attribute__((visibility("hidden")));
+
+static inline long vdso_syscall2(long nr, long arg0, long arg1) {
+	register long a7 asm("a7") = nr;
+	register long a0 asm("a0") = arg0;
+	register long a1 asm("a1") = arg1;
+	asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+	return a0;
+}
+
+/*
+ * 读一致的 (monotonic, offset) 快照；返回 0 表示这个时钟只能走系统调用
+ */
+static inline int32 do_hres(const struct vdso_data* vd, clockid_t clk, uint64* ns) {
+	uint32 seq;
+	int64 offs;
+
+	do {
+		seq = vdso_read_begin(vd);
+		switch (clk) {
+		case CLOCK_REALTIME:
+		case CLOCK_REALTIME_COARSE:
+			offs = vd->offs_real;
+			break;
+		case CLOCK_MONOTONIC:
+		case CLOCK_MONOTONIC_RAW:
+		case CLOCK_MONOTONIC_COARSE:
+			offs = 0;
+			break;
+		case CLOCK_BOOTTIME:
+			offs = vd->offs_boot;
+			break;
+		default:
+			return 0;
+		}
+		*ns = clocksource_cyc2ns(read_csr(time), vd->mult, vd->shift) + offs;
+	} while (vdso_read_retry(vd, seq));
+	return 1;
+}
+
+int __vdso_clock_gettime(clockid_t clk, struct timespec* ts) {
+	uint64 ns;
+
+	if (!do_hres(&_vdso_data, clk, &ns)) return vdso_syscall2(SYS_clock_gettime, clk, (long)ts);
+	ts->tv_sec = ns / NSEC_PER_SEC;
+	ts->tv_nsec = ns % NSEC_PER_SEC;
+	return 0;
+}
+
+int __vdso_gettimeofday(struct timeval* tv, struct timezone* tz) {
+	uint64 ns;
+
+	if (tv) {
+		do_hres(&_vdso_data, CLOCK_REALTIME, &ns);
+		tv->tv_sec = ns / NSEC_PER_SEC;
+		tv->tv_usec = (ns % NSEC_PER_SEC) / NSEC_PER_USEC;
+	}
+	if (tz) {
+		tz->tz_minuteswest = 0;
+		tz->tz_dsttime = 0;
+	}
+	return 0;
+}
+
+int __vdso_clock_getres(clockid_t clk, struct timespec* res) {
+	const struct vdso_data* vd = &_vdso_data;
+	uint64 ns;
+
+	switch (clk) {
+	case CLOCK_REALTIME:
+	case CLOCK_MONOTONIC:
+	case CLOCK_MONOTONIC_RAW:
+	case CLOCK_BOOTTIME:
+		ns = READ_ONCE(vd->res);
+		break;
+	case CLOCK_REALTIME_COARSE:
+	case CLOCK_MONOTONIC_COARSE:
+		ns = NSEC_PER_SEC / HZ;
+		break;
+	default:
+		return vdso_syscall2(SYS_clock_getres, clk, (long)res);
+	}
+	if (res) {
+		res->tv_sec = 0;
+		res->tv_nsec = ns;
+	}
+	return 0;
+}
@@ -7,9 +7,22 @@
 // #include "lib/string.h"
 // #include "mm/memlayout.h"
 #include <kernel/param.h>
+#include <kernel/mm/memlayout.h>
 
 uint64_t dtbEntry = 0;
 struct MemInfo memInfo;
+struct UartInfo uartInfo = {
+    .base = UART0,
+    .size = PAGE_SIZE,
+    .irq = UART0_IRQ,
+    .clock = 0,
+};
+struct PlicInfo plicInfo = {
+    .base = PLIC,
+    .size = 0x600000,
+    .ndev = 95,
+};
+struct CpuInfo cpuInfo;
 
 static void swapChar(void* a, void* b) {
 	char c = *(char*)a;
@@ -81,6 +94,53 @@ void recordMem(void* value) {
 	memInfo.size = readBigEndian64(value + 8);
 }
 
+/**
+ * @brief 记录 ns16550a 串口的寄存器基址、中断号和时钟
+ * @param reg：reg 属性（#address-cells = #size-cells = 2）
+ */
+static void recordUart(void* reg, uint32_t regLen, uint32_t irq, uint32_t clock) {
+	if (reg && regLen >= 16) {
+		uartInfo.base = readBigEndian64(reg);
+		uartInfo.size = readBigEndian64(reg + 8);
+	}
+	if (irq) uartInfo.irq = irq;
+	if (clock) uartInfo.clock = clock;
+}
+
+/**
+ * @brief 记录 PLIC 的寄存器基址和中断源个数
+ */
+static void recordPlic(void* reg, uint32_t regLen, uint32_t ndev) {
+	if (reg && regLen >= 16) {
+		plicInfo.base = readBigEndian64(reg);
+		plicInfo.size = readBigEndian64(reg + 8);
+	}
+	if (ndev) plicInfo.ndev = ndev;
+}
+
+/**
+ * @brief 记录一个 cpu 节点，reg 只有一个 cell（/cpus 的 #address-cells = 1）
+ */
+static void recordCpu(void* reg, uint32_t regLen, char* status) {
+	if (!reg || regLen < 4) return;
+	if (status != NULL && strcmp(status, "okay") != 0 && strcmp(status, "ok") != 0) return;
+	uint32_t hartid = readBigEndian32(reg);
+	cpuInfo.nr++;
+	if (hartid < 64) cpuInfo.hart_mask |= 1UL << hartid;
+}
+
+/**
+ * @brief compatible 属性是以 '\0' 分隔的字符串列表，逐个比较
+ */
+static int compatibleMatch(char* compatible, uint32_t len, const char* target) {
+	char* end = compatible + len;
+	while (compatible < end) {
+		if (strcmp(compatible, target) == 0) return 1;
+		compatible += strlen(compatible) + 1;
+	}
+	return 0;
+}
+
 /**
  * @brief 解析flatten device tree blob的单个Node，获取设备树的信息
  * @param fdtHeader：设备树的头指针
@@ -111,6 +171,11 @@ static void* parseFdtNode(struct FDTHeader* fdtHeader, void* node, char* parent)
 		if (readBigEndian32(node) == FDT_PROP) {
 			char* nodeStr = NULL;
 			void* value = NULL;
+			char* compatible = NULL;
+			char* deviceType = NULL;
+			char* status = NULL;
+			void* reg = NULL;
+			uint32_t compatibleLen = 0, regLen = 0, irq = 0, clock = 0, ndev = 0;
 
 			while (readBigEndian32(node) == FDT_PROP) {
 				node += 4;
@@ -118,7 +183,30 @@ static void* parseFdtNode(struct FDTHeader* fdtHeader, void* node, char* parent)
 				node += 4;
 				uint32_t nameoff = readBigEndian32(node);
 				node += 4;
-				char* name = (char*)(node + fdtHeader->off_dt_strings + nameoff);
+				char* name = (char*)fdtHeader + fdtHeader->off_dt_strings + nameoff;
+
+				// 设备节点关心的几个属性按名字记录，不依赖属性出现的顺序
+				if (strcmp(name, "compatible") == 0) {
+					compatible = (char*)node;
+					compatibleLen = len;
+				} else if (strcmp(name, "reg") == 0) {
+					reg = (void*)node;
+					regLen = len;
+				} else if (strcmp(name, "interrupts") == 0 && len >= 4) {
+					irq = readBigEndian32(node);
+				} else if (strcmp(name, "clock-frequency") == 0 && len >= 4) {
+					clock = readBigEndian32(node);
+				} else if (strcmp(name, "timebase-frequency") == 0 && len >= 4) {
+					// 一般在 /cpus 中，也可能出现在每个 cpu 节点里，各 hart 相同
+					cpuInfo.timebase = len >= 8 ? readBigEndian64(node) : readBigEndian32(node);
+				} else if (strcmp(name, "riscv,ndev") == 0 && len >= 4) {
+					ndev = readBigEndian32(node);
+				} else if (strcmp(name, "device_type") == 0) {
+					// "cpu" 连同结尾的 '\0' 正好 4 字节，会被下面当成数值，单独记录
+					deviceType = (char*)node;
+				} else if (strcmp(name, "status") == 0) {
+					status = (char*)node;
+				}
 
 				if (name[0] != '\0') {
 					// log(LEVEL_MODULE, "name:   %s\n", name);
@@ -151,6 +239,16 @@ static void* parseFdtNode(struct FDTHeader* fdtHeader, void* node, char* parent)
 				// memInfo.start = readBigEndian64(value);
 				// memInfo.size = readBigEndian64(value + 8);
 			}
+			if (compatible != NULL && compatibleMatch(compatible, compatibleLen, "ns16550a")) {
+				recordUart(reg, regLen, irq, clock);
+			}
+			if (compatible != NULL && (compatibleMatch(compatible, compatibleLen, "riscv,plic0") ||
+			                           compatibleMatch(compatible, compatibleLen, "sifive,plic-1.0.0"))) {
+				recordPlic(reg, regLen, ndev);
+			}
+			if (deviceType != NULL && strcmp(deviceType, "cpu") == 0) {
+				recordCpu(reg, regLen, status);
+			}
 		} else {
 			break;
 		}
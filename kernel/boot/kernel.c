@@ -3,14 +3,25 @@
  */
 
 #include <kernel/boot/dtb.h>
+#include <kernel/device/char_device.h>
+#include <kernel/device/irq.h>
+#include <kernel/device/plic.h>
 #include <kernel/device/sbi.h>
+#include <kernel/device/uart.h>
 #include <kernel/elf.h>
+#include <kernel/futex.h>
 #include <kernel/mmu.h>
+#include <kernel/percpu.h>
 #include <kernel/riscv.h>
 #include <kernel/sched.h>
 #include <kernel/syscall/syscall.h>
+#include <kernel/syscall/syscall_stat.h>
+#include <kernel/time.h>
 #include <kernel/types.h>
 #include <kernel/util.h>
+#include <kernel/util/klog.h>
+#include <kernel/util/lockstat.h>
+#include <kernel/vdso.h>
 #include <kernel/vfs.h>
 
 // 分配 (NCPU + 1) 个保护页 + NCPU 个实际栈页
@@ -68,8 +79,9 @@ static void kernel_vm_init(void) {
 
 	// pagetable_dump(g_kernel_pagetable);
 
-	// // 6. 映射MMIO区域（如果有需要）
-	// // 例如UART、PLIC等外设的内存映射IO区域
+	// 映射MMIO区域：串口和PLIC
+	pgt_map_pages(g_kernel_pagetable, uartInfo.base, uartInfo.base, ROUNDUP(uartInfo.size, PAGE_SIZE), prot_to_type(PROT_READ | PROT_WRITE, 0));
+	pgt_map_pages(g_kernel_pagetable, plicInfo.base, plicInfo.base, ROUNDUP(plicInfo.size, PAGE_SIZE), prot_to_type(PROT_READ | PROT_WRITE, 0));
 
 	kprintf("kern_vm_init: complete\n");
 }
@@ -112,9 +124,10 @@ int32 create_init_process(void) {
 	init_task = alloc_process(); // No parent for init
 	if (!init_task) return -ENOMEM;
 
-	// Set up process ID and other basic attributes
-	init_task->pid = 1;
+	// 第一个分配的 pid 就是 1
+	assert(init_task->pid == 1);
 	init_task->parent = NULL; // No parent
+	child_reaper = init_task;
 
 	setup_init_fds(init_task);
 	// Load the init binary
@@ -122,41 +135,40 @@ int32 create_init_process(void) {
 	if (error) goto fail_exec;
 
 	// Add to scheduler queue and start running
-	insert_to_ready_queue(init_task);
+	wake_up_new_task(init_task);
 
 	// we should never reach here.
 	return 0;
 
 fail_exec:
-	// Clean up file descriptors
-	for (int fd = 0; fd < init_task->fdtable->max_fds; fd++) {
-		if (init_task->fdtable->fd_array[fd]) fdtable_closeFd(init_task->fdtable, fd);
-	}
-fail_fds:
-	fs_struct_unref(init_task->fs);
-fail_fs:
+	// 文件描述符随 fdtable 一起关闭
+	child_reaper = NULL;
 	free_process(init_task);
 	return error;
 }
 
 void start_trap() { while (1); }
 
-struct task_struct boot_task;
-
+// 每个 hart 在第一次 schedule() 之前运行在自己的启动上下文中
+struct task_struct boot_task[NCPU];
+struct trapframe boot_trapframe[NCPU];
 
-struct trapframe boot_trapframe;
-// 这个boot_trapframe应该给每个核都发一个
 void boot_trap_setup(void){
-	current_percpu[read_tp()] = &boot_task;
-	boot_task.trapframe = &boot_trapframe;
-
-	extern char smode_trap_vector[];
+	int32 hartid = smp_processor_id();
+	raw_cpu_write(current_percpu, &boot_task[hartid]);
+	// 启动上下文在第一次 schedule() 之前不可抢占
+	boot_task[hartid].preempt_count = PREEMPT_OFFSET;
+	boot_task[hartid].trapframe = &boot_trapframe[hartid];
+
+	// 启动阶段还在内核态，陷阱走内核入口；第一次返回用户态时 ret_to_user 换成 smode_trap_vector
+	extern char kernel_trap_vector[];
+	write_csr(stvec, (uint64)kernel_trap_vector);
 	write_csr(sstatus, read_csr(sstatus) | SSTATUS_SIE);
-	write_csr(stvec, (uint64)smode_trap_vector);
-	write_csr(sscratch, (uint64)&boot_trapframe);
+	write_csr(sscratch, (uint64)&boot_trapframe[hartid]);
 	uint64 ksp = read_reg(sp);
-	boot_trapframe.kernel_sp = ROUNDUP(ksp, PAGE_SIZE);
-	boot_trapframe.kernel_schedule = (uint64)schedule;
+	boot_trapframe[hartid].kernel_sp = ROUNDUP(ksp, PAGE_SIZE);
+	boot_trapframe[hartid].kernel_schedule = (uint64)schedule;
+	boot_trapframe[hartid].kernel_tp = read_tp();
 
 	return;
 }
@@ -165,68 +177,95 @@ void boot_trap_setup(void){
 //
 // s_start: S-mode entry point of riscv-pke OS kernel.
 //
+// 启动 hart 完成全局初始化后清零，其余 hart 才能使用内核页表和各个子系统
 volatile static int32 sig = 1;
-volatile static int counter = 0;
+
+extern void init_idle_task(void);
+
+/*
+ * 从核：等启动 hart 完成初始化，然后建立本 hart 的 idle 任务、中断和时钟节拍，
+ * 上线后进入调度器，不再返回。
+ */
+static void secondary_start(uintptr_t hartid) {
+	while (sig) {
+	}
+	smp_rmb();
+	pagetable_activate(g_kernel_pagetable);
+	// per-CPU 副本已经由启动 hart 分配好，换上自己的那一份之后才能使用 CURRENT
+	percpu_init_hart(hartid);
+	boot_trap_setup();
+	fpu_init_hart();
+	boot_trapframe[hartid].kernel_satp = MAKE_SATP(g_kernel_pagetable);
+
+	write_csr(sie, read_csr(sie) | SIE_SEIE | SIE_SSIE);
+	plic_init_hart();
+	init_idle_task();
+	timer_init_hart();
+	set_cpu_online(hartid);
+	kprintf("hart %d online\n", hartid);
+	schedule();
+}
 
 void s_start(uintptr_t hartid, uintptr_t dtb) {
-	write_tp(hartid);
+	// 第一个到达的 hart 负责全局初始化。SBI 只放出一个 hart，其余的由它经 HSM 启动；
+	// 不支持 HSM 的固件会同时放出所有 hart，它们在 secondary_start 中等待。
+	// 从核在 per-CPU 副本分配好之前不能碰 tp 和 per-CPU 变量
+	if (!smp_claim_boot_hart(hartid)) {
+		secondary_start(hartid);
+		// we should never reach here.
+		return;
+	}
+
+	// 在 setup_per_cpu_areas 之前启动 hart 直接使用 per-CPU 模板
+	percpu_init_hart(hartid);
 	boot_trap_setup();
+	// 内核不使用浮点，用户任务的浮点现场在第一次使用时装载
+	fpu_init_hart();
 	// 最重要！先把中断服务程序挂上去，不然崩溃都不知道怎么死的。
 
-	if (hartid == 0) {
-		// spike_file_init(); //TODO: 将文件系统迁移到 QEMU
-		// init_dtb(dtb);
-		parseDtb(dtb);
-	}
-	if (NCPU > 1) sync_barrier(&counter, NCPU);
-	write_csr(sie, read_csr(sie) | SIE_SEIE | SIE_STIE); // 不启用核间中断（暂时） TODO
-
-	// init timing. added @lab1_3
-	// lab1_challenge1 为了调试便利，禁用了外部时钟中断：
-	// timerinit(hartid);
-
-	// switch to supervisor mode (S mode) and jump to s_start(), i.e., set pc to
-	// mepc
-	// asm volatile("mret");
-	// 在内核初始化早期添加
-	// kprintf("Current privilege level: %ld\n", (read_csr(mstatus) >> 11) & 3);
-	// kprintf("stvec: 0x%lx\n", read_csr(stvec));
-	// kprintf("medeleg: 0x%lx\n", read_csr(medeleg));
-	// kprintf("mideleg: 0x%lx\n", read_csr(mideleg));
-	// kprintf("sstatus: 0x%lx\n", read_csr(sstatus));
-	// kprintf("sie: 0x%lx\n", read_csr(sie));
-	// kprintf("In m_start, hartid:%d\n", hartid);
+	// spike_file_init(); //TODO: 将文件系统迁移到 QEMU
+	// init_dtb(dtb);
+	parseDtb(dtb);
+	// 时钟源频率来自设备树，必须在任何 hart 打开时钟节拍之前确定
+	time_init();
+	write_csr(sie, read_csr(sie) | SIE_SEIE | SIE_SSIE);
 
 	//write_csr(stvec, (uint64)start_trap);
 
-	extern void init_idle_task(void);
-
 	kprintf("Enter supervisor mode...\n");
 	write_csr(satp, 0);
 
-	if (hartid == 0) {
-		init_page_manager();
-		kernel_vm_init();
-		pagetable_activate(g_kernel_pagetable);
-		boot_trapframe.kernel_satp = MAKE_SATP(g_kernel_pagetable);
-		create_init_mm();
-		kmem_init();
-		init_scheduler();
-
-		init_idle_task();
-		// kmalloc在形式上需要使用init_mm的“用户虚拟空间分配器”
-		// 所以我们在启用kmalloc之前，需要先初始化0号进程
-
-		// init_scheduler();
-		vfs_init();
-		sig = 0;
-	} else {
-		while (sig) {
-		}
-		pagetable_activate(g_kernel_pagetable);
-	}
-
-	// sync_barrier(&sync_counter, NCPU);
+	init_page_manager();
+	kernel_vm_init();
+	pagetable_activate(g_kernel_pagetable);
+	boot_trapframe[hartid].kernel_satp = MAKE_SATP(g_kernel_pagetable);
+	// 串口接管控制台输出，此后 kprintf 不再逐字节陷入 SBI
+	console_init();
+	plic_init();
+	create_init_mm();
+	kmem_init();
+	setup_per_cpu_areas();
+	boot_trapframe[hartid].kernel_tp = read_tp();
+	vdso_init();
+	init_scheduler();
+	futex_init();
+
+	init_idle_task();
+	set_cpu_online(hartid);
+	// kmalloc在形式上需要使用init_mm的“用户虚拟空间分配器”
+	// 所以我们在启用kmalloc之前，需要先初始化0号进程
+
+	vfs_init();
+	syscall_stat_init();
+	lockstat_init();
+	irq_stat_init();
+	log_mask_init();
+	smp_wmb();
+	sig = 0;
+	smp_boot_secondary_harts(dtb);
+
+	plic_init_hart();
+	uart_enable_irq();
 
 	//  写入satp寄存器并刷新tlb缓存
 	//    从这里开始，所有内存访问都通过MMU进行虚实转换
@@ -235,6 +274,9 @@ void s_start(uintptr_t hartid, uintptr_t dtb) {
 	// the application code (elf) is first loaded into memory, and then put into
 	// execution added @lab3_1
 	create_init_process();
+	// 调度器接管之后，控制台输出交给 idle/时钟节拍异步排空
+	klog_set_async(1);
+	timer_init_hart();
 	schedule();
 	// we should never reach here.
 	return;
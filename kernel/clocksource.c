@@ -0,0 +1,37 @@
+/*
+ * time CSR 时钟源，见 include/kernel/clocksource.h
+ */
+
+#include <kernel/clocksource.h>
+#include <kernel/config.h>
+#include <kernel/util.h>
+
+#define CLOCKSOURCE_SHIFT 32
+
+static uint64 riscv_clocksource_read(void) { return read_csr(time); }
+
+// 在 clocksource_init 之前按默认频率换算，早期的 klog 时间戳也是对的
+struct clocksource riscv_clocksource = {
+    .name = "riscv_time",
+    .read = riscv_clocksource_read,
+    .freq = TIMEBASE_FREQUENCY,
+    .mult = (1000000000ULL << CLOCKSOURCE_SHIFT) / TIMEBASE_FREQUENCY,
+    .shift = CLOCKSOURCE_SHIFT,
+};
+
+uint64 ns_to_cycles(uint64 ns) {
+	const uint64 freq = riscv_clocksource.freq;
+	// 分成整秒和余数两部分，余数乘 freq 不会溢出 64 位
+	uint64 cycles = ns / 1000000000ULL * freq + ((ns % 1000000000ULL) * freq + 999999999ULL) / 1000000000ULL;
+
+	// mult 是截断得到的，cycles_to_ns 比精确值略小，运行很久之后会差出几个计数，补上
+	while (cycles_to_ns(cycles) < ns) cycles += (ns - cycles_to_ns(cycles)) * freq / 1000000000ULL + 1;
+	return cycles;
+}
+
+void clocksource_init(uint64 freq) {
+	if (!freq) freq = TIMEBASE_FREQUENCY;
+	riscv_clocksource.freq = freq;
+	riscv_clocksource.mult = (1000000000ULL << CLOCKSOURCE_SHIFT) / freq;
+	kprintf("clocksource: %s, %lu Hz\n", riscv_clocksource.name, freq);
+}
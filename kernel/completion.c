@@ -0,0 +1,60 @@
+/*
+ * 完成量，见 include/kernel/completion.h
+ */
+
+#include <kernel/completion.h>
+#include <kernel/sched.h>
+#include <kernel/util.h>
+
+/**
+ * try_wait_for_completion - 不睡眠地取走一次完成
+ *
+ * Returns: 1 表示取到，0 表示还没有完成
+ */
+int32 try_wait_for_completion(struct completion* x) {
+	int32 ret = 1;
+	int64 flags = spinlock_lock_irqsave(&x->wait.lock);
+	if (!x->done)
+		ret = 0;
+	else if (x->done != COMPLETION_ALL)
+		x->done--;
+	spinlock_unlock_irqrestore(&x->wait.lock, flags);
+	return ret;
+}
+
+// 是否有尚未被取走的完成，不消耗计数
+int32 completion_done(struct completion* x) { return READ_ONCE(x->done) != 0; }
+
+// 每次 complete() 只唤醒一个等待者，所以都以排他方式等待
+void wait_for_completion(struct completion* x) { wait_event_exclusive(x->wait, try_wait_for_completion(x)); }
+
+// Returns: 0 表示已完成，-EINTR 表示被信号打断
+int32 wait_for_completion_interruptible(struct completion* x) {
+	return wait_event_interruptible_exclusive(x->wait, try_wait_for_completion(x));
+}
+
+// Returns: 剩余节拍数（完成时至少为 1），超时返回 0
+int64 wait_for_completion_timeout(struct completion* x, int64 timeout) {
+	if (try_wait_for_completion(x)) return timeout ? timeout : 1;
+	return ___wait_event(x->wait, try_wait_for_completion(x), TASK_UNINTERRUPTIBLE, 1, timeout);
+}
+
+/**
+ * complete - 完成一次，唤醒一个等待者
+ *
+ * 可以在中断上下文中调用。
+ */
+void complete(struct completion* x) {
+	int64 flags = spinlock_lock_irqsave(&x->wait.lock);
+	if (x->done != COMPLETION_ALL) x->done++;
+	__wake_up_locked(&x->wait, TASK_NORMAL, 1, NULL);
+	spinlock_unlock_irqrestore(&x->wait.lock, flags);
+}
+
+// 之后的等待全部立即返回，唤醒所有等待者
+void complete_all(struct completion* x) {
+	int64 flags = spinlock_lock_irqsave(&x->wait.lock);
+	x->done = COMPLETION_ALL;
+	__wake_up_locked(&x->wait, TASK_NORMAL, 0, NULL);
+	spinlock_unlock_irqrestore(&x->wait.lock, flags);
+}
@@ -1,5 +1,6 @@
 #include <kernel/device/buffer_head.h>
 #include <kernel/mm/kmalloc.h>
+#include <kernel/sched/preempt.h>
 #include <kernel/types.h>
 #include <kernel/util/hashtable.h>
 #include <kernel/util/list.h>
@@ -61,7 +62,7 @@ struct buffer_head* alloc_buffer_head(void) {
 	if (bh) {
 		memset(bh, 0, sizeof(struct buffer_head));
 		INIT_LIST_HEAD(&bh->b_lru);
-		spinlock_init(&bh->b_lock);
+		init_waitqueue_head(&bh->b_wait);
 		atomic_set(&bh->b_count, 0);
 	}
 	return bh;
@@ -226,25 +227,21 @@ void ll_rw_block(int32 rw, int32 nr, struct buffer_head* bhs[]) {
 	}
 }
 
-// 锁住一个缓冲区
+// 锁住一个缓冲区，BH_Lock 就是锁本身，拿不到时在 b_wait 上睡眠
 void lock_buffer(struct buffer_head* bh) {
-	spinlock_lock(&bh->b_lock);
-	set_buffer_locked(bh);
+	// 排他等待：解锁时只放一个加锁者进来
+	wait_event_exclusive(bh->b_wait, !test_and_set_bit(BH_Lock, &bh->b_state));
 }
 
-// 解锁一个缓冲区
+// 解锁一个缓冲区，唤醒 wait_on_buffer 的等待者和下一个加锁者
 void unlock_buffer(struct buffer_head* bh) {
-	clear_buffer_locked(bh);
-	spinlock_unlock(&bh->b_lock);
+	clear_bit_unlock(BH_Lock, &bh->b_state);
+	wake_up(&bh->b_wait);
 }
 
 // 等待缓冲区操作完成
 void wait_on_buffer(struct buffer_head* bh) {
-	while (buffer_locked(bh)) {
-		// 在实际实现中，这里应该使用睡眠/唤醒机制
-		// 简单起见，使用简单的轮询
-		// yield_cpu(); // 让出CPU时间
-	}
+	wait_event(bh->b_wait, !buffer_locked(bh));
 }
 
 // 初始化buffer_head子系统
@@ -271,11 +268,26 @@ int32 sync_dirty_buffers(struct block_device* bdev) {
 	// 需要实现一个额外的设备->缓冲区映射或修改哈希表接口
 
 	// 简单起见，遍历LRU列表查找该设备的脏缓冲区
+restart:
 	spinlock_lock(&bh_lru_lock);
 	list_for_each_entry(bh, &bh_lru_list, b_lru) {
 		if (bh->b_bdev == bdev && buffer_dirty(bh)) {
+			// 写回可能要睡眠等待缓冲区锁，不能持有 bh_lru_lock。
+			// 写失败的缓冲区仍然是脏的，重新扫描会反复碰到它，直接返回错误
+			atomic_inc(&bh->b_count);
+			spinlock_unlock(&bh_lru_lock);
 			int32 err = sync_dirty_buffer(bh);
-			if (err && !ret) ret = err;
+			atomic_dec(&bh->b_count);
+			if (err) return err;
+			cond_resched();
+			goto restart;
+		}
+		// LRU 很长时让出 CPU。放锁期间链表可能变化，只能从头重新扫描，
+		// 已经写回的缓冲区不再是脏的，不会被重复同步
+		if (need_resched()) {
+			spinlock_unlock(&bh_lru_lock);
+			cond_resched();
+			goto restart;
 		}
 	}
 	spinlock_unlock(&bh_lru_lock);
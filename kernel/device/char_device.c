@@ -0,0 +1,147 @@
+#include <kernel/device/char_device.h>
+#include <kernel/types.h>
+#include <kernel/util.h>
+#include <kernel/util/print.h>
+#include <kernel/vfs.h>
+
+/* Global character device list */
+static struct list_head char_device_list = {&char_device_list, &char_device_list};
+static spinlock_t char_device_list_lock = SPINLOCK_INIT;
+
+/**
+ * cdev_register - Make a character device visible to device node lookups
+ * @cdev: Driver-owned character device, cd_dev and ops must be set
+ *
+ * Returns: 0 on success, -EBUSY if the device number is already taken
+ */
+int32 cdev_register(struct char_device* cdev) {
+	struct char_device* cur;
+
+	if (!cdev || !cdev->ops) return -EINVAL;
+
+	spinlock_lock(&char_device_list_lock);
+	list_for_each_entry(cur, &char_device_list, cd_list) {
+		if (cur->cd_dev == cdev->cd_dev) {
+			spinlock_unlock(&char_device_list_lock);
+			return -EBUSY;
+		}
+	}
+	atomic_set(&cdev->cd_count, 0);
+	list_add(&cdev->cd_list, &char_device_list);
+	spinlock_unlock(&char_device_list_lock);
+	return 0;
+}
+
+/**
+ * cdev_unregister - Remove a character device from the lookup list
+ * @cdev: Character device previously passed to cdev_register
+ */
+void cdev_unregister(struct char_device* cdev) {
+	spinlock_lock(&char_device_list_lock);
+	list_del_init(&cdev->cd_list);
+	spinlock_unlock(&char_device_list_lock);
+	if (atomic_read(&cdev->cd_count) > 0) kprintf("Warning: unregistering char device 0x%x with active references\n", cdev->cd_dev);
+}
+
+/**
+ * cdev_get - Look up a character device and take a reference
+ * @dev: Device number
+ *
+ * Returns: Character device or NULL if no driver is registered
+ */
+struct char_device* cdev_get(dev_t dev) {
+	struct char_device* cdev;
+
+	spinlock_lock(&char_device_list_lock);
+	list_for_each_entry(cdev, &char_device_list, cd_list) {
+		if (cdev->cd_dev == dev) {
+			atomic_inc(&cdev->cd_count);
+			spinlock_unlock(&char_device_list_lock);
+			return cdev;
+		}
+	}
+	spinlock_unlock(&char_device_list_lock);
+	return NULL;
+}
+
+/**
+ * cdev_put - Drop a reference taken by cdev_get
+ */
+void cdev_put(struct char_device* cdev) {
+	if (cdev) atomic_dec(&cdev->cd_count);
+}
+
+/**
+ * cdev_create_nodes - Create /dev entries for every named character device
+ * @dev_dir: The /dev directory dentry
+ *
+ * Returns: 0, failures for individual nodes are only reported
+ */
+int32 cdev_create_nodes(struct dentry* dev_dir) {
+	struct char_device* cdev;
+
+	spinlock_lock(&char_device_list_lock);
+	list_for_each_entry(cdev, &char_device_list, cd_list) {
+		if (!cdev->cd_name) continue;
+		struct dentry* nod_dentry = vfs_mknod(dev_dir, cdev->cd_name, S_IFCHR | 0600, cdev->cd_dev);
+		if (PTR_IS_ERROR(nod_dentry)) {
+			kprintf("Failed to create device node /dev/%s: %d\n", cdev->cd_name, PTR_ERR(nod_dentry));
+			continue;
+		}
+		kprintf("Created device node /dev/%s (dev=0x%x)\n", cdev->cd_name, cdev->cd_dev);
+		dentry_unref(nod_dentry);
+	}
+	spinlock_unlock(&char_device_list_lock);
+	return 0;
+}
+
+static int32 chrdev_open(struct file* file, int32 flags) {
+	struct char_device* cdev = cdev_get(file->f_inode->i_rdev);
+	int32 ret = 0;
+
+	if (!cdev) return -ENXIO;
+	file->f_private = cdev;
+	if (cdev->ops->open) ret = cdev->ops->open(cdev, file);
+	if (ret) {
+		file->f_private = NULL;
+		cdev_put(cdev);
+	}
+	return ret;
+}
+
+static int32 chrdev_release(struct file* file) {
+	struct char_device* cdev = file->f_private;
+	int32 ret = 0;
+
+	if (!cdev) return 0;
+	if (cdev->ops->release) ret = cdev->ops->release(cdev, file);
+	file->f_private = NULL;
+	cdev_put(cdev);
+	return ret;
+}
+
+static ssize_t chrdev_read(struct file* file, char* buf, size_t count, loff_t* ppos) {
+	struct char_device* cdev = file->f_private;
+	if (!cdev || !cdev->ops->read) return -EINVAL;
+	return cdev->ops->read(cdev, file, buf, count, ppos);
+}
+
+static ssize_t chrdev_write(struct file* file, const char* buf, size_t count, loff_t* ppos) {
+	struct char_device* cdev = file->f_private;
+	if (!cdev || !cdev->ops->write) return -EINVAL;
+	return cdev->ops->write(cdev, file, buf, count, ppos);
+}
+
+static loff_t chrdev_llseek(struct file* file, loff_t offset, int32 whence) {
+	struct char_device* cdev = file->f_private;
+	if (!cdev || !cdev->ops->llseek) return -ESPIPE;
+	return cdev->ops->llseek(cdev, file, offset, whence);
+}
+
+const struct file_operations chFile_operations = {
+    .open = chrdev_open,
+    .release = chrdev_release,
+    .read = chrdev_read,
+    .write = chrdev_write,
+    .llseek = chrdev_llseek,
+};
@@ -1,5 +1,6 @@
 #include <kernel/device/interface.h>
 #include <kernel/device/sbi.h>
+#include <kernel/device/uart.h>
 // #include <dev/sd.h>
 // #include <dev/uart.h>
 // #include <dev/virtio.h>
@@ -32,9 +33,27 @@
 // #endif
 // }
 
+// 串口驱动初始化之前（以及没有串口的平台上）仍然经过 SBI 输出
 void cons_putc(int c) {
-	SBI_PUTCHAR(c);
-	// uart_putchar(c);
+	if (uart0.ready) {
+		uart_putc(c);
+	} else {
+		SBI_PUTCHAR(c);
+	}
+}
+
+void cons_write(const char* buf, size_t len) {
+	if (uart0.ready) {
+		uart_write(buf, len);
+	} else {
+		for (size_t i = 0; i < len; i++) SBI_PUTCHAR(buf[i]);
+	}
+}
+
+int cons_getc() {
+	if (uart0.ready) return uart_getc();
+	int c = (uint8)SBI_GETCHAR();
+	return c == 255 ? -1 : c;
 }
 
 // #define GETC_EMPTY ((char)255)
@@ -1,4 +1,5 @@
 #include <kernel/device/block_device.h>
+#include <kernel/device/char_device.h>
 #include <kernel/util/print.h>
 #include <kernel/util.h>
 #include <kernel/vfs.h>
@@ -43,6 +44,9 @@ int32 create_device_nodes(void) {
 		return PTR_ERR(dev_dir);
 	}
 
+	/* Character devices registered by drivers (console, statistics, ...) */
+	cdev_create_nodes(dev_dir);
+
 	/* Lock the block device list */
 	spinlock_lock(&block_device_list_lock);
 
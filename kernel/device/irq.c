@@ -0,0 +1,225 @@
+#include <kernel/boot/dtb.h>
+#include <kernel/device/char_device.h>
+#include <kernel/device/irq.h>
+#include <kernel/device/plic.h>
+#include <kernel/percpu.h>
+#include <kernel/riscv.h>
+#include <kernel/types.h>
+#include <kernel/util.h>
+#include <kernel/mm/kmalloc.h>
+#include <kernel/util/print.h>
+#include <kernel/util/seq_buf.h>
+
+static struct irq_desc irq_descs[NR_IRQS];
+static spinlock_t irq_desc_lock = SPINLOCK_INIT;
+
+static inline int32 irq_valid(uint32 irq) { return irq > 0 && irq < NR_IRQS && irq <= plicInfo.ndev; }
+
+/*
+ * 按亲和性掩码设置每个 hart 上的使能位，调用者持有 irq_desc_lock
+ */
+static void irq_apply_affinity(uint32 irq, uint64 mask) {
+	for (int32 hart = 0; hart < NCPU; hart++) {
+		if (mask & (1UL << hart)) {
+			plic_enable_hart(irq, hart);
+		} else {
+			plic_disable_hart(irq, hart);
+		}
+	}
+}
+
+/**
+ * request_irq - Install a handler for an external interrupt
+ * @irq: PLIC interrupt source number
+ * @handler: Called in interrupt context with the irq and dev_id
+ * @name: Short name for statistics output
+ * @dev_id: Cookie passed back to the handler and required by free_irq
+ *
+ * The source is enabled on the harts in its affinity mask (hart 0 unless
+ * irq_set_affinity was called earlier).
+ *
+ * Returns: 0 on success, -EINVAL for a bad irq, -EBUSY if already taken
+ */
+int32 request_irq(uint32 irq, irq_handler_t handler, const char* name, void* dev_id) {
+	if (!irq_valid(irq) || !handler) return -EINVAL;
+
+	int64 flags = spinlock_lock_irqsave(&irq_desc_lock);
+	struct irq_desc* desc = &irq_descs[irq];
+	if (desc->handler) {
+		spinlock_unlock_irqrestore(&irq_desc_lock, flags);
+		return -EBUSY;
+	}
+	desc->dev_id = dev_id;
+	desc->name = name;
+	if (!desc->affinity) desc->affinity = IRQ_AFFINITY_DEFAULT;
+	smp_wmb();
+	desc->handler = handler;
+
+	plic_set_priority(irq, 1);
+	irq_apply_affinity(irq, desc->affinity);
+	spinlock_unlock_irqrestore(&irq_desc_lock, flags);
+
+	log_info(LOG_SUB_DEV, "irq %d: registered %s\n", irq, name);
+	return 0;
+}
+
+/**
+ * free_irq - Remove a handler installed by request_irq
+ * @irq: PLIC interrupt source number
+ * @dev_id: Must match the cookie given to request_irq
+ */
+void free_irq(uint32 irq, void* dev_id) {
+	if (!irq_valid(irq)) return;
+
+	int64 flags = spinlock_lock_irqsave(&irq_desc_lock);
+	struct irq_desc* desc = &irq_descs[irq];
+	if (!desc->handler || desc->dev_id != dev_id) {
+		spinlock_unlock_irqrestore(&irq_desc_lock, flags);
+		log_warn(LOG_SUB_DEV, "free_irq: irq %d not owned by %p\n", irq, dev_id);
+		return;
+	}
+	irq_apply_affinity(irq, 0);
+	plic_set_priority(irq, 0);
+	desc->handler = NULL;
+	desc->dev_id = NULL;
+	desc->name = NULL;
+	spinlock_unlock_irqrestore(&irq_desc_lock, flags);
+}
+
+/**
+ * irq_set_affinity - Choose which harts may receive an interrupt
+ * @irq: PLIC interrupt source number
+ * @mask: Bitmask of hart ids, bits beyond NCPU are ignored
+ *
+ * If several harts are enabled, whichever claims first handles it.
+ *
+ * Returns: 0 on success, -EINVAL if the mask selects no hart
+ */
+int32 irq_set_affinity(uint32 irq, uint64 mask) {
+	if (!irq_valid(irq)) return -EINVAL;
+	mask &= IRQ_AFFINITY_ALL;
+	if (!mask) return -EINVAL;
+
+	int64 flags = spinlock_lock_irqsave(&irq_desc_lock);
+	struct irq_desc* desc = &irq_descs[irq];
+	desc->affinity = mask;
+	if (desc->handler) irq_apply_affinity(irq, mask);
+	spinlock_unlock_irqrestore(&irq_desc_lock, flags);
+	return 0;
+}
+
+uint64 irq_get_affinity(uint32 irq) {
+	if (!irq_valid(irq)) return 0;
+	return irq_descs[irq].affinity ? irq_descs[irq].affinity : IRQ_AFFINITY_DEFAULT;
+}
+
+uint64 irq_get_count(uint32 irq, int32 cpu) {
+	if (!irq_valid(irq) || cpu < 0 || cpu >= NCPU) return 0;
+	return READ_ONCE(irq_descs[irq].count[cpu]);
+}
+
+/**
+ * generic_handle_irq - Dispatch a claimed interrupt to its handler
+ *
+ * 计数只由本 hart 写自己的那一格，不需要原子操作。
+ */
+void generic_handle_irq(uint32 irq) {
+	if (irq >= NR_IRQS) {
+		log_warn(LOG_SUB_DEV, "irq %d out of range\n", irq);
+		return;
+	}
+	struct irq_desc* desc = &irq_descs[irq];
+	irq_handler_t handler = READ_ONCE(desc->handler);
+
+	desc->count[smp_processor_id()]++;
+	if (!handler) {
+		desc->unhandled++;
+		log_warn(LOG_SUB_DEV, "irq %d: no handler\n", irq);
+		return;
+	}
+	smp_rmb();
+	handler(irq, desc->dev_id);
+}
+
+#define IRQ_STAT_BUF_SIZE (8 * 1024)
+
+// 按 /proc/interrupts 的格式输出每个中断源在各个 hart 上的计数
+static void irq_stat_render(struct seq_buf* s) {
+	seq_buf_printf(s, "IRQ ");
+	for (int32 cpu = 0; cpu < NCPU; cpu++) seq_buf_printf(s, "      CPU%d", cpu);
+	seq_buf_printf(s, "   affinity name\n");
+
+	for (uint32 irq = 1; irq < NR_IRQS && irq <= plicInfo.ndev; irq++) {
+		struct irq_desc* desc = &irq_descs[irq];
+		const char* name = READ_ONCE(desc->name);
+		if (!READ_ONCE(desc->handler) && !desc->unhandled) continue;
+		seq_buf_printf(s, "%3d:", irq);
+		for (int32 cpu = 0; cpu < NCPU; cpu++) seq_buf_printf(s, " %10lu", irq_get_count(irq, cpu));
+		seq_buf_printf(s, " %10lx %s\n", irq_get_affinity(irq), name ? name : "(none)");
+	}
+	if (s->overflow) seq_buf_printf(s, "...\n");
+}
+
+static ssize_t irq_stat_read(struct char_device* cdev, struct file* file, char* buf, size_t count, loff_t* ppos) {
+	struct seq_buf s;
+	char* text = kmalloc(IRQ_STAT_BUF_SIZE);
+	if (!text) return -ENOMEM;
+
+	seq_buf_init(&s, text, IRQ_STAT_BUF_SIZE);
+	irq_stat_render(&s);
+	ssize_t ret = seq_buf_read(&s, buf, count, ppos);
+	kfree(text);
+	return ret;
+}
+
+// 解析一个无符号数，跳过前导空白，返回读过的字符数，没有数字时返回 0
+static size_t parse_uint(const char* buf, size_t count, int32 base, uint64* val) {
+	size_t i = 0, start;
+
+	*val = 0;
+	while (i < count && (buf[i] == ' ' || buf[i] == '\t')) i++;
+	if (base == 16 && i + 1 < count && buf[i] == '0' && (buf[i + 1] == 'x' || buf[i + 1] == 'X')) i += 2;
+	for (start = i; i < count; i++) {
+		char c = buf[i];
+		int32 d;
+		if (c >= '0' && c <= '9')
+			d = c - '0';
+		else if (base == 16 && c >= 'a' && c <= 'f')
+			d = c - 'a' + 10;
+		else if (base == 16 && c >= 'A' && c <= 'F')
+			d = c - 'A' + 10;
+		else
+			break;
+		*val = *val * base + d;
+	}
+	return i > start ? i : 0;
+}
+
+/*
+ * 写入 "<irq> <mask>" 设置亲和性，irq 为十进制，mask 为十六进制的 hart 掩码
+ */
+static ssize_t irq_stat_write(struct char_device* cdev, struct file* file, const char* buf, size_t count, loff_t* ppos) {
+	uint64 irq, mask;
+	size_t n = parse_uint(buf, count, 10, &irq);
+	if (!n || n == count || irq >= NR_IRQS) return -EINVAL;
+	if (!parse_uint(buf + n, count - n, 16, &mask)) return -EINVAL;
+
+	int32 ret = irq_set_affinity(irq, mask);
+	return ret ? ret : (ssize_t)count;
+}
+
+static const struct char_device_operations irq_stat_ops = {
+    .read = irq_stat_read,
+    .write = irq_stat_write,
+};
+
+static struct char_device irq_stat_cdev = {
+    .cd_dev = IRQ_STAT_DEV,
+    .cd_name = "interrupts",
+    .ops = &irq_stat_ops,
+};
+
+/**
+ * irq_stat_init - 注册 /dev/interrupts：读出计数和亲和性，写入设置亲和性
+ */
+void irq_stat_init(void) { cdev_register(&irq_stat_cdev); }
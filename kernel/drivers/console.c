@@ -0,0 +1,53 @@
+/*
+ * /dev/console 字符设备
+ *
+ * 写入直接进入串口发送环；读取从串口接收环中取数据。
+ */
+
+#include <kernel/device/char_device.h>
+#include <kernel/device/interface.h>
+#include <kernel/device/uart.h>
+#include <kernel/riscv.h>
+#include <kernel/sched.h>
+#include <kernel/util.h>
+
+static ssize_t console_read(struct char_device* cdev, struct file* file, char* buf, size_t count, loff_t* ppos) {
+	size_t n;
+
+	if (count == 0) return 0;
+	// 接收环为空时睡眠，由接收中断唤醒；多个读者被唤醒后可能有人读不到，重新等待
+	while ((n = uart_read(buf, count)) == 0) {
+		int64 ret = wait_event_interruptible(uart0.rx_wait, uart_rx_pending());
+		if (ret) return ret;
+	}
+	for (size_t i = 0; i < n; i++) {
+		if (buf[i] == '\r') buf[i] = '\n';
+	}
+	return n;
+}
+
+static ssize_t console_write(struct char_device* cdev, struct file* file, const char* buf, size_t count, loff_t* ppos) {
+	cons_write(buf, count);
+	return count;
+}
+
+static const struct char_device_operations console_ops = {
+    .read = console_read,
+    .write = console_write,
+};
+
+static struct char_device console_cdev = {
+    .cd_dev = CONSOLE_DEV,
+    .cd_name = "console",
+    .ops = &console_ops,
+};
+
+/**
+ * console_init - 初始化串口并注册 /dev/console
+ *
+ * 需要在串口的 MMIO 区域映射之后调用，此后 kprintf 不再经过 SBI。
+ */
+void console_init(void) {
+	uart_init();
+	cdev_register(&console_cdev);
+}
@@ -0,0 +1,76 @@
+/*
+ * PLIC 驱动
+ *
+ * 只负责寄存器层面的操作：优先级、每个 hart 的使能位和阈值、claim/complete。
+ * 中断号到处理函数的映射、亲和性和统计由 kernel/device/irq.c 管理。
+ */
+
+#include <kernel/boot/dtb.h>
+#include <kernel/device/irq.h>
+#include <kernel/device/plic.h>
+#include <kernel/percpu.h>
+#include <kernel/riscv.h>
+#include <kernel/util.h>
+
+static uint64 plic_base;
+
+#define PLIC_REG(off) ((volatile uint32*)(plic_base + (off)))
+
+// 使能寄存器按位存放，同一个字可能被多个 hart 的 request_irq/irq_set_affinity 并发修改
+static spinlock_t plic_enable_lock = SPINLOCK_INIT;
+
+void plic_set_priority(uint32 irq, uint32 priority) { *PLIC_REG(PLIC_PRIORITY_OFF + irq * 4) = priority; }
+
+void plic_set_threshold(int32 hart, uint32 threshold) { *PLIC_REG(PLIC_THRESHOLD_OFF(PLIC_SCONTEXT(hart))) = threshold; }
+
+void plic_enable_hart(uint32 irq, int32 hart) {
+	volatile uint32* reg = PLIC_REG(PLIC_ENABLE_OFF(PLIC_SCONTEXT(hart)) + (irq / 32) * 4);
+	int64 flags = spinlock_lock_irqsave(&plic_enable_lock);
+	*reg |= (1U << (irq % 32));
+	spinlock_unlock_irqrestore(&plic_enable_lock, flags);
+}
+
+void plic_disable_hart(uint32 irq, int32 hart) {
+	volatile uint32* reg = PLIC_REG(PLIC_ENABLE_OFF(PLIC_SCONTEXT(hart)) + (irq / 32) * 4);
+	int64 flags = spinlock_lock_irqsave(&plic_enable_lock);
+	*reg &= ~(1U << (irq % 32));
+	spinlock_unlock_irqrestore(&plic_enable_lock, flags);
+}
+
+/**
+ * plic_init - 把所有中断源的优先级清零，只需要由 0 号核调用一次
+ *
+ * 优先级为 0 的中断源永远不会被送达，request_irq 时才会打开。
+ */
+void plic_init(void) {
+	plic_base = plicInfo.base;
+	for (uint32 irq = 1; irq <= plicInfo.ndev; irq++) plic_set_priority(irq, 0);
+}
+
+/**
+ * plic_init_hart - 初始化本 hart 的 S 态 context，每个 hart 各调用一次
+ */
+void plic_init_hart(void) {
+	int32 hart = smp_processor_id();
+	uint32 ctx = PLIC_SCONTEXT(hart);
+
+	for (uint32 word = 0; word <= plicInfo.ndev / 32; word++) *PLIC_REG(PLIC_ENABLE_OFF(ctx) + word * 4) = 0;
+	plic_set_threshold(hart, 0);
+}
+
+uint32 plic_claim(void) { return *PLIC_REG(PLIC_CLAIM_OFF(PLIC_SCONTEXT(smp_processor_id()))); }
+
+void plic_complete(uint32 irq) { *PLIC_REG(PLIC_CLAIM_OFF(PLIC_SCONTEXT(smp_processor_id()))) = irq; }
+
+/**
+ * plic_handle_irq - S 态外部中断入口
+ *
+ * 一次把所有挂起的中断源都处理完，避免每个中断源都单独陷入一次。
+ */
+void plic_handle_irq(void) {
+	uint32 irq;
+	while ((irq = plic_claim()) != 0) {
+		generic_handle_irq(irq);
+		plic_complete(irq);
+	}
+}
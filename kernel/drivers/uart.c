@@ -0,0 +1,246 @@
+/*
+ * NS16550A 串口驱动
+ *
+ * 取代逐字节陷入 SBI 的 SBI_PUTCHAR：写者只向发送环拷贝数据，
+ * THR 空中断到来时一次把最多 UART_FIFO_DEPTH 个字节灌进硬件 FIFO。
+ */
+
+#include <kernel/boot/dtb.h>
+#include <kernel/device/irq.h>
+#include <kernel/device/uart.h>
+#include <kernel/riscv.h>
+#include <kernel/sched.h>
+#include <kernel/util.h>
+
+struct uart_port uart0 = {
+    .lock = {SPINLOCK_INIT},
+    .rx_wait = __WAIT_QUEUE_HEAD_INITIALIZER(uart0.rx_wait),
+};
+
+#define UART_REG(port, reg) ((volatile uint8*)((port)->base + (reg)))
+#define uart_read_reg(port, reg) (*UART_REG(port, reg))
+#define uart_write_reg(port, reg, v) (*UART_REG(port, reg) = (v))
+
+#define TX_MASK (UART_TX_BUF_SIZE - 1)
+#define RX_MASK (UART_RX_BUF_SIZE - 1)
+
+static inline int32 tx_empty(struct uart_port* port) { return port->tx_r == port->tx_w; }
+static inline int32 tx_full(struct uart_port* port) { return port->tx_w - port->tx_r == UART_TX_BUF_SIZE; }
+
+/*
+ * 把发送环中的数据送进硬件 FIFO，调用者持有 port->lock。
+ * THR 为空说明硬件 FIFO 已经排空，一次可以写满整个 FIFO。
+ */
+static void uart_start(struct uart_port* port) {
+	if (tx_empty(port) || !(uart_read_reg(port, UART_LSR) & UART_LSR_TX_IDLE)) return;
+
+	for (int32 i = 0; i < UART_FIFO_DEPTH && !tx_empty(port); i++) {
+		uart_write_reg(port, UART_THR, port->tx_buf[port->tx_r & TX_MASK]);
+		port->tx_r++;
+		port->tx_bytes++;
+	}
+}
+
+/*
+ * 轮询排空发送环：没有中断可用，或者发送环已满时由写者自己完成发送。
+ */
+static void uart_drain(struct uart_port* port, int32 all) {
+	while (!tx_empty(port) && (all || tx_full(port))) {
+		while (!(uart_read_reg(port, UART_LSR) & UART_LSR_TX_IDLE)) {
+		}
+		uart_start(port);
+	}
+}
+
+/*
+ * 把 RHR 中已到达的字节搬进接收环，调用者持有 port->lock
+ */
+static void uart_rx(struct uart_port* port) {
+	while (uart_read_reg(port, UART_LSR) & UART_LSR_RX_READY) {
+		char c = uart_read_reg(port, UART_RHR);
+		if (port->rx_w - port->rx_r == UART_RX_BUF_SIZE) {
+			port->rx_overruns++;
+			continue;
+		}
+		port->rx_buf[port->rx_w & RX_MASK] = c;
+		port->rx_w++;
+		port->rx_bytes++;
+	}
+}
+
+/**
+ * uart_init - 初始化串口寄存器，此后控制台输出不再经过 SBI
+ *
+ * 寄存器基址取自设备树，调用前需要完成 MMIO 区域的映射。
+ * 初始化后处于轮询模式，挂上 PLIC 中断后调用 uart_enable_irq()。
+ */
+void uart_init(void) {
+	struct uart_port* port = &uart0;
+
+	port->base = uartInfo.base;
+	port->irq = uartInfo.irq;
+
+	// 关中断
+	uart_write_reg(port, UART_IER, 0x00);
+	// 38.4K baud
+	uart_write_reg(port, UART_LCR, UART_LCR_BAUD_LATCH);
+	uart_write_reg(port, 0, 0x03);
+	uart_write_reg(port, 1, 0x00);
+	// 8 位数据，无校验
+	uart_write_reg(port, UART_LCR, UART_LCR_EIGHT_BITS);
+	// 打开并清空 FIFO
+	uart_write_reg(port, UART_FCR, UART_FCR_FIFO_ENABLE | UART_FCR_FIFO_CLEAR);
+	uart_write_reg(port, UART_MCR, UART_MCR_OUT2);
+
+	port->tx_r = port->tx_w = 0;
+	port->rx_r = port->rx_w = 0;
+	smp_wmb();
+	port->ready = 1;
+}
+
+static void uart_irq_handler(int32 irq, void* dev_id) { uart_intr(); }
+
+/**
+ * uart_enable_irq - 挂上 PLIC 中断并打开收发中断，发送转为异步模式
+ */
+void uart_enable_irq(void) {
+	struct uart_port* port = &uart0;
+	if (request_irq(port->irq, uart_irq_handler, "uart", port)) {
+		log_warn(LOG_SUB_DEV, "uart: irq %d unavailable, staying in polling mode\n", port->irq);
+		return;
+	}
+	int64 flags = spinlock_lock_irqsave(&port->lock);
+	uart_write_reg(port, UART_IER, UART_IER_RX_ENABLE | UART_IER_TX_ENABLE);
+	port->irq_mode = 1;
+	uart_start(port);
+	spinlock_unlock_irqrestore(&port->lock, flags);
+}
+
+/**
+ * uart_write - 向串口写入一段数据
+ *
+ * 中断模式下只拷贝进发送环，由中断完成发送；发送环写满时写者轮询排空一部分。
+ * 返回写入的字节数。
+ */
+size_t uart_write(const char* buf, size_t len) {
+	struct uart_port* port = &uart0;
+	int64 flags = spinlock_lock_irqsave(&port->lock);
+
+	for (size_t i = 0; i < len; i++) {
+		if (tx_full(port)) uart_drain(port, 0);
+		port->tx_buf[port->tx_w & TX_MASK] = buf[i];
+		port->tx_w++;
+	}
+
+	if (port->irq_mode) {
+		uart_start(port);
+	} else {
+		uart_drain(port, 1);
+	}
+
+	spinlock_unlock_irqrestore(&port->lock, flags);
+	return len;
+}
+
+void uart_putc(int32 c) {
+	char ch = c;
+	uart_write(&ch, 1);
+}
+
+/**
+ * uart_putc_sync - 绕过发送环直接轮询输出，只用于 panic 等无法依赖中断的场合
+ */
+void uart_putc_sync(int32 c) {
+	struct uart_port* port = &uart0;
+	while (!(uart_read_reg(port, UART_LSR) & UART_LSR_TX_IDLE)) {
+	}
+	uart_write_reg(port, UART_THR, c);
+}
+
+// panic 时取发送锁的尝试次数，持锁的 hart 可能已经停下
+#define UART_PANIC_LOCK_TRIES 100000
+
+/**
+ * uart_panic_flush - panic 时切回轮询模式，用 uart_putc_sync 排空发送环
+ *
+ * 之后的输出也由写者同步完成，不再等待中断。拿不到锁时照样输出，宁可与其他 hart 交错也不丢失。
+ */
+void uart_panic_flush(void) {
+	struct uart_port* port = &uart0;
+	int32 locked = 0;
+
+	if (!port->ready) return;
+	for (int32 i = 0; i < UART_PANIC_LOCK_TRIES && !(locked = spinlock_trylock(&port->lock)); i++) cpu_relax();
+
+	port->irq_mode = 0;
+	uart_write_reg(port, UART_IER, 0x00);
+	while (!tx_empty(port)) {
+		uart_putc_sync(port->tx_buf[port->tx_r & TX_MASK]);
+		port->tx_r++;
+		port->tx_bytes++;
+	}
+	// 等最后一批字节离开 THR 再返回，调用者随后可能复位
+	while (!(uart_read_reg(port, UART_LSR) & UART_LSR_TX_IDLE)) {
+	}
+
+	if (locked) spinlock_unlock(&port->lock);
+}
+
+/**
+ * uart_read - 从接收环中取出最多 len 个字节，不阻塞
+ */
+size_t uart_read(char* buf, size_t len) {
+	struct uart_port* port = &uart0;
+	size_t n = 0;
+	int64 flags = spinlock_lock_irqsave(&port->lock);
+
+	// 系统调用路径上中断是关着的，顺手把已到达的字节收进来
+	uart_rx(port);
+	while (n < len && port->rx_r != port->rx_w) {
+		buf[n++] = port->rx_buf[port->rx_r & RX_MASK];
+		port->rx_r++;
+	}
+
+	spinlock_unlock_irqrestore(&port->lock, flags);
+	return n;
+}
+
+/**
+ * uart_rx_pending - 接收环中是否有数据，作为读者睡眠的条件
+ */
+int32 uart_rx_pending(void) {
+	struct uart_port* port = &uart0;
+	// 还没有挂上中断时没有人往接收环里搬数据，自己轮询一次
+	if (!port->irq_mode) {
+		int64 flags = spinlock_lock_irqsave(&port->lock);
+		uart_rx(port);
+		spinlock_unlock_irqrestore(&port->lock, flags);
+	}
+	return READ_ONCE(port->rx_r) != READ_ONCE(port->rx_w);
+}
+
+/**
+ * uart_getc - 读取一个字符，没有数据时返回 -1
+ */
+int32 uart_getc(void) {
+	char c;
+	return uart_read(&c, 1) == 1 ? (uint8)c : -1;
+}
+
+/**
+ * uart_intr - 串口中断处理
+ */
+void uart_intr(void) {
+	struct uart_port* port = &uart0;
+
+	spinlock_lock(&port->lock);
+	// 读 ISR 以确认中断
+	(void)uart_read_reg(port, UART_ISR);
+	uint64 rx_w = port->rx_w;
+	uart_rx(port);
+	uart_start(port);
+	int32 received = port->rx_w != rx_w;
+	spinlock_unlock(&port->lock);
+
+	if (received) wake_up_interruptible(&port->rx_wait);
+}
@@ -14,6 +14,7 @@
 #include <kernel/riscv.h>
 #include <kernel/sched/process.h>
 #include <kernel/trapframe.h>
+#include <kernel/vdso.h>
 
 #include <kernel/util/print.h>
 #include <kernel/util/string.h>
@@ -27,6 +28,8 @@ typedef struct elf_context {
   struct task_struct *proc; // 目标进程
   elf_header ehdr;          // ELF头部
   uint64 entry_point;       // 入口点
+  uint64 phdr_addr;         // 程序头表被装入后的用户地址，没有装入时为 0
+  const char *filename;     // 放进初始栈的 argv[0] 和 AT_EXECFN
 } elf_context;
 
 static int32 init_elf_context(elf_context *ctx, int32 fd, struct task_struct *proc);
@@ -78,6 +81,7 @@ void load_elf_from_file(struct task_struct *proc, char *filename) {
     do_close(fd);
     panic("Failed to initialize ELF context\n");
   }
+  ctx.filename = filename;
 
   // 加载ELF二进制文件
   if (load_elf_binary(&ctx) != 0) {
@@ -413,6 +417,59 @@ static int32 load_debug_information(elf_context *ctx) {
 }
 
 
+/**
+ * 在用户栈顶建立 argc、argv、envp 和辅助向量，设置用户态的 sp
+ *
+ * 栈从高到低依次是 argv[0] 字符串，然后按 16 字节对齐的
+ * argc | argv[0] | NULL | NULL（envp）| auxv ... | AT_NULL
+ *
+ * @param ctx ELF上下文，段已经装入
+ * @param vdso_base vdso.so 的用户地址，为 0 时不提供 AT_SYSINFO_EHDR
+ * @return 0表示成功，非0表示失败
+ */
+static int32 create_elf_tables(elf_context *ctx, uint64 vdso_base) {
+  struct mm_struct *mm = ctx->proc->mm;
+  uint64 table[4 + 2 * 10];
+  int32 n = 0;
+
+  uint64 sp = mm->end_stack;
+  size_t len = strlen(ctx->filename) + 1;
+  sp -= len;
+  uint64 execfn = sp;
+  if (mm_copy_to_user(mm, execfn, ctx->filename, len) != len)
+    return -1;
+
+#define NEW_AUX_ENT(id, val)                                                   \
+  do {                                                                         \
+    table[n++] = (id);                                                         \
+    table[n++] = (val);                                                        \
+  } while (0)
+
+  table[n++] = 1;      // argc
+  table[n++] = execfn; // argv[0]
+  table[n++] = 0;      // argv 结束
+  table[n++] = 0;      // envp 为空
+  if (ctx->phdr_addr) {
+    NEW_AUX_ENT(AT_PHDR, ctx->phdr_addr);
+    NEW_AUX_ENT(AT_PHENT, sizeof(elf_prog_header));
+    NEW_AUX_ENT(AT_PHNUM, ctx->ehdr.phnum);
+  }
+  NEW_AUX_ENT(AT_PAGESZ, PAGE_SIZE);
+  NEW_AUX_ENT(AT_ENTRY, ctx->entry_point);
+  NEW_AUX_ENT(AT_CLKTCK, HZ);
+  NEW_AUX_ENT(AT_EXECFN, execfn);
+  if (vdso_base)
+    NEW_AUX_ENT(AT_SYSINFO_EHDR, vdso_base);
+  NEW_AUX_ENT(AT_NULL, 0);
+#undef NEW_AUX_ENT
+
+  sp = ROUNDDOWN(sp - n * sizeof(uint64), 16);
+  if (mm_copy_to_user(mm, sp, table, n * sizeof(uint64)) != n * sizeof(uint64))
+    return -1;
+  ctx->proc->trapframe->regs.sp = sp;
+  return 0;
+}
+
 /**
  * 加载ELF文件到进程
  *
@@ -438,11 +495,23 @@ static int32 load_elf_binary(elf_context *ctx) {
       kprintf("Failed to load segment %d\n", i);
       return -1;
     }
+
+    // 记下程序头表的用户地址，libc 通过 AT_PHDR 找到 PT_TLS 等
+    if (ph.type == ELF_PROG_PHDR)
+      ctx->phdr_addr = ph.vaddr;
+    else if (ph.type == ELF_PROG_LOAD && !ctx->phdr_addr && ph.off <= ehdr->phoff &&
+             ehdr->phoff + ehdr->phnum * sizeof(ph) <= ph.off + ph.filesz)
+      ctx->phdr_addr = ph.vaddr + (ehdr->phoff - ph.off);
   }
 
   // 设置全局指针
   setup_global_pointer(ctx);
 
+  if (create_elf_tables(ctx, vdso_map(ctx->proc->mm)) != 0) {
+    kprintf("Failed to set up the initial user stack\n");
+    return -1;
+  }
+
   // 设置进程入口点
   ctx->proc->trapframe->epc = ctx->entry_point;
 
@@ -490,6 +559,7 @@ int32 load_init_binary(struct task_struct *init_task, const char *path) {
     memset(&ctx, 0, sizeof(elf_context));
     ctx.fd = fd;
     ctx.proc = init_task;
+    ctx.filename = path;
 
     // Read ELF header
     if (elf_read_at(&ctx, &ctx.ehdr, sizeof(elf_header), 0) != sizeof(elf_header)) {
@@ -20,6 +20,7 @@ static int32 EXT4_dir_iterate(struct file* filp, struct dir_context* ctx) {
 
 	if (!ext4_dir) return -EBADF;
 
+	ext4_lock();
 	// 简单地迭代目录条目
 	while ((entry = ext4_dir_entry_next(ext4_dir)) != NULL) {
 		// 确定条目类型
@@ -60,6 +61,7 @@ static int32 EXT4_dir_iterate(struct file* filp, struct dir_context* ctx) {
 			break;
 		}
 	}
+	ext4_unlock();
 
 	return 0;
 }
@@ -93,7 +95,9 @@ static int32 EXT4_file_open(struct file* file, int32 flags)
     /* 在这里可以使用 mode 参数 */
     
     /* 使用lwext4库的fopen2函数打开文件 */
-    ret = ext4_fopen2(ext4_f, path, flags);    
+    ext4_lock();
+    ret = ext4_fopen2(ext4_f, path, flags);
+    ext4_unlock();
     if (ret != EOK) {
 		kfree(ext4_f);
 		goto clean;
@@ -141,7 +145,9 @@ static int32 EXT4_dir_open(struct file* file, int32 flags)
     }
     
     /* Open directory using lwext4 library */
+    ext4_lock();
     ret = ext4_dir_open(ext4_d, path);
+    ext4_unlock();
     if (ret != EOK) {
         kfree(ext4_d);
         kfree(path);
@@ -166,12 +172,12 @@ static int32 EXT4_dir_open(struct file* file, int32 flags)
 	 size_t bytes_read;
 	 
 	 /* Set file position */
+	 ext4_lock();
 	 int ret = ext4_fseek(ext4_file, *pos, SEEK_SET);
-	 if (ret != 0)
-		 return -EIO;
-	 
 	 /* Read from file */
-	 ret = ext4_fread(ext4_file, buf, count, &bytes_read);
+	 if (ret == 0)
+		 ret = ext4_fread(ext4_file, buf, count, &bytes_read);
+	 ext4_unlock();
 	 if (ret != 0)
 		 return -EIO;
 	
@@ -185,12 +191,12 @@ static int32 EXT4_dir_open(struct file* file, int32 flags)
 	 size_t bytes_written;
 	 
 	 /* Set file position */
+	 ext4_lock();
 	 int ret = ext4_fseek(ext4_file, *pos, SEEK_SET);
-	 if (ret != 0)
-		 return -EIO;
-	 
 	 /* Write to file */
-	 ret = ext4_fwrite(ext4_file, buf, count, &bytes_written);
+	 if (ret == 0)
+		 ret = ext4_fwrite(ext4_file, buf, count, &bytes_written);
+	 ext4_unlock();
 	 if (ret != 0)
 		 return -EIO;
 	
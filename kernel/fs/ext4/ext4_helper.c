@@ -8,18 +8,24 @@
 #include <kernel/fs/lwext4/ext4_fs.h>
 #include <kernel/fs/lwext4/ext4_dir.h>
 
-#include <kernel/util/spinlock.h>
-
-spinlock_t ext4_spinlock = SPINLOCK_INIT;
-
-static inline void ext4_lock_noop(void) {
-    // no-op placeholder: intentionally left blank
+#include <kernel/mutex.h>
+#include <kernel/sched.h>
+
+DEFINE_MUTEX(ext4_mutex);
+static int32 ext4_lock_depth; // 嵌套层数，只有持锁者读写
+
+void ext4_lock(void) {
+	if (__atomic_load_n(&ext4_mutex.owner, __ATOMIC_RELAXED) == CURRENT) {
+		ext4_lock_depth++;
+		return;
+	}
+	mutex_lock(&ext4_mutex);
+	ext4_lock_depth = 1;
 }
 
-struct ext4_lock ext4_mount_lock = {
-	.lock = ext4_lock_noop,
-	.unlock = ext4_lock_noop
-};
+void ext4_unlock(void) {
+	if (--ext4_lock_depth == 0) mutex_unlock(&ext4_mutex);
+}
 
 
 
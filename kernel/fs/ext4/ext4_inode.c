@@ -1,4 +1,5 @@
 #include <kernel/fs/ext4_adaptor.h>
+#include <kernel/device/char_device.h>
 #include <kernel/vfs.h>
 #include <kernel/mm/kmalloc.h>
 #include <kernel/time.h>
@@ -172,7 +173,8 @@ int32 ext4_inode_init(struct superblock *sb, struct inode *inode, uint32_t ino)
         /* Handle device files */
         inode->i_rdev = ext4_inode_get_dev(e_inode);
         inode->i_op = &ext4_file_inode_operations;
-        inode->i_fop = NULL; /* Special device operations would go here */
+        /* 字符设备按 i_rdev 分发给驱动，块设备还没有文件操作 */
+        inode->i_fop = S_ISCHR(inode->i_mode) ? &chFile_operations : NULL;
     } else {
         /* FIFO, socket, etc. */
         inode->i_op = &ext4_file_inode_operations;
@@ -322,7 +324,7 @@ static int32 ext4_vfs_create(struct inode *dir, struct dentry *dentry, mode_t mo
  * 
  * Returns: 0 on success, negative error code on failure
  */
-static int32 ext4_vfs_link(struct dentry *old_dentry, struct inode *dir, struct dentry *new_dentry) {
+static int32 __ext4_vfs_link(struct dentry *old_dentry, struct inode *dir, struct dentry *new_dentry) {
     struct ext4_inode_ref e_dir_ref, e_inode_ref;
     int32 ret;
     
@@ -366,7 +368,7 @@ static int32 ext4_vfs_link(struct dentry *old_dentry, struct inode *dir, struct
  * 
  * Returns: 0 on success, negative error code on failure
  */
-static int32 ext4_vfs_unlink(struct inode *dir, struct dentry *dentry) {
+static int32 __ext4_vfs_unlink(struct inode *dir, struct dentry *dentry) {
     struct ext4_inode_ref e_dir_ref, e_inode_ref;
     int32 ret;
     
@@ -415,7 +417,7 @@ static int32 ext4_vfs_unlink(struct inode *dir, struct dentry *dentry) {
  * 
  * Returns: 0 on success, negative error code on failure
  */
-static int32 ext4_vfs_symlink(struct inode *dir, struct dentry *dentry, const char *symname) {
+static int32 __ext4_vfs_symlink(struct inode *dir, struct dentry *dentry, const char *symname) {
     struct ext4_inode_ref e_dir_ref, e_inode_ref;
     struct inode *inode;
     int32 ret;
@@ -506,7 +508,7 @@ static int32 ext4_vfs_symlink(struct inode *dir, struct dentry *dentry, const ch
  * 
  * Returns: 0 on success, negative error code on failure
  */
-static int32 ext4_vfs_mkdir(struct inode *dir, struct dentry *dentry, mode_t mode) {
+static int32 __ext4_vfs_mkdir(struct inode *dir, struct dentry *dentry, mode_t mode) {
     struct ext4_inode_ref e_dir_ref, e_inode_ref;
     struct inode *inode;
     int32 ret;
@@ -610,7 +612,7 @@ static int32 ext4_vfs_mkdir(struct inode *dir, struct dentry *dentry, mode_t mod
  * 
  * Returns: 0 on success, negative error code on failure
  */
-static int32 ext4_vfs_rmdir(struct inode *dir, struct dentry *dentry) {
+static int32 __ext4_vfs_rmdir(struct inode *dir, struct dentry *dentry) {
     struct ext4_inode_ref e_dir_ref, e_inode_ref;
     struct ext4_dir_iter it;
     bool is_empty = true;
@@ -998,7 +1000,7 @@ static int32 ext4_vfs_readlink(struct dentry *dentry, char *buffer, int32 buflen
  * @param mask Permission mask to check
  * @return 0 if permitted, negative error code otherwise
  */
-static int32 ext4_vfs_permission(struct inode *inode, int32 mask)
+static int32 __ext4_vfs_permission(struct inode *inode, int32 mask)
 {
     /* Basic permission check - simplified for initial implementation 
      * A full implementation would involve:
@@ -1040,7 +1042,7 @@ static int32 ext4_vfs_permission(struct inode *inode, int32 mask)
  * @param attr Attributes to set
  * @return 0 on success, negative error code on failure
  */
-static int32 ext4_vfs_setattr(struct dentry *dentry, struct iattr *attr)
+static int32 __ext4_vfs_setattr(struct dentry *dentry, struct iattr *attr)
 {
     struct inode *inode = dentry->d_inode;
     struct ext4_inode_ref e_inode_ref;
@@ -1162,7 +1164,7 @@ static int32 ext4_vfs_getattr(struct vfsmount *mnt, struct dentry *dentry, struc
  * @param flags Flags for the operation
  * @return 0 on success, negative error code on failure
  */
-static int32 ext4_vfs_setxattr(struct dentry *dentry, const char *name, const void *value, 
+static int32 __ext4_vfs_setxattr(struct dentry *dentry, const char *name, const void *value, 
                          size_t size, int32 flags)
 {
     #if CONFIG_XATTR_ENABLE
@@ -1210,7 +1212,7 @@ static int32 ext4_vfs_setxattr(struct dentry *dentry, const char *name, const vo
  * @param dev Device number (for device files)
  * @return int32 Error code
  */
-static int32 ext4_vfs_mknod(struct inode *inode, struct dentry *dentry, fmode_t mode, dev_t dev)
+static int32 __ext4_vfs_mknod(struct inode *inode, struct dentry *dentry, fmode_t mode, dev_t dev)
 {
     struct ext4_inode_ref parent_ref;
     struct ext4_inode_ref child_ref;
@@ -1265,6 +1267,8 @@ static int32 ext4_vfs_mknod(struct inode *inode, struct dentry *dentry, fmode_t
     child_inode->i_ino = child_ref.index;
     child_inode->i_mode = mode;
     child_inode->i_rdev = dev;
+    if (S_ISCHR(mode))
+        child_inode->i_fop = &chFile_operations;
     
     /* Link the dentry to the inode */
     dentry_instantiate(dentry, child_inode);
@@ -1503,7 +1507,7 @@ static int32 ext4_vfs_get_link(struct dentry *dentry, struct inode *inode, struc
  * @param create Create block if it doesn't exist
  * @return int32 Error code
  */
-static int32 ext4_vfs_get_block(struct inode *inode, sector_t block, 
+static int32 __ext4_vfs_get_block(struct inode *inode, sector_t block, 
                          struct buffer_head *buffer_head, int32 create)
 {
     struct ext4_inode_ref e_inode_ref;
@@ -1549,7 +1553,7 @@ static int32 ext4_vfs_get_block(struct inode *inode, sector_t block,
  * @param block Logical block number
  * @return sector_t Physical block number or error code
  */
-static sector_t ext4_vfs_bmap(struct inode *inode, sector_t block)
+static sector_t __ext4_vfs_bmap(struct inode *inode, sector_t block)
 {
     struct ext4_inode_ref e_inode_ref;
     ext4_fsblk_t phys_block;
@@ -1577,7 +1581,7 @@ static sector_t ext4_vfs_bmap(struct inode *inode, sector_t block)
  * @param inode Target inode
  * @param size New file size
  */
-static void ext4_vfs_truncate_blocks(struct inode *inode, loff_t size)
+static void __ext4_vfs_truncate_blocks(struct inode *inode, loff_t size)
 {
     struct ext4_inode_ref e_inode_ref;
     int32 ret;
@@ -1671,7 +1675,7 @@ static vm_fault_t ext4_vfs_page_fault(struct vm_area_struct *vma, struct vm_faul
  * @param mode File mode
  * @return int32 Error code
  */
-static int32 ext4_vfs_tmpfile(struct inode *inode, struct dentry *dentry, umode_t mode)
+static int32 __ext4_vfs_tmpfile(struct inode *inode, struct dentry *dentry, umode_t mode)
 {
     struct ext4_inode_ref parent_ref;
     struct ext4_inode_ref child_ref;
@@ -1726,7 +1730,7 @@ static int32 ext4_vfs_tmpfile(struct inode *inode, struct dentry *dentry, umode_
  * @param size Size of the buffer
  * @return Size of the attribute value on success, negative error code on failure
  */
-static ssize_t ext4_vfs_getxattr(struct dentry *dentry, const char *name, void *buffer, size_t size)
+static ssize_t __ext4_vfs_getxattr(struct dentry *dentry, const char *name, void *buffer, size_t size)
 {
     #if CONFIG_XATTR_ENABLE
     struct inode *inode = dentry->d_inode;
@@ -1770,7 +1774,7 @@ static ssize_t ext4_vfs_getxattr(struct dentry *dentry, const char *name, void *
  * @param size Size of the buffer
  * @return Size of the attribute list on success, negative error code on failure
  */
-static ssize_t ext4_vfs_listxattr(struct dentry *dentry, char *buffer, size_t size)
+static ssize_t __ext4_vfs_listxattr(struct dentry *dentry, char *buffer, size_t size)
 {
     #if CONFIG_XATTR_ENABLE
     struct inode *inode = dentry->d_inode;
@@ -1844,7 +1848,7 @@ static ssize_t ext4_vfs_listxattr(struct dentry *dentry, char *buffer, size_t si
  * @param name Name of the attribute
  * @return 0 on success, negative error code on failure
  */
-static int32 ext4_vfs_removexattr(struct dentry *dentry, const char *name)
+static int32 __ext4_vfs_removexattr(struct dentry *dentry, const char *name)
 {
     #if CONFIG_XATTR_ENABLE
     struct inode *inode = dentry->d_inode;
@@ -1950,4 +1954,136 @@ int32 __ext4_flush_dirty_inode(struct ext4_inode_ref *inode_ref)
     }
     
     return ret;
-}
\ No newline at end of file
+}
+
+
+/*
+ * 加锁入口：inode 操作表中会进入 lwext4 的操作都经过这里持 ext4_mutex，
+ * direct_IO 和 page_fault 不访问 lwext4，不需要加锁。
+ */
+static int32 ext4_vfs_link(struct dentry *old_dentry, struct inode *dir, struct dentry *new_dentry)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_link(old_dentry, dir, new_dentry);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_unlink(struct inode *dir, struct dentry *dentry)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_unlink(dir, dentry);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_symlink(struct inode *dir, struct dentry *dentry, const char *symname)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_symlink(dir, dentry, symname);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_mkdir(struct inode *dir, struct dentry *dentry, mode_t mode)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_mkdir(dir, dentry, mode);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_rmdir(struct inode *dir, struct dentry *dentry)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_rmdir(dir, dentry);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_permission(struct inode *inode, int32 mask)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_permission(inode, mask);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_setattr(struct dentry *dentry, struct iattr *attr)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_setattr(dentry, attr);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_setxattr(struct dentry *dentry, const char *name, const void *value, size_t size, int32 flags)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_setxattr(dentry, name, value, size, flags);
+    ext4_unlock();
+    return ret;
+}
+
+static ssize_t ext4_vfs_getxattr(struct dentry *dentry, const char *name, void *buffer, size_t size)
+{
+    ext4_lock();
+    ssize_t ret = __ext4_vfs_getxattr(dentry, name, buffer, size);
+    ext4_unlock();
+    return ret;
+}
+
+static ssize_t ext4_vfs_listxattr(struct dentry *dentry, char *buffer, size_t size)
+{
+    ext4_lock();
+    ssize_t ret = __ext4_vfs_listxattr(dentry, buffer, size);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_removexattr(struct dentry *dentry, const char *name)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_removexattr(dentry, name);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_mknod(struct inode *inode, struct dentry *dentry, fmode_t mode, dev_t dev)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_mknod(inode, dentry, mode, dev);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_tmpfile(struct inode *inode, struct dentry *dentry, umode_t mode)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_tmpfile(inode, dentry, mode);
+    ext4_unlock();
+    return ret;
+}
+
+static int32 ext4_vfs_get_block(struct inode *inode, sector_t block, struct buffer_head *buffer_head, int32 create)
+{
+    ext4_lock();
+    int32 ret = __ext4_vfs_get_block(inode, block, buffer_head, create);
+    ext4_unlock();
+    return ret;
+}
+
+static sector_t ext4_vfs_bmap(struct inode *inode, sector_t block)
+{
+    ext4_lock();
+    sector_t ret = __ext4_vfs_bmap(inode, block);
+    ext4_unlock();
+    return ret;
+}
+
+static void ext4_vfs_truncate_blocks(struct inode *inode, loff_t size)
+{
+    ext4_lock();
+    __ext4_vfs_truncate_blocks(inode, size);
+    ext4_unlock();
+}
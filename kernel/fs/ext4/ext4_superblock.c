@@ -31,7 +31,10 @@ const struct superblock_operations ext4_superblock_operations = {
 static int32 ext4_read_inode(struct inode* inode) {
 	/* This is implemented in ext4_inode_operations.c */
 	extern int32 ext4_inode_init(struct superblock * sb, struct inode * inode, uint32_t ino);
-	return ext4_inode_init(inode->i_superblock, inode, inode->i_ino);
+	ext4_lock();
+	int32 ret = ext4_inode_init(inode->i_superblock, inode, inode->i_ino);
+	ext4_unlock();
+	return ret;
 }
 
 /**
@@ -49,9 +52,10 @@ static int32 ext4_write_inode(struct inode* inode, int32 wait) {
 
 	if (!inode || !e_fs) return -EINVAL;
 
+	ext4_lock();
 	/* Get the ext4 inode reference */
 	ret = ext4_fs_get_inode_ref(e_fs, inode->i_ino, &inode_ref);
-	if (ret != 0) return ret;
+	if (ret != 0) goto out;
 
 	/* Update the ext4 inode from VFS inode */
 	ext4_inode_set_mode(e_sb, inode_ref.inode, inode->i_mode);
@@ -69,7 +73,8 @@ static int32 ext4_write_inode(struct inode* inode, int32 wait) {
 
 	/* Release the ext4 inode reference */
 	ext4_fs_put_inode_ref(&inode_ref);
-
+out:
+	ext4_unlock();
 	return ret;
 }
 
@@ -82,11 +87,13 @@ static void ext4_put_super(struct superblock* sb) {
 
 	if (!fs) return;
 
+	ext4_lock();
 	/* Sync the filesystem */
 	ext4_fs_sync(fs);
 
 	/* Unmount the filesystem */
 	ext4_fs_fini(fs);
+	ext4_unlock();
 
 	/* Free the ext4_fs structure */
 	kfree(fs);
@@ -144,7 +151,10 @@ static int32 ext4_sync_fs(struct superblock* sb, int32 wait) {
 	if (!fs) return -EINVAL;
 
 	/* Sync the filesystem */
-	return ext4_fs_sync(fs);
+	ext4_lock();
+	int32 ret = ext4_fs_sync(fs);
+	ext4_unlock();
+	return ret;
 }
 
 int32 ext4_fill_super(struct superblock* sb, void* data, int32 silent) {
@@ -172,7 +182,9 @@ int32 ext4_fill_super(struct superblock* sb, void* data, int32 silent) {
     e_blockdevice->fs = e_fs;
 
     /* Initialize the filesystem */
+    ext4_lock();
     int32 ret = ext4_fs_init(e_fs, e_blockdevice, sb->s_flags & MS_RDONLY);
+    ext4_unlock();
     if (ret != 0) {
         ext4_blockdev_free_adapter(e_blockdevice);
         kfree(e_fs);
@@ -69,8 +69,8 @@ struct fdtable* fdtable_copy(struct fdtable* old) {
 	for (i = 0; i < size; i++) {
 		if (old->fd_array[i]) {
 			new->fd_array[i] = old->fd_array[i];
-			// 增加file引用计数
-			// file_ref(new->fd_array[i]);
+			// 增加file引用计数，两张表各自关闭
+			file_ref(new->fd_array[i]);
 			new->fd_flags[i] = old->fd_flags[i];
 		}
 	}
@@ -124,7 +124,7 @@ static void __fdtable_free(struct fdtable* fdt) {
 	// 关闭所有打开的文件
 	for (i = 0; i < fdt->max_fds; i++) {
 		if (fdt->fd_array[i]) {
-			// file_unref(fdt->fd_array[i]);
+			file_unref(fdt->fd_array[i]);
 			fdt->fd_array[i] = NULL;
 		}
 	}
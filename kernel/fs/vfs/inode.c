@@ -1,3 +1,4 @@
+#include <kernel/device/char_device.h>
 #include <kernel/mmu.h>
 #include <kernel/sched.h>
 #include <kernel/util/print.h>
@@ -390,7 +391,10 @@ int32 inode_mkdir(struct inode* dir, struct dentry* dentry, mode_t mode) {
 
 	/* Call filesystem-specific mkdir if available */
 	if (dir->i_op && dir->i_op->mkdir) {
-		return dir->i_op->mkdir(dir, dentry, mode);
+		down_write(&dir->i_rwsem);
+		error = dir->i_op->mkdir(dir, dentry, mode);
+		up_write(&dir->i_rwsem);
+		return error;
 	}
 
 	/* Default implementation if no filesystem handler */
@@ -443,13 +447,20 @@ int32 inode_mknod(struct inode* dir, struct dentry* dentry, mode_t mode, dev_t d
 
 	/* Call filesystem-specific mknod if available */
 	if (dir->i_op && dir->i_op->mknod) {
-		return dir->i_op->mknod(dir, dentry, mode, dev);
+		down_write(&dir->i_rwsem);
+		error = dir->i_op->mknod(dir, dentry, mode, dev);
+		up_write(&dir->i_rwsem);
+		return error;
 	}
 
 	/* Default implementation for simple filesystems like ramfs */
 	struct inode* inode = inode_acquire(dir->i_superblock, 0);
 	if (PTR_IS_ERROR(inode)) return PTR_ERR(inode);
 	// TODO: 做一个通用的inode_init方法。
+	inode->i_mode = mode;
+	if (S_ISBLK(mode) || S_ISCHR(mode)) inode->i_rdev = dev;
+	// 字符设备按设备号分发给驱动
+	if (S_ISCHR(mode)) inode->i_fop = &chFile_operations;
 	// /* Set up basic inode attributes */
 	// inode->i_mode = mode;
 	// inode->i_uid = current_task()->uid;
@@ -584,7 +595,10 @@ int32 inode_rmdir(struct inode* dir, struct dentry* dentry) {
 	/* Cannot remove non-empty directory */
 	if (!dentry_isEmptyDir(dentry)) return -ENOTEMPTY;
 
-	return dir->i_op->rmdir(dir, dentry);
+	down_write(&dir->i_rwsem);
+	error = dir->i_op->rmdir(dir, dentry);
+	up_write(&dir->i_rwsem);
+	return error;
 }
 
 /**
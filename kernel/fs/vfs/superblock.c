@@ -266,6 +266,7 @@ struct inode* superblock_createInode(struct superblock* sb) {
 	INIT_LIST_HEAD(&inode->i_s_list_node);
 	INIT_LIST_HEAD(&inode->i_state_list_node);
 	spinlock_init(&inode->i_lock);
+	init_rwsem(&inode->i_rwsem);
 	inode->i_superblock = sb;
 	// inode->i_state = I_NEW; /* Mark as new */
 	inode->i_ino = ino;
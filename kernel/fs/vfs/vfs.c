@@ -97,7 +97,9 @@ int32 vfs_link(struct dentry* old_dentry, struct inode* dir, struct dentry* new_
 	error = inode_checkPermission(dir, MAY_WRITE);
 	if (error) return error;
 
+	down_write(&dir->i_rwsem);
 	error = dir->i_op->link(old_dentry, dir, new_dentry);
+	up_write(&dir->i_rwsem);
 	if (error) return error;
 
 	if (new_inode) *new_inode = new_dentry->d_inode;
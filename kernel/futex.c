@@ -0,0 +1,309 @@
+/*
+ * futex，见 include/kernel/futex.h
+ */
+
+#include <kernel/futex.h>
+#include <kernel/mm/mm_struct.h>
+#include <kernel/mm/uaccess.h>
+#include <kernel/sched.h>
+#include <kernel/sched/signal.h>
+#include <kernel/time.h>
+#include <kernel/timer.h>
+#include <kernel/util.h>
+
+#define FUTEX_HASH_BITS 8
+#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
+
+struct futex_hash_bucket {
+	spinlock_t lock;
+	struct list_head chain;
+} __attribute__((aligned(64)));
+
+static struct futex_hash_bucket futex_queues[FUTEX_HASH_SIZE];
+
+/**
+ * futex_init - 初始化全局散列桶
+ */
+void futex_init(void) {
+	for (int32 i = 0; i < FUTEX_HASH_SIZE; i++) {
+		spinlock_init(&futex_queues[i].lock);
+		INIT_LIST_HEAD(&futex_queues[i].chain);
+	}
+}
+
+static inline int32 match_futex(const union futex_key* a, const union futex_key* b) {
+	return a->both.word == b->both.word && a->both.address == b->both.address;
+}
+
+static struct futex_hash_bucket* hash_futex(const union futex_key* key) {
+	uint64 h = (key->both.word ^ (key->both.address >> 2)) * 0x9E3779B97F4A7C15UL;
+	return &futex_queues[h >> (64 - FUTEX_HASH_BITS)];
+}
+
+/*
+ * 私有 futex 直接用 (mm, 虚拟地址)；共享 futex 查页表得到物理地址，
+ * 这样不同进程映射同一页时得到同一个键。
+ *
+ * 不在 VM_SHARED 映射中的地址只能被同一地址空间的线程访问，不论有没有 FUTEX_PRIVATE_FLAG
+ * 都用私有键，否则一方带标志一方不带时（例如 CLONE_CHILD_CLEARTID 的唤醒）会互相找不到。
+ */
+static int32 get_futex_key(uint32* uaddr, uint32 flags, union futex_key* key) {
+	struct mm_struct* mm = current_task()->mm;
+	uint64 address = (uint64)uaddr;
+
+	if (address & (sizeof(uint32) - 1)) return -EINVAL;
+	if (!mm) return -EFAULT;
+
+	int32 shared = 0;
+	if (!(flags & FUTEX_PRIVATE_FLAG)) {
+		down_read(&mm->mmap_lock);
+		struct vm_area_struct* vma = find_vma(mm, address);
+		shared = vma && vma->vm_start <= address && (vma->vm_flags & VM_SHARED);
+		up_read(&mm->mmap_lock);
+	}
+	if (!shared) {
+		key->private.mm = mm;
+		key->private.address = address;
+		return 0;
+	}
+	paddr_t pa = lookup_pa(mm->pagetable, address);
+	if (!pa) return -EFAULT;
+	key->shared.zero = NULL;
+	key->shared.address = pa;
+	return 0;
+}
+
+// 同时锁住两个桶，按地址顺序加锁避免死锁
+static void double_lock_hb(struct futex_hash_bucket* hb1, struct futex_hash_bucket* hb2) {
+	if (hb1 > hb2) {
+		struct futex_hash_bucket* t = hb1;
+		hb1 = hb2;
+		hb2 = t;
+	}
+	spinlock_lock(&hb1->lock);
+	if (hb1 != hb2) spinlock_lock(&hb2->lock);
+}
+
+static void double_unlock_hb(struct futex_hash_bucket* hb1, struct futex_hash_bucket* hb2) {
+	spinlock_unlock(&hb1->lock);
+	if (hb1 != hb2) spinlock_unlock(&hb2->lock);
+}
+
+/*
+ * 在持有桶锁时摘下并唤醒 q。先清 lock_ptr 再唤醒：等待者每次睡眠前都检查 lock_ptr，
+ * 反过来的话唤醒可能落在它重新设置睡眠状态之前而丢失。
+ * 等待者看到 lock_ptr 为空就会返回，q 随之失效，所以之后不能再访问 q；
+ * 它还可能在唤醒之前就退出，所以清 lock_ptr 之前先取得任务的引用。
+ */
+static void wake_futex(struct futex_q* q) {
+	struct task_struct* p = q->task;
+	get_task_struct(p);
+	list_del_init(&q->list);
+	__atomic_store_n(&q->lock_ptr, NULL, __ATOMIC_SEQ_CST);
+	wake_up_process(p);
+	put_task_struct(p);
+}
+
+/**
+ * unqueue_me - 等待结束后把自己从桶中摘下
+ *
+ * Returns: 1 表示 q 还在桶中（超时、信号或伪唤醒），0 表示已经被 futex_wake 摘下
+ */
+static int32 unqueue_me(struct futex_q* q) {
+	for (;;) {
+		spinlock_t* lock_ptr = __atomic_load_n(&q->lock_ptr, __ATOMIC_ACQUIRE);
+		if (!lock_ptr) return 0;
+		spinlock_lock(lock_ptr);
+		// 加锁期间可能被 requeue 到别的桶
+		if (lock_ptr != q->lock_ptr) {
+			spinlock_unlock(lock_ptr);
+			continue;
+		}
+		list_del_init(&q->list);
+		q->lock_ptr = NULL;
+		spinlock_unlock(lock_ptr);
+		return 1;
+	}
+}
+
+/*
+ * 把用户给出的超时换算成节拍数。FUTEX_WAIT 的超时是相对时间；
+ * FUTEX_WAIT_BITSET 的是绝对时间，默认以 CLOCK_MONOTONIC 计，带 FUTEX_CLOCK_REALTIME 时以 CLOCK_REALTIME 计。
+ */
+static int64 futex_timeout(const struct timespec* ts, int32 cmd, uint32 flags) {
+	struct timespec rel;
+
+	if (!ts) return MAX_SCHEDULE_TIMEOUT;
+	if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000L) return -EINVAL;
+	if (cmd == FUTEX_WAIT) return timespec_to_jiffies(ts);
+
+	struct timespec now;
+	do_clock_gettime((flags & FUTEX_CLOCK_REALTIME) ? CLOCK_REALTIME : CLOCK_MONOTONIC, &now);
+	rel.tv_sec = ts->tv_sec - now.tv_sec;
+	rel.tv_nsec = ts->tv_nsec - now.tv_nsec;
+	if (rel.tv_nsec < 0) {
+		rel.tv_sec--;
+		rel.tv_nsec += 1000000000L;
+	}
+	if (rel.tv_sec < 0) return 0;
+	return timespec_to_jiffies(&rel);
+}
+
+static int64 futex_wait(uint32* uaddr, uint32 flags, uint32 val, int64 timeout, uint32 bitset) {
+	struct futex_q q;
+	uint32 uval;
+
+	if (!bitset) return -EINVAL;
+	if (timeout < 0) return timeout;
+
+	int32 ret = get_futex_key(uaddr, flags, &q.key);
+	if (ret) return ret;
+	q.task = CURRENT;
+	q.bitset = bitset;
+	INIT_LIST_HEAD(&q.list);
+
+	struct futex_hash_bucket* hb = hash_futex(&q.key);
+	spinlock_lock(&hb->lock);
+	// 读值和挂入桶在同一把锁内：唤醒方修改 *uaddr 后才会来拿这把锁
+	if (copy_from_user(&uval, uaddr, sizeof(uval))) {
+		spinlock_unlock(&hb->lock);
+		return -EFAULT;
+	}
+	if (uval != val) {
+		spinlock_unlock(&hb->lock);
+		return -EAGAIN;
+	}
+	if (!timeout) {
+		spinlock_unlock(&hb->lock);
+		return -ETIMEDOUT;
+	}
+	list_add_tail(&q.list, &hb->chain);
+	q.lock_ptr = &hb->lock;
+	WRITE_ONCE(CURRENT->state, TASK_INTERRUPTIBLE);
+	spinlock_unlock(&hb->lock);
+
+	for (;;) {
+		// 信号可能在设置睡眠状态之前就已经到达，那次唤醒看到的还是 TASK_RUNNING
+		if (!__atomic_load_n(&q.lock_ptr, __ATOMIC_ACQUIRE) || signal_pending(CURRENT) || !timeout) break;
+		timeout = schedule_timeout(timeout);
+		// 与 wake_futex 中先清 lock_ptr 再唤醒配对
+		WRITE_ONCE(CURRENT->state, TASK_INTERRUPTIBLE);
+		smp_mb();
+	}
+	WRITE_ONCE(CURRENT->state, TASK_RUNNING);
+
+	if (!unqueue_me(&q)) return 0;
+	if (!timeout) return -ETIMEDOUT;
+	return -EINTR;
+}
+
+/**
+ * futex_wake - 唤醒最多 nr_wake 个在 uaddr 上等待、且 bitset 有交集的任务
+ *
+ * Returns: 唤醒的任务数，或负的错误码
+ */
+int32 futex_wake(uint32* uaddr, uint32 flags, int32 nr_wake, uint32 bitset) {
+	union futex_key key;
+	struct futex_q *q, *next;
+	int32 woken = 0;
+
+	if (!bitset) return -EINVAL;
+	int32 ret = get_futex_key(uaddr, flags, &key);
+	if (ret) return ret;
+
+	struct futex_hash_bucket* hb = hash_futex(&key);
+	spinlock_lock(&hb->lock);
+	list_for_each_entry_safe(q, next, &hb->chain, list) {
+		if (!match_futex(&q->key, &key) || !(q->bitset & bitset)) continue;
+		if (woken >= nr_wake) break;
+		wake_futex(q);
+		woken++;
+	}
+	spinlock_unlock(&hb->lock);
+	return woken;
+}
+
+/*
+ * 唤醒 uaddr 上的 nr_wake 个等待者，再把最多 nr_requeue 个移到 uaddr2 上，
+ * 避免条件变量广播时所有等待者一起醒来争抢同一把锁。
+ * cmpval 非空时（FUTEX_CMP_REQUEUE）先确认 *uaddr 仍等于 *cmpval。
+ */
+static int64 futex_requeue(uint32* uaddr, uint32 flags, uint32* uaddr2, int32 nr_wake, int32 nr_requeue, uint32* cmpval) {
+	union futex_key key1, key2;
+	struct futex_q *q, *next;
+	int32 woken = 0, requeued = 0;
+
+	if (nr_wake < 0 || nr_requeue < 0) return -EINVAL;
+	int32 ret = get_futex_key(uaddr, flags, &key1);
+	if (ret) return ret;
+	ret = get_futex_key(uaddr2, flags, &key2);
+	if (ret) return ret;
+
+	struct futex_hash_bucket* hb1 = hash_futex(&key1);
+	struct futex_hash_bucket* hb2 = hash_futex(&key2);
+	double_lock_hb(hb1, hb2);
+
+	if (cmpval) {
+		uint32 curval;
+		if (copy_from_user(&curval, uaddr, sizeof(curval))) {
+			double_unlock_hb(hb1, hb2);
+			return -EFAULT;
+		}
+		if (curval != *cmpval) {
+			double_unlock_hb(hb1, hb2);
+			return -EAGAIN;
+		}
+	}
+
+	list_for_each_entry_safe(q, next, &hb1->chain, list) {
+		if (!match_futex(&q->key, &key1)) continue;
+		if (woken < nr_wake) {
+			wake_futex(q);
+			woken++;
+			continue;
+		}
+		if (requeued >= nr_requeue) break;
+		// 同一个桶内也要更新键，链表位置不变
+		if (hb1 != hb2) {
+			list_del(&q->list);
+			list_add_tail(&q->list, &hb2->chain);
+			q->lock_ptr = &hb2->lock;
+		}
+		q->key = key2;
+		requeued++;
+	}
+
+	double_unlock_hb(hb1, hb2);
+	return woken + requeued;
+}
+
+/**
+ * do_futex - futex 系统调用的分发
+ * @timeout: FUTEX_WAIT/FUTEX_WAIT_BITSET 的超时（已复制到内核），NULL 表示不限时
+ * @val2: FUTEX_REQUEUE/FUTEX_CMP_REQUEUE 的最大迁移数
+ *
+ * 不支持 PI 锁和 FUTEX_WAKE_OP。
+ */
+int64 do_futex(uint32* uaddr, int32 op, uint32 val, const struct timespec* timeout, uint32* uaddr2, uint32 val2, uint32 val3) {
+	int32 cmd = op & FUTEX_CMD_MASK;
+	uint32 flags = op & ~FUTEX_CMD_MASK;
+
+	if ((flags & FUTEX_CLOCK_REALTIME) && cmd != FUTEX_WAIT_BITSET) return -ENOSYS;
+
+	switch (cmd) {
+	case FUTEX_WAIT:
+		return futex_wait(uaddr, flags, val, futex_timeout(timeout, cmd, flags), FUTEX_BITSET_MATCH_ANY);
+	case FUTEX_WAIT_BITSET:
+		return futex_wait(uaddr, flags, val, futex_timeout(timeout, cmd, flags), val3);
+	case FUTEX_WAKE:
+		return futex_wake(uaddr, flags, val, FUTEX_BITSET_MATCH_ANY);
+	case FUTEX_WAKE_BITSET:
+		return futex_wake(uaddr, flags, val, val3);
+	case FUTEX_REQUEUE:
+		return futex_requeue(uaddr, flags, uaddr2, val, val2, NULL);
+	case FUTEX_CMP_REQUEUE:
+		return futex_requeue(uaddr, flags, uaddr2, val, val2, &val3);
+	default:
+		return -ENOSYS;
+	}
+}
@@ -0,0 +1,298 @@
+/*
+ * 高精度定时器与 nanosleep，见 include/kernel/hrtimer.h
+ *
+ * 比较器通过 SBI set_timer 编程，只能设置调用者自己的 hart，
+ * 所以只有本 hart 的队列会在插入和删除时立即重新编程。
+ * 远端队列最早的定时器被取消时，那个 hart 会提前醒一次，发现没有到期的再重新编程。
+ */
+
+#include <kernel/clocksource.h>
+#include <kernel/device/sbi.h>
+#include <kernel/hrtimer.h>
+#include <kernel/sched.h>
+#include <kernel/sched/signal.h>
+#include <kernel/time.h>
+#include <kernel/util.h>
+
+DEFINE_PER_CPU(struct hrtimer_cpu_base, hrtimer_bases);
+
+// 到期时间已经过去时，中断内最多重新检查几轮，避免回调不断在过去重启导致死循环
+#define HRTIMER_INTERRUPT_RETRIES 3
+
+static inline uint64 ktime_add_safe(uint64 a, uint64 b) {
+	uint64 res = a + b;
+	return res > KTIME_MAX ? KTIME_MAX : res;
+}
+
+static void hrtimer_program(uint64 expires) {
+	// 没有定时器时把比较器推到最远，同时清除 STIP
+	SBI_SET_TIMER(expires == KTIME_MAX ? (uint64)-1 : ns_to_cycles(expires));
+}
+
+/*
+ * 按队列中最早的定时器重新编程本 hart 的比较器，调用者持有 base->lock
+ */
+static void hrtimer_reprogram(struct hrtimer_cpu_base* base) {
+	struct rb_node* first = rb_first_cached(&base->active);
+	uint64 next = first ? rb_entry(first, struct hrtimer, node)->expires : KTIME_MAX;
+
+	if (base->in_hrtirq || next == base->next_event) return;
+	base->next_event = next;
+	hrtimer_program(next);
+}
+
+static void enqueue_hrtimer(struct hrtimer* timer, struct hrtimer_cpu_base* base) {
+	struct rb_node **link = &base->active.rb_root.rb_node, *parent = NULL;
+	int32 leftmost = 1;
+
+	// 到期时间相同的按挂入顺序排在后面
+	while (*link) {
+		parent = *link;
+		if (timer->expires < rb_entry(parent, struct hrtimer, node)->expires) {
+			link = &parent->rb_left;
+		} else {
+			link = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+	rb_link_node(&timer->node, parent, link);
+	rb_insert_color_cached(&timer->node, &base->active, leftmost);
+}
+
+static void __remove_hrtimer(struct hrtimer* timer, struct hrtimer_cpu_base* base) {
+	rb_erase_cached(&timer->node, &base->active);
+	RB_CLEAR_NODE(&timer->node);
+}
+
+/**
+ * hrtimer_init - 初始化定时器
+ * @clockid: HRTIMER_MODE_ABS 的到期时间所属的时钟，CLOCK_REALTIME/CLOCK_MONOTONIC/CLOCK_BOOTTIME
+ */
+void hrtimer_init(struct hrtimer* timer, clockid_t clockid, enum hrtimer_restart (*function)(struct hrtimer*)) {
+	RB_CLEAR_NODE(&timer->node);
+	timer->expires = 0;
+	timer->function = function;
+	timer->base = NULL;
+	timer->clockid = clockid;
+}
+
+/*
+ * 绝对到期时间换算到 CLOCK_MONOTONIC。换算只在启动时做一次，
+ * 之后再 settimeofday 不会移动已经挂入的 CLOCK_REALTIME 定时器
+ */
+static uint64 hrtimer_abs_to_mono(const struct hrtimer* timer, uint64 expires) {
+	int64 offs = ktime_get_offset(timer->clockid);
+	if (offs >= 0) return expires > (uint64)offs ? expires - offs : 0;
+	return ktime_add_safe(expires, (uint64)-offs);
+}
+
+/**
+ * hrtimer_start - 启动或者重新启动定时器
+ * @expires: 纳秒，按 @mode 解释
+ *
+ * 定时器挂到当前 hart 上；回调正在其他 hart 上执行的定时器留在原处，
+ * 由那个 hart 在回调返回后一并处理。
+ */
+void hrtimer_start(struct hrtimer* timer, uint64 expires, enum hrtimer_mode mode) {
+	uint64 flags = disable_irqsave();
+	struct hrtimer_cpu_base* new_base = this_cpu_ptr(&hrtimer_bases);
+	struct hrtimer_cpu_base* base = timer->base;
+
+	if (mode == HRTIMER_MODE_REL)
+		expires = ktime_add_safe(ktime_get_ns(), expires);
+	else
+		expires = hrtimer_abs_to_mono(timer, expires);
+
+	if (base) {
+		spinlock_lock(&base->lock);
+		if (hrtimer_is_queued(timer)) __remove_hrtimer(timer, base);
+		if (base == new_base || base->running == timer) goto enqueue;
+		spinlock_unlock(&base->lock);
+	}
+	base = new_base;
+	spinlock_lock(&base->lock);
+	timer->base = base;
+enqueue:
+	timer->expires = expires;
+	enqueue_hrtimer(timer, base);
+	if (base == new_base) hrtimer_reprogram(base);
+	spinlock_unlock(&base->lock);
+	enable_irqrestore(flags);
+}
+
+/**
+ * hrtimer_try_to_cancel - 取消定时器，不等待正在执行的回调
+ *
+ * Returns: 1 表示取消了一个挂入的定时器，0 表示它没有挂入，-1 表示回调正在执行
+ */
+int32 hrtimer_try_to_cancel(struct hrtimer* timer) {
+	struct hrtimer_cpu_base* base = READ_ONCE(timer->base);
+	int32 ret = 0;
+
+	if (!base) return 0;
+	int64 flags = spinlock_lock_irqsave(&base->lock);
+	if (base->running == timer) {
+		ret = -1;
+	} else if (hrtimer_is_queued(timer)) {
+		__remove_hrtimer(timer, base);
+		if (base == this_cpu_ptr(&hrtimer_bases)) hrtimer_reprogram(base);
+		ret = 1;
+	}
+	spinlock_unlock_irqrestore(&base->lock, flags);
+	return ret;
+}
+
+/**
+ * hrtimer_cancel - 取消定时器并等待正在执行的回调结束
+ *
+ * 返回后可以释放 timer。不能在它自己的回调中调用。
+ */
+int32 hrtimer_cancel(struct hrtimer* timer) {
+	for (;;) {
+		int32 ret = hrtimer_try_to_cancel(timer);
+		if (ret >= 0) return ret;
+		cpu_relax();
+	}
+}
+
+/**
+ * hrtimer_forward - 把到期时间按 @interval 推到 @now 之后
+ *
+ * 只能对没有挂入的定时器使用，通常在它自己的回调中。
+ *
+ * Returns: 推后的周期数，@now 还没到到期时间时为 0
+ */
+uint64 hrtimer_forward(struct hrtimer* timer, uint64 now, uint64 interval) {
+	if (now < timer->expires) return 0;
+	uint64 overruns = (now - timer->expires) / interval + 1;
+	timer->expires = ktime_add_safe(timer->expires, overruns * interval);
+	return overruns;
+}
+
+// 距离到期还有多少纳秒，已经过去时为负
+int64 hrtimer_get_remaining(const struct hrtimer* timer) { return (int64)(timer->expires - ktime_get_ns()); }
+
+/*
+ * 执行所有在 now 之前到期的定时器，调用者持有 base->lock
+ */
+static void __run_hrtimers(struct hrtimer_cpu_base* base, uint64 now) {
+	struct rb_node* node;
+
+	while ((node = rb_first_cached(&base->active))) {
+		struct hrtimer* timer = rb_entry(node, struct hrtimer, node);
+		if (timer->expires > now) break;
+
+		__remove_hrtimer(timer, base);
+		base->running = timer;
+		spinlock_unlock(&base->lock);
+		enum hrtimer_restart restart = timer->function(timer);
+		spinlock_lock(&base->lock);
+		// 回调执行期间可能已经被 hrtimer_start 重新挂入
+		if (restart == HRTIMER_RESTART && !hrtimer_is_queued(timer)) enqueue_hrtimer(timer, base);
+		base->running = NULL;
+	}
+}
+
+/**
+ * hrtimer_interrupt - 时钟中断处理：执行到期的定时器并编程下一次中断
+ *
+ * 在关中断的中断上下文中调用。写比较器同时清除 STIP。
+ */
+void hrtimer_interrupt(void) {
+	struct hrtimer_cpu_base* base = this_cpu_ptr(&hrtimer_bases);
+	struct rb_node* first;
+	uint64 next;
+
+	spinlock_lock(&base->lock);
+	base->in_hrtirq = 1;
+	for (int32 retries = 0;; retries++) {
+		__run_hrtimers(base, ktime_get_ns());
+		first = rb_first_cached(&base->active);
+		next = first ? rb_entry(first, struct hrtimer, node)->expires : KTIME_MAX;
+		if (next > ktime_get_ns() || retries == HRTIMER_INTERRUPT_RETRIES) break;
+	}
+	base->in_hrtirq = 0;
+	base->next_event = next;
+	hrtimer_program(next);
+	spinlock_unlock(&base->lock);
+}
+
+/**
+ * hrtimer_init_cpu - 初始化本 hart 的定时器队列，在打开时钟中断之前调用
+ */
+void hrtimer_init_cpu(void) {
+	struct hrtimer_cpu_base* base = this_cpu_ptr(&hrtimer_bases);
+
+	spinlock_init(&base->lock);
+	base->active = RB_ROOT_CACHED;
+	base->running = NULL;
+	base->in_hrtirq = 0;
+	base->next_event = KTIME_MAX;
+	hrtimer_program(KTIME_MAX);
+}
+
+static enum hrtimer_restart hrtimer_wakeup(struct hrtimer* timer) {
+	struct hrtimer_sleeper* sl = container_of(timer, struct hrtimer_sleeper, timer);
+	struct task_struct* task = sl->task;
+
+	// 先清 task 再唤醒，与 hrtimer_nanosleep 中先设睡眠状态再检查 task 配对
+	WRITE_ONCE(sl->task, NULL);
+	if (task) wake_up_process(task);
+	return HRTIMER_NORESTART;
+}
+
+void hrtimer_init_sleeper(struct hrtimer_sleeper* sl, clockid_t clockid) {
+	hrtimer_init(&sl->timer, clockid, hrtimer_wakeup);
+	sl->task = CURRENT;
+}
+
+/**
+ * hrtimer_nanosleep - 可中断地睡眠到定时器到期
+ * @rem: 被信号打断时写入剩余时间，可以为 NULL
+ *
+ * Returns: 0 表示睡满，-EINTR 表示被信号打断
+ */
+int32 hrtimer_nanosleep(uint64 expires, enum hrtimer_mode mode, clockid_t clockid, struct timespec* rem) {
+	struct hrtimer_sleeper sl;
+
+	hrtimer_init_sleeper(&sl, clockid);
+	hrtimer_start(&sl.timer, expires, mode);
+	for (;;) {
+		WRITE_ONCE(CURRENT->state, TASK_INTERRUPTIBLE);
+		smp_mb();
+		if (!READ_ONCE(sl.task) || signal_pending(CURRENT)) break;
+		schedule();
+	}
+	WRITE_ONCE(CURRENT->state, TASK_RUNNING);
+	hrtimer_cancel(&sl.timer);
+
+	if (!READ_ONCE(sl.task)) return 0;
+	if (rem) {
+		int64 left = hrtimer_get_remaining(&sl.timer);
+		ns_to_timespec(rem, left > 0 ? left : 0);
+	}
+	return -EINTR;
+}
+
+int32 do_nanosleep(const struct timespec* req, struct timespec* rem) {
+	return do_clock_nanosleep(CLOCK_MONOTONIC, 0, req, rem);
+}
+
+/**
+ * do_clock_nanosleep - 在 @which_clock 上睡眠一段时间或者睡到某个时刻
+ * @flags: TIMER_ABSTIME 表示 @req 是绝对时间，此时不写 @rem
+ */
+int32 do_clock_nanosleep(clockid_t which_clock, int32 flags, const struct timespec* req, struct timespec* rem) {
+	switch (which_clock) {
+	case CLOCK_REALTIME:
+	case CLOCK_MONOTONIC:
+	case CLOCK_BOOTTIME:
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (!req || !timespec_valid(req)) return -EINVAL;
+
+	if (flags & TIMER_ABSTIME) return hrtimer_nanosleep(timespec_to_ns(req), HRTIMER_MODE_ABS, which_clock, NULL);
+	return hrtimer_nanosleep(timespec_to_ns(req), HRTIMER_MODE_REL, which_clock, rem);
+}
@@ -37,7 +37,7 @@ void create_init_mm() {
   init_mm.map_count = 0;
 
 
-	spinlock_init(&init_mm.mm_lock);
+	init_rwsem(&init_mm.mmap_lock);
 	atomic_set(&init_mm.mm_users,0);
 	atomic_set(&init_mm.mm_count,0);
 	kprintf("create_init_mm: complete.\n");
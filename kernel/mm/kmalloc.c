@@ -61,7 +61,7 @@ void kmem_init(void) {
  * @brief Allocate kernel memory
  */
  void *kmalloc(size_t size) {
-  kprintf("kmalloc: request mem size = %d\n",size);
+  log_trace(LOG_SUB_MM, "kmalloc: request mem size = %d\n", size);
   if (size == 0)
     return NULL;
 
@@ -89,7 +89,7 @@ void kmem_init(void) {
     vaddr_t ret = mmap_file(&init_mm, 0, size, PROT_READ | PROT_WRITE,
                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, NULL, 0);
 					
-	kprintf("kmalloc:mmap_file ret=%lx\n", ret);
+	log_trace(LOG_SUB_MM, "kmalloc: mmap_file ret=%lx\n", ret);
     struct page *page = addr_to_page(ret);
 
     if (page) {
@@ -102,7 +102,7 @@ void kmem_init(void) {
 	}
   }
   //kprintf("kmalloc: end\n");
-  kprintf("kmalloc: allocated %d bytes at %lx\n", size, mem);
+  log_trace(LOG_SUB_MM, "kmalloc: allocated %d bytes at %lx\n", size, mem);
   return mem;
 }
 
@@ -113,7 +113,7 @@ void kmem_init(void) {
   if (!ptr)
     return;
 
-  kprintf("calling kfree with ptr=%lx\n", ptr);
+  log_trace(LOG_SUB_MM, "calling kfree with ptr=%lx\n", ptr);
 
   // Check if this is a page allocation (page-aligned pointer)
   if (((uint64)ptr & (PAGE_SIZE - 1)) == 0) {
@@ -25,7 +25,7 @@ struct mm_struct *user_alloc_mm(void) {
   }
   memset(mm->pagetable, 0, PAGE_SIZE);
 
-  spinlock_init(&mm->mm_lock);
+  init_rwsem(&mm->mmap_lock);
   atomic_set(&mm->mm_users, 1);
   atomic_set(&mm->mm_count, 1);
 
@@ -65,23 +65,10 @@ void free_mm(struct mm_struct *mm) {
   if (atomic_dec_and_test(&mm->mm_count)) {
     // 引用计数为0，可以释放mm结构
 
-    // 释放所有VMA
+    // 释放所有VMA，free_vma 同时归还VMA关联的所有页
     struct vm_area_struct *vma, *tmp;
     list_for_each_entry_safe(vma, tmp, &mm->vma_list, vm_list) {
       free_vma(vma);
-      // 释放VMA关联的所有页
-      if (vma->pages) {
-        for (int32 i = 0; i < vma->page_count; i++) {
-          if (vma->pages[i]) {
-            put_page(vma->pages[i]);
-          }
-        }
-        kfree(vma->pages);
-      }
-
-      // 从链表中移除并释放VMA
-      list_del(&vma->vm_list);
-      kfree(vma);
     }
 
     // 释放页表
@@ -94,6 +81,85 @@ void free_mm(struct mm_struct *mm) {
   }
 }
 
+/**
+ * mmput - 放弃一个地址空间的使用者，最后一个使用者释放它
+ */
+void mmput(struct mm_struct *mm) {
+  if (mm && atomic_dec_and_test(&mm->mm_users))
+    free_mm(mm);
+}
+
+/**
+ * dup_mm - 为不带 CLONE_VM 的 clone 复制一份地址空间
+ * @oldmm: 调用者的地址空间，调用者持有它的 mmap_lock 读锁
+ *
+ * 私有映射的已分配页逐页复制（还没有写时复制），共享映射与原进程共用物理页。
+ *
+ * Returns: 新的 mm_struct，失败返回 NULL
+ */
+struct mm_struct *dup_mm(struct mm_struct *oldmm) {
+  struct mm_struct *mm = (struct mm_struct *)kmalloc(sizeof(struct mm_struct));
+  if (unlikely(mm == NULL))
+    return NULL;
+
+  // 布局信息直接沿用，VMA 链表和页表重新建立
+  memcpy(mm, oldmm, sizeof(struct mm_struct));
+  INIT_LIST_HEAD(&mm->vma_list);
+  mm->map_count = 0;
+  mm->is_kernel_mm = 0;
+  init_rwsem(&mm->mmap_lock);
+  atomic_set(&mm->mm_users, 1);
+  atomic_set(&mm->mm_count, 1);
+
+  mm->pagetable = (pagetable_t)kmalloc(PAGE_SIZE);
+  if (unlikely(mm->pagetable == NULL)) {
+    kfree(mm);
+    return NULL;
+  }
+  memset(mm->pagetable, 0, PAGE_SIZE);
+
+  struct vm_area_struct *vma;
+  list_for_each_entry(vma, &oldmm->vma_list, vm_list) {
+    if (vma->vm_flags & VM_DONTCOPY)
+      continue;
+
+    struct vm_area_struct *new_vma =
+        vm_area_setup(mm, vma->vm_start, vma->vm_end - vma->vm_start,
+                      vma->vm_type, vma->vm_prot, vma->vm_flags);
+    if (unlikely(new_vma == NULL))
+      goto fail;
+    new_vma->vm_file = vma->vm_file;
+    new_vma->vm_pgoff = vma->vm_pgoff;
+
+    for (int32 i = 0; i < vma->page_count; i++) {
+      struct page *page = vma->pages[i];
+      if (!page)
+        continue;
+
+      if (vma->vm_flags & VM_SHARED) {
+        get_page(page);
+      } else {
+        struct page *copy = alloc_page();
+        if (unlikely(copy == NULL))
+          goto fail;
+        memcpy((void *)copy->paddr, (void *)page->paddr, PAGE_SIZE);
+        page = copy;
+      }
+      // 先记入 pages[]，映射失败时由 free_mm 统一归还
+      new_vma->pages[i] = page;
+      if (pgt_map_page(mm->pagetable, new_vma->vm_start + (uint64)i * PAGE_SIZE, page->paddr,
+                       prot_to_type(vma->vm_prot, vma->vm_flags & VM_USER)))
+        goto fail;
+    }
+  }
+
+  return mm;
+
+fail:
+  free_mm(mm);
+  return NULL;
+}
+
 /**
  * 查找包含指定地址的VMA
  */
@@ -157,7 +223,7 @@ ssize_t mm_copy_to_user(struct mm_struct *mm, uint64 dst, const void* src,
       return bytes_copied > 0 ? bytes_copied : -EFAULT;
 
     // Calculate bytes to copy in current page
-    uint64 page_offset = (dst_addr + bytes_copied) | (PAGE_SIZE - 1);
+    uint64 page_offset = (dst_addr + bytes_copied) % PAGE_SIZE;
     uint64 page_bytes = MIN(PAGE_SIZE - page_offset, len - bytes_copied);
 
     // Get page virtual address
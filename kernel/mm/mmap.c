@@ -211,7 +211,9 @@ int32 do_unmap(struct mm_struct *mm, uint64 start, size_t len) {
     }
   }
 
-  /* Free all VMAs in the range */
+  /* Take the VMAs in the range off the list and clear their PTEs */
+  struct list_head doomed;
+  INIT_LIST_HEAD(&doomed);
   list_for_each_entry_safe(vma, next, &mm->vma_list, vm_list) {
     if (vma->vm_start >= end)
       break;
@@ -219,35 +221,39 @@ int32 do_unmap(struct mm_struct *mm, uint64 start, size_t len) {
     if (vma->vm_end <= start)
       continue;
 
-    /* Calculate region to unmap in this VMA */
+    list_move_tail(&vma->vm_list, &doomed);
+    mm->map_count--;
+    count++;
+  }
+  pgt_unmap_noflush(mm->pagetable, start, len);
+
+  /*
+   * One flush for the whole range on every hart running this mm. Pages
+   * may only be freed after it, another hart could still reach them
+   * through a stale TLB entry.
+   */
+  flush_tlb_range(mm->pagetable, start, end);
+
+  list_for_each_entry_safe(vma, next, &doomed, vm_list) {
+    /* Calculate region unmapped in this VMA */
     uint64 unmap_start = MAX(start, vma->vm_start);
     uint64 unmap_end = MIN(end, vma->vm_end);
-
-    /* Free physical pages and unmap */
     int32 start_idx = (unmap_start - vma->vm_start) / PAGE_SIZE;
     int32 end_idx = (unmap_end - vma->vm_start + PAGE_SIZE - 1) / PAGE_SIZE;
 
     for (int32 i = start_idx; i < end_idx && i < vma->page_count; i++) {
       if (vma->pages[i]) {
-        uint64 page_va = vma->vm_start + (i * PAGE_SIZE);
-        pgt_unmap(mm->pagetable, page_va, PAGE_SIZE, 1);
         put_page(vma->pages[i]);
         vma->pages[i] = NULL;
       }
     }
 
-    /* Remove this VMA */
     list_del(&vma->vm_list);
     if (vma->pages)
       kfree(vma->pages);
     kfree(vma);
-    mm->map_count--;
-    count++;
   }
 
-  /* Flush TLB */
-  flush_tlb();
-
   return 0;
 }
 
@@ -338,16 +344,17 @@ uint64 do_brk(struct mm_struct *mm, uint64 new_brk) {
 			struct vm_area_struct *vma = find_vma(mm, new_brk);
 			
 			if (vma && vma->vm_start < new_brk && vma->vm_type == VMA_HEAP) {
-					// Free the pages in the contracted region
+					// Unmap the contracted region with one TLB flush, then free its pages
 					uint64 page_size = PAGE_SIZE;
-					for (uint64 addr = ROUNDUP(new_brk, page_size); 
+					uint64 shrink_start = ROUNDUP(new_brk, page_size);
+					if (shrink_start < old_brk)
+							pgt_unmap(mm->pagetable, shrink_start, old_brk - shrink_start, 0);
+					for (uint64 addr = shrink_start; 
 							 addr < old_brk; 
 							 addr += page_size) {
 							
 							int32 page_idx = (addr - vma->vm_start) / page_size;
 							if (page_idx >= 0 && page_idx < vma->page_count && vma->pages[page_idx]) {
-									// Unmap and free this page
-									pgt_unmap(mm->pagetable, addr, page_size, 1);
 									put_page(vma->pages[page_idx]);
 									vma->pages[page_idx] = NULL;
 							}
@@ -456,8 +463,8 @@ int32 do_protect(struct mm_struct *mm, __page_aligned uint64 start, size_t len,
 			current_addr = vma->vm_end;
 	}
 	
-	/* Flush TLB after updating all pages */
-	flush_tlb();
+	/* Flush TLB on every hart running this mm after updating all pages */
+	flush_tlb_range(mm->pagetable, start, end);
 	
 	return 0;
 }
\ No newline at end of file
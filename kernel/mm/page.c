@@ -144,18 +144,16 @@ struct page* pfn_to_page(uint64 pfn) {
 struct page* addr_to_page(paddr_t addr) {
 	paddr_t pa;
 	if (addr >= mem_base_addr + mem_size) {
-		kprintf("addr_to_page: original kva 0x%lx\n",addr);
 		pa = lookup_pa(g_kernel_pagetable, addr);
-		kprintf("addr_to_page: translate kpa 0x%lx\n",addr);
+		log_trace(LOG_SUB_MM, "addr_to_page: kva 0x%lx -> pa 0x%lx\n", addr, pa);
 
 	}else{
 		pa = addr;
 	}
 	if (((uint64)pa % PAGE_SIZE) != 0 || (uint64)pa < mem_base_addr || (uint64)pa >= mem_base_addr + mem_size) {
-		kprintf("addr_to_page: invalid address 0x%lx\n",addr);
+		log_debug(LOG_SUB_MM, "addr_to_page: invalid address 0x%lx\n", addr);
 		return NULL;
 	}
-	kprintf("addr_to_page: pa 0x%lx\n",pa);
 	uint64 pfn = get_pfn(pa);
 	// kprintf("addr_to_page: pfn=%lx\n",pfn);
 	return pfn_to_page(pfn);
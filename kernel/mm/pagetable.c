@@ -4,6 +4,7 @@
  */
 
 #include <kernel/mmu.h>
+#include <kernel/sched/preempt.h>
 #include <kernel/util.h>
 
 // pointer to kernel page director
@@ -211,57 +212,84 @@ int32 pgt_map_pages(pagetable_t pagetable, uint64 va, uint64 pa, uint64 size, in
 	return 0;
 }
 
+// pgt_unmap 一次最多暂存多少个待释放的物理页，满了就先刷新 TLB 再释放
+#define PGT_UNMAP_BATCH 32
+
+// 检查并按页对齐 [va, va + size)，无效时返回 -1
+static int32 pgt_unmap_range(uint64 va, uint64 size, uint64* start_va, uint64* end_va) {
+	*start_va = ROUNDDOWN(va, PAGE_SIZE);
+	*end_va = ROUNDUP(va + size, PAGE_SIZE);
+	if (*start_va >= MAXVA || *end_va > MAXVA || *end_va < *start_va) return -1;
+	return 0;
+}
+
+/*
+ * 清除一页的映射，返回原来映射的物理页，没有映射时返回 NULL。调用者持有 pagetable_lock
+ */
+static struct page* pgt_clear_pte(pagetable_t pagetable, uint64 va) {
+	// 查找页表项，不分配新页表
+	pte_t* pte = page_walk(pagetable, va, 0);
+	if (pte == NULL || !(*pte & PTE_V)) return NULL;
+
+	struct page* page = addr_to_page(PTE2PA(*pte));
+	*pte = 0;
+	atomic_dec(&pt_stats.mapped_pages);
+	return page;
+}
+
 /**
  * 解除页表中一块虚拟地址区域的映射
+ *
+ * 物理页要等所有 hart 的 TLB 都刷新之后才释放，否则其他 hart 还可能通过旧表项访问已经重新分配的页。
  */
 int32 pgt_unmap(pagetable_t pagetable, uint64 va, uint64 size, int32 free_phys) {
-	if (pagetable == NULL) {
-		return -1;
-	}
-
-	// 确保地址对齐到页边界
-	uint64 start_va = ROUNDDOWN(va, PAGE_SIZE);
-	uint64 end_va = ROUNDUP(va + size, PAGE_SIZE);
+	struct page* batch[PGT_UNMAP_BATCH];
+	uint64 start_va, end_va, flush_start;
+	int32 nr = 0;
 
-	// 检查虚拟地址范围是否有效
-	if (start_va >= MAXVA || end_va > MAXVA || end_va < start_va) {
-		return -1;
-	}
+	if (pagetable == NULL || pgt_unmap_range(va, size, &start_va, &end_va)) return -1;
 
-	// 锁定页表操作
+	flush_start = start_va;
 	int64 flags = spinlock_lock_irqsave(&pagetable_lock);
-
-	// 逐页取消映射
 	for (uint64 va_page = start_va; va_page < end_va; va_page += PAGE_SIZE) {
-		// 查找页表项，不分配新页表
-		pte_t* pte = page_walk(pagetable, va_page, 0);
-		if (pte == NULL) {
-			// 页表不存在，跳过
-			continue;
-		}
+		struct page* page = pgt_clear_pte(pagetable, va_page);
+		if (!page || !free_phys) continue;
 
-		// 检查页是否已映射
-		if (*pte & PTE_V) {
-			// 如果需要，释放物理页
-			if (free_phys) {
-				paddr_t pa = PTE2PA(*pte);
-				put_page((addr_to_page(pa)));
-			}
-
-			// 清除页表项
-			*pte = 0;
-			atomic_dec(&pt_stats.mapped_pages);
+		batch[nr++] = page;
+		if (nr == PGT_UNMAP_BATCH) {
+			// 刷新 IPI 要等其他 hart 应答，不能持锁关中断等待
+			spinlock_unlock_irqrestore(&pagetable_lock, flags);
+			flush_tlb_range(pagetable, flush_start, va_page + PAGE_SIZE);
+			while (nr) put_page(batch[--nr]);
+			flush_start = va_page + PAGE_SIZE;
+			flags = spinlock_lock_irqsave(&pagetable_lock);
 		}
 	}
-
 	spinlock_unlock_irqrestore(&pagetable_lock, flags);
 
-	// 刷新TLB
-	flush_tlb();
+	// 刷新本 hart 和正在使用这个页表的其他 hart 的 TLB
+	if (flush_start < end_va) flush_tlb_range(pagetable, flush_start, end_va);
+	while (nr) put_page(batch[--nr]);
 
 	return 0;
 }
 
+/**
+ * 解除映射但不刷新 TLB、不释放物理页
+ *
+ * 用于一次解除多段映射的场合：调用者最后对整个区域调用一次 flush_tlb_range，之后才能释放物理页。
+ */
+int32 pgt_unmap_noflush(pagetable_t pagetable, uint64 va, uint64 size) {
+	uint64 start_va, end_va;
+
+	if (pagetable == NULL || pgt_unmap_range(va, size, &start_va, &end_va)) return -1;
+
+	int64 flags = spinlock_lock_irqsave(&pagetable_lock);
+	for (uint64 va_page = start_va; va_page < end_va; va_page += PAGE_SIZE) pgt_clear_pte(pagetable, va_page);
+	spinlock_unlock_irqrestore(&pagetable_lock, flags);
+	return 0;
+}
+
 /**
  * 查找虚拟地址对应的物理地址
  */
@@ -326,6 +354,13 @@ pagetable_t pagetable_copy(pagetable_t src, uint64 start, uint64 end, int32 shar
 
 	// 逐页复制映射
 	for (uint64 va = start; va < end; va += PAGE_SIZE) {
+		// 地址范围很大时定期放锁让出 CPU；循环状态只有 va，放锁前后各页的处理互不影响
+		if (need_resched()) {
+			spinlock_unlock_irqrestore(&pagetable_lock, flags);
+			cond_resched();
+			flags = spinlock_lock_irqsave(&pagetable_lock);
+		}
+
 		// 查找源页表项
 		pte_t* src_pte = page_walk(src, va, 0);
 		if (src_pte == NULL || !(*src_pte & PTE_V)) {
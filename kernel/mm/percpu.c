@@ -0,0 +1,49 @@
+/*
+ * per-CPU 数据区，见 include/kernel/percpu.h
+ */
+
+#include <kernel/mm/kmalloc.h>
+#include <kernel/percpu.h>
+#include <kernel/util.h>
+
+uint64 __per_cpu_offset[NCPU];
+DEFINE_PER_CPU(int32, cpu_number);
+
+/**
+ * percpu_init_hart - 让本 hart 的 tp 指向自己的 per-CPU 副本
+ * @cpu: 本 hart 的编号
+ *
+ * 启动 hart 一开始就调用，此时偏移全为 0，使用的是模板本身。
+ */
+void percpu_init_hart(int32 cpu) {
+	write_tp(__per_cpu_offset[cpu]);
+	raw_cpu_write(cpu_number, cpu);
+}
+
+/**
+ * setup_per_cpu_areas - 给每个 hart 分配 per-CPU 副本，由启动 hart 在 kmem_init 之后调用
+ *
+ * 模板中已经有启动 hart 到目前为止写入的值，连同它们一起复制到每一份，
+ * 启动 hart 随后换到自己的副本，从核换上副本后各自改写自己的那一份。
+ */
+void setup_per_cpu_areas(void) {
+	uint64 size = __per_cpu_end - __per_cpu_start;
+	uint64 stride = ROUNDUP(size, L1_CACHE_BYTES);
+
+	// 超过 2048 字节的 kmalloc 按页分配，每一份的起点都按缓存行对齐
+	char* base = kmalloc(ROUNDUP(stride * NCPU, PAGE_SIZE));
+	if (!base) panic("setup_per_cpu_areas: out of memory\n");
+
+	// 复制期间不能有中断处理程序改写模板
+	uint64 flags = disable_irqsave();
+	for (int32 cpu = 0; cpu < NCPU; cpu++) {
+		char* area = base + cpu * stride;
+		memcpy(area, __per_cpu_start, size);
+		__per_cpu_offset[cpu] = (uint64)(area - __per_cpu_start);
+		per_cpu(cpu_number, cpu) = cpu;
+	}
+	percpu_init_hart(smp_processor_id());
+	enable_irqrestore(flags);
+
+	kprintf("percpu: %ld bytes per hart\n", stride);
+}
@@ -130,6 +130,7 @@ static void vma_init(struct vm_area_struct* vma, struct mm_struct* mm, uint64 st
 	vma->vm_end = end;
 	vma->vm_flags = flags;
 	vma->vm_mm = mm;
+	vma->vm_prot = prot;
 
 	// Calculate page count - moved to a separate step
 	vma->page_count = (end - start + PAGE_SIZE - 1) / PAGE_SIZE;
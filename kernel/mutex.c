@@ -0,0 +1,77 @@
+/*
+ * 睡眠互斥锁，见 include/kernel/mutex.h
+ */
+
+#include <kernel/mutex.h>
+#include <kernel/sched.h>
+#include <kernel/util.h>
+
+void mutex_init(struct mutex* lock) {
+	lock->owner = NULL;
+	init_waitqueue_head(&lock->wait);
+}
+
+/**
+ * mutex_trylock - 尝试获取锁，不睡眠
+ *
+ * 使用全序的 CAS：等待者先挂入队列再尝试加锁，解锁者先释放再检查队列，
+ * 两边至少有一方能看到对方的写入。
+ *
+ * Returns: 1 表示获取成功
+ */
+int32 mutex_trylock(struct mutex* lock) {
+	struct task_struct* expected = NULL;
+	return __atomic_compare_exchange_n(&lock->owner, &expected, CURRENT, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+// 只比较 current_percpu 中的指针，不解引用 owner：它可能在我们检查的同时解锁并退出
+static int32 owner_on_cpu(struct task_struct* owner) {
+	for (int32 cpu = 0; cpu < NCPU; cpu++) {
+		if (READ_ONCE(per_cpu(current_percpu, cpu)) == owner) return 1;
+	}
+	return 0;
+}
+
+/*
+ * 乐观自旋：持有者正在其他 hart 上运行时，它通常很快就会解锁，
+ * 自旋等待比睡眠后再被唤醒便宜。持有者睡眠、本 hart 需要调度或者已经有任务在排队时放弃。
+ */
+static int32 mutex_optimistic_spin(struct mutex* lock) {
+	int32 acquired = 0;
+	preempt_disable();
+	for (;;) {
+		struct task_struct* owner = __atomic_load_n(&lock->owner, __ATOMIC_RELAXED);
+		if (!owner) {
+			if (mutex_trylock(lock)) {
+				acquired = 1;
+				break;
+			}
+			continue;
+		}
+		if (owner == CURRENT || !owner_on_cpu(owner) || need_resched() || waitqueue_active(&lock->wait)) break;
+	}
+	preempt_enable();
+	return acquired;
+}
+
+void mutex_lock(struct mutex* lock) {
+	if (mutex_trylock(lock) || mutex_optimistic_spin(lock)) return;
+	wait_event_exclusive(lock->wait, mutex_trylock(lock));
+}
+
+/**
+ * mutex_lock_interruptible - 同 mutex_lock，但睡眠可以被信号打断
+ *
+ * Returns: 0 表示获取成功，-EINTR 表示被信号打断且没有持有锁
+ */
+int32 mutex_lock_interruptible(struct mutex* lock) {
+	if (mutex_trylock(lock) || mutex_optimistic_spin(lock)) return 0;
+	return wait_event_interruptible_exclusive(lock->wait, mutex_trylock(lock));
+}
+
+void mutex_unlock(struct mutex* lock) {
+	if (unlikely(lock->owner != CURRENT)) panic("mutex_unlock: not owner\n");
+	__atomic_store_n(&lock->owner, NULL, __ATOMIC_RELEASE);
+	smp_mb();
+	if (waitqueue_active(&lock->wait)) wake_up(&lock->wait);
+}
@@ -0,0 +1,85 @@
+/*
+ * 读写信号量，见 include/kernel/rwsem.h
+ */
+
+#include <kernel/rwsem.h>
+#include <kernel/sched.h>
+#include <kernel/util.h>
+
+void init_rwsem(struct rw_semaphore* sem) {
+	spinlock_init(&sem->lock);
+	sem->count = 0;
+	sem->writers_waiting = 0;
+	init_waitqueue_head(&sem->wait);
+}
+
+int32 down_read_trylock(struct rw_semaphore* sem) {
+	int32 ret = 0;
+	spinlock_lock(&sem->lock);
+	if (sem->count >= 0 && !sem->writers_waiting) {
+		sem->count++;
+		ret = 1;
+	}
+	spinlock_unlock(&sem->lock);
+	return ret;
+}
+
+int32 down_write_trylock(struct rw_semaphore* sem) {
+	int32 ret = 0;
+	spinlock_lock(&sem->lock);
+	if (sem->count == 0) {
+		sem->count = -1;
+		ret = 1;
+	}
+	spinlock_unlock(&sem->lock);
+	return ret;
+}
+
+// 已经计入 writers_waiting 的写者获取锁，成功时撤销计数
+static int32 down_write_waiter(struct rw_semaphore* sem) {
+	int32 ret = 0;
+	spinlock_lock(&sem->lock);
+	if (sem->count == 0) {
+		sem->count = -1;
+		sem->writers_waiting--;
+		ret = 1;
+	}
+	spinlock_unlock(&sem->lock);
+	return ret;
+}
+
+void down_read(struct rw_semaphore* sem) { wait_event(sem->wait, down_read_trylock(sem)); }
+
+void down_write(struct rw_semaphore* sem) {
+	if (down_write_trylock(sem)) return;
+	spinlock_lock(&sem->lock);
+	sem->writers_waiting++;
+	spinlock_unlock(&sem->lock);
+	wait_event_exclusive(sem->wait, down_write_waiter(sem));
+}
+
+/*
+ * 释放时唤醒所有读者和一个写者：有写者在等待时读者检查条件后会继续睡眠，
+ * 写者排在队尾，总能被这次唤醒选中。
+ */
+void up_read(struct rw_semaphore* sem) {
+	spinlock_lock(&sem->lock);
+	int32 last = --sem->count == 0;
+	spinlock_unlock(&sem->lock);
+	if (last) wake_up(&sem->wait);
+}
+
+void up_write(struct rw_semaphore* sem) {
+	spinlock_lock(&sem->lock);
+	sem->count = 0;
+	spinlock_unlock(&sem->lock);
+	wake_up(&sem->wait);
+}
+
+// 写者转为读者，不释放锁；其他读者仍要等待排队的写者
+void downgrade_write(struct rw_semaphore* sem) {
+	spinlock_lock(&sem->lock);
+	sem->count = 1;
+	spinlock_unlock(&sem->lock);
+	wake_up_all(&sem->wait);
+}
@@ -0,0 +1,240 @@
+/*
+ * 公平调度类
+ *
+ * 任务按权重累积虚拟运行时间：delta_vruntime = delta_exec * NICE_0_LOAD / weight，
+ * nice 值越小权重越大，vruntime 增长越慢。运行队列用红黑树按 vruntime 排序，
+ * 每次选择 vruntime 最小的任务运行。
+ *
+ * 时间片不是固定的：一个调度周期 (sysctl_sched_latency) 按权重分给所有可运行任务，
+ * 每个任务至少运行 sysctl_sched_min_granularity。
+ */
+
+#include <kernel/sched/sched.h>
+#include <kernel/util.h>
+
+uint64 sysctl_sched_latency = CONFIG_SCHED_LATENCY_NS;
+uint64 sysctl_sched_min_granularity = CONFIG_SCHED_MIN_GRANULARITY_NS;
+uint64 sysctl_sched_wakeup_granularity = CONFIG_SCHED_WAKEUP_GRANULARITY_NS;
+
+/*
+ * nice -20..19 对应的权重，相邻两级相差约 1.25 倍，
+ * 即 nice 值每差 1，两个竞争的任务分到的 CPU 时间相差约 10%
+ */
+static const uint32 prio_to_weight[40] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548,  7620,  6100,  4904,  3906,
+    /*  -5 */ 3121,  2501,  1991,  1586,  1277,
+    /*   0 */ 1024,  820,   655,   526,   423,
+    /*   5 */ 335,   272,   215,   172,   137,
+    /*  10 */ 110,   87,    70,    56,    45,
+    /*  15 */ 36,    29,    23,    18,    15,
+};
+
+uint32 sched_prio_to_weight(int32 prio) {
+	if (prio < MAX_RT_PRIO) prio = MAX_RT_PRIO;
+	if (prio >= MAX_PRIO) prio = MAX_PRIO - 1;
+	return prio_to_weight[prio - MAX_RT_PRIO];
+}
+
+void init_cfs_rq(struct cfs_rq* cfs_rq) {
+	cfs_rq->nr_running = 0;
+	cfs_rq->load = 0;
+	cfs_rq->min_vruntime = 0;
+	cfs_rq->tasks_timeline = RB_ROOT_CACHED;
+}
+
+/*
+ * vruntime 只比较差值，回绕后顺序依然正确
+ */
+static inline uint64 max_vruntime(uint64 a, uint64 b) { return (int64)(b - a) > 0 ? b : a; }
+static inline uint64 min_vruntime(uint64 a, uint64 b) { return (int64)(b - a) < 0 ? b : a; }
+
+static inline int32 entity_before(const struct sched_entity* a, const struct sched_entity* b) {
+	return (int64)(a->vruntime - b->vruntime) < 0;
+}
+
+#define se_task(entity) container_of(entity, struct task_struct, se)
+
+static inline uint64 calc_delta_fair(uint64 delta, const struct sched_entity* se) {
+	if (se->weight != NICE_0_LOAD) delta = delta * NICE_0_LOAD / se->weight;
+	return delta;
+}
+
+static inline struct sched_entity* first_entity(struct cfs_rq* cfs_rq) {
+	struct rb_node* left = rb_first_cached(&cfs_rq->tasks_timeline);
+	return left ? rb_entry(left, struct sched_entity, run_node) : NULL;
+}
+
+static inline int32 curr_is_fair(struct rq* rq) { return rq->curr && rq->curr->sched_class == &fair_sched_class; }
+
+// min_vruntime 跟踪 curr 与树中最小 vruntime 的较小者，且只增不减
+static void update_min_vruntime(struct rq* rq) {
+	struct cfs_rq* cfs_rq = &rq->cfs;
+	struct sched_entity* left = first_entity(cfs_rq);
+	uint64 vruntime = cfs_rq->min_vruntime;
+
+	if (curr_is_fair(rq)) {
+		vruntime = rq->curr->se.vruntime;
+		if (left) vruntime = min_vruntime(vruntime, left->vruntime);
+	} else if (left) {
+		vruntime = left->vruntime;
+	}
+	cfs_rq->min_vruntime = max_vruntime(cfs_rq->min_vruntime, vruntime);
+}
+
+static void __enqueue_entity(struct cfs_rq* cfs_rq, struct sched_entity* se) {
+	struct rb_node** link = &cfs_rq->tasks_timeline.rb_root.rb_node;
+	struct rb_node* parent = NULL;
+	int32 leftmost = 1;
+
+	// vruntime 相同的任务插到右边，保持先来先运行
+	while (*link) {
+		parent = *link;
+		if (entity_before(se, rb_entry(parent, struct sched_entity, run_node))) {
+			link = &parent->rb_left;
+		} else {
+			link = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+	rb_link_node(&se->run_node, parent, link);
+	rb_insert_color_cached(&se->run_node, &cfs_rq->tasks_timeline, leftmost);
+}
+
+static void __dequeue_entity(struct cfs_rq* cfs_rq, struct sched_entity* se) {
+	rb_erase_cached(&se->run_node, &cfs_rq->tasks_timeline);
+}
+
+/*
+ * 可运行任务过多时拉长调度周期，保证每个任务至少运行 min_granularity
+ */
+static uint64 sched_period(uint32 nr_running) {
+	uint64 nr_latency = sysctl_sched_latency / sysctl_sched_min_granularity;
+	if (nr_running > nr_latency) return nr_running * sysctl_sched_min_granularity;
+	return sysctl_sched_latency;
+}
+
+/*
+ * se 在一个调度周期中按权重应得的运行时间。se 不在树中（正在运行或即将入队）。
+ */
+static uint64 sched_slice(struct cfs_rq* cfs_rq, struct sched_entity* se) {
+	uint32 nr = cfs_rq->nr_running + 1;
+	uint64 load = cfs_rq->load + se->weight;
+	uint64 slice = sched_period(nr) * se->weight / load;
+	return MAX(slice, sysctl_sched_min_granularity);
+}
+
+/*
+ * 确定新建或被唤醒任务的 vruntime
+ *
+ * 新任务排在当前所有任务之后，先欠一个时间片，避免不断 fork 抢占 CPU；
+ * 睡眠过的任务最多获得半个调度周期的补偿，让交互式任务醒来后能尽快运行，
+ * 又不会因为睡了很久而长期霸占 CPU。
+ */
+static void place_entity(struct cfs_rq* cfs_rq, struct sched_entity* se, int32 flags) {
+	uint64 vruntime = cfs_rq->min_vruntime;
+
+	if (flags & ENQUEUE_INITIAL) {
+		se->vruntime = vruntime + calc_delta_fair(sched_slice(cfs_rq, se), se);
+		return;
+	}
+	vruntime -= sysctl_sched_latency / 2;
+	se->vruntime = max_vruntime(se->vruntime, vruntime);
+}
+
+static void update_curr_fair(struct rq* rq) {
+	if (!curr_is_fair(rq)) return;
+
+	struct sched_entity* se = &rq->curr->se;
+	uint64 delta_exec = account_exec_runtime(rq->curr);
+
+	if (!delta_exec) return;
+	se->vruntime += calc_delta_fair(delta_exec, se);
+	update_min_vruntime(rq);
+}
+
+static void enqueue_task_fair(struct rq* rq, struct task_struct* p, int32 flags) {
+	struct cfs_rq* cfs_rq = &rq->cfs;
+	struct sched_entity* se = &p->se;
+
+	// 正在运行的任务被放回队列（时间片用完或主动让出），先把这段运行记账
+	if (p == rq->curr) update_curr_fair(rq);
+	// 迁移时 vruntime 以原队列的 min_vruntime 为基准保存，这里换算到本队列
+	if (flags & ENQUEUE_MIGRATED) se->vruntime += cfs_rq->min_vruntime;
+	if (flags & (ENQUEUE_WAKEUP | ENQUEUE_INITIAL)) place_entity(cfs_rq, se, flags);
+
+	__enqueue_entity(cfs_rq, se);
+	cfs_rq->nr_running++;
+	cfs_rq->load += se->weight;
+}
+
+static void dequeue_task_fair(struct rq* rq, struct task_struct* p, int32 flags) {
+	struct cfs_rq* cfs_rq = &rq->cfs;
+	struct sched_entity* se = &p->se;
+
+	__dequeue_entity(cfs_rq, se);
+	cfs_rq->nr_running--;
+	cfs_rq->load -= se->weight;
+	if (flags & DEQUEUE_MIGRATE) se->vruntime -= cfs_rq->min_vruntime;
+	update_min_vruntime(rq);
+}
+
+static struct task_struct* pick_next_task_fair(struct rq* rq) {
+	struct sched_entity* se = first_entity(&rq->cfs);
+	return se ? se_task(se) : NULL;
+}
+
+// vruntime 最大的任务在本队列上最晚才会运行，优先迁走
+static struct task_struct* pick_migrate_task_fair(struct rq* rq) {
+	for (struct rb_node* node = rb_last(&rq->cfs.tasks_timeline.rb_root); node; node = rb_prev(node)) {
+		struct task_struct* p = se_task(rb_entry(node, struct sched_entity, run_node));
+		if (!task_running(rq, p)) return p;
+	}
+	return NULL;
+}
+
+/*
+ * 时钟节拍中检查 curr 是否该让出：
+ * 本次已用完按权重分到的时间片，或者已运行超过最小粒度且领先最左任务一个时间片以上
+ */
+static void task_tick_fair(struct rq* rq, struct task_struct* curr) {
+	struct cfs_rq* cfs_rq = &rq->cfs;
+	struct sched_entity* se = &curr->se;
+
+	update_curr_fair(rq);
+	if (!cfs_rq->nr_running) return;
+
+	uint64 ideal_runtime = sched_slice(cfs_rq, se);
+	uint64 delta_exec = se->sum_exec_runtime - se->prev_sum_exec_runtime;
+	if (delta_exec > ideal_runtime) {
+		resched_curr(rq);
+		return;
+	}
+	if (delta_exec < sysctl_sched_min_granularity) return;
+
+	struct sched_entity* left = first_entity(cfs_rq);
+	if ((int64)(se->vruntime - left->vruntime) > (int64)ideal_runtime) resched_curr(rq);
+}
+
+/*
+ * 被唤醒的任务 vruntime 比 curr 小出唤醒粒度以上时抢占 curr，
+ * 粒度按唤醒者的权重换算，避免频繁切换
+ */
+static void check_preempt_curr_fair(struct rq* rq, struct task_struct* p) {
+	struct task_struct* curr = rq->curr;
+
+	update_curr_fair(rq);
+	int64 vdiff = curr->se.vruntime - p->se.vruntime;
+	if (vdiff > (int64)calc_delta_fair(sysctl_sched_wakeup_granularity, &p->se)) resched_curr(rq);
+}
+
+const struct sched_class fair_sched_class = {
+    .enqueue_task = enqueue_task_fair,
+    .dequeue_task = dequeue_task_fair,
+    .pick_next_task = pick_next_task_fair,
+    .pick_migrate_task = pick_migrate_task_fair,
+    .update_curr = update_curr_fair,
+    .task_tick = task_tick_fair,
+    .check_preempt_curr = check_preempt_curr_fair,
+};
@@ -0,0 +1,91 @@
+/*
+ * 用户态浮点现场的惰性切换，见 include/kernel/sched/fpu.h
+ */
+
+#include <kernel/sched.h>
+#include <kernel/sched/fpu.h>
+#include <kernel/riscv.h>
+#include <kernel/util.h>
+
+// 每个 hart 的浮点寄存器中最后装载的是哪个任务的现场
+static DEFINE_PER_CPU(struct task_struct*, fpu_owner);
+
+static inline void fs_set(uint64 fs) { write_csr(sstatus, (read_csr(sstatus) & ~SSTATUS_FS) | fs); }
+
+void fpu_init_hart(void) {
+	fs_set(SSTATUS_FS_OFF);
+	raw_cpu_write(fpu_owner, NULL);
+}
+
+// 新任务的浮点寄存器和 fcsr 全部为 0，第一次使用时装载
+void fpu_init_task(struct task_struct* p) {
+	memset(&p->fpstate, 0, sizeof(p->fpstate));
+	p->fpstate.fs = SSTATUS_FS_OFF;
+	p->fpstate.cpu = -1;
+}
+
+/*
+ * clone 时继承 src 的浮点现场。src 必须是当前 hart 上的 CURRENT，
+ * 先把寄存器写回再复制，dst 第一次使用浮点时从副本恢复。
+ */
+void fpu_copy_task(struct task_struct* dst, struct task_struct* src) {
+	fpu_flush(src);
+	memcpy(&dst->fpstate, &src->fpstate, sizeof(dst->fpstate));
+	dst->fpstate.fs = SSTATUS_FS_OFF;
+	dst->fpstate.cpu = -1;
+}
+
+/*
+ * 从用户态陷入时调用：记下用户态的 FS，然后在内核中关闭浮点单元，
+ * 内核代码误用浮点指令会立即触发非法指令异常。
+ */
+void fpu_enter_kernel(struct task_struct* p) {
+	p->fpstate.fs = read_csr(sstatus) & SSTATUS_FS;
+	fs_set(SSTATUS_FS_OFF);
+}
+
+/*
+ * 返回用户态时 sstatus.FS 应取的值：本 hart 的寄存器中仍是 p 的现场时沿用陷入前的状态，
+ * 否则为 Off，等第一次使用时再恢复
+ */
+uint64 fpu_return_fs(struct task_struct* p) {
+	if (raw_cpu_read(fpu_owner) != p || p->fpstate.cpu != smp_processor_id()) return SSTATUS_FS_OFF;
+	return p->fpstate.fs;
+}
+
+/*
+ * 把 p 在本 hart 上被修改过的浮点寄存器写回 fp_state。
+ * 只能对当前 hart 上的 CURRENT 调用，在切换走之前或复制现场之前使用。
+ */
+void fpu_flush(struct task_struct* p) {
+	if (p->fpstate.fs != SSTATUS_FS_DIRTY) return;
+	fs_set(SSTATUS_FS_CLEAN);
+	__fpu_save(&p->fpstate);
+	fs_set(SSTATUS_FS_OFF);
+	p->fpstate.fs = SSTATUS_FS_CLEAN;
+}
+
+/*
+ * 用户态非法指令异常：如果是因为 FS 为 Off，装载 p 的浮点现场后重新执行该指令。
+ *
+ * Returns: 1 表示已处理，0 表示是真正的非法指令
+ */
+int32 fpu_handle_first_use(struct task_struct* p) {
+	if (p->fpstate.fs != SSTATUS_FS_OFF) return 0;
+	fs_set(SSTATUS_FS_CLEAN);
+	__fpu_restore(&p->fpstate);
+	fs_set(SSTATUS_FS_OFF);
+	raw_cpu_write(fpu_owner, p);
+	p->fpstate.cpu = smp_processor_id();
+	p->fpstate.fs = SSTATUS_FS_CLEAN;
+	p->flags |= PF_USED_MATH;
+	return 1;
+}
+
+// 任务释放前调用，避免 task_struct 被复用后误认为寄存器中的现场属于新任务
+void fpu_release(struct task_struct* p) {
+	for (int32 i = 0; i < NCPU; i++) {
+		if (per_cpu(fpu_owner, i) == p) per_cpu(fpu_owner, i) = NULL;
+	}
+	p->fpstate.cpu = -1;
+}
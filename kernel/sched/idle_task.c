@@ -12,7 +12,10 @@
 #include <kernel/sched/sched.h> // task_struct 定义，TASK_RUNNING, PF_KTHREAD 等
 //#include <linux/init.h>         // __init 宏
 #include <kernel/mmu.h>
+#include <kernel/sched/kthread.h>
+#include <kernel/tick.h>
 #include <kernel/util.h>
+#include <kernel/util/klog.h>
 
 /* 外部声明 */
 extern void schedule(void);
@@ -28,12 +31,23 @@ static inline void halt_cpu(void) {
  *
  * 当系统中没有其他可运行的进程时，idle_loop 将被调度执行，
  * 它会不断调用 schedule() 尝试切换到其他任务，
- * 若无任务可运行，则调用 halt_cpu() 让 CPU 进入低功耗等待状态。
+ * 若无任务可运行，则停掉时钟节拍（NO_HZ）并调用 halt_cpu() 让 CPU 进入低功耗等待状态。
+ *
+ * 检查有没有任务和进入 wfi 之间关着中断：这期间到达的唤醒 IPI 或定时器中断
+ * 在 sie 中是使能的，即使 sstatus.SIE 关闭也会让 wfi 立即返回，不会睡过头。
  */
 void idle_loop(void) {
   while (1) {
+    klog_console_flush(); // 空闲时把日志缓冲区的积压输出到控制台
+    klog_wake_readers();
     schedule(); // 尝试切换到更高优先级任务
-    halt_cpu(); // 没有任务时进入低功耗等待（如 HLT 指令）
+    intr_off();
+    if (!need_resched() && !READ_ONCE(this_rq()->nr_running)) {
+      tick_nohz_idle_enter();
+      halt_cpu(); // 没有任务时进入低功耗等待（如 HLT 指令）
+      tick_nohz_idle_exit();
+    }
+    intr_on(); // 唤醒我们的中断在这里得到处理
   }
 }
 
@@ -43,52 +57,47 @@ void idle_loop(void) {
 //extern pgd_t swapper_pg_dir[]; // 内核页目录
 
 /*
- * 静态定义 idle_task，全局唯一的 idle 进程。
+ * 静态定义 idle 任务，每个 hart 一个，按 hartid 索引。
  * 注意：为了简单起见，只展示了关键字段的初始化，
  * 实际实现中还会有更多字段和 CPU 上下文信息。
- * 这里特指0号idle_task
  */
-struct task_struct idle_task;
+struct task_struct idle_tasks[NCPU];
 //struct proc_file_management kernel_file_management;
 /*
- * init_idle_task - 初始化并注册 idle 进程
+ * init_idle_task - 初始化并注册本 hart 的 idle 进程
  *
- * 在内核启动过程中，此函数将被调用来完成 idle 进程的 CPU 上下文初始化，
- * 并将 idle 进程注册到调度器中，使其在必要时被调度执行。
- * 每个cpu都需要自己的idle任务
- * 
+ * 每个 hart 启动时在自己上面调用一次，完成 idle 进程的 CPU 上下文初始化，
+ * 并将 idle 进程注册到本 hart 的运行队列中，使其在必要时被调度执行。
  */
 void init_idle_task(void) {
-	kprintf("Initializing idle process (PID 0)...\n");
-	idle_task.kstack = (uint64)alloc_kernel_stack();
-	idle_task.trapframe = NULL;
+	int32 cpu = smp_processor_id();
+	struct task_struct *idle = &idle_tasks[cpu];
 
-	idle_task.ktrapframe = kmalloc(sizeof(struct trapframe));
-	kprintf("idle_task.ktrapframe: %p\n",idle_task.ktrapframe);
-	memset(idle_task.ktrapframe,0,sizeof(struct trapframe));
-  idle_task.ktrapframe->epc = (uint64)idle_loop;
+	kprintf("Initializing idle process (PID 0) on hart %d...\n", cpu);
+	idle->kstack = (uint64)alloc_kernel_stack();
+	idle->trapframe = NULL;
+	// 第一次切换到 idle 时在它自己的内核栈上进入 idle_loop
+	kthread_init_context(idle, (kthread_fn_t)idle_loop, NULL);
 
 	extern struct mm_struct init_mm;
-	idle_task.mm = &init_mm;
-  //idle_task.pfiles = alloc_pfm();
-
-
-
+	idle->mm = &init_mm;
 
-	idle_task.pid = 0;
+	idle->pid = 0;
 
-	idle_task.state = TASK_RUNNING; // Idle 进程始终处于可运行状态
-	idle_task.flags = PF_KTHREAD;
-	idle_task.parent;
-	INIT_LIST_HEAD(&idle_task.children);
-	INIT_LIST_HEAD(&idle_task.sibling);
-	INIT_LIST_HEAD(&idle_task.ready_queue_node);
-  idle_task.tick_count = 0;
+	idle->state = TASK_RUNNING; // Idle 进程始终处于可运行状态
+	idle->flags = PF_KTHREAD;
+	idle->prio = idle->static_prio = MAX_PRIO - 1;
+	idle->sched_class = &idle_sched_class;
+	idle->cpu = cpu;
+	INIT_LIST_HEAD(&idle->children);
+	INIT_LIST_HEAD(&idle->sibling);
+	INIT_LIST_HEAD(&idle->ready_queue_node);
+  idle->tick_count = 0;
 
   //ps->sem_index = sem_new(0);	//这个信号量需要重写
 
-  /* 将 idle 进程注册到调度器中 */
-  insert_to_ready_queue(&idle_task);
+  /* idle 进程不进入运行队列，本 hart 的运行队列为空时才会被选中 */
+  this_rq()->idle = idle;
 
   kprintf("Idle process (PID 0) initialized and registered.\n");
 }
@@ -0,0 +1,78 @@
+#include <kernel/mm/kmalloc.h>
+#include <kernel/sched/kthread.h>
+#include <kernel/sched/pid.h>
+#include <kernel/sched/sched.h>
+#include <kernel/util.h>
+
+extern char ret_from_kernel_thread[];
+
+/**
+ * kthread_init_context - 让 p 第一次被调度时在自己的内核栈上执行 fn(arg)
+ */
+void kthread_init_context(struct task_struct* p, kthread_fn_t fn, void* arg) {
+	memset(&p->context, 0, sizeof(p->context));
+	p->context.ra = (uint64)ret_from_kernel_thread;
+	p->context.sp = p->kstack;
+	p->context.s[0] = (uint64)fn;
+	p->context.s[1] = (uint64)arg;
+}
+
+/**
+ * kthread_create - 创建一个内核线程，创建后处于睡眠状态
+ * @fn: 线程函数，返回值作为 kthread_exit 的参数
+ *
+ * Returns: 新线程，用 wake_up_new_task 让它开始运行；失败返回 NULL
+ */
+struct task_struct* kthread_create(kthread_fn_t fn, void* arg) {
+	extern struct mm_struct init_mm;
+	struct task_struct* p = alloc_empty_process();
+	if (!p) return NULL;
+
+	p->kstack = (uint64)alloc_kernel_stack();
+	p->trapframe = NULL;
+	p->mm = &init_mm;
+	p->pid = pid_alloc();
+	p->tgid = p->pid;
+	attach_pid(p);
+	p->state = TASK_INTERRUPTIBLE;
+	p->flags = PF_KTHREAD;
+	p->parent = NULL;
+	INIT_LIST_HEAD(&p->children);
+	INIT_LIST_HEAD(&p->sibling);
+	INIT_LIST_HEAD(&p->ready_queue_node);
+	kthread_init_context(p, fn, arg);
+	return p;
+}
+
+struct task_struct* kthread_run(kthread_fn_t fn, void* arg) {
+	struct task_struct* p = kthread_create(fn, arg);
+	if (p) wake_up_new_task(p);
+	return p;
+}
+
+/**
+ * kthread_exit - 结束当前内核线程
+ *
+ * 线程仍在使用自己的内核栈，资源要等切换到下一个任务之后
+ * 由 finish_task_switch 调用 kthread_free 释放。
+ */
+void kthread_exit(int32 ret) {
+	struct task_struct* cur = current_task();
+	log_debug(LOG_SUB_SCHED, "kthread %d exited with %d\n", cur->pid, ret);
+	cur->flags |= PF_EXITING;
+	// 被抢占时 TASK_DEAD 的线程会被放回运行队列，从这里到切换出去不能被抢占
+	preempt_disable();
+	cur->state = TASK_DEAD;
+	schedule();
+	panic("kthread_exit: dead task rescheduled\n");
+	while (1) {
+	}
+}
+
+void kthread_free(struct task_struct* p) {
+	pid_t pid = p->pid;
+
+	kfree((void*)ROUNDDOWN(p->kstack, PAGE_SIZE));
+	free_empty_process(p);
+	pid_free(pid);
+}
@@ -1,36 +1,54 @@
+#include <kernel/sched.h>
 #include <kernel/sched/pid.h>
 #include <kernel/util/string.h>
 #include <kernel/util/print.h>
 
 struct pid_manager manager;
 
+// pid -> task_struct，由 tasklist_lock 保护。pid 顺序分配，取低位即可均匀分布
+static struct list_head pid_hash[PIDHASH_SIZE];
+
+static inline struct list_head *pid_hashfn(pid_t pid) {
+  return &pid_hash[pid & (PIDHASH_SIZE - 1)];
+}
+
 // 初始化PID管理器
 void pid_init() {
   spinlock_init(&manager.lock);
 
   manager.next_pid = 1;
   memset(manager.pid_map, 0, sizeof(manager.pid_map));
+  // PID 0 保留给 idle，永远不分配
+  manager.pid_map[0] = 1;
+
+  for (int32 i = 0; i < PIDHASH_SIZE; i++)
+    INIT_LIST_HEAD(&pid_hash[i]);
 }
 
-// PID分配核心逻辑
+/*
+ * PID分配核心逻辑
+ *
+ * 从游标开始每次检查一个 64 位字，用 ctz 找出第一个空闲位；
+ * 第一个字中游标之前的位在最后绕回时再检查。
+ */
 pid_t pid_alloc(void) {
+  const int32 nwords = PID_MAX / 64;
 
   int64 irq_flags = spinlock_lock_irqsave(&manager.lock);
 
-  for (int32 i = 0; i < PID_MAX; i++) {
-    int32_t current_pid = (manager.next_pid + i) % PID_MAX;
-    if (current_pid == 0)
-      continue; // 跳过保留PID 0
-
-    int32 byte_idx = current_pid / 8;
-    int32 bit_idx = current_pid % 8;
-
-    if (!(manager.pid_map[byte_idx] & (1 << bit_idx))) {
-      manager.pid_map[byte_idx] |= (1 << bit_idx);
-      manager.next_pid = (current_pid + 1) % PID_MAX;
+  int32 word = manager.next_pid / 64;
+  uint64 mask = ~0UL << (manager.next_pid % 64);
+  for (int32 i = 0; i <= nwords; i++) {
+    uint64 free = ~manager.pid_map[word] & mask;
+    if (free) {
+      pid_t pid = word * 64 + __builtin_ctzl(free);
+      manager.pid_map[word] |= 1UL << (pid % 64);
+      manager.next_pid = (pid + 1) % PID_MAX;
       spinlock_unlock_irqrestore(&manager.lock, irq_flags); // 解锁
-      return current_pid;                                   // 成功
+      return pid;                                           // 成功
     }
+    word = (word + 1) % nwords;
+    mask = ~0UL;
   }
 
   spinlock_unlock_irqrestore(&manager.lock, irq_flags);
@@ -43,10 +61,47 @@ void pid_free(pid_t pid) {
     panic("pid_free: wrong pid\n");
 
   int64 irq_flags = spinlock_lock_irqsave(&manager.lock);
+  manager.pid_map[pid / 64] &= ~(1UL << (pid % 64));
+  spinlock_unlock_irqrestore(&manager.lock, irq_flags);
+}
 
-  int32 byte_idx = pid / 8;
-  int32 bit_idx = pid % 8;
-  manager.pid_map[byte_idx] &= ~(1 << bit_idx);
+void attach_pid(struct task_struct *p) {
+  spinlock_lock(&tasklist_lock);
+  list_add(&p->pid_chain, pid_hashfn(p->pid));
+  spinlock_unlock(&tasklist_lock);
+}
 
-  spinlock_unlock_irqrestore(&manager.lock, irq_flags);
-}
\ No newline at end of file
+void detach_pid(struct task_struct *p) {
+  spinlock_lock(&tasklist_lock);
+  list_del_init(&p->pid_chain);
+  spinlock_unlock(&tasklist_lock);
+}
+
+/**
+ * find_process_by_pid - Find a process by its PID
+ * @pid: Process ID to search for
+ *
+ * Looks the PID up in the hash table, O(1) regardless of how many
+ * tasks exist.
+ *
+ * Returns: Pointer to the task_struct if found with a reference held,
+ * which the caller drops with put_task_struct(); NULL if not found
+ */
+struct task_struct *find_process_by_pid(pid_t pid) {
+  struct task_struct *p, *found = NULL;
+
+  if (pid <= 0)
+    return NULL;
+
+  spinlock_lock(&tasklist_lock);
+  list_for_each_entry(p, pid_hashfn(pid), pid_chain) {
+    if (p->pid == pid) {
+      // 持 tasklist_lock 取得引用，回收者随后摘下它也不会释放
+      get_task_struct(p);
+      found = p;
+      break;
+    }
+  }
+  spinlock_unlock(&tasklist_lock);
+  return found;  // NULL if not found
+}
@@ -0,0 +1,56 @@
+/*
+ * 抢占计数与内核态的抢占点，见 include/kernel/sched/preempt.h
+ *
+ * 时钟节拍或唤醒只设置 rq->need_resched，真正的切换发生在：
+ * - 返回用户态前（rrsched）；
+ * - preempt_enable() 把计数减到 0 且中断打开时；
+ * - 内核态被中断、中断返回时被打断的代码处于可抢占状态；
+ * - 长循环中主动调用 cond_resched()。
+ */
+
+#include <kernel/config.h>
+#include <kernel/riscv.h>
+#include <kernel/sched/preempt.h>
+#include <kernel/sched/sched.h>
+
+// 启动早期 CURRENT 还没有设置，计数无处可记，此时也不会发生调度
+int32 preempt_count(void) {
+	struct task_struct* p = CURRENT;
+	return p ? p->preempt_count : 0;
+}
+
+void preempt_count_add(int32 val) {
+	struct task_struct* p = CURRENT;
+	if (p) p->preempt_count += val;
+}
+
+void preempt_count_sub(int32 val) {
+	struct task_struct* p = CURRENT;
+	if (p) p->preempt_count -= val;
+}
+
+int32 need_resched(void) { return READ_ONCE(this_rq()->need_resched); }
+
+void preempt_disable(void) { preempt_count_add(PREEMPT_OFFSET); }
+
+void preempt_enable_no_resched(void) { preempt_count_sub(PREEMPT_OFFSET); }
+
+/*
+ * 关中断的区域（例如 schedule() 内部和中断处理）里计数回到 0 也不切换，
+ * 由外层的 enable_irqrestore 之后的 preempt_enable 或中断返回路径负责
+ */
+void preempt_enable(void) {
+	preempt_count_sub(PREEMPT_OFFSET);
+#if CONFIG_PREEMPT
+	if (!preempt_count() && is_intr_enable() && need_resched()) preempt_schedule();
+#endif
+}
+
+/**
+ * cond_resched - 长时间运行的内核循环中的主动让出点
+ *
+ * 不依赖 CONFIG_PREEMPT，调用者不能持有自旋锁。
+ */
+void cond_resched(void) {
+	if (!preempt_count() && need_resched()) preempt_schedule();
+}
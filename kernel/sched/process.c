@@ -21,11 +21,15 @@
 
 static void free_kernel_stack(void* kstack);
 
+spinlock_t tasklist_lock = SPINLOCK_INIT;
+struct task_struct* child_reaper;
+
 //
 // switch to a user-mode process
 //
 
 extern void return_to_user(struct trapframe*, uint64 satp);
+extern char ret_from_fork[];
 
 //
 // allocate an empty process, init its vm space. returns the pointer to
@@ -34,15 +38,20 @@ extern void return_to_user(struct trapframe*, uint64 satp);
 struct task_struct* alloc_process() {
 	// locate the first usable process structure
 	struct task_struct* ps = alloc_empty_process();
+	if (!ps) return NULL;
 	ps->kstack = (uint64)alloc_kernel_stack();
 	ps->trapframe = (struct trapframe*)kmalloc(sizeof(struct trapframe));
-	ps->ktrapframe = NULL;
+	// 第一次被调度时从 ret_from_fork 经 trapframe 进入用户态
+	ps->context.ra = (uint64)ret_from_fork;
+	ps->context.sp = ps->kstack;
 	ps->mm = user_alloc_mm();
 	ps->fs = fs_struct_create();
 	ps->fdtable = fdtable_acquire(NULL);
 	// ps->active_mm =ps->mm;
 	// 分配内核栈
 	ps->pid = pid_alloc();
+	ps->tgid = ps->pid;
+	attach_pid(ps);
 	ps->state;
 	ps->flags;
 	ps->parent;
@@ -58,63 +67,40 @@ struct task_struct* alloc_process() {
 	// Initialize signal handling
 	memset(&ps->pending, 0, sizeof(ps->pending));
 	memset(&ps->blocked, 0, sizeof(ps->blocked));
-	memset(&ps->sighand, 0, sizeof(ps->sighand));
-
 	// Default signal actions
-	for (int32 i = 0; i < _NSIG; i++) { ps->sighand[i].sa_handler = SIG_DFL; }
+	ps->sighand = sighand_alloc();
 
-	kprintf("alloc_process: end.\n");
+	log_debug(LOG_SUB_SCHED, "alloc_process: pid %d allocated.\n", ps->pid);
 	return ps;
 }
 
+/**
+ * free_process - 释放 alloc_process 分配、还没有运行过的进程
+ *
+ * 运行过的进程由 do_exit 放弃各项资源，再由 wait 或 finish_task_switch 调用 release_task。
+ */
 int32 free_process(struct task_struct* proc) {
-	// 在exit中把进程的状态设成ZOMBIE，然后在父进程wait中调用这个函数，用于释放子进程的资源（待实现）
-	// 由于代理内核的特殊机制，不做也不会造成内存泄漏（代填）
-
+	sighand_put(proc->sighand);
+	if (proc->fdtable) fdtable_unref(proc->fdtable);
+	if (proc->fs) fs_struct_unref(proc->fs);
+	if (proc->mm) mmput(proc->mm);
+	release_task(proc);
 	return 0;
 }
 
-ssize_t do_wait(int32 pid) {
-	// kprintf("DEBUG LINE, pid = %d\n",pid);
-	extern struct task_struct* procs[NPROC];
-	int32 hartid = read_tp();
-	// int32 child_found_flag = 0;
-	if (pid == -1) {
-		while (1) {
-			for (int32 i = 0; i < NPROC; i++) {
-				// kprintf("DEBUG LINE\n");
-
-				struct task_struct* p = procs[i];
-				// kprintf("p = 0x%lx,\n",p);
-				if (p->parent != NULL && p->parent->pid == CURRENT->pid && p->state & TASK_DEAD) {
-					// kprintf("DEBUG LINE\n");
-
-					free_process(p);
-					return i;
-				}
-			}
-			// kprintf("current->sem_index = %d\n",current->sem_index);
-			//sem_P(CURRENT->sem_index);
-			// kprintf("wait:return from blocking!\n");
-		}
-	}
-	if (0 < pid && pid < NPROC) {
-		// kprintf("DEBUG LINE\n");
-
-		struct task_struct* p = procs[pid];
-		if (p->parent != CURRENT) {
-			return -1;
-		} else if (p->state & TASK_DEAD) {
-			free_process(p);
-			return pid;
-		} else {
-			//sem_P(p->sem_index);
-			// kprintf("return from blocking!\n");
-
-			return pid;
-		}
-	}
-	return -1;
+/**
+ * release_task - 释放已经退出的任务最后的资源：pid、内核栈、trapframe，并放弃 task_struct 的引用
+ *
+ * 任务已经切换出去之后才能调用，mm、文件等共享资源由退出路径先行释放。
+ */
+void release_task(struct task_struct* p) {
+	pid_t pid = p->pid;
+
+	free_kernel_stack((void*)p->kstack);
+	kfree(p->trapframe);
+	// 先从散列表摘下再归还 pid，否则新任务拿到这个 pid 后可能查到旧任务
+	free_empty_process(p);
+	pid_free(pid);
 }
 
 static void free_kernel_stack(void* kstack) { kfree((void*)(ROUNDDOWN((uint64)kstack, PAGE_SIZE))); }
@@ -0,0 +1,111 @@
+/*
+ * 实时调度类：每个优先级一个 FIFO 链表，位图记录非空的优先级，
+ * 选择下一个任务只需找位图中的第一个置位，与任务数无关。
+ *
+ * prio = MAX_RT_PRIO - 1 - rt_priority，用户优先级 99 对应 prio 0。
+ */
+
+#include <kernel/sched/sched.h>
+#include <kernel/util.h>
+
+uint64 sysctl_sched_rr_timeslice = CONFIG_SCHED_RR_TIMESLICE_NS;
+
+void init_rt_rq(struct rt_rq* rt_rq) {
+	rt_rq->nr_running = 0;
+	memset(rt_rq->bitmap, 0, sizeof(rt_rq->bitmap));
+	for (int32 i = 0; i < MAX_RT_PRIO; i++) INIT_LIST_HEAD(&rt_rq->queue[i]);
+}
+
+// 最高优先级（数值最小）的非空队列，没有时返回 -1
+static int32 rt_first_prio(struct rt_rq* rt_rq) {
+	for (int32 w = 0; w < RT_BITMAP_WORDS; w++) {
+		if (rt_rq->bitmap[w]) return w * 64 + __builtin_ctzl(rt_rq->bitmap[w]);
+	}
+	return -1;
+}
+
+// 最低优先级（数值最大）的非空队列，迁移时优先搬走它们
+static int32 rt_last_prio(struct rt_rq* rt_rq) {
+	for (int32 w = RT_BITMAP_WORDS - 1; w >= 0; w--) {
+		if (rt_rq->bitmap[w]) return w * 64 + 63 - __builtin_clzl(rt_rq->bitmap[w]);
+	}
+	return -1;
+}
+
+static void update_curr_rt(struct rq* rq) { account_exec_runtime(rq->curr); }
+
+// SCHED_RR 任务本次运行是否已用完时间片
+static inline int32 rr_slice_expired(struct task_struct* p) {
+	return p->policy == SCHED_RR && p->se.sum_exec_runtime - p->se.prev_sum_exec_runtime >= sysctl_sched_rr_timeslice;
+}
+
+static void enqueue_task_rt(struct rq* rq, struct task_struct* p, int32 flags) {
+	struct rt_rq* rt_rq = &rq->rt;
+	int32 prio = p->prio;
+
+	if (p == rq->curr) update_curr_rt(rq);
+	// 被更高优先级抢占的任务回到队首，下次仍然先于同优先级的其他任务运行；
+	// 其余情况（唤醒、让出、时间片用完）插到队尾
+	if ((flags & ENQUEUE_PREEMPTED) && !rr_slice_expired(p))
+		list_add(&p->ready_queue_node, &rt_rq->queue[prio]);
+	else
+		list_add_tail(&p->ready_queue_node, &rt_rq->queue[prio]);
+	rt_rq->bitmap[prio / 64] |= 1UL << (prio % 64);
+	rt_rq->nr_running++;
+}
+
+static void dequeue_task_rt(struct rq* rq, struct task_struct* p, int32 flags) {
+	struct rt_rq* rt_rq = &rq->rt;
+	int32 prio = p->prio;
+	list_del_init(&p->ready_queue_node);
+	if (list_empty(&rt_rq->queue[prio])) rt_rq->bitmap[prio / 64] &= ~(1UL << (prio % 64));
+	rt_rq->nr_running--;
+}
+
+static struct task_struct* pick_next_task_rt(struct rq* rq) {
+	int32 prio = rt_first_prio(&rq->rt);
+	if (prio < 0) return NULL;
+	return list_first_entry(&rq->rt.queue[prio], struct task_struct, ready_queue_node);
+}
+
+// 低优先级、且在队列中等得最久的任务先被搬走：它们在原 hart 上最晚才能运行
+static struct task_struct* pick_migrate_task_rt(struct rq* rq) {
+	struct rt_rq* rt_rq = &rq->rt;
+	struct task_struct* p;
+
+	for (int32 prio = rt_last_prio(rt_rq); prio >= 0; prio--) {
+		if (!(rt_rq->bitmap[prio / 64] & (1UL << (prio % 64)))) continue;
+		list_for_each_entry(p, &rt_rq->queue[prio], ready_queue_node) {
+			if (!task_running(rq, p)) return p;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * SCHED_FIFO 任务一直运行到阻塞、让出或被更高优先级抢占；
+ * SCHED_RR 任务时间片用完后，如果同优先级还有任务就轮转到队尾，否则开始新的时间片
+ */
+static void task_tick_rt(struct rq* rq, struct task_struct* curr) {
+	update_curr_rt(rq);
+	if (!rr_slice_expired(curr)) return;
+	if (!list_empty(&rq->rt.queue[curr->prio]))
+		resched_curr(rq);
+	else
+		curr->se.prev_sum_exec_runtime = curr->se.sum_exec_runtime;
+}
+
+// 更高优先级的实时任务入队时立即抢占
+static void check_preempt_curr_rt(struct rq* rq, struct task_struct* p) {
+	if (p->prio < rq->curr->prio) resched_curr(rq);
+}
+
+const struct sched_class rt_sched_class = {
+    .enqueue_task = enqueue_task_rt,
+    .dequeue_task = dequeue_task_rt,
+    .pick_next_task = pick_next_task_rt,
+    .pick_migrate_task = pick_migrate_task_rt,
+    .update_curr = update_curr_rt,
+    .task_tick = task_tick_rt,
+    .check_preempt_curr = check_preempt_curr_rt,
+};
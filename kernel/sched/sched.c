@@ -4,6 +4,7 @@
 
 #include <kernel/mm/kmalloc.h>
 #include <kernel/mm/mm_struct.h>
+#include <kernel/sched/kthread.h>
 #include <kernel/sched/pid.h>
 #include <kernel/sched/sched.h>
 #include <kernel/sched/process.h>
@@ -12,117 +13,601 @@
 #include <kernel/util/list.h>
 #include <kernel/util/string.h>
 
-struct list_head ready_queue;
-struct task_struct *procs[NPROC];
-struct task_struct *current_percpu[NCPU];
+// 所有 task_struct，由 tasklist_lock 保护，见 for_each_process
+struct list_head task_list = {&task_list, &task_list};
+DEFINE_PER_CPU(struct task_struct *, current_percpu);
+DEFINE_PER_CPU(struct rq, runqueues);
+
+static void init_rq(struct rq *rq, int32 cpu) {
+  spinlock_init(&rq->lock);
+  rq->cpu = cpu;
+  rq->nr_running = 0;
+  init_rt_rq(&rq->rt);
+  init_cfs_rq(&rq->cfs);
+  rq->curr = NULL;
+  rq->idle = NULL;
+  rq->need_resched = 0;
+  rq->tick = 0;
+  rq->next_balance = SCHED_LB_INTERVAL;
+}
 
 //
-// initialize process pool (the procs[] array). added @lab3_1
+// initialize the run queues and the pid allocator. added @lab3_1
 //
 void init_scheduler() {
   // kprintf("init_scheduler: start\n");
-  INIT_LIST_HEAD(&ready_queue);
+  for (int32 cpu = 0; cpu < NCPU; cpu++) init_rq(cpu_rq(cpu), cpu);
   pid_init();
-  memset(procs, 0, sizeof(struct task_struct *) * NPROC);
-
-  for (int32 i = 0; i < NPROC; ++i) {
-    procs[i] = NULL;
-  }
   kprintf("Scheduler initiated\n");
 }
 
+//
+// allocate a zeroed task_struct and link it into task_list. the caller
+// assigns the pid and calls attach_pid() to make it visible to lookups.
+//
 struct task_struct *alloc_empty_process() {
-  for (int32 i = 0; i < NPROC; i++) {
-    if (procs[i] == NULL) {
-      procs[i] = (struct task_struct *)kmalloc(sizeof(struct task_struct));
-      memset(procs[i], 0, sizeof(struct task_struct));
-      return procs[i];
+  struct task_struct *p = (struct task_struct *)kmalloc(sizeof(struct task_struct));
+  if (unlikely(p == NULL)) return NULL;
+
+  memset(p, 0, sizeof(struct task_struct));
+  atomic_set(&p->usage, 1);
+  p->prio = p->static_prio = DEFAULT_PRIO;
+  p->cpu = smp_processor_id();
+  p->sched_class = &fair_sched_class;
+  p->se.weight = NICE_0_LOAD;
+  RB_CLEAR_NODE(&p->se.run_node);
+  init_waitqueue_head(&p->wait_chldexit);
+  p->group_leader = p;
+  INIT_LIST_HEAD(&p->thread_group);
+  INIT_LIST_HEAD(&p->pid_chain);
+  fpu_init_task(p);
+
+  spinlock_lock(&tasklist_lock);
+  list_add_tail(&p->tasks, &task_list);
+  spinlock_unlock(&tasklist_lock);
+  return p;
+}
+
+// 从 task_list 和 pid 散列表中摘下并放弃创建时的引用，之后 find_process_by_pid 找不到它
+void free_empty_process(struct task_struct *p) {
+  fpu_release(p);
+  spinlock_lock(&tasklist_lock);
+  list_del(&p->tasks);
+  list_del_init(&p->pid_chain);
+  spinlock_unlock(&tasklist_lock);
+  put_task_struct(p);
+}
+
+void put_task_struct(struct task_struct *p) {
+  if (!atomic_dec_and_test(&p->usage)) return;
+  // 此时已经不在 task_list 上，/dev/syscall_stat 的读者看不到它
+  kfree(p->syscall_counts);
+  kfree(p);
+}
+
+/*
+ * 把 curr 自上次记账以来的运行时间计入 sum_exec_runtime，返回这段时间（纳秒）
+ */
+uint64 account_exec_runtime(struct task_struct *curr) {
+  uint64 now = sched_clock();
+  int64 delta = now - curr->se.exec_start;
+  if (delta <= 0) return 0;
+  curr->se.exec_start = now;
+  curr->se.sum_exec_runtime += delta;
+  return delta;
+}
+
+/*
+ * idle 任务不进入运行队列，只在本 hart 无事可做时由 schedule() 直接选中
+ */
+static void update_curr_idle(struct rq *rq) { account_exec_runtime(rq->curr); }
+
+static void task_tick_idle(struct rq *rq, struct task_struct *curr) {
+  update_curr_idle(rq);
+  if (rq->nr_running) resched_curr(rq);
+}
+
+const struct sched_class idle_sched_class = {
+    .update_curr = update_curr_idle,
+    .task_tick = task_tick_idle,
+};
+
+// 调度类按 实时 > 公平 > idle 的顺序选择任务
+static const struct sched_class *const sched_classes[] = {&rt_sched_class, &fair_sched_class};
+#define NR_SCHED_CLASSES (sizeof(sched_classes) / sizeof(sched_classes[0]))
+
+static int32 sched_class_above(const struct sched_class *a, const struct sched_class *b) {
+  if (a == b) return 0;
+  if (a == &rt_sched_class) return 1;
+  return a == &fair_sched_class && b == &idle_sched_class;
+}
+
+/*
+ * 运行队列基本操作，调用者持有 rq->lock
+ */
+static void enqueue_task(struct rq *rq, struct task_struct *p, int32 flags) {
+  p->sched_class->enqueue_task(rq, p, flags);
+  rq->nr_running++;
+  p->cpu = rq->cpu;
+  p->on_rq = 1;
+}
+
+static void dequeue_task(struct rq *rq, struct task_struct *p, int32 flags) {
+  p->sched_class->dequeue_task(rq, p, flags);
+  rq->nr_running--;
+  p->on_rq = 0;
+}
+
+/*
+ * 选中 next 后立即在同一个临界区内更新 curr，调用者持有 rq->lock。
+ * 之后唤醒 prev 的 hart 看到它已经不是 curr，会把它放回队列，不会丢失唤醒
+ */
+static void set_next_task(struct rq *rq, struct task_struct *next) {
+  rq->curr = next;
+  next->se.exec_start = sched_clock();
+  next->se.prev_sum_exec_runtime = next->se.sum_exec_runtime;
+}
+
+static struct task_struct *pick_next_task(struct rq *rq) {
+  for (int32 i = 0; i < NR_SCHED_CLASSES; i++) {
+    struct task_struct *p = sched_classes[i]->pick_next_task(rq);
+    if (p) {
+      dequeue_task(rq, p, 0);
+      return p;
     }
   }
-  
-  panic("cannot find any free process structure.\n");
   return NULL;
 }
+
+/*
+ * 新入队的 p 是否应抢占本队列正在运行的任务。
+ * 目前只设置 rq->need_resched，由 curr 所在 hart 在下一个调度点处理。
+ */
+static void check_preempt_curr(struct rq *rq, struct task_struct *p) {
+  struct task_struct *curr = rq->curr;
+  if (!curr || curr == p) return;
+  if (p->sched_class == curr->sched_class)
+    p->sched_class->check_preempt_curr(rq, p);
+  else if (sched_class_above(p->sched_class, curr->sched_class))
+    resched_curr(rq);
+}
+
+// 锁住 p 所在的运行队列，加锁期间 p 可能被迁走，需要重新检查
+static struct rq *task_rq_lock(struct task_struct *p, int64 *flags) {
+  for (;;) {
+    struct rq *rq = cpu_rq(READ_ONCE(p->cpu));
+    *flags = spinlock_lock_irqsave(&rq->lock);
+    if (rq->cpu == READ_ONCE(p->cpu)) return rq;
+    spinlock_unlock_irqrestore(&rq->lock, *flags);
+  }
+}
+
+/*
+ * 同时锁住两个运行队列，按 hart 编号顺序加锁避免死锁
+ */
+static int64 double_rq_lock(struct rq *a, struct rq *b) {
+  int64 flags = disable_irqsave();
+  if (a->cpu < b->cpu) {
+    spinlock_lock(&a->lock);
+    spinlock_lock(&b->lock);
+  } else {
+    spinlock_lock(&b->lock);
+    spinlock_lock(&a->lock);
+  }
+  return flags;
+}
+
+static void double_rq_unlock(struct rq *a, struct rq *b, int64 flags) {
+  spinlock_unlock(&a->lock);
+  spinlock_unlock(&b->lock);
+  enable_irqrestore(flags);
+}
+
+/*
+ * 从 src 迁移最多 nr 个任务到 dst，两个队列的锁都已持有。
+ * 先迁公平调度类的任务，由各调度类挑出在原 hart 上最晚才能运行的任务。
+ */
+static int32 move_tasks(struct rq *dst, struct rq *src, int32 nr) {
+  int32 moved = 0;
+  for (int32 i = NR_SCHED_CLASSES - 1; i >= 0 && moved < nr; i--) {
+    struct task_struct *p;
+    while (moved < nr && (p = sched_classes[i]->pick_migrate_task(src))) {
+      dequeue_task(src, p, DEQUEUE_MIGRATE);
+      enqueue_task(dst, p, ENQUEUE_MIGRATED);
+      dst->nr_migrations++;
+      moved++;
+    }
+  }
+  return moved;
+}
+
+static struct rq *find_busiest_rq(struct rq *this) {
+  struct rq *busiest = NULL;
+  uint32 max = 0;
+  for (int32 cpu = 0; cpu < NCPU; cpu++) {
+    struct rq *rq = cpu_rq(cpu);
+    uint32 nr = READ_ONCE(rq->nr_running);
+    if (rq != this && nr > max) {
+      max = nr;
+      busiest = rq;
+    }
+  }
+  return busiest;
+}
+
+/*
+ * 周期性负载均衡：把最忙队列超出本队列的部分搬一半过来
+ */
+static void load_balance(struct rq *this) {
+  struct rq *busiest = find_busiest_rq(this);
+  if (!busiest) return;
+
+  int64 flags = double_rq_lock(this, busiest);
+  if (busiest->nr_running > this->nr_running + 1) move_tasks(this, busiest, (busiest->nr_running - this->nr_running) / 2);
+  double_rq_unlock(this, busiest, flags);
+}
+
+/*
+ * 空闲时窃取：本队列为空时从最忙的队列拿一个任务直接运行
+ */
+static struct task_struct *steal_task(struct rq *this) {
+  struct task_struct *p = NULL;
+  struct rq *busiest = find_busiest_rq(this);
+  if (!busiest) return NULL;
+
+  int64 flags = double_rq_lock(this, busiest);
+  if (busiest->nr_running > 0 && move_tasks(this, busiest, 1)) p = pick_next_task(this);
+  if (p) set_next_task(this, p);
+  double_rq_unlock(this, busiest, flags);
+  return p;
+}
+
+// 运行中的任务也算一份负载，空闲 hart 的负载为 0
+static uint32 rq_load(struct rq *rq) {
+  struct task_struct *curr = READ_ONCE(rq->curr);
+  return READ_ONCE(rq->nr_running) + (curr && curr != rq->idle);
+}
+
+/*
+ * 新任务放到负载最轻的在线 hart 上，负载相同时优先本 hart
+ */
+static int32 select_task_rq(struct task_struct *p) {
+  int32 best = smp_processor_id();
+  uint32 min = rq_load(cpu_rq(best));
+  int32 cpu;
+  for_each_online_cpu(cpu) {
+    uint32 load = rq_load(cpu_rq(cpu));
+    if (load < min) {
+      min = load;
+      best = cpu;
+    }
+  }
+  return best;
+}
+
+/*
+ * rq 上刚有任务入队却不会马上运行时，叫醒一个空闲的 hart，让它在 schedule() 中窃取
+ */
+static void kick_idle_cpu(struct rq *rq) {
+  int32 cpu;
+  if (!rq->nr_running || rq->need_resched) return;
+  for_each_online_cpu(cpu) {
+    struct rq *idle = cpu_rq(cpu);
+    if (idle != rq && READ_ONCE(idle->curr) == idle->idle && !READ_ONCE(idle->nr_running)) {
+      smp_send_reschedule(cpu);
+      return;
+    }
+  }
+}
+
 //
-// insert a process, proc, into the END of ready queue.
+// put a runnable process, proc, back into its ready queue. the position is
+// decided by its scheduling class (priority FIFO tail, or by vruntime).
 //
 void insert_to_ready_queue(struct task_struct *proc) {
-  kprintf("going to insert process %d to ready queue.\n", proc->pid);
-  list_add(&proc->ready_queue_node, &ready_queue);
+  log_debug(LOG_SUB_SCHED, "going to insert process %d to ready queue.\n", proc->pid);
+  int64 flags;
+  struct rq *rq = task_rq_lock(proc, &flags);
+  if (!proc->on_rq) enqueue_task(rq, proc, 0);
+  spinlock_unlock_irqrestore(&rq->lock, flags);
 }
 
-//
-// choose a proc from the ready queue, and put it to run.
-// note: schedule() does not take care of previous current process. If the
-// current process is still runnable, you should place it into the ready queue
-// (by calling ready_queue_insert), and then call schedule().
-//
-void schedule() {
-  kprintf("schedule: start\n");
-  extern struct task_struct *procs[NPROC];
-  int32 hartid = read_tp();
-  struct task_struct *cur = CURRENT;
-  // kprintf("debug\n");
-  if (cur &&
-      ((cur->state == TASK_INTERRUPTIBLE) |
-       (cur->state == TASK_UNINTERRUPTIBLE)) &&
-      cur->ktrapframe == NULL) {
-    cur->ktrapframe = (struct trapframe *)kmalloc(sizeof(struct trapframe));
-    store_all_registers(cur->ktrapframe);
-    // kprintf("cur->ktrapframe->regs.ra=0x%x\n",cur->ktrapframe->regs.ra);
+/**
+ * sched_fork - clone 出的任务继承父任务的调度策略和优先级
+ *
+ * 新任务还不在任何运行队列上，不需要加锁；vruntime 由 wake_up_new_task 入队时设定。
+ */
+void sched_fork(struct task_struct *p, struct task_struct *parent) {
+  p->policy = parent->policy;
+  p->rt_priority = parent->rt_priority;
+  p->static_prio = parent->static_prio;
+  p->prio = parent->prio;
+  p->sched_class = parent->sched_class;
+  p->se.weight = parent->se.weight;
+}
+
+/**
+ * wake_up_new_task - 新创建的任务第一次进入运行队列
+ */
+void wake_up_new_task(struct task_struct *p) {
+  // 还没有入队，可以直接改 cpu
+  p->cpu = select_task_rq(p);
+  p->state = TASK_RUNNING;
+
+  int64 flags;
+  struct rq *rq = task_rq_lock(p, &flags);
+  enqueue_task(rq, p, ENQUEUE_INITIAL);
+  check_preempt_curr(rq, p);
+  kick_idle_cpu(rq);
+  spinlock_unlock_irqrestore(&rq->lock, flags);
+}
+
+/**
+ * wake_up_state - 唤醒状态属于 state 的任务
+ *
+ * Returns: 1 表示任务从睡眠转为可运行，0 表示它的状态不在 state 中（包括本来就是可运行的）
+ */
+int32 wake_up_state(struct task_struct *p, uint32 state) {
+  int64 flags;
+  struct rq *rq = task_rq_lock(p, &flags);
+  int32 woken = 0;
+
+  if (p->state & state) {
+    p->state = TASK_RUNNING;
+    woken = 1;
+    // 还没来得及调用 schedule() 的任务仍是 curr，改回 TASK_RUNNING 即可
+    if (!p->on_rq && p != rq->curr) {
+      enqueue_task(rq, p, ENQUEUE_WAKEUP);
+      check_preempt_curr(rq, p);
+      kick_idle_cpu(rq);
+    }
   }
-  if (list_empty(&ready_queue)) {
-    // by default, if there are no ready process, and all processes are in the
-    // state of FREE and ZOMBIE, we should shutdown the emulated RISC-V
-    // machine.
-    int32 should_shutdown = 1;
-
-    // for (int32 i = 0; i < NPROC; i++)
-    //   if ((procs[i]) && (procs[i]->exit_state != EXIT_TRACE)) {
-    //     should_shutdown = 0;
-    //     kprintf("ready queue empty, but process %d is not in free/zombie "
-    //            "state:%d\n",
-    //            i, procs[i]->exit_state);
-    //   }
-
-    // // 如果所有进程都在 FREE 或 ZOMBIE 状态，允许关机
-    // if (should_shutdown) {
-    //   // 确保只有 hartid == 0 的核心执行 shutdown
-    //   if (hartid == 0) {
-    //     kprintf("no more ready processes, system shutdown now.\n");
-    //     shutdown(0); // 只有核心 0 执行关机
-    //   }
-    //   // 否则，其他核心等待关机标志
-    //   else {
-    //     while (1) {
-    //       // 自旋等待，直到 hartid == 0 核心完成 shutdown
-    //     }
-    //   }
-    // } else {
-    //   panic(
-    //       "Not handled: we should let system wait for unfinished processes.\n");
-    // }
+  spinlock_unlock_irqrestore(&rq->lock, flags);
+  return woken;
+}
+
+/**
+ * wake_up_process - 唤醒睡眠中的任务
+ *
+ * Returns: 1 表示任务从睡眠转为可运行，0 表示它本来就是可运行的
+ */
+int32 wake_up_process(struct task_struct *p) { return wake_up_state(p, TASK_NORMAL); }
+
+static void set_load_weight(struct task_struct *p) {
+  if (p->policy == SCHED_IDLE)
+    p->se.weight = WEIGHT_IDLEPRIO;
+  else
+    p->se.weight = sched_prio_to_weight(p->static_prio);
+}
+
+/**
+ * set_user_nice - 修改任务的 nice 值
+ * @nice: 超出 [MIN_NICE, MAX_NICE] 的部分被截断
+ *
+ * 实时任务只记录 nice 值，回到公平调度类后才生效
+ */
+int32 set_user_nice(struct task_struct *p, int32 nice) {
+  nice = MAX(MIN_NICE, MIN(nice, MAX_NICE));
+
+  int64 flags;
+  struct rq *rq = task_rq_lock(p, &flags);
+  int32 old_prio = p->static_prio;
+  p->static_prio = NICE_TO_PRIO(nice);
+  if (!rt_policy(p->policy)) {
+    int32 queued = p->on_rq;
+    // 先按旧权重给队列中或正在运行的任务记账
+    if (queued)
+      dequeue_task(rq, p, 0);
+    else if (p == rq->curr)
+      p->sched_class->update_curr(rq);
+    p->prio = p->static_prio;
+    set_load_weight(p);
+    if (queued) enqueue_task(rq, p, 0);
+    // 正在运行的任务降低了优先级，让出 CPU 以便重新比较
+    if (p == rq->curr && p->static_prio > old_prio) resched_curr(rq);
   }
+  spinlock_unlock_irqrestore(&rq->lock, flags);
+  return 0;
+}
+
+static int32 valid_policy(int32 policy) {
+  return policy == SCHED_NORMAL || policy == SCHED_BATCH || policy == SCHED_IDLE || rt_policy(policy);
+}
+
+/**
+ * sched_setscheduler - 修改任务的调度策略和实时优先级
+ * @policy: SCHED_NORMAL/SCHED_BATCH/SCHED_IDLE 要求 sched_priority 为 0，
+ *          SCHED_FIFO/SCHED_RR 要求 1..99
+ *
+ * 调用者负责权限检查。Returns: 0 或 -EINVAL
+ */
+int32 sched_setscheduler(struct task_struct *p, int32 policy, const struct sched_param *param) {
+  if (!valid_policy(policy)) return -EINVAL;
+  if (param->sched_priority < 0 || param->sched_priority > MAX_USER_RT_PRIO - 1) return -EINVAL;
+  if (rt_policy(policy) != (param->sched_priority != 0)) return -EINVAL;
 
-  CURRENT = container_of(ready_queue.next, struct task_struct, ready_queue_node);
-  list_del_init(ready_queue.next);
-  if (cur->ktrapframe != NULL) {
-    kprintf("going to schedule process %d to run in s-mode.\n", CURRENT->pid);
+  int64 flags;
+  struct rq *rq = task_rq_lock(p, &flags);
+  const struct sched_class *prev_class = p->sched_class;
+  int32 old_prio = p->prio;
+  int32 queued = p->on_rq;
+  int32 running = p == rq->curr;
 
-    restore_all_registers(cur->ktrapframe);
-    kfree(cur->ktrapframe);
-    cur->ktrapframe = NULL;
-    return;
+  if (queued)
+    dequeue_task(rq, p, 0);
+  else if (running)
+    prev_class->update_curr(rq);
+
+  p->policy = policy;
+  p->rt_priority = param->sched_priority;
+  if (rt_policy(policy)) {
+    p->prio = MAX_RT_PRIO - 1 - p->rt_priority;
+    p->sched_class = &rt_sched_class;
   } else {
-    kprintf("going to schedule process %d to run in u-mode.\n", CURRENT->pid);
-    switch_to(cur);
+    p->prio = p->static_prio;
+    p->sched_class = &fair_sched_class;
+  }
+  set_load_weight(p);
+  // 从实时调度类回来的任务以当前 min_vruntime 为起点，既不补偿也不惩罚
+  if (prev_class != &fair_sched_class && p->sched_class == &fair_sched_class) p->se.vruntime = rq->cfs.min_vruntime;
+
+  if (queued) {
+    enqueue_task(rq, p, 0);
+    check_preempt_curr(rq, p);
+  } else if (running && (sched_class_above(prev_class, p->sched_class) || p->prio > old_prio)) {
+    // 正在运行的任务降低了优先级，让出 CPU 以便重新比较
+    resched_curr(rq);
   }
+  spinlock_unlock_irqrestore(&rq->lock, flags);
+  return 0;
 }
 
-void switch_to(struct task_struct *proc) {
+static void __schedule(int32 preempt);
+
+/**
+ * preempt_schedule - curr 被抢占：留在运行队列中重新调度
+ *
+ * rq->need_resched 被置位后，在返回用户态前或内核中的抢占点（见 preempt.c）调用。
+ * 被抢占的任务不论 state 是什么都放回队列：它可能刚在 prepare_to_wait 中设置了睡眠状态，
+ * 还没有检查等待条件或启动超时定时器，只有它自己再次运行后调用 schedule() 才能真正睡眠。
+ */
+void preempt_schedule(void) {
+  // 切换完成之前不能再次被抢占，解锁时的 preempt_enable 也不会递归进来
+  preempt_disable();
+  __schedule(1);
+  preempt_enable_no_resched();
+}
+
+/**
+ * sched_yield - 主动让出 CPU，排到同优先级的最后
+ */
+void sched_yield(void) {
+  preempt_disable();
+  __schedule(0);
+  preempt_enable_no_resched();
+}
+
+/**
+ * scheduler_tick - 时钟节拍中的调度器记账，每个 hart 各自调用
+ *
+ * 除了 curr 所在调度类自己的时间片检查外，只要队列中有更高调度类的任务
+ * （例如其他 hart 唤醒到这里的实时任务）就抢占 curr。
+ */
+void scheduler_tick(void) {
+  struct rq *rq = this_rq();
+  int64 flags = spinlock_lock_irqsave(&rq->lock);
+  struct task_struct *curr = rq->curr;
+  rq->tick++;
+  if (curr) {
+    curr->sched_class->task_tick(rq, curr);
+    if (rq->rt.nr_running && sched_class_above(&rt_sched_class, curr->sched_class)) resched_curr(rq);
+  }
+  spinlock_unlock_irqrestore(&rq->lock, flags);
+  if (NCPU > 1 && rq->tick >= rq->next_balance) {
+    rq->next_balance = rq->tick + SCHED_LB_INTERVAL;
+    load_balance(rq);
+  }
+}
+
+/*
+ * 切换完成后在 next 的上下文中执行：prev 已经不再使用自己的内核栈，
+ * 此时才能让其他 hart 运行它，或者释放已经退出的内核线程。
+ */
+static void finish_task_switch(struct task_struct *prev) {
+  // on_cpu 清零之后僵尸进程随时可能被父进程回收，需要的字段先取出来
+  int32 dead = prev->state == TASK_DEAD;
+  int32 kthread = prev->flags & PF_KTHREAD;
+  int32 autoreap = prev->exit_signal == -1;
+  smp_wmb();
+  WRITE_ONCE(prev->on_cpu, 0);
+  if (!dead) return;
+  // 内核线程和退出后不需要父进程回收的用户线程，在这里释放最后的资源
+  if (kthread)
+    kthread_free(prev);
+  else if (autoreap)
+    release_task(prev);
+}
+
+/**
+ * schedule_tail - 新任务第一次运行时由 ret_from_fork/ret_from_kernel_thread 调用
+ * @prev: 切换前任务的 context，即 __switch_to 的第一个参数
+ *
+ * Returns: 当前任务
+ */
+struct task_struct *schedule_tail(struct context *prev) {
+  finish_task_switch(container_of(prev, struct task_struct, context));
+  // 新任务的栈上没有 schedule() 保存的中断状态，直接打开；返回用户态前 ret_to_user 会再关掉
+  intr_on();
+  return CURRENT;
+}
+
+static struct task_struct *context_switch(struct task_struct *prev, struct task_struct *next) {
+  // next 刚在别的 hart 上被换下，还在使用自己的内核栈时不能恢复它
+  while (READ_ONCE(next->on_cpu)) {
+  }
+  next->on_cpu = 1;
+  // 只有用过浮点且修改过的用户任务才需要保存，恢复推迟到下次使用时
+  fpu_flush(prev);
+  raw_cpu_write(current_percpu, next);
+  struct context *last = __switch_to(&prev->context, &next->context);
+  return container_of(last, struct task_struct, context);
+}
+
+/*
+ * 从运行队列中选出下一个任务并切换过去。
+ * @preempt: 由 preempt_schedule 调用，prev 不论 state 是什么都放回队列
+ *
+ * 仍是 TASK_RUNNING 的 prev（例如在调用 schedule() 之前就被唤醒）也会被放回队列；
+ * 其余状态的 prev 在这里睡眠，被唤醒并再次选中后才从 schedule() 返回。
+ */
+static void __schedule(int32 preempt) {
+  log_trace(LOG_SUB_SCHED, "schedule: start\n");
+  struct rq *rq = this_rq();
+  struct task_struct *prev = CURRENT;
+  struct task_struct *next;
+
+  // 中断一直关到切换完成，flags 保存在每个任务自己的栈上
+  int64 flags = disable_irqsave();
+  spinlock_lock(&rq->lock);
+  // 给即将让出 CPU 的任务记账
+  if (rq->curr) rq->curr->sched_class->update_curr(rq);
+  // 启动上下文（boot_task）不属于任何调度类，不会被放回队列；退出的任务在切换前关闭了抢占。
+  // 在持锁时入队，其他 hart 的迁移会跳过 on_cpu 的任务；cpu 已经不是本 hart 说明它已被别处接管
+  if ((preempt || prev->state == TASK_RUNNING) && prev->state != TASK_DEAD && !prev->on_rq && prev != rq->idle &&
+      prev->sched_class && prev->cpu == rq->cpu)
+    enqueue_task(rq, prev, preempt ? ENQUEUE_PREEMPTED : 0);
+  rq->need_resched = 0;
+  next = pick_next_task(rq);
+  // 队列为空时先记为 idle，窃取成功后由 steal_task 在持锁时改成窃来的任务
+  set_next_task(rq, next ? next : rq->idle);
+  spinlock_unlock(&rq->lock);
+
+  // 本队列为空：先尝试从其他 hart 窃取，仍然没有就运行本 hart 的 idle
+  if (!next && NCPU > 1) next = steal_task(rq);
+  if (!next) next = rq->idle;
+  assert(next);
+
+  if (next != prev) {
+    log_debug(LOG_SUB_SCHED, "switch from process %d to %d.\n", prev->pid, next->pid);
+    next->se.nr_switches++;
+    rq->nr_switches++;
+    prev = context_switch(prev, next);
+    finish_task_switch(prev);
+  }
+  enable_irqrestore(flags);
+}
+
+void schedule() { __schedule(0); }
+
+/**
+ * ret_to_user - 经 trapframe 返回用户态，不返回
+ */
+void ret_to_user(struct task_struct *proc) {
 
   assert(proc);
-  CURRENT = proc;
+  // 换成用户态的 stvec 之后直到 sret 都不能再响应中断
+  intr_off();
+  raw_cpu_write(current_percpu, proc);
 
   extern char smode_trap_vector[];
   write_csr(stvec, (uint64)smode_trap_vector);
@@ -130,6 +615,7 @@ void switch_to(struct task_struct *proc) {
   // need when the process next re-enters the kernel.
   proc->trapframe->kernel_sp = proc->kstack;     // process's kernel stack
   proc->trapframe->kernel_satp = read_csr(satp); // kernel page table
+  proc->trapframe->kernel_tp = read_tp();        // this hart's per-CPU offset
 
   extern char smode_trap_handler[];
   //proc->trapframe->kernel_trap = (uint64)smode_trap_handler;	//这个字段现在硬编码了
@@ -138,37 +624,14 @@ void switch_to(struct task_struct *proc) {
   // SSTATUS_SPP and SSTATUS_SPIE are defined in kernel/riscv.h
   // set S Previous Privilege mode (the SSTATUS_SPP bit in sstatus register) to
   // User mode,to to enable interrupts, and sret destination.
-
-  write_csr(sstatus, ((read_csr(sstatus) & ~SSTATUS_SPP) | SSTATUS_SPIE));
+  // sstatus.FS 决定用户态能否直接使用本 hart 上的浮点寄存器，见 fpu.c
+  uint64 status = read_csr(sstatus) & ~(SSTATUS_SPP | SSTATUS_FS);
+  write_csr(sstatus, status | SSTATUS_SPIE | fpu_return_fs(proc));
 
   // set S Exception Program Counter (sepc register) to the elf entry pc.
   write_csr(sepc, proc->trapframe->epc);
-  kprintf("return to user\n");
+  log_trace(LOG_SUB_SCHED, "return to user\n");
 
   extern void return_to_user(struct trapframe *, uint64);
   return_to_user(proc->trapframe, MAKE_SATP(proc->mm->pagetable));
 }
-
-
-
-/**
- * find_process_by_pid - Find a process by its PID
- * @pid: Process ID to search for
- *
- * Searches the process table for a process with the given PID.
- * 
- * Returns: Pointer to the task_struct if found, NULL if not found
- */
-struct task_struct *find_process_by_pid(pid_t pid) {
-    if (pid <= 0)
-        return NULL;
-    
-    // Search the process table
-    for (int32 i = 0; i < NPROC; i++) {
-        if (procs[i] && procs[i]->pid == pid) {
-            return procs[i];
-        }
-    }
-    
-    return NULL;  // Process not found
-}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <kernel/util.h>
 #include <kernel/util/print.h>
 #include <kernel/mmu.h>
+#include <kernel/syscall/syscall.h>
 
 /* Global variable to track the signal that caused an interrupt */
 int32 g_signal_pending = 0;
@@ -90,6 +91,77 @@ int32 sigismember(const sigset_t *set, int32 signo)
         (1UL << ((signo - 1) % (8 * sizeof(uint64)))));
 }
 
+/**
+ * signal_pending - Check for unblocked pending signals
+ * @p: Task to check
+ *
+ * Interruptible sleeps give up with -EINTR when this is true.
+ */
+int32 signal_pending(struct task_struct *p)
+{
+    for (int32 i = 0; i < sizeof(sigset_t) / sizeof(unsigned long); i++) {
+        if (p->pending.__bits[i] & ~p->blocked.__bits[i])
+            return 1;
+    }
+    return 0;
+}
+
+/*
+ * sig_ignored - Whether delivering sig to p would do nothing
+ *
+ * Blocked signals are kept, the handler may change before they are unblocked.
+ */
+static int32 sig_ignored(struct task_struct *p, int32 sig)
+{
+    if (!p->sighand || sigismember(&p->blocked, sig))
+        return 0;
+
+    void (*handler)(int32) = p->sighand->action[sig - 1].sa_handler;
+    if (handler == SIG_IGN)
+        return 1;
+    if (handler != SIG_DFL)
+        return 0;
+
+    // Signals whose default action is to ignore
+    switch (sig) {
+        case SIGCHLD:
+        case SIGCONT:
+        case SIGURG:
+        case SIGWINCH:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * send_sig - Queue a signal on a task
+ * @sig: Signal to send
+ * @p: Target task
+ *
+ * Ignored signals are dropped so that they do not interrupt sleeps,
+ * e.g. SIGCHLD waking a parent blocked in wait4 with -EINTR.
+ *
+ * Returns 0 on success, negative error code on failure
+ */
+int32 send_sig(int32 sig, struct task_struct *p)
+{
+    if (sig <= 0 || sig >= NSIG)
+        return -EINVAL;
+
+    if (sig_ignored(p, sig))
+        return 0;
+
+    // Add signal to pending set
+    sigaddset(&p->pending, sig);
+
+    // Wake up if sleeping interruptibly, the wait returns -EINTR
+    if (!sigismember(&p->blocked, sig))
+        wake_up_state(p, TASK_INTERRUPTIBLE);
+
+    return 0;
+}
+
 /**
  * do_send_signal - Core signal sending function
  * @pid: Process ID to send signal to
@@ -100,6 +172,7 @@ int32 sigismember(const sigset_t *set, int32 signo)
 int32 do_send_signal(pid_t pid, int32 sig)
 {
     struct task_struct *p;
+    int32 put = 0, ret;
     
     if (sig <= 0 || sig >= NSIG)
         return -EINVAL;
@@ -113,37 +186,72 @@ int32 do_send_signal(pid_t pid, int32 sig)
         p = find_process_by_pid(pid);
         if (!p)
             return -ESRCH;
+        // The reference keeps p valid if it is reaped meanwhile
+        put = 1;
     }
     
-    // Handle SIGKILL and SIGSTOP specially
-    if (sig == SIGKILL || sig == SIGSTOP) {
-        // These signals cannot be blocked or ignored
-        
-        // For SIGKILL, terminate the process immediately
-        if (sig == SIGKILL) {
-            kprintf("Process %d killed by signal %d\n", p->pid, sig);
-            // Implement process termination logic
-            // do_exit(p, sig);
-            return 0;
-        }
-        
-        // For SIGSTOP, stop the process
-        if (sig == SIGSTOP) {
-            kprintf("Process %d stopped by signal %d\n", p->pid, sig);
-            // Implement process stop logic
-            // p->state = TASK_STOPPED;
-            return 0;
-        }
-    }
+    // SIGKILL cannot be blocked or ignored, the target exits in
+    // do_signal_delivery on its way back to user mode
     
-    // Add signal to pending set
-    sigaddset(&p->pending, sig);
-    
-    // Wake up if sleeping
-    // if (p->state == TASK_INTERRUPTIBLE)
-    //     wake_up_process(p);
-    
-    return 0;
+    // For SIGSTOP, stop the process
+    if (sig == SIGSTOP) {
+        kprintf("Process %d stopped by signal %d\n", p->pid, sig);
+        // Implement process stop logic
+        // p->state = TASK_STOPPED;
+        ret = 0;
+    } else {
+        ret = send_sig(sig, p);
+    }
+
+    if (put)
+        put_task_struct(p);
+    return ret;
+}
+
+/**
+ * sighand_alloc - Allocate a handler table with every action set to SIG_DFL
+ *
+ * Returns the new table with a count of 1, or NULL on failure
+ */
+struct sighand_struct *sighand_alloc(void)
+{
+    struct sighand_struct *sighand = kmalloc(sizeof(struct sighand_struct));
+    if (!sighand)
+        return NULL;
+
+    memset(sighand, 0, sizeof(struct sighand_struct));
+    atomic_set(&sighand->count, 1);
+    spinlock_init(&sighand->siglock);
+    for (int32 i = 0; i < _NSIG; i++)
+        sighand->action[i].sa_handler = SIG_DFL;
+    return sighand;
+}
+
+/**
+ * sighand_copy - Private copy of a handler table, used by clone without CLONE_SIGHAND
+ */
+struct sighand_struct *sighand_copy(struct sighand_struct *old)
+{
+    struct sighand_struct *sighand = sighand_alloc();
+    if (!sighand)
+        return NULL;
+
+    spinlock_lock(&old->siglock);
+    memcpy(sighand->action, old->action, sizeof(sighand->action));
+    spinlock_unlock(&old->siglock);
+    return sighand;
+}
+
+void sighand_get(struct sighand_struct *sighand)
+{
+    atomic_inc(&sighand->count);
+}
+
+/* Drop a reference, the last user frees the table */
+void sighand_put(struct sighand_struct *sighand)
+{
+    if (sighand && atomic_dec_and_test(&sighand->count))
+        kfree(sighand);
 }
 
 /**
@@ -168,14 +276,18 @@ int32 do_sigaction(int32 sig, const struct sigaction *act, struct sigaction *old
     if (sig == SIGKILL || sig == SIGSTOP)
         return -EINVAL;
     
+    // The table may be shared with other threads
+    spinlock_lock(&p->sighand->siglock);
+
     // Store old action if requested
     if (oldact)
-        *oldact = p->sighand[sig - 1];
+        *oldact = p->sighand->action[sig - 1];
     
     // Set new action if provided
     if (act)
-        p->sighand[sig - 1] = *act;
+        p->sighand->action[sig - 1] = *act;
     
+    spinlock_unlock(&p->sighand->siglock);
     return 0;
 }
 
@@ -279,7 +391,8 @@ void do_signal_delivery(void)
     struct task_struct *p = current_task();
     int32 sig;
     
-    if (!p)
+    // Kernel threads have no handler table
+    if (!p || !p->sighand)
         return;
     
     // Find the first pending and unblocked signal
@@ -289,13 +402,19 @@ void do_signal_delivery(void)
             sigdelset(&p->pending, sig);
             
             // Check the signal handler action
-            if (p->sighand[sig - 1].sa_handler == SIG_IGN) {
+            if (p->sighand->action[sig - 1].sa_handler == SIG_IGN) {
                 // Signal is ignored, just continue
                 continue;
             } 
-            else if (p->sighand[sig - 1].sa_handler == SIG_DFL) {
+            else if (p->sighand->action[sig - 1].sa_handler == SIG_DFL) {
                 // Default action
                 switch (sig) {
+                    case SIGHUP:
+                    case SIGINT:
+                    case SIGPIPE:
+                    case SIGALRM:
+                    case SIGUSR1:
+                    case SIGUSR2:
                     case SIGTERM:
                     case SIGKILL:
                     case SIGSEGV:
@@ -304,10 +423,10 @@ void do_signal_delivery(void)
                     case SIGFPE:
                     case SIGQUIT:
                     case SIGABRT:
-                        // Default is to terminate the process
+                        // Default is to terminate the whole thread group,
+                        // the parent sees WIFSIGNALED with WTERMSIG == sig
                         kprintf("Process %d terminated by signal %d\n", p->pid, sig);
-                        // Implement termination here
-                        // do_exit(p, sig);
+                        do_group_exit(sig);
                         break;
                         
                     case SIGSTOP:
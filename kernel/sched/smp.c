@@ -0,0 +1,213 @@
+/*
+ * 多核启动与核间中断，见 include/kernel/sched/smp.h
+ */
+
+#include <kernel/boot/dtb.h>
+#include <kernel/device/sbi.h>
+#include <kernel/mm/mm_struct.h>
+#include <kernel/mm/pagetable.h>
+#include <kernel/riscv.h>
+#include <kernel/sched/sched.h>
+#include <kernel/sched/smp.h>
+#include <kernel/util.h>
+
+// 局部刷新超过这么多页时直接刷新整个 TLB
+#define TLB_FLUSH_PAGES_MAX 32
+
+volatile uint64 cpu_online_mask;
+int32 boot_hartid = -1;
+
+/*
+ * 一次跨 hart 的函数调用。每个 (发送方, 目标) 对只有一个槽位，
+ * 发送方在关中断期间使用自己的槽位，上一次调用完成之前不会复用。
+ */
+struct call_single_data {
+	smp_call_func_t func;
+	void* info;
+	volatile int32 pending; // 目标执行完 func 后清零
+};
+
+struct ipi_data {
+	volatile uint64 bits;              // 待处理的 IPI_* 位
+	struct call_single_data csd[NCPU]; // 按发送方编号
+} __attribute__((aligned(64)));
+
+static struct ipi_data ipi_data[NCPU];
+
+/**
+ * smp_claim_boot_hart - 第一个进入 s_start 的 hart 负责全局初始化
+ *
+ * Returns: 1 表示本 hart 成为启动 hart
+ */
+int32 smp_claim_boot_hart(int32 hartid) { return __sync_bool_compare_and_swap(&boot_hartid, -1, hartid); }
+
+/**
+ * smp_boot_secondary_harts - 通过 SBI HSM 启动设备树中的其余 hart
+ * @dtb: 原样传给从核的 s_start
+ *
+ * 从核从 _entry 开始执行，此时全局初始化已经完成。
+ */
+void smp_boot_secondary_harts(uint64 dtb) {
+	extern char _entry[];
+	for (int32 hartid = 0; hartid < NCPU; hartid++) {
+		if (hartid == boot_hartid || !(cpuInfo.hart_mask & (1UL << hartid))) continue;
+		struct sbiret ret = SBI_HART_START(hartid, (uint64)_entry, dtb);
+		// 不支持 HSM 的固件会同时放出所有 hart，它们已经在 s_start 中等待
+		int64 error = (int64)ret.error;
+		if (error && error != SBI_ERR_ALREADY_AVAILABLE && error != SBI_ERR_ALREADY_STARTED)
+			kprintf("smp: failed to start hart %d, error %ld\n", hartid, error);
+	}
+	if (cpuInfo.nr > NCPU) kprintf("smp: %d harts in device tree, only hartid < %d are used\n", cpuInfo.nr, NCPU);
+}
+
+void set_cpu_online(int32 cpu) { __atomic_fetch_or(&cpu_online_mask, 1UL << cpu, __ATOMIC_RELEASE); }
+
+int32 num_online_cpus(void) { return __builtin_popcountl(cpu_online_mask); }
+
+static void send_ipi_mask(uint64 mask, int32 type) {
+	for (int32 cpu = 0; cpu < NCPU; cpu++) {
+		if (mask & (1UL << cpu)) __atomic_fetch_or(&ipi_data[cpu].bits, 1UL << type, __ATOMIC_RELEASE);
+	}
+	SBI_SEND_IPI(mask, 0);
+}
+
+void smp_send_reschedule(int32 cpu) { send_ipi_mask(1UL << cpu, IPI_RESCHEDULE); }
+
+// 执行其他 hart 发给 cpu 的调用，中断关闭时调用
+static void flush_call_queue(int32 cpu) {
+	struct ipi_data* d = &ipi_data[cpu];
+	for (int32 src = 0; src < NCPU; src++) {
+		struct call_single_data* csd = &d->csd[src];
+		if (!__atomic_load_n(&csd->pending, __ATOMIC_ACQUIRE)) continue;
+		csd->func(csd->info);
+		__atomic_store_n(&csd->pending, 0, __ATOMIC_RELEASE);
+	}
+}
+
+/*
+ * 等待 csd 执行完。对方可能也关着中断在等本 hart 执行它的请求，
+ * 所以等待期间顺带处理发给自己的调用。
+ */
+static void csd_wait(struct call_single_data* csd) {
+	int32 self = smp_processor_id();
+	while (__atomic_load_n(&csd->pending, __ATOMIC_ACQUIRE)) flush_call_queue(self);
+}
+
+/**
+ * smp_call_function_many - 在 mask 中的其他在线 hart 上执行 func
+ * @wait: 为 1 时等所有目标执行完才返回；为 0 时 info 必须在调用完成前保持有效
+ *
+ * 不会在本 hart 上执行。不能在持有其他 hart 可能关中断自旋等待的锁时调用。
+ */
+void smp_call_function_many(uint64 mask, smp_call_func_t func, void* info, int32 wait) {
+	int32 self = smp_processor_id();
+	mask &= cpu_online_mask & ~(1UL << self);
+	if (!mask) return;
+
+	int64 flags = disable_irqsave();
+	for (int32 cpu = 0; cpu < NCPU; cpu++) {
+		if (!(mask & (1UL << cpu))) continue;
+		struct call_single_data* csd = &ipi_data[cpu].csd[self];
+		// 上一次异步调用还没有完成
+		csd_wait(csd);
+		csd->func = func;
+		csd->info = info;
+		__atomic_store_n(&csd->pending, 1, __ATOMIC_RELEASE);
+	}
+	send_ipi_mask(mask, IPI_CALL_FUNC);
+	if (wait) {
+		for (int32 cpu = 0; cpu < NCPU; cpu++) {
+			if (mask & (1UL << cpu)) csd_wait(&ipi_data[cpu].csd[self]);
+		}
+	}
+	enable_irqrestore(flags);
+}
+
+/**
+ * smp_call_function_single - 在指定 hart 上执行 func，目标是本 hart 时直接关中断执行
+ *
+ * Returns: 0 表示成功，-ENXIO 表示目标 hart 不在线
+ */
+int32 smp_call_function_single(int32 cpu, smp_call_func_t func, void* info, int32 wait) {
+	if (cpu == smp_processor_id()) {
+		int64 flags = disable_irqsave();
+		func(info);
+		enable_irqrestore(flags);
+		return 0;
+	}
+	if (cpu < 0 || cpu >= NCPU || !cpu_online(cpu)) return -ENXIO;
+	smp_call_function_many(1UL << cpu, func, info, wait);
+	return 0;
+}
+
+// 在除本 hart 以外的所有在线 hart 上执行 func
+void smp_call_function(smp_call_func_t func, void* info, int32 wait) { smp_call_function_many(~0UL, func, info, wait); }
+
+// 在所有在线 hart（包括本 hart）上执行 func
+void on_each_cpu(smp_call_func_t func, void* info, int32 wait) {
+	smp_call_function(func, info, wait);
+	int64 flags = disable_irqsave();
+	func(info);
+	enable_irqrestore(flags);
+}
+
+/**
+ * handle_ipi - S 模式软件中断，由内核和用户态的陷阱入口调用
+ *
+ * 先清 SSIP 再取走待处理位，之后新到的 IPI 会再次触发中断。
+ */
+void handle_ipi(void) {
+	int32 cpu = smp_processor_id();
+	write_csr(sip, read_csr(sip) & ~SIP_SSIP);
+	uint64 pending = __atomic_exchange_n(&ipi_data[cpu].bits, 0, __ATOMIC_ACQ_REL);
+
+	// 发送方已经置位 need_resched，中断返回路径上的抢占点负责切换
+	if (pending & (1UL << IPI_RESCHEDULE)) WRITE_ONCE(this_rq()->need_resched, 1);
+	if (pending & (1UL << IPI_CALL_FUNC)) flush_call_queue(cpu);
+}
+
+/*
+ * TLB 击落
+ *
+ * 每次进出用户态切换 satp 时都会刷新整个 TLB，所以只有正在运行同一页表的 hart
+ * 可能缓存着旧的映射；修改内核页表则需要通知所有 hart。
+ */
+struct tlb_flush_info {
+	uint64 start;
+	uint64 end;
+};
+
+static void local_flush_tlb_range(uint64 start, uint64 end) {
+	if (end - start > TLB_FLUSH_PAGES_MAX * PAGE_SIZE) {
+		flush_tlb();
+		return;
+	}
+	for (uint64 va = ROUNDDOWN(start, PAGE_SIZE); va < end; va += PAGE_SIZE) flush_tlb_page(va);
+}
+
+static void ipi_flush_tlb_range(void* info) {
+	struct tlb_flush_info* f = info;
+	local_flush_tlb_range(f->start, f->end);
+}
+
+static void ipi_flush_tlb_all(void* info) { flush_tlb(); }
+
+void flush_tlb_all(void) { on_each_cpu(ipi_flush_tlb_all, NULL, 1); }
+
+/**
+ * flush_tlb_range - 修改 pagetable 中 [start, end) 的映射之后刷新所有相关 hart 的 TLB
+ *
+ * 返回时其他 hart 都已经不再使用旧的映射，可以释放原来的物理页。
+ */
+void flush_tlb_range(uint64* pagetable, uint64 start, uint64 end) {
+	struct tlb_flush_info f = {start, end};
+	uint64 mask = 0;
+	int32 cpu;
+
+	local_flush_tlb_range(start, end);
+	for_each_online_cpu(cpu) {
+		struct task_struct* p = READ_ONCE(per_cpu(current_percpu, cpu));
+		if (pagetable == g_kernel_pagetable || (p && p->mm && p->mm->pagetable == pagetable)) mask |= 1UL << cpu;
+	}
+	smp_call_function_many(mask, ipi_flush_tlb_range, &f, 1);
+}
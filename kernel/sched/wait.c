@@ -0,0 +1,137 @@
+/*
+ * 等待队列，见 include/kernel/sched/wait.h
+ */
+
+#include <kernel/sched.h>
+#include <kernel/sched/signal.h>
+#include <kernel/sched/wait.h>
+#include <kernel/util.h>
+
+int32 default_wake_function(struct wait_queue_entry* wq_entry, uint32 mode, int32 flags, void* key) {
+	return wake_up_state(wq_entry->private, mode);
+}
+
+// 唤醒成功就把等待项摘下，同一个等待者不会被重复唤醒
+int32 autoremove_wake_function(struct wait_queue_entry* wq_entry, uint32 mode, int32 flags, void* key) {
+	int32 ret = default_wake_function(wq_entry, mode, flags, key);
+	if (ret) list_del_init(&wq_entry->entry);
+	return ret;
+}
+
+void init_wait_entry(struct wait_queue_entry* wq_entry, int32 flags) {
+	wq_entry->flags = flags;
+	wq_entry->private = CURRENT;
+	wq_entry->func = autoremove_wake_function;
+	INIT_LIST_HEAD(&wq_entry->entry);
+}
+
+// 非排他等待者放在队首，排他等待者放在队尾，唤醒时先处理完非排他的
+static inline void __add_wait_queue(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry) {
+	if (wq_entry->flags & WQ_FLAG_EXCLUSIVE)
+		list_add_tail(&wq_entry->entry, &wq_head->head);
+	else
+		list_add(&wq_entry->entry, &wq_head->head);
+}
+
+void add_wait_queue(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry) {
+	int64 flags = spinlock_lock_irqsave(&wq_head->lock);
+	wq_entry->flags &= ~WQ_FLAG_EXCLUSIVE;
+	__add_wait_queue(wq_head, wq_entry);
+	spinlock_unlock_irqrestore(&wq_head->lock, flags);
+}
+
+void add_wait_queue_exclusive(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry) {
+	int64 flags = spinlock_lock_irqsave(&wq_head->lock);
+	wq_entry->flags |= WQ_FLAG_EXCLUSIVE;
+	__add_wait_queue(wq_head, wq_entry);
+	spinlock_unlock_irqrestore(&wq_head->lock, flags);
+}
+
+void remove_wait_queue(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry) {
+	int64 flags = spinlock_lock_irqsave(&wq_head->lock);
+	list_del_init(&wq_entry->entry);
+	spinlock_unlock_irqrestore(&wq_head->lock, flags);
+}
+
+/**
+ * prepare_to_wait - 挂入等待队列并设置睡眠状态，之后调用者检查条件再决定是否 schedule()
+ *
+ * 状态在队列锁内设置：唤醒者只要看到了这个等待项，就一定能看到新的状态。
+ */
+void prepare_to_wait(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry, int32 state) {
+	int64 flags = spinlock_lock_irqsave(&wq_head->lock);
+	wq_entry->flags &= ~WQ_FLAG_EXCLUSIVE;
+	if (list_empty(&wq_entry->entry)) __add_wait_queue(wq_head, wq_entry);
+	WRITE_ONCE(CURRENT->state, state);
+	spinlock_unlock_irqrestore(&wq_head->lock, flags);
+}
+
+void prepare_to_wait_exclusive(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry, int32 state) {
+	int64 flags = spinlock_lock_irqsave(&wq_head->lock);
+	wq_entry->flags |= WQ_FLAG_EXCLUSIVE;
+	if (list_empty(&wq_entry->entry)) __add_wait_queue(wq_head, wq_entry);
+	WRITE_ONCE(CURRENT->state, state);
+	spinlock_unlock_irqrestore(&wq_head->lock, flags);
+}
+
+/**
+ * prepare_to_wait_event - wait_event 系列宏使用的 prepare_to_wait，排他与否取决于 wq_entry->flags
+ *
+ * Returns: 0；可中断的睡眠遇到未屏蔽的信号时不再挂入队列，返回 -EINTR
+ */
+int64 prepare_to_wait_event(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry, int32 state) {
+	int64 ret = 0;
+	int64 flags = spinlock_lock_irqsave(&wq_head->lock);
+	if ((state & TASK_INTERRUPTIBLE) && signal_pending(CURRENT)) {
+		if (!list_empty(&wq_entry->entry)) {
+			list_del_init(&wq_entry->entry);
+		} else if (wq_entry->flags & WQ_FLAG_EXCLUSIVE) {
+			// 已经被排他唤醒摘下，却因信号放弃等待：把这次唤醒转给下一个排他等待者，否则它会丢失
+			__wake_up_locked(wq_head, TASK_NORMAL, 1, NULL);
+		}
+		ret = -EINTR;
+	} else {
+		if (list_empty(&wq_entry->entry)) __add_wait_queue(wq_head, wq_entry);
+		WRITE_ONCE(CURRENT->state, state);
+	}
+	spinlock_unlock_irqrestore(&wq_head->lock, flags);
+	return ret;
+}
+
+/**
+ * finish_wait - 等待结束：恢复运行状态，等待项还在队列中（超时或条件已成立）时摘下
+ */
+void finish_wait(struct wait_queue_head* wq_head, struct wait_queue_entry* wq_entry) {
+	WRITE_ONCE(CURRENT->state, TASK_RUNNING);
+	// 唤醒者可能正在锁内摘下这个等待项，等它写完才能让等待项出栈
+	int64 flags = spinlock_lock_irqsave(&wq_head->lock);
+	list_del_init(&wq_entry->entry);
+	spinlock_unlock_irqrestore(&wq_head->lock, flags);
+}
+
+/**
+ * __wake_up - 唤醒 wq_head 上状态属于 mode 的等待者
+ * @nr_exclusive: 最多唤醒的排他等待者个数，0 表示全部
+ *
+ * 可以在中断上下文中调用。
+ */
+void __wake_up(struct wait_queue_head* wq_head, uint32 mode, int32 nr_exclusive, void* key) {
+	int64 flags = spinlock_lock_irqsave(&wq_head->lock);
+	__wake_up_locked(wq_head, mode, nr_exclusive, key);
+	spinlock_unlock_irqrestore(&wq_head->lock, flags);
+}
+
+/**
+ * __wake_up_locked - 调用者已经持有 wq_head->lock 的 __wake_up
+ *
+ * 用于条件和唤醒必须在同一次持锁中完成的场合，例如 complete()：
+ * 等待者看到条件后可能立即释放等待队列所在的内存。
+ */
+void __wake_up_locked(struct wait_queue_head* wq_head, uint32 mode, int32 nr_exclusive, void* key) {
+	struct wait_queue_entry *curr, *next;
+	list_for_each_entry_safe(curr, next, &wq_head->head, entry) {
+		uint32 wq_flags = curr->flags;
+		int32 ret = curr->func(curr, mode, 0, key);
+		if (ret && (wq_flags & WQ_FLAG_EXCLUSIVE) && !--nr_exclusive) break;
+	}
+}
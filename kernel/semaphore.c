@@ -6,18 +6,24 @@
 #include <kernel/util/print.h>
 //信号灯库
 semaphore sem_pool[NSEM];
+static spinlock_t sem_pool_lock = {SPINLOCK_INIT};
+
 // 获取一个新的信号灯编号，成功返回0-64，失败返回-1
 int32 sem_new(int32 initial_value) {
+  int64 flags = spinlock_lock_irqsave(&sem_pool_lock);
   for (int32 i = 0; i < NSEM; i++) {
     if (sem_pool[i].isActive == 0) {
       sem_pool[i].isActive = 1;
       sem_pool[i].value = initial_value;
 			//kprintf("sem %d initialvalue %d\n",i,initial_value);
       // sem_pool[i].pid = pid;
-      sem_pool[i].wait_queue = NULL;
+      spinlock_init(&sem_pool[i].lock);
+      init_waitqueue_head(&sem_pool[i].wait);
+      spinlock_unlock_irqrestore(&sem_pool_lock, flags);
       return i;
     }
   }
+  spinlock_unlock_irqrestore(&sem_pool_lock, flags);
   return -1;
 }
 
@@ -30,48 +36,39 @@ void sem_free(int32 sem_index) {
   return;
 }
 
-int32 sem_P(int32 sem_index) {
-  // //kprintf("Received calling sem_P index = %d\n", sem_index);
-  // if (sem_index < 0 || sem_index >= NSEM || !sem_pool[sem_index].isActive) {
-  //   panic("invalid sem_index!");
-  // }
-
-  // semaphore *sem = &sem_pool[sem_index];
-  // if (sem->value > 0) {
-  //   return sem->value--;
-  // } else {
-  //   // kprintf("BLOCK!\n");
-  //   int32 hartid = read_tp();
-  //   struct task_struct *cur = CURRENT;
-  //   cur->state = TASK_INTERRUPTIBLE;
-  //   cur->ready_queue_node = sem->wait_queue;
-  //   sem->wait_queue = cur;
+// 条件成立时顺带取走一份资源，wait_event 的条件检查与扣减是原子的
+static int32 sem_try_down(semaphore *sem) {
+  int32 ok = 0;
+  int64 flags = spinlock_lock_irqsave(&sem->lock);
+  if (sem->value > 0) {
+    sem->value--;
+    ok = 1;
+  }
+  spinlock_unlock_irqrestore(&sem->lock, flags);
+  return ok;
+}
 
-  //   schedule();
+// P 操作：没有资源时睡眠等待。返回 0，被信号打断时返回 -EINTR
+int32 sem_P(int32 sem_index) {
+  if (sem_index < 0 || sem_index >= NSEM || !sem_pool[sem_index].isActive) {
+    panic("invalid sem_index!");
+  }
 
-  //   // kprintf("return from blocking!\n");
-  //   return 0;
-  //   // 直接嵌入保存内核上下文到process->ktrapframe的汇编代码
-  // }
-	return 0;
+  semaphore *sem = &sem_pool[sem_index];
+  // 排他等待：每次 V 只放出一份资源，只需要唤醒一个等待者
+  return wait_event_interruptible_exclusive(sem->wait, sem_try_down(sem));
 }
 
-// 我们这里为了实现简单，直接把信号队列当成信号栈使了。
-// 如果说有进程等待信号量，返回0，不然返回增加后的信号资源量sem->value
+// V 操作：归还一份资源并唤醒一个等待者，返回增加后的资源量
 int32 sem_V(int32 sem_index) {
-  // if (sem_index < 0 || sem_index >= NSEM || !sem_pool[sem_index].isActive) {
-  //   panic("invalid sem_index!");
-  // }
-  // semaphore *sem = &sem_pool[sem_index];
+  if (sem_index < 0 || sem_index >= NSEM || !sem_pool[sem_index].isActive) {
+    panic("invalid sem_index!");
+  }
+  semaphore *sem = &sem_pool[sem_index];
 
-  // if (sem->value == 0 && sem->wait_queue != NULL) {
-  //   insert_to_ready_queue(sem->wait_queue);
-	// 	//insert_to_ready_queue(current);
-  //   // sem->wait_queue->state = READY;
-  //   sem->wait_queue = sem->wait_queue->queue_next;
-  //   //schedule();
-  //   return 0;
-  // }
-	// return sem->value++;
-	return 0;
-}
\ No newline at end of file
+  int64 flags = spinlock_lock_irqsave(&sem->lock);
+  int32 value = ++sem->value;
+  spinlock_unlock_irqrestore(&sem->lock, flags);
+  wake_up(&sem->wait);
+  return value;
+}
@@ -3,12 +3,14 @@
  */
 
 #include <kernel/strap.h>
+#include <kernel/device/plic.h>
 #include <kernel/mmu.h>
 #include <kernel/sched.h>
 #include <kernel/riscv.h>
 #include <kernel/util.h>
 #include <kernel/syscall/syscall.h>
 #include <kernel/time.h>
+#include <kernel/hrtimer.h>
 
 //
 // handling the syscalls. will call do_syscall() defined in kernel/syscall.c
@@ -26,14 +28,10 @@ static void handle_syscall(struct trapframe *tf) {
 // added @lab1_3
 //
 void handle_mtimer_trap() {
-  kprintf("Ticks %d\n", jiffies);
-  int32 hartid = read_tp();
-  if(hartid == 0){
-	jiffies++;
-  }
-  CURRENT->tick_count++;
-
-  write_csr(sip, read_csr(sip) & ~SIP_SSIP);
+  log_trace(LOG_SUB_TRAP, "Ticks %d\n", jiffies);
+  // 时钟节拍和 jiffies 的推进都是 hrtimer 的回调，见 kernel/tick.c；
+  // 处理完到期的定时器后按最早的剩余定时器重新编程比较器，同时清除 STIP
+  hrtimer_interrupt();
 }
 
 /**
@@ -48,7 +46,7 @@ void handle_user_page_fault(uint64 mcause, uint64 sepc, uint64 stval) {
 	struct task_struct *proc = CURRENT;
 	uint64 addr = stval;
 	
-	kprintf("sepc=%lx, handle_page_fault: %lx\n", sepc, addr);
+	log_debug(LOG_SUB_MM, "sepc=%lx, handle_page_fault: %lx\n", sepc, addr);
 	
 	// 标记访问类型
 	int32 fault_prot = 0;
@@ -61,13 +59,15 @@ void handle_user_page_fault(uint64 mcause, uint64 sepc, uint64 stval) {
 	
 	// 处理基于 VMA 的内存管理
 	if (proc->mm) {
-			// 查找地址所在的VMA
+			// 查找地址所在的VMA，持有读锁期间 VMA 不会被 mmap/munmap 修改
+			down_read(&proc->mm->mmap_lock);
 			struct vm_area_struct *vma = find_vma(proc->mm, addr);
 			
 			if (vma) {
 					// 确认访问权限
 					if ((fault_prot & vma->vm_prot) != fault_prot) {
 							kprintf("权限不足: 需要 %d, VMA允许 %d\n", fault_prot, vma->vm_prot);
+							up_read(&proc->mm->mmap_lock);
 							goto error;
 					}
 					
@@ -78,6 +78,7 @@ void handle_user_page_fault(uint64 mcause, uint64 sepc, uint64 stval) {
 					int32 page_idx = (page_va - vma->vm_start) / PAGE_SIZE;
 					if (page_idx < 0 || page_idx >= vma->page_count) {
 							kprintf("页索引越界: %d\n", page_idx);
+							up_read(&proc->mm->mmap_lock);
 							goto error;
 					}
 					
@@ -120,6 +121,7 @@ void handle_user_page_fault(uint64 mcause, uint64 sepc, uint64 stval) {
 					// uint64 page_addr = mm_alloc_page(proc, page_va, vma->vm_prot);
 					// if (page_addr) return;
 			}
+			up_read(&proc->mm->mmap_lock);
 	}
 	
 	// // 如果没有找到VMA或VMA处理失败，回退到原有处理逻辑
@@ -155,48 +157,56 @@ error:
 }
 
 //
-// implements round-robin scheduling. added @lab3_3
+// preemption point on the way back to user mode. added @lab3_3
 //
 void rrsched() {
-  int32 hartid = read_tp();
-  if (CURRENT->tick_count >= TIME_SLICE_LEN) {
-    CURRENT->tick_count = 0;
-  }
+  // 时钟节拍、唤醒或调度策略变化认为 cur 应当让出 CPU
+  if (READ_ONCE(this_rq()->need_resched)) preempt_schedule();
 }
 
 /**
  * 处理内核模式下的陷阱
- * 当在内核模式下发生异常或中断时被调用
+ * 当在内核模式下发生异常或中断时由 kernel_trap_vector 调用，tf 是内核栈上的现场
  */
 void kernel_trap_handler(struct trapframe *tf) {
 	uint64 cause = read_csr(scause);
 	uint64 epc = read_csr(sepc);
 	uint64 stval = read_csr(stval);
-	printReg(tf);
+	// 中断返回前可能切换到其他任务，它们的陷阱会覆盖 sepc/sstatus
+	uint64 status = read_csr(sstatus);
 	// 检查是否是中断（最高位为1表示中断）
 	if (cause & (1ULL << 63)) {
 	  uint64 interrupt_cause = cause & ~(1ULL << 63); // 去掉最高位获取中断类型
 	  
+	  irq_enter();
 	  // 处理不同类型的中断
 	  switch (interrupt_cause) {
 		case IRQ_S_TIMER:
-		  kprintf("内核中断: IRQ_S_TIMER (S模式计时器中断)\n");
+		  log_trace(LOG_SUB_TRAP, "内核中断: IRQ_S_TIMER (S模式计时器中断)\n");
 		  handle_mtimer_trap();
 		  break;
 		case IRQ_S_SOFT:
-		  kprintf("内核中断: IRQ_S_SOFT (S模式软件中断)\n");
-		  // 处理软件中断
+		  log_trace(LOG_SUB_TRAP, "内核中断: IRQ_S_SOFT (S模式软件中断)\n");
+		  // 其他 hart 发来的核间中断
+		  handle_ipi();
 		  break;
 		case IRQ_S_EXT:
-		  kprintf("内核中断: IRQ_S_EXT (S模式外部中断)\n");
-		  // 处理外部中断
+		  log_trace(LOG_SUB_TRAP, "内核中断: IRQ_S_EXT (S模式外部中断)\n");
+		  plic_handle_irq();
 		  break;
 		default:
-		  kprintf("内核中断: 未知类型 (代码: %p)\n", interrupt_cause);
+		  log_warn(LOG_SUB_TRAP, "内核中断: 未知类型 (代码: %p)\n", interrupt_cause);
 		  break;
 	  }
+	  irq_exit();
+#if CONFIG_PREEMPT
+	  // 被打断的内核代码没有关抢占时，时钟节拍设置的 need_resched 在这里生效
+	  if (!preempt_count() && need_resched()) preempt_schedule();
+#endif
 	} else {
 	  // 处理异常（非中断）
+	  // 异常路径不在热路径上，只在这里打印完整的寄存器现场
+	  printReg(tf);
 	  switch (cause) {
 		case CAUSE_MISALIGNED_FETCH:
 		  kprintf("内核异常: CAUSE_MISALIGNED_FETCH (取指未对齐)\n");
@@ -209,6 +219,7 @@ void kernel_trap_handler(struct trapframe *tf) {
 		  panic("内核异常: 取指访问错误");
 		  break;
 		case CAUSE_ILLEGAL_INSTRUCTION:
+		  // 内核中 sstatus.FS 为 Off，误用浮点指令也会落到这里
 		  kprintf("内核异常: CAUSE_ILLEGAL_INSTRUCTION (非法指令)\n");
 		  kprintf("  epc = %p, stval = %p\n", epc, stval);
 		  panic("内核异常: 非法指令");
@@ -277,8 +288,9 @@ void kernel_trap_handler(struct trapframe *tf) {
 	  }
 	}
   
-	// 恢复中断
-	write_csr(sstatus, read_csr(sstatus) | SSTATUS_SIE);
+	// sret 按 SPIE 恢复被打断代码的中断状态
+	write_csr(sepc, epc);
+	write_csr(sstatus, status);
   }
 
 
@@ -287,12 +299,17 @@ void kernel_trap_handler(struct trapframe *tf) {
 // happens in S-mode.
 //
 void user_trap_handler(struct trapframe *tf) {
-  int32 hartid = read_tp();
+  int32 hartid = smp_processor_id();
   // make sure we are in User mode before entering the trap handling.
   // we will consider other previous case in lab1_3 (interrupt).
 
 
   assert(CURRENT);
+  // 此后内核中的陷阱走 kernel_trap_vector，直到 ret_to_user 换回来
+  extern char kernel_trap_vector[];
+  write_csr(stvec, (uint64)kernel_trap_vector);
+  // 记下用户态的浮点状态，内核中不使用浮点单元
+  fpu_enter_kernel(CURRENT);
   // save user process counter.
   CURRENT->trapframe->epc = read_csr(sepc);
 
@@ -303,13 +320,27 @@ void user_trap_handler(struct trapframe *tf) {
   // use switch-case instead of if-else, as there are many cases since lab2_3.
   switch (cause) {
   case CAUSE_USER_ECALL:
+#if CONFIG_PREEMPT
+    // 现场已经保存，系统调用期间允许中断，长时间的系统调用也能被时钟节拍抢占
+    intr_on();
+#endif
     handle_syscall(CURRENT->trapframe);
     // kprintf("coming back from syscall\n");
     break;
-  case CAUSE_MTIMER_S_TRAP:
+  case CAUSE_STIMER_S_TRAP:
+    irq_enter();
     handle_mtimer_trap();
-    // invoke round-robin scheduler. added @lab3_3
-    rrsched();
+    irq_exit();
+    break;
+  case CAUSE_MTIMER_S_TRAP:
+    irq_enter();
+    handle_ipi();
+    irq_exit();
+    break;
+  case CAUSE_SEXT_S_TRAP:
+    irq_enter();
+    plic_handle_irq();
+    irq_exit();
     break;
   case CAUSE_STORE_PAGE_FAULT:
   case CAUSE_LOAD_PAGE_FAULT:
@@ -317,17 +348,24 @@ void user_trap_handler(struct trapframe *tf) {
     // call handle_user_page_fault to process page faults
     handle_user_page_fault(cause, read_csr(sepc), read_csr(stval));
     break;
+  case CAUSE_ILLEGAL_INSTRUCTION:
+    // 浮点单元关闭时第一次使用浮点指令：装载现场后重新执行，epc 不变
+    if (fpu_handle_first_use(CURRENT)) break;
+    kprintf("smode_trap_handler(): illegal instruction %p\n", read_csr(stval));
+    kprintf("            sepc=%p\n", read_csr(sepc));
+    panic("unexpected exception happened.\n");
+    break;
   default:
     kprintf("smode_trap_handler(): unexpected scause %p\n", read_csr(scause));
     kprintf("            sepc=%p stval=%p\n", read_csr(sepc), read_csr(stval));
     panic("unexpected exception happened.\n");
     break;
   }
-  write_csr(sstatus, read_csr(sstatus) | SSTATUS_SIE);
+  // 返回用户态前的抢占点：时钟节拍、设备中断或系统调用都可能让更高优先级的任务就绪
+  rrsched();
 
-  // kprintf("calling switch_to, current = 0x%x\n", current);
   // continue (come back to) the execution of current process.
-  switch_to(CURRENT);
+  ret_to_user(CURRENT);
 }
 
 
@@ -1,18 +1,205 @@
+#include <kernel/completion.h>
+#include <kernel/futex.h>
+#include <kernel/mm/uaccess.h>
 #include <kernel/sched.h>
 #include <kernel/vfs.h>
 #include <kernel/syscall/syscall.h>
 #include <kernel/mmu.h>
 #include <kernel/util.h>
 
+extern char ret_from_fork[];
 
 int64 sys_clone(uint64 flags, uint64 stack, uint64 ptid, uint64 tls, uint64 ctid) {
 	/* Implementation here */
 	return do_clone(flags, stack, ptid, tls, ctid);
 }
 
-int64 do_clone(uint64 flags, uint64 stack, uint64 ptid, uint64 tls, uint64 ctid){
+int64 sys_set_tid_address(int32* tidptr) {
+	CURRENT->clear_child_tid = tidptr;
+	return CURRENT->pid;
+}
+
+int64 sys_gettid(void) { return CURRENT->pid; }
+
+// 归还 copy_process 已经取得的资源，任务还没有对外可见
+static void free_unborn_task(struct task_struct* p) {
+	if (p->sighand) sighand_put(p->sighand);
+	if (p->fdtable) fdtable_unref(p->fdtable);
+	if (p->fs) fs_struct_unref(p->fs);
+	if (p->mm) mmput(p->mm);
+	kfree(p->trapframe);
+	kfree((void*)ROUNDDOWN(p->kstack, PAGE_SIZE));
+	free_empty_process(p);
+}
+
+/*
+ * 按 clone_flags 共享或复制调用者的资源：共享的结构只增加引用计数，
+ * 不共享的复制一份。调用者是 CURRENT。
+ */
+static struct task_struct* copy_process(uint64 clone_flags, uint64 stack, uint64 tls) {
+	struct task_struct* parent = CURRENT;
+	struct task_struct* p = alloc_empty_process();
+	if (!p) return NULL;
+
+	p->kstack = (uint64)alloc_kernel_stack();
+	p->trapframe = (struct trapframe*)kmalloc(sizeof(struct trapframe));
+	if (!p->trapframe) goto fail;
+
+	// 子任务从 clone 的下一条指令返回用户态，返回值为 0
+	memcpy(p->trapframe, parent->trapframe, sizeof(struct trapframe));
+	p->trapframe->regs.a0 = 0;
+	if (stack) p->trapframe->regs.sp = stack;
+	if (clone_flags & CLONE_SETTLS) p->trapframe->regs.tp = tls;
+	p->context.ra = (uint64)ret_from_fork;
+	p->context.sp = p->kstack;
+	fpu_copy_task(p, parent);
+	p->flags = parent->flags & PF_USED_MATH;
+	sched_fork(p, parent);
+
+	if (clone_flags & CLONE_VM) {
+		mmget(parent->mm);
+		p->mm = parent->mm;
+	} else {
+		down_read(&parent->mm->mmap_lock);
+		p->mm = dup_mm(parent->mm);
+		up_read(&parent->mm->mmap_lock);
+		if (!p->mm) goto fail;
+	}
+
+	if (clone_flags & CLONE_FS) {
+		atomic_inc(&parent->fs->count);
+		p->fs = parent->fs;
+	} else if (!(p->fs = copy_fs_struct(parent->fs))) {
+		goto fail;
+	}
+
+	p->fdtable = (clone_flags & CLONE_FILES) ? fdtable_acquire(parent->fdtable) : fdtable_copy(parent->fdtable);
+	if (!p->fdtable) goto fail;
+
+	if (clone_flags & CLONE_SIGHAND) {
+		sighand_get(parent->sighand);
+		p->sighand = parent->sighand;
+	} else if (!(p->sighand = sighand_copy(parent->sighand))) {
+		goto fail;
+	}
+	p->blocked = parent->blocked;
+
+	p->uid = parent->uid;
+	p->euid = parent->euid;
+	p->gid = parent->gid;
+	p->egid = parent->egid;
+
+	p->pid = pid_alloc();
+	if (p->pid < 0) goto fail;
+	attach_pid(p);
+	return p;
+
+fail:
+	free_unborn_task(p);
+	return NULL;
+}
+
+/**
+ * do_clone - 创建子进程或线程
+ * @flags: CLONE_* 标志，低 8 位是子进程退出时发给父进程的信号
+ * @stack: 子任务的用户栈顶，为 0 时沿用调用者的 sp
+ * @ptid: CLONE_PARENT_SETTID 时写入子任务 tid 的地址
+ * @tls: CLONE_SETTLS 时子任务的 tp
+ * @ctid: CLONE_CHILD_SETTID/CLONE_CHILD_CLEARTID 使用的子任务地址
+ *
+ * CLONE_THREAD 创建的线程加入调用者的线程组，共享 tgid，退出时自行释放，不通知父进程。
+ * CLONE_VM|CLONE_VFORK 不复制地址空间，调用者睡眠到子进程 exec 或退出为止，
+ * 这是 vfork() 和 posix_spawn() 的快速路径。
+ *
+ * Returns: 子任务的 tid，失败返回负的错误码
+ */
+int64 do_clone(uint64 flags, uint64 stack, uint64 ptid, uint64 tls, uint64 ctid) {
+	struct task_struct* parent = CURRENT;
+	struct completion vfork;
+
+	// 线程共享信号处理函数，共享信号处理函数要求共享地址空间
+	if ((flags & CLONE_THREAD) && !(flags & CLONE_SIGHAND)) return -EINVAL;
+	if ((flags & CLONE_SIGHAND) && !(flags & CLONE_VM)) return -EINVAL;
+	if (!parent->trapframe) return -EINVAL;
+
+	struct task_struct* p = copy_process(flags, stack, tls);
+	if (!p) return -ENOMEM;
+
+	if (flags & CLONE_CHILD_SETTID) p->set_child_tid = (int32*)ctid;
+	if (flags & CLONE_CHILD_CLEARTID) p->clear_child_tid = (int32*)ctid;
+	if (flags & CLONE_VFORK) {
+		init_completion(&vfork);
+		p->vfork_done = &vfork;
+	}
+
+	spinlock_lock(&tasklist_lock);
+	if (flags & CLONE_THREAD) {
+		p->tgid = parent->tgid;
+		p->group_leader = parent->group_leader;
+		p->parent = parent->parent;
+		p->exit_signal = -1;
+		list_add_tail(&p->thread_group, &p->group_leader->thread_group);
+	} else {
+		p->tgid = p->pid;
+		p->parent = (flags & CLONE_PARENT) ? parent->parent : parent;
+		p->exit_signal = flags & CSIGNAL;
+		if (p->parent) list_add_tail(&p->sibling, &p->parent->children);
+	}
+	spinlock_unlock(&tasklist_lock);
+
+	// 子任务还没有运行，*ctid 直接写进它的地址空间
+	if (flags & CLONE_PARENT_SETTID) copy_to_user((void*)ptid, &p->pid, sizeof(int32));
+	if (flags & CLONE_CHILD_SETTID) mm_copy_to_user(p->mm, ctid, &p->pid, sizeof(int32));
+
+	// 子任务开始运行后可能随时退出，先记下 tid
+	pid_t tid = p->pid;
+	log_debug(LOG_SUB_SCHED, "clone: %d -> %d (tgid %d, flags 0x%lx)\n", parent->pid, tid, p->tgid, flags);
+	wake_up_new_task(p);
+
+	// 子进程借用着调用者的地址空间和用户栈，它放手之前调用者不能回到用户态
+	if (flags & CLONE_VFORK) wait_for_completion(&vfork);
+	return tid;
+}
+
+/**
+ * mm_release - 任务放弃地址空间前调用
+ *
+ * 设置了 clear_child_tid 时把它清零并唤醒一个等在上面的 futex 等待者，
+ * pthread_join 就是这样等到线程结束的；vfork 出的子进程在这里放行父进程。
+ */
+void mm_release(struct task_struct* tsk) {
+	int32* tidptr = tsk->clear_child_tid;
+	if (tidptr) {
+		tsk->clear_child_tid = NULL;
+		// 地址空间还有其他使用者时才有人等待，等待者是同一地址空间的线程
+		// tidptr 在私有映射中，不论等待者是否带 FUTEX_PRIVATE_FLAG 都会得到同一个私有键
+		if (atomic_read(&tsk->mm->mm_users) > 1) {
+			int32 zero = 0;
+			if (!copy_to_user(tidptr, &zero, sizeof(zero)))
+				futex_wake((uint32*)tidptr, FUTEX_PRIVATE_FLAG, 1, FUTEX_BITSET_MATCH_ANY);
+		}
+	}
+
+	// vfork_done 在父进程的栈上，complete() 返回后就不能再访问
+	struct completion* vfork_done = tsk->vfork_done;
+	if (vfork_done) {
+		tsk->vfork_done = NULL;
+		complete(vfork_done);
+	}
+}
 
+/**
+ * exec_mmap - exec 装入新映像之后换上新的地址空间
+ * @mm: 已经装好新映像的地址空间
+ *
+ * 旧地址空间可能与 vfork 的父进程或其他 CLONE_VM 的任务共用，
+ * 只放弃自己的引用；vfork 的父进程从这里开始继续运行。
+ */
+void exec_mmap(struct mm_struct* mm) {
+	struct task_struct* tsk = CURRENT;
+	struct mm_struct* old_mm = tsk->mm;
 
-	// TODO: clone
-	return 0;
+	mm_release(tsk);
+	tsk->mm = mm;
+	mmput(old_mm);
 }
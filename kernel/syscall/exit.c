@@ -1,18 +1,392 @@
+#include <kernel/config.h>
 #include <kernel/sched.h>
+#include <kernel/time.h>
 #include <kernel/vfs.h>
+#include <kernel/mm/uaccess.h>
 #include <kernel/syscall/syscall.h>
 #include <kernel/mmu.h>
 #include <kernel/util.h>
 
+/*
+ * 用户态 siginfo_t 中 SIGCHLD 用到的部分，布局与 Linux/musl 一致，共 128 字节。
+ * 内核自己的 siginfo_t 与用户态布局不同，不能直接复制出去。
+ */
+struct siginfo_chld {
+	int32 si_signo;
+	int32 si_errno;
+	int32 si_code;
+	int32 __pad0;
+	pid_t si_pid;
+	uid_t si_uid;
+	int32 si_status;
+	int32 __pad1;
+	int64 si_utime; // 时钟节拍
+	int64 si_stime;
+	uint8 __pad2[128 - 48];
+};
 
+/* wait4/waitid 共用的参数与结果 */
+struct wait_opts {
+	int32 type; // P_ALL 或 P_PID
+	pid_t pid;
+	int32 options;
+	// 在 tasklist_lock 下从找到的子进程中取出
+	struct task_struct* reaped; // 已经摘下、等待释放的子进程，WNOWAIT 时为 NULL
+	uid_t uid;
+	int32 exit_code;
+	uint64 runtime; // 子进程及其已回收后代的运行时间（纳秒）
+};
 
+int64 sys_exit(int32 status) { do_exit((status & 0xff) << 8); }
 
-int64 sys_exit(int32 status) {
-	/* Implementation here */
-	return do_exit(status);
+int64 sys_exit_group(int32 status) { do_group_exit((status & 0xff) << 8); }
+
+/*
+ * 释放已经回收的僵尸进程。它可能刚调用 schedule() 还没有切换出去，
+ * 等它离开 CPU 之后才能释放内核栈
+ */
+static void reap_task(struct task_struct* p) {
+	while (READ_ONCE(p->on_cpu)) {
+	}
+	release_task(p);
+}
+
+/*
+ * 线程组全部退出后通知父进程：发送 exit_signal，唤醒在 wait 中等待的线程。
+ * 父进程忽略 SIGCHLD 或设置了 SA_NOCLDWAIT 时不保留僵尸进程。
+ * 调用者持有 tasklist_lock。
+ *
+ * Returns: 1 表示不需要等父进程回收，由调用者释放 tsk
+ */
+static int32 do_notify_parent(struct task_struct* tsk) {
+	struct task_struct* parent = tsk->parent;
+	struct sighand_struct* psig = parent->sighand;
+	int32 sig = tsk->exit_signal;
+	int32 autoreap = 0;
+
+	if (sig == SIGCHLD) {
+		spinlock_lock(&psig->siglock);
+		struct sigaction* act = &psig->action[SIGCHLD - 1];
+		if (act->sa_handler == SIG_IGN || (act->sa_flags & SA_NOCLDWAIT)) autoreap = 1;
+		spinlock_unlock(&psig->siglock);
+	}
+	if (sig > 0) send_sig(sig, parent);
+	// 同一线程组的线程都在主线程的 wait_chldexit 上等待
+	wake_up_interruptible_all(&parent->group_leader->wait_chldexit);
+	return autoreap;
+}
+
+/*
+ * 退出任务的子进程交给谁：同一线程组中还没有退出的线程，否则交给 child_reaper。
+ * 调用者持有 tasklist_lock
+ */
+static struct task_struct* find_new_reaper(struct task_struct* tsk) {
+	struct task_struct* t;
+	for (t = next_thread(tsk); t != tsk; t = next_thread(t)) {
+		if (!(t->flags & PF_EXITING)) return t;
+	}
+	return child_reaper;
+}
+
+// 把子进程过继出去，其中的僵尸进程要让新的父进程知道。调用者持有 tasklist_lock
+static void forget_original_parent(struct task_struct* tsk) {
+	struct task_struct *p, *n;
+	struct task_struct* reaper = find_new_reaper(tsk);
+	int32 zombie = 0;
+
+	list_for_each_entry_safe(p, n, &tsk->children, sibling) {
+		p->parent = reaper;
+		list_move_tail(&p->sibling, &reaper->children);
+		if (p->exit_state == EXIT_ZOMBIE) zombie = 1;
+	}
+	if (zombie) wake_up_interruptible_all(&reaper->group_leader->wait_chldexit);
+}
+
+/*
+ * 线程组中非主线程的退出：放弃共享资源的引用后切换出去，不通知父进程，
+ * task_struct 由 finish_task_switch 释放。主线程已经退出时，
+ * 最后一个线程代它通知父进程。
+ */
+static void exit_thread(struct task_struct* tsk) {
+	struct task_struct* leader = tsk->group_leader;
+	int32 reap_leader = 0;
+
+	tsk->flags |= PF_EXITING;
+	mm_release(tsk);
+
+	spinlock_lock(&tasklist_lock);
+	forget_original_parent(tsk);
+	list_del_init(&tsk->thread_group);
+	leader->exit_runtime += tsk->se.sum_exec_runtime;
+	if (leader->exit_state == EXIT_ZOMBIE && thread_group_empty(leader) && do_notify_parent(leader)) {
+		leader->exit_state = EXIT_DEAD;
+		list_del_init(&leader->sibling);
+		reap_leader = 1;
+	}
+	spinlock_unlock(&tasklist_lock);
+	if (reap_leader) reap_task(leader);
+
+	sighand_put(tsk->sighand);
+	tsk->sighand = NULL;
+	fdtable_unref(tsk->fdtable);
+	tsk->fdtable = NULL;
+	fs_struct_unref(tsk->fs);
+	tsk->fs = NULL;
+	// 内核态使用内核页表，放弃 mm 之后仍可以继续执行到 schedule()
+	struct mm_struct* mm = tsk->mm;
+	tsk->mm = NULL;
+	mmput(mm);
+
+	// 从这里到切换出去不能被抢占，否则 TASK_DEAD 的线程会被当作可运行任务调度
+	preempt_disable();
+	tsk->state = TASK_DEAD;
+	schedule();
+	panic("exit_thread: dead task rescheduled\n");
+}
+
+/*
+ * 主线程成为僵尸进程。其他线程都已退出时通知父进程，父进程不回收时
+ * 标记为自行释放，切换出去之后由 finish_task_switch 释放
+ */
+static void exit_notify(struct task_struct* tsk, int32 code) {
+	spinlock_lock(&tasklist_lock);
+	forget_original_parent(tsk);
+	// 整个线程组退出时使用 do_group_exit 记下的退出码
+	if (!(tsk->signal_flags & SIGNAL_GROUP_EXIT)) tsk->exit_code = code;
+	tsk->exit_state = EXIT_ZOMBIE;
+	if (thread_group_empty(tsk) && do_notify_parent(tsk)) {
+		tsk->exit_state = EXIT_DEAD;
+		list_del_init(&tsk->sibling);
+		tsk->exit_signal = -1;
+	}
+	spinlock_unlock(&tasklist_lock);
+}
+
+/**
+ * do_exit - 当前任务退出，不返回
+ * @code: wait 状态，正常退出为 (status & 0xff) << 8，被信号杀死为信号值
+ *
+ * 主线程放弃地址空间、文件和信号处理函数后成为僵尸进程，只留下 task_struct、
+ * pid 和内核栈，等父进程 wait 时释放。
+ */
+void do_exit(int32 code) {
+	struct task_struct* tsk = CURRENT;
+	if (!thread_group_leader(tsk)) exit_thread(tsk);
+	if (tsk == child_reaper) panic("do_exit: init exited with code 0x%x\n", code);
+
+	tsk->flags |= PF_EXITING;
+	// 放行 vfork 的父进程，唤醒等在 clear_child_tid 上的线程
+	mm_release(tsk);
+
+	struct mm_struct* mm = tsk->mm;
+	tsk->mm = NULL;
+	mmput(mm);
+	fdtable_unref(tsk->fdtable);
+	tsk->fdtable = NULL;
+	fs_struct_unref(tsk->fs);
+	tsk->fs = NULL;
+
+	// 成为僵尸进程之后父进程随时可能回收，从这里到切换出去不能被抢占
+	preempt_disable();
+	exit_notify(tsk, code);
+	sighand_put(tsk->sighand);
+	tsk->sighand = NULL;
+
+	tsk->state = TASK_DEAD;
+	schedule();
+	panic("do_exit: dead task rescheduled\n");
+}
+
+/**
+ * do_group_exit - 整个线程组退出，不返回
+ * @code: 同 do_exit
+ *
+ * 给组内其他线程发 SIGKILL，它们在返回用户态前处理信号时也来到这里，
+ * 使用第一个调用者记下的退出码。
+ */
+void do_group_exit(int32 code) {
+	struct task_struct* tsk = CURRENT;
+	struct task_struct* leader = tsk->group_leader;
+	struct task_struct* t;
+
+	spinlock_lock(&tasklist_lock);
+	if (leader->signal_flags & SIGNAL_GROUP_EXIT) {
+		code = leader->exit_code;
+	} else {
+		leader->signal_flags |= SIGNAL_GROUP_EXIT;
+		leader->exit_code = code;
+		for (t = next_thread(tsk); t != tsk; t = next_thread(t)) {
+			if (!t->exit_state) send_sig(SIGKILL, t);
+		}
+	}
+	spinlock_unlock(&tasklist_lock);
+	do_exit(code);
+}
+
+// p 是不是 wo 要等的子进程
+static int32 eligible_child(struct wait_opts* wo, struct task_struct* p) {
+	if (wo->type == P_PID && p->pid != wo->pid) return 0;
+	// 默认只等退出时发 SIGCHLD 的子进程，__WCLONE 只等其他的，__WALL 都等
+	if (wo->options & __WALL) return 1;
+	return (p->exit_signal == SIGCHLD) != !!(wo->options & __WCLONE);
+}
+
+/*
+ * 在调用者线程组的子进程中找一个整个线程组都已退出的僵尸进程，结果记在 wo 中。
+ * 不是 WNOWAIT 时同时把它摘下来，其他等待者不会再看到它。
+ *
+ * Returns: 子进程的 pid；有匹配的子进程但还没有退出时为 0；没有匹配的子进程时为 -ECHILD
+ */
+static int64 wait_scan_children(struct wait_opts* wo) {
+	struct task_struct* leader = CURRENT->group_leader;
+	struct task_struct *t, *p;
+	int64 ret = -ECHILD;
+
+	spinlock_lock(&tasklist_lock);
+	t = (wo->options & __WNOTHREAD) ? CURRENT : leader;
+	do {
+		list_for_each_entry(p, &t->children, sibling) {
+			if (!eligible_child(wo, p)) continue;
+			ret = 0;
+			if (!(wo->options & WEXITED)) continue;
+			if (p->exit_state != EXIT_ZOMBIE || !thread_group_empty(p)) continue;
+
+			wo->uid = p->uid;
+			wo->exit_code = p->exit_code;
+			wo->runtime = p->se.sum_exec_runtime + p->exit_runtime + p->children_runtime;
+			if (!(wo->options & WNOWAIT)) {
+				p->exit_state = EXIT_DEAD;
+				list_del_init(&p->sibling);
+				leader->children_runtime += wo->runtime;
+				wo->reaped = p;
+			}
+			ret = p->pid;
+			goto out;
+		}
+	} while (!(wo->options & __WNOTHREAD) && (t = next_thread(t)) != leader);
+out:
+	spinlock_unlock(&tasklist_lock);
+	return ret;
+}
+
+/*
+ * 子进程退出时 do_notify_parent 唤醒主线程的 wait_chldexit，
+ * 没有可回收的子进程时睡在上面，不轮询。
+ *
+ * Returns: 子进程的 pid，WNOHANG 时没有可回收的子进程返回 0，失败返回负的错误码
+ */
+static int64 do_wait(struct wait_opts* wo) {
+	int64 ret = 0;
+	wo->reaped = NULL;
+
+	if (wo->options & WNOHANG) {
+		ret = wait_scan_children(wo);
+	} else {
+		int64 err = wait_event_interruptible(CURRENT->group_leader->wait_chldexit, (ret = wait_scan_children(wo)) != 0);
+		if (err) return err;
+	}
+
+	if (wo->reaped) reap_task(wo->reaped);
+	return ret;
 }
 
-int64 do_exit(int32 status) {
-	// TODO: Implement the exit logic
+// 还没有区分用户态和内核态时间，全部算作用户态
+static void fill_rusage(struct rusage* ru, uint64 runtime) {
+	memset(ru, 0, sizeof(*ru));
+	ru->ru_utime.tv_sec = runtime / NSEC_PER_SEC;
+	ru->ru_utime.tv_usec = (runtime % NSEC_PER_SEC) / NSEC_PER_USEC;
+}
+
+/**
+ * kernel_wait4 - 等待子进程退出并回收
+ * @pid: 大于 0 时只等这个子进程，否则等任意子进程
+ * @wstatus: 不为 NULL 时存放 wait 状态（内核地址）
+ * @options: WNOHANG/__WALL/__WCLONE/__WNOTHREAD，WUNTRACED 和 WCONTINUED 接受但不会等到
+ * @ru: 不为 NULL 时存放子进程的资源使用情况（内核地址）
+ *
+ * 还没有进程组，所有进程都在同一个组里，pid 为 0 和小于 -1 时与 -1 相同。
+ *
+ * Returns: 子进程的 pid，WNOHANG 时没有可回收的子进程返回 0，失败返回负的错误码
+ */
+int64 kernel_wait4(pid_t pid, int32* wstatus, int32 options, struct rusage* ru) {
+	if (options & ~(WNOHANG | WUNTRACED | WCONTINUED | __WNOTHREAD | __WCLONE | __WALL)) return -EINVAL;
+
+	struct wait_opts wo = {
+	    .type = pid > 0 ? P_PID : P_ALL,
+	    .pid = pid,
+	    .options = options | WEXITED,
+	};
+	int64 ret = do_wait(&wo);
+	if (ret > 0) {
+		if (wstatus) *wstatus = wo.exit_code;
+		if (ru) fill_rusage(ru, wo.runtime);
+	}
+	return ret;
+}
+
+int64 sys_wait4(pid_t pid, int32* wstatus, int32 options, struct rusage* rusage) {
+	int32 status;
+	struct rusage ru;
+
+	int64 ret = kernel_wait4(pid, wstatus ? &status : NULL, options, rusage ? &ru : NULL);
+	if (ret > 0) {
+		if (wstatus && copy_to_user(wstatus, &status, sizeof(status))) return -EFAULT;
+		if (rusage && copy_to_user(rusage, &ru, sizeof(ru))) return -EFAULT;
+	}
+	return ret;
+}
+
+/**
+ * sys_waitid - 按 idtype/id 等待子进程，结果以 siginfo 的形式返回
+ *
+ * 只会等到 CLD_EXITED 和 CLD_KILLED。WNOHANG 时没有可回收的子进程，
+ * infop 清零后返回 0，调用者通过 si_pid 为 0 判断。
+ */
+int64 sys_waitid(int32 idtype, pid_t id, void* infop, int32 options, struct rusage* rusage) {
+	if (options & ~(WNOHANG | WNOWAIT | WEXITED | WSTOPPED | WCONTINUED | __WNOTHREAD | __WCLONE | __WALL))
+		return -EINVAL;
+	if (!(options & (WEXITED | WSTOPPED | WCONTINUED))) return -EINVAL;
+
+	struct wait_opts wo = {.pid = id, .options = options};
+	switch (idtype) {
+	case P_ALL:
+		wo.type = P_ALL;
+		break;
+	case P_PID:
+		if (id <= 0) return -EINVAL;
+		wo.type = P_PID;
+		break;
+	case P_PGID:
+		// 所有进程都在同一个进程组里
+		wo.type = P_ALL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	int64 ret = do_wait(&wo);
+	if (ret < 0) return ret;
+
+	struct siginfo_chld info;
+	memset(&info, 0, sizeof(info));
+	if (ret > 0) {
+		info.si_signo = SIGCHLD;
+		info.si_pid = ret;
+		info.si_uid = wo.uid;
+		if (wo.exit_code & 0x7f) {
+			info.si_code = CLD_KILLED;
+			info.si_status = wo.exit_code & 0x7f;
+		} else {
+			info.si_code = CLD_EXITED;
+			info.si_status = (wo.exit_code >> 8) & 0xff;
+		}
+		info.si_utime = wo.runtime / (NSEC_PER_SEC / HZ);
+	}
+	if (infop && copy_to_user(infop, &info, sizeof(info))) return -EFAULT;
+	if (ret > 0 && rusage) {
+		struct rusage ru;
+		fill_rusage(&ru, wo.runtime);
+		if (copy_to_user(rusage, &ru, sizeof(ru))) return -EFAULT;
+	}
 	return 0;
-}
\ No newline at end of file
+}
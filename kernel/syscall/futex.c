@@ -0,0 +1,19 @@
+#include <kernel/futex.h>
+#include <kernel/mm/uaccess.h>
+#include <kernel/sched.h>
+#include <kernel/syscall/syscall.h>
+#include <kernel/util.h>
+
+/*
+ * 第四个参数对等待类操作是指向超时的指针，对 requeue 类操作是最大迁移数
+ */
+int64 sys_futex(uint32* uaddr, int32 op, uint32 val, uint64 timeout_or_val2, uint32* uaddr2, uint32 val3) {
+	struct timespec ts, *timeout = NULL;
+	int32 cmd = op & FUTEX_CMD_MASK;
+
+	if ((cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_BITSET) && timeout_or_val2) {
+		if (copy_from_user(&ts, (void*)timeout_or_val2, sizeof(ts))) return -EFAULT;
+		timeout = &ts;
+	}
+	return do_futex(uaddr, op, val, timeout, uaddr2, (uint32)timeout_or_val2, val3);
+}
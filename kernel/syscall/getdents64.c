@@ -81,7 +81,7 @@ int32 do_getdents64(int32 fd, struct linux_dirent* dirp, size_t count) {
 	if (!file) return -EBADF;
 
 	/* Check if file is a directory */
-	if (!S_ISDIR(file->f_inode->i_mode)) return -ENOTDIR;
+	if (!file->f_dentry || !S_ISDIR(file->f_inode->i_mode)) return -ENOTDIR;
 
 	/* Setup the callback structure */
 	struct getdents_callback buf;
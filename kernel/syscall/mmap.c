@@ -15,8 +15,11 @@ int64 do_mmap(void* addr, size_t length, int32 prot, int32 flags, int32 fd, off_
 	CHECK_PTR_VALID(file,-EBADF);
 
 
-	/* Implementation here */
-	return mmap_file(mm, (uint64)addr, length, prot, flags,file,  offset);
+	/* MAP_POPULATE 会在持锁期间读文件，这里不能用自旋锁 */
+	down_write(&mm->mmap_lock);
+	int64 ret = mmap_file(mm, (uint64)addr, length, prot, flags,file,  offset);
+	up_write(&mm->mmap_lock);
+	return ret;
 }
 
 
@@ -54,8 +54,16 @@ ssize_t file_read(struct file *filp, char *buf, size_t count, loff_t *ppos) {
         return -EBADF;
     
     // If the file has a read method, call it
-    if (filp->f_op->read)
-        return filp->f_op->read(filp, buf, count, ppos);
+    // 普通文件的读者之间共享 i_rwsem，只和写者互斥
+    if (filp->f_op->read) {
+        // timerfd 这类匿名文件没有 dentry
+        struct inode* inode = filp->f_dentry ? filp->f_inode : NULL;
+        if (!inode || !is_file(inode->i_mode)) return filp->f_op->read(filp, buf, count, ppos);
+        down_read(&inode->i_rwsem);
+        ssize_t ret = filp->f_op->read(filp, buf, count, ppos);
+        up_read(&inode->i_rwsem);
+        return ret;
+    }
     // Otherwise, try using read_iter if available
     else {
 		return -ENOSYS;
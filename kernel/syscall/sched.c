@@ -0,0 +1,161 @@
+#include <kernel/sched.h>
+#include <kernel/mm/uaccess.h>
+#include <kernel/syscall/syscall.h>
+#include <kernel/util.h>
+
+/*
+ * pid 为 0 表示调用者自己。返回的任务带着引用，用完后 put_task_struct
+ */
+static struct task_struct* find_task_get(pid_t pid) {
+	struct task_struct* p;
+
+	if (!pid) {
+		p = current_task();
+		get_task_struct(p);
+		return p;
+	}
+	p = find_process_by_pid(pid);
+	return p ? p : ERR_PTR(-ESRCH);
+}
+
+/*
+ * 目前只支持 PRIO_PROCESS，who 为 0 表示调用者自己
+ */
+static struct task_struct* prio_find_task(int32 which, int32 who) {
+	if (which != PRIO_PROCESS) return ERR_PTR(-EINVAL);
+	return find_task_get(who);
+}
+
+int64 sys_setpriority(int32 which, int32 who, int32 niceval) { return do_setpriority(which, who, niceval); }
+
+int64 sys_getpriority(int32 which, int32 who) { return do_getpriority(which, who); }
+
+int64 do_setpriority(int32 which, int32 who, int32 niceval) {
+	struct task_struct* p = prio_find_task(which, who);
+	int64 ret;
+	if (PTR_IS_ERROR(p)) return PTR_ERR(p);
+
+	niceval = MAX(MIN_NICE, MIN(niceval, MAX_NICE));
+	// 只有 root 可以提高优先级
+	if (niceval < task_nice(p) && current_task()->euid != 0)
+		ret = -EACCES;
+	else
+		ret = set_user_nice(p, niceval);
+	put_task_struct(p);
+	return ret;
+}
+
+/*
+ * 与 Linux 相同，返回 20 - nice（范围 1..40）以避开错误码，由 libc 换算回 nice
+ */
+int64 do_getpriority(int32 which, int32 who) {
+	struct task_struct* p = prio_find_task(which, who);
+	if (PTR_IS_ERROR(p)) return PTR_ERR(p);
+	int64 ret = 20 - task_nice(p);
+	put_task_struct(p);
+	return ret;
+}
+
+static struct task_struct* sched_find_task(pid_t pid) {
+	if (pid < 0) return ERR_PTR(-EINVAL);
+	return find_task_get(pid);
+}
+
+int64 sys_sched_setscheduler(pid_t pid, int32 policy, const struct sched_param* param) {
+	struct sched_param kparam;
+	if (!param) return -EINVAL;
+	if (copy_from_user(&kparam, param, sizeof(kparam))) return -EFAULT;
+	return do_sched_setscheduler(pid, policy, &kparam);
+}
+
+int64 sys_sched_setparam(pid_t pid, const struct sched_param* param) {
+	struct sched_param kparam;
+	if (!param) return -EINVAL;
+	if (copy_from_user(&kparam, param, sizeof(kparam))) return -EFAULT;
+	// 保持原来的调度策略
+	return do_sched_setscheduler(pid, -1, &kparam);
+}
+
+int64 sys_sched_getscheduler(pid_t pid) {
+	struct task_struct* p = sched_find_task(pid);
+	if (PTR_IS_ERROR(p)) return PTR_ERR(p);
+	int64 policy = p->policy;
+	put_task_struct(p);
+	return policy;
+}
+
+int64 sys_sched_getparam(pid_t pid, struct sched_param* param) {
+	if (!param) return -EINVAL;
+	struct task_struct* p = sched_find_task(pid);
+	if (PTR_IS_ERROR(p)) return PTR_ERR(p);
+
+	struct sched_param kparam = {.sched_priority = p->rt_priority};
+	put_task_struct(p);
+	if (copy_to_user(param, &kparam, sizeof(kparam))) return -EFAULT;
+	return 0;
+}
+
+int64 sys_sched_yield(void) {
+	sched_yield();
+	return 0;
+}
+
+int64 sys_sched_get_priority_max(int32 policy) {
+	if (rt_policy(policy)) return MAX_USER_RT_PRIO - 1;
+	if (policy == SCHED_NORMAL || policy == SCHED_BATCH || policy == SCHED_IDLE) return 0;
+	return -EINVAL;
+}
+
+int64 sys_sched_get_priority_min(int32 policy) {
+	if (rt_policy(policy)) return 1;
+	if (policy == SCHED_NORMAL || policy == SCHED_BATCH || policy == SCHED_IDLE) return 0;
+	return -EINVAL;
+}
+
+/*
+ * SCHED_RR 返回轮转时间片，SCHED_FIFO 没有时间片返回 0，
+ * 公平调度类的时间片随队列变化，返回调度周期作为参考
+ */
+int64 sys_sched_rr_get_interval(pid_t pid, struct timespec* interval) {
+	struct task_struct* p = sched_find_task(pid);
+	if (PTR_IS_ERROR(p)) return PTR_ERR(p);
+
+	uint64 ns = 0;
+	if (p->policy == SCHED_RR)
+		ns = sysctl_sched_rr_timeslice;
+	else if (!rt_policy(p->policy))
+		ns = sysctl_sched_latency;
+	put_task_struct(p);
+	struct timespec ts = {.tv_sec = ns / 1000000000UL, .tv_nsec = ns % 1000000000UL};
+	if (copy_to_user(interval, &ts, sizeof(ts))) return -EFAULT;
+	return 0;
+}
+
+/*
+ * 返回时可能已经被迁移到别的 hart，结果只作参考。没有 NUMA，node 总是 0
+ */
+int64 sys_getcpu(uint32* cpu, uint32* node, void* unused) {
+	uint32 c = smp_processor_id(), n = 0;
+	if (cpu && copy_to_user(cpu, &c, sizeof(c))) return -EFAULT;
+	if (node && copy_to_user(node, &n, sizeof(n))) return -EFAULT;
+	return 0;
+}
+
+/**
+ * do_sched_setscheduler - sched_setscheduler/sched_setparam 的实现
+ * @policy: 为 -1 时保持任务原来的调度策略
+ */
+int64 do_sched_setscheduler(pid_t pid, int32 policy, const struct sched_param* param) {
+	struct task_struct* p = sched_find_task(pid);
+	if (PTR_IS_ERROR(p)) return PTR_ERR(p);
+
+	int64 ret;
+	if (policy < 0) policy = p->policy;
+	// 只有 root 可以使用实时调度策略
+	if (rt_policy(policy) && current_task()->euid != 0)
+		ret = -EPERM;
+	else
+		ret = sched_setscheduler(p, policy, param);
+	put_task_struct(p);
+	return ret;
+}
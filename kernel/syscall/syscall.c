@@ -3,14 +3,12 @@
 #include <kernel/sched/process.h>
 #include <kernel/util/print.h>
 #include <kernel/syscall/syscall.h>
+#include <kernel/syscall/syscall_stat.h>
 #include <kernel/types.h>
 #include <kernel/util/string.h>
 #include <kernel/vfs.h>
 #include <syscall.h>
 
-/* Debug flag to enable syscall tracing */
-#define SYSCALL_DEBUG 0
-
 int64 sys_close(int32 fd) {
 	/* Implementation here */
 	return do_close(fd);
@@ -32,9 +30,10 @@ int64 sys_mount(const char* source, const char* target, const char* fstype, uint
 
 
 
+// 进程 id 是线程组 id，各线程的 id 用 gettid 获取
 int64 sys_getpid(void) {
 	/* Implementation here */
-	return current_task()->pid;
+	return current_task()->tgid;
 }
 
 
@@ -56,21 +55,59 @@ static struct syscall_entry syscall_table[] = {
 
     /* Process operations */
     [SYS_exit] = {(syscall_fn_t)sys_exit, "exit", 1},
+    [SYS_exit_group] = {(syscall_fn_t)sys_exit_group, "exit_group", 1},
+    [SYS_wait4] = {(syscall_fn_t)sys_wait4, "wait4", 4},
+    [SYS_waitid] = {(syscall_fn_t)sys_waitid, "waitid", 5},
     [SYS_getpid] = {(syscall_fn_t)sys_getpid, "getpid", 0},
     [SYS_getppid] = {NULL, "getppid", 0}, // Not implemented yet
+    [SYS_gettid] = {(syscall_fn_t)sys_gettid, "gettid", 0},
+    [SYS_set_tid_address] = {(syscall_fn_t)sys_set_tid_address, "set_tid_address", 1},
     [SYS_clone] = {(syscall_fn_t)sys_clone, "clone", 5},
+    [SYS_setpriority] = {(syscall_fn_t)sys_setpriority, "setpriority", 3},
+    [SYS_getpriority] = {(syscall_fn_t)sys_getpriority, "getpriority", 2},
+    [SYS_sched_setparam] = {(syscall_fn_t)sys_sched_setparam, "sched_setparam", 2},
+    [SYS_sched_setscheduler] = {(syscall_fn_t)sys_sched_setscheduler, "sched_setscheduler", 3},
+    [SYS_sched_getscheduler] = {(syscall_fn_t)sys_sched_getscheduler, "sched_getscheduler", 1},
+    [SYS_sched_getparam] = {(syscall_fn_t)sys_sched_getparam, "sched_getparam", 2},
+    [SYS_sched_yield] = {(syscall_fn_t)sys_sched_yield, "sched_yield", 0},
+    [SYS_sched_get_priority_max] = {(syscall_fn_t)sys_sched_get_priority_max, "sched_get_priority_max", 1},
+    [SYS_sched_get_priority_min] = {(syscall_fn_t)sys_sched_get_priority_min, "sched_get_priority_min", 1},
+    [SYS_sched_rr_get_interval] = {(syscall_fn_t)sys_sched_rr_get_interval, "sched_rr_get_interval", 2},
+    [SYS_getcpu] = {(syscall_fn_t)sys_getcpu, "getcpu", 3},
+    [SYS_futex] = {(syscall_fn_t)sys_futex, "futex", 6},
 
     /* Memory operations */
     [SYS_mmap] = {(syscall_fn_t)sys_mmap, "mmap", 6},
     [SYS_brk] = {NULL, "brk", 1}, // Not implemented yet
 
+    /* Logging */
+    [SYS_syslog] = {(syscall_fn_t)sys_syslog, "syslog", 3},
+
     /* Time operations */
     //[SYS_time] = {(syscall_fn_t)sys_time, "time", 1},
+    [SYS_clock_gettime] = {(syscall_fn_t)sys_clock_gettime, "clock_gettime", 2},
+    [SYS_clock_getres] = {(syscall_fn_t)sys_clock_getres, "clock_getres", 2},
+    [SYS_clock_settime] = {(syscall_fn_t)sys_clock_settime, "clock_settime", 2},
+    [SYS_gettimeofday] = {(syscall_fn_t)sys_gettimeofday, "gettimeofday", 2},
+    [SYS_nanosleep] = {(syscall_fn_t)sys_nanosleep, "nanosleep", 2},
+    [SYS_clock_nanosleep] = {(syscall_fn_t)sys_clock_nanosleep, "clock_nanosleep", 4},
+    [SYS_timerfd_create] = {(syscall_fn_t)sys_timerfd_create, "timerfd_create", 2},
+    [SYS_timerfd_settime] = {(syscall_fn_t)sys_timerfd_settime, "timerfd_settime", 4},
+    [SYS_timerfd_gettime] = {(syscall_fn_t)sys_timerfd_gettime, "timerfd_gettime", 2},
 
     /* Add more syscalls as needed */
 };
 
 #define SYSCALL_TABLE_SIZE (sizeof(syscall_table) / sizeof(syscall_table[0]))
+_Static_assert(SYSCALL_TABLE_SIZE <= SYSCALL_NR_MAX, "raise SYSCALL_NR_MAX in syscall_stat.h");
+
+/**
+ * syscall_name - 系统调用号对应的名字，未实现的返回 NULL
+ */
+const char* syscall_name(int64 syscall_num) {
+	if (syscall_num < 0 || syscall_num >= SYSCALL_TABLE_SIZE) return NULL;
+	return syscall_table[syscall_num].name;
+}
 
 /**
  * The main syscall dispatcher
@@ -79,24 +116,22 @@ long do_syscall(long syscall_num, long a0, long a1, long a2, long a3, long a4, l
 
 	/* Validate syscall number */
 	if (syscall_num < 0 || syscall_num >= SYSCALL_TABLE_SIZE || !syscall_table[syscall_num].func) {
-		kprintf("Invalid syscall: %ld\n", syscall_num);
+		log_warn(LOG_SUB_SYSCALL, "Invalid syscall: %ld\n", syscall_num);
 		return -ENOSYS;
 	}
 
 	struct syscall_entry* entry = &syscall_table[syscall_num];
 
-#if SYSCALL_DEBUG
-	/* Debug output before syscall */
-	kprintf("SYSCALL: %s(%ld, %ld, ...)\n", entry->name, a0, a1);
-#endif
+	/* Trace output before syscall, compiled out below LOG_LEVEL_TRACE */
+	log_trace(LOG_SUB_SYSCALL, "SYSCALL: %s(%ld, %ld, ...)\n", entry->name, a0, a1);
 
 	/* Execute syscall through the function pointer with type casting */
+	uint64 stat_start = syscall_stat_begin();
 	int64 ret = entry->func(a0, a1, a2, a3, a4, a5);
+	syscall_stat_end(syscall_num, stat_start);
 
-#if SYSCALL_DEBUG
-	/* Debug output after syscall */
-	kprintf("SYSCALL: %s returned %ld\n", entry->name, ret);
-#endif
+	/* Trace output after syscall */
+	log_trace(LOG_SUB_SYSCALL, "SYSCALL: %s returned %ld\n", entry->name, ret);
 
 	return ret;
 }
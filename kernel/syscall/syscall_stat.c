@@ -0,0 +1,195 @@
+#include <kernel/clocksource.h>
+#include <kernel/device/char_device.h>
+#include <kernel/mm/kmalloc.h>
+#include <kernel/sched/process.h>
+#include <kernel/sched/sched.h>
+#include <kernel/syscall/syscall.h>
+#include <kernel/syscall/syscall_stat.h>
+#include <kernel/util.h>
+#include <kernel/util/seq_buf.h>
+
+// 每个 hart 一份，只由本 hart 在 syscall_stat_end 中写入
+static DEFINE_PER_CPU(struct syscall_stat[SYSCALL_NR_MAX], syscall_stats);
+volatile int32 syscall_stat_enabled = 1;
+
+#define SYSCALL_STAT_BUF_SIZE (64 * 1024)
+
+static inline int32 stat_bucket(uint64 ns) {
+	if (ns == 0) return 0;
+	int32 b = 63 - __builtin_clzl(ns);
+	return b < SYSCALL_HIST_BUCKETS ? b : SYSCALL_HIST_BUCKETS - 1;
+}
+
+static inline void stat_account(struct syscall_stat* st, uint64 ticks, int32 bucket) {
+	st->count++;
+	st->ticks += ticks;
+	if (ticks > st->max_ticks) st->max_ticks = ticks;
+	st->hist[bucket]++;
+}
+
+static void stat_merge(struct syscall_stat* dst, const struct syscall_stat* src) {
+	dst->count += src->count;
+	dst->ticks += src->ticks;
+	if (src->max_ticks > dst->max_ticks) dst->max_ticks = src->max_ticks;
+	for (int32 i = 0; i < SYSCALL_HIST_BUCKETS; i++) dst->hist[i] += src->hist[i];
+}
+
+#if CONFIG_SYSCALL_STAT
+/**
+ * syscall_stat_end - 记录一次系统调用的耗时
+ * @nr: 系统调用号
+ * @start: syscall_stat_begin 的返回值
+ *
+ * 本 hart 的统计只有自己写，不需要加锁；系统调用期间可能被抢占，
+ * 关中断防止写到一半时被其他任务插入。
+ */
+void syscall_stat_end(int64 nr, uint64 start) {
+	if (!start) return;
+
+	uint64 ticks = read_csr(time) - start;
+	int32 bucket = stat_bucket(cycles_to_ns(ticks));
+
+	if (nr >= 0 && nr < SYSCALL_NR_MAX) {
+		uint64 flags = disable_irqsave();
+		stat_account(&(*this_cpu_ptr(&syscall_stats))[nr], ticks, bucket);
+		enable_irqrestore(flags);
+	}
+	struct task_struct* task = CURRENT;
+	if (!task) return;
+	stat_account(&task->syscall_stat, ticks, bucket);
+	if (nr < 0 || nr >= SYSCALL_NR_MAX) return;
+	// 第一次记账时分配，分配失败只丢掉按调用号的部分。读者持 tasklist_lock，
+	// 看到指针时数组已经清零
+	if (!task->syscall_counts) {
+		struct syscall_count* counts = kzalloc(SYSCALL_NR_MAX * sizeof(*counts));
+		if (!counts) return;
+		smp_wmb();
+		WRITE_ONCE(task->syscall_counts, counts);
+	}
+	task->syscall_counts[nr].count++;
+	task->syscall_counts[nr].ticks += ticks;
+}
+#endif
+
+/**
+ * syscall_stat_reset - 清零全局和所有进程的统计
+ */
+void syscall_stat_reset(void) {
+	struct task_struct* p;
+
+	int32 enabled = syscall_stat_enabled;
+	syscall_stat_enabled = 0;
+	for (int32 cpu = 0; cpu < NCPU; cpu++) memset(per_cpu_ptr(&syscall_stats, cpu), 0, sizeof(syscall_stats));
+	spinlock_lock(&tasklist_lock);
+	for_each_process(p) {
+		memset(&p->syscall_stat, 0, sizeof(p->syscall_stat));
+		if (p->syscall_counts) memset(p->syscall_counts, 0, SYSCALL_NR_MAX * sizeof(*p->syscall_counts));
+	}
+	spinlock_unlock(&tasklist_lock);
+	syscall_stat_enabled = enabled;
+}
+
+// 直方图下界 2^i ns，按 K/M/G 缩写
+static void show_hist(struct seq_buf* s, const struct syscall_stat* st) {
+	static const char units[] = " KMG";
+	seq_buf_printf(s, "    ns:");
+	for (int32 i = 0; i < SYSCALL_HIST_BUCKETS; i++) {
+		if (!st->hist[i]) continue;
+		int32 u = i / 10;
+		if (u == 0) {
+			seq_buf_printf(s, " %d:%d", 1 << i, st->hist[i]);
+		} else {
+			seq_buf_printf(s, " %d%c:%d", 1 << (i % 10), units[u], st->hist[i]);
+		}
+	}
+	seq_buf_printf(s, "\n");
+}
+
+static void show_stat(struct seq_buf* s, const struct syscall_stat* st) {
+	seq_buf_printf(s, " %10lu %12lu %10lu %10lu\n", st->count, cycles_to_ns(st->ticks) / 1000,
+	               cycles_to_ns(st->ticks) / st->count, cycles_to_ns(st->max_ticks));
+	show_hist(s, st);
+}
+
+// 系统调用名占 20 列，没有名字的按调用号显示；进程下的明细缩进两列
+static void show_name(struct seq_buf* s, int32 nr, int32 indent) {
+	const char* name = syscall_name(nr);
+	if (name) {
+		seq_buf_printf(s, indent ? "  %-18s" : "%-20s", name);
+	} else {
+		seq_buf_printf(s, indent ? "  %-18d" : "%-20d", nr);
+	}
+}
+
+static void syscall_stat_render(struct seq_buf* s) {
+	struct task_struct* task;
+	struct syscall_stat sum;
+
+	seq_buf_printf(s, "enabled: %d\n\n", syscall_stat_enabled);
+	seq_buf_printf(s, "%-20s %10s %12s %10s %10s\n", "syscall", "calls", "total_us", "avg_ns", "max_ns");
+	for (int32 nr = 0; nr < SYSCALL_NR_MAX; nr++) {
+		memset(&sum, 0, sizeof(sum));
+		for (int32 cpu = 0; cpu < NCPU; cpu++) stat_merge(&sum, &per_cpu(syscall_stats, cpu)[nr]);
+		if (!sum.count) continue;
+		show_name(s, nr, 0);
+		show_stat(s, &sum);
+	}
+
+	seq_buf_printf(s, "\n%-20s %10s %12s %10s %10s\n", "pid", "calls", "total_us", "avg_ns", "max_ns");
+	spinlock_lock(&tasklist_lock);
+	for_each_process(task) {
+		if (!task->syscall_stat.count) continue;
+		seq_buf_printf(s, "%-20d", task->pid);
+		show_stat(s, &task->syscall_stat);
+		struct syscall_count* counts = READ_ONCE(task->syscall_counts);
+		if (!counts) continue;
+		smp_rmb();
+		for (int32 nr = 0; nr < SYSCALL_NR_MAX; nr++) {
+			if (!counts[nr].count) continue;
+			show_name(s, nr, 1);
+			seq_buf_printf(s, " %10lu %12lu %10lu\n", counts[nr].count, cycles_to_ns(counts[nr].ticks) / 1000,
+			               cycles_to_ns(counts[nr].ticks) / counts[nr].count);
+		}
+	}
+	spinlock_unlock(&tasklist_lock);
+	if (s->overflow) seq_buf_printf(s, "...\n");
+}
+
+static ssize_t syscall_stat_read(struct char_device* cdev, struct file* file, char* buf, size_t count, loff_t* ppos) {
+	struct seq_buf s;
+	char* text = kmalloc(SYSCALL_STAT_BUF_SIZE);
+	if (!text) return -ENOMEM;
+
+	seq_buf_init(&s, text, SYSCALL_STAT_BUF_SIZE);
+	syscall_stat_render(&s);
+	ssize_t ret = seq_buf_read(&s, buf, count, ppos);
+	kfree(text);
+	return ret;
+}
+
+/*
+ * 写入 "off" 关闭统计，"on" 打开统计，其余任何内容都清零
+ */
+static ssize_t syscall_stat_write(struct char_device* cdev, struct file* file, const char* buf, size_t count, loff_t* ppos) {
+	if (count >= 3 && strncmp(buf, "off", 3) == 0) {
+		syscall_stat_enabled = 0;
+	} else if (count >= 2 && strncmp(buf, "on", 2) == 0) {
+		syscall_stat_enabled = 1;
+	} else {
+		syscall_stat_reset();
+	}
+	return count;
+}
+
+static const struct char_device_operations syscall_stat_ops = {
+    .read = syscall_stat_read,
+    .write = syscall_stat_write,
+};
+
+static struct char_device syscall_stat_cdev = {
+    .cd_dev = SYSCALL_STAT_DEV,
+    .cd_name = "syscall_stat",
+    .ops = &syscall_stat_ops,
+};
+
+void syscall_stat_init(void) { cdev_register(&syscall_stat_cdev); }
@@ -0,0 +1,28 @@
+#include <kernel/sched.h>
+#include <kernel/syscall/syscall.h>
+#include <kernel/mmu.h>
+#include <kernel/util.h>
+#include <kernel/util/klog.h>
+
+/**
+ * sys_syslog - 读取/控制内核日志缓冲区（glibc/musl 中的 klogctl）
+ * @type: SYSLOG_ACTION_*
+ * @buf: 用户缓冲区
+ * @len: 缓冲区长度，或 CONSOLE_LEVEL 动作的目标级别
+ */
+int64 sys_syslog(int32 type, char* buf, int32 len) {
+	if (type != SYSLOG_ACTION_READ && type != SYSLOG_ACTION_READ_ALL && type != SYSLOG_ACTION_READ_CLEAR)
+		return do_syslog(type, NULL, len);
+
+	if (!buf || len < 0) return -EINVAL;
+	if (len == 0) return 0;
+	// 一次最多读出整个缓冲区，更大的 len 不必分配
+	if (len > KLOG_BUF_SIZE) len = KLOG_BUF_SIZE;
+
+	char* kbuf = kmalloc(len);
+	if (!kbuf) return -ENOMEM;
+	int64 ret = do_syslog(type, kbuf, len);
+	if (ret > 0 && copy_to_user((void __user*)buf, kbuf, ret)) ret = -EFAULT;
+	kfree(kbuf);
+	return ret;
+}
@@ -24,3 +24,56 @@ int64 sys_time(time_t __user* tloc) {
 
     return ktime;  // 返回时间值（兼容 tloc==NULL 的场景）
 }
+
+int64 sys_clock_gettime(clockid_t clk_id, struct timespec __user* tp) {
+    struct timespec ts;
+    int32 ret = do_clock_gettime(clk_id, &ts);
+    if (ret < 0) return ret;
+    if (copy_to_user(tp, &ts, sizeof(ts))) return -EFAULT;
+    return 0;
+}
+
+int64 sys_clock_getres(clockid_t clk_id, struct timespec __user* res) {
+    struct timespec ts;
+    int32 ret = do_clock_getres(clk_id, &ts);
+    if (ret < 0) return ret;
+    // res 可以为 NULL，只检查时钟是否有效
+    if (res && copy_to_user(res, &ts, sizeof(ts))) return -EFAULT;
+    return 0;
+}
+
+int64 sys_clock_settime(clockid_t clk_id, const struct timespec __user* tp) {
+    struct timespec ts;
+    if (copy_from_user(&ts, tp, sizeof(ts))) return -EFAULT;
+    return do_clock_settime(clk_id, &ts);
+}
+
+int64 sys_gettimeofday(struct timeval __user* tv, struct timezone __user* tz) {
+    if (tv) {
+        struct timeval ktv;
+        do_gettimeofday(&ktv);
+        if (copy_to_user(tv, &ktv, sizeof(ktv))) return -EFAULT;
+    }
+    // 不维护时区，总是 UTC
+    if (tz) {
+        struct timezone ktz = {0};
+        if (copy_to_user(tz, &ktz, sizeof(ktz))) return -EFAULT;
+    }
+    return 0;
+}
+
+int64 sys_nanosleep(const struct timespec __user* req, struct timespec __user* rem) {
+    return sys_clock_nanosleep(CLOCK_MONOTONIC, 0, req, rem);
+}
+
+int64 sys_clock_nanosleep(clockid_t clk_id, int32 flags, const struct timespec __user* req,
+                          struct timespec __user* rem) {
+    struct timespec kreq, krem;
+    if (copy_from_user(&kreq, req, sizeof(kreq))) return -EFAULT;
+    int32 ret = do_clock_nanosleep(clk_id, flags, &kreq, &krem);
+    // 只有相对睡眠被信号打断时才写回剩余时间
+    if (ret == -EINTR && rem && !(flags & TIMER_ABSTIME)) {
+        if (copy_to_user(rem, &krem, sizeof(krem))) return -EFAULT;
+    }
+    return ret;
+}
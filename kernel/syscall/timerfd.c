@@ -0,0 +1,211 @@
+/*
+ * timerfd：用文件描述符读取的 hrtimer
+ *
+ * read() 阻塞到定时器至少到期一次，返回自上次读取以来到期的次数（uint64）。
+ * 周期定时器在回调中按间隔推后，错过的周期计入到期次数。
+ * 文件没有 dentry 和 inode，只存在于打开它的描述符表中。
+ */
+
+#include <kernel/hrtimer.h>
+#include <kernel/mm/kmalloc.h>
+#include <kernel/mm/uaccess.h>
+#include <kernel/sched.h>
+#include <kernel/syscall/syscall.h>
+#include <kernel/time.h>
+#include <kernel/util.h>
+#include <kernel/vfs.h>
+
+/* 与 Linux 的 <sys/timerfd.h> 相同 */
+#define TFD_TIMER_ABSTIME (1 << 0)
+#define TFD_CLOEXEC O_CLOEXEC
+#define TFD_NONBLOCK O_NONBLOCK
+
+struct timerfd_ctx {
+	struct hrtimer timer;
+	struct wait_queue_head wqh; // 读者在这里等待，它的锁同时保护下面的字段
+	uint64 ticks;               // 上次读取以来的到期次数
+	uint64 interval;            // 周期（纳秒），0 表示一次性
+};
+
+static enum hrtimer_restart timerfd_tmrproc(struct hrtimer* timer) {
+	struct timerfd_ctx* ctx = container_of(timer, struct timerfd_ctx, timer);
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+
+	int64 flags = spinlock_lock_irqsave(&ctx->wqh.lock);
+	if (ctx->interval) {
+		ctx->ticks += hrtimer_forward(timer, ktime_get_ns(), ctx->interval);
+		ret = HRTIMER_RESTART;
+	} else {
+		ctx->ticks++;
+	}
+	__wake_up_locked(&ctx->wqh, TASK_NORMAL, 0, NULL);
+	spinlock_unlock_irqrestore(&ctx->wqh.lock, flags);
+	return ret;
+}
+
+static ssize_t timerfd_read(struct file* file, char* buf, size_t count, loff_t* ppos) {
+	struct timerfd_ctx* ctx = file->f_private;
+	uint64 ticks;
+
+	if (count < sizeof(ticks)) return -EINVAL;
+	for (;;) {
+		if (!(file->f_flags & O_NONBLOCK)) {
+			int64 ret = wait_event_interruptible(ctx->wqh, READ_ONCE(ctx->ticks));
+			if (ret) return ret;
+		}
+		int64 flags = spinlock_lock_irqsave(&ctx->wqh.lock);
+		ticks = ctx->ticks;
+		ctx->ticks = 0;
+		spinlock_unlock_irqrestore(&ctx->wqh.lock, flags);
+		// 被同一文件的其他读者抢先读走时，阻塞的读者继续等
+		if (ticks) break;
+		if (file->f_flags & O_NONBLOCK) return -EAGAIN;
+	}
+	memcpy(buf, &ticks, sizeof(ticks));
+	return sizeof(ticks);
+}
+
+static int32 timerfd_release(struct file* file) {
+	struct timerfd_ctx* ctx = file->f_private;
+	hrtimer_cancel(&ctx->timer);
+	kfree(ctx);
+	return 0;
+}
+
+static const struct file_operations timerfd_fops = {
+    .read = timerfd_read,
+    .release = timerfd_release,
+};
+
+static struct timerfd_ctx* timerfd_get_ctx(int32 fd, struct file** filp) {
+	struct file* file = fdtable_getFile(current_task()->fdtable, fd);
+	if (!file) return ERR_PTR(-EBADF);
+	if (file->f_op != &timerfd_fops) {
+		file_unref(file);
+		return ERR_PTR(-EINVAL);
+	}
+	*filp = file;
+	return file->f_private;
+}
+
+/*
+ * 当前设定，调用者持有 ctx->wqh.lock
+ */
+static void timerfd_get_locked(struct timerfd_ctx* ctx, struct itimerspec* cur) {
+	int64 remaining = 0;
+
+	if (hrtimer_is_queued(&ctx->timer)) {
+		remaining = hrtimer_get_remaining(&ctx->timer);
+		// 已经到期、回调还没来得及执行的定时器仍然算作启动中
+		if (remaining <= 0) remaining = 1;
+	}
+	ns_to_timespec(&cur->it_value, remaining);
+	ns_to_timespec(&cur->it_interval, ctx->interval);
+}
+
+int32 do_timerfd_create(clockid_t clockid, int32 flags) {
+	struct timerfd_ctx* ctx;
+	struct file* file;
+	int32 fd;
+
+	if (flags & ~(TFD_CLOEXEC | TFD_NONBLOCK)) return -EINVAL;
+	if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC && clockid != CLOCK_BOOTTIME) return -EINVAL;
+
+	ctx = kzalloc(sizeof(*ctx));
+	if (!ctx) return -ENOMEM;
+	hrtimer_init(&ctx->timer, clockid, timerfd_tmrproc);
+	init_waitqueue_head(&ctx->wqh);
+
+	file = kzalloc(sizeof(*file));
+	if (!file) {
+		kfree(ctx);
+		return -ENOMEM;
+	}
+	spinlock_init(&file->f_lock);
+	atomic_set(&file->f_refcount, 1);
+	file->f_mode = FMODE_READ;
+	file->f_flags = O_RDONLY | (flags & TFD_NONBLOCK);
+	file->f_private = ctx;
+	file->f_op = &timerfd_fops;
+
+	fd = fdtable_allocFd(current_task()->fdtable, (flags & TFD_CLOEXEC) ? FD_CLOEXEC : 0);
+	if (fd < 0) {
+		file_unref(file);
+		return fd;
+	}
+	fdtable_installFd(current_task()->fdtable, fd, file);
+	return fd;
+}
+
+/**
+ * do_timerfd_settime - 启动或停止 timerfd
+ * @new: it_value 为 0 时停止；否则按 @flags 解释为相对或绝对的首次到期时间
+ * @old: 可以为 NULL，写入修改之前的设定
+ *
+ * 重新设定会清零还没有读取的到期次数。
+ */
+int32 do_timerfd_settime(int32 fd, int32 flags, const struct itimerspec* new, struct itimerspec* old) {
+	struct file* file;
+	struct timerfd_ctx* ctx;
+	int64 irqflags;
+
+	if (flags & ~TFD_TIMER_ABSTIME) return -EINVAL;
+	if (!timespec_valid(&new->it_value) || !timespec_valid(&new->it_interval)) return -EINVAL;
+
+	ctx = timerfd_get_ctx(fd, &file);
+	if (PTR_IS_ERROR(ctx)) return PTR_ERR(ctx);
+
+	// 回调要拿 wqh.lock，不能持锁等它结束
+	for (;;) {
+		irqflags = spinlock_lock_irqsave(&ctx->wqh.lock);
+		if (hrtimer_try_to_cancel(&ctx->timer) >= 0) break;
+		spinlock_unlock_irqrestore(&ctx->wqh.lock, irqflags);
+		cpu_relax();
+	}
+	if (old) timerfd_get_locked(ctx, old);
+
+	ctx->ticks = 0;
+	ctx->interval = timespec_to_ns(&new->it_interval);
+	if (new->it_value.tv_sec || new->it_value.tv_nsec)
+		hrtimer_start(&ctx->timer, timespec_to_ns(&new->it_value),
+		              (flags & TFD_TIMER_ABSTIME) ? HRTIMER_MODE_ABS : HRTIMER_MODE_REL);
+	spinlock_unlock_irqrestore(&ctx->wqh.lock, irqflags);
+
+	file_unref(file);
+	return 0;
+}
+
+int32 do_timerfd_gettime(int32 fd, struct itimerspec* cur) {
+	struct file* file;
+	struct timerfd_ctx* ctx = timerfd_get_ctx(fd, &file);
+
+	if (PTR_IS_ERROR(ctx)) return PTR_ERR(ctx);
+	int64 flags = spinlock_lock_irqsave(&ctx->wqh.lock);
+	timerfd_get_locked(ctx, cur);
+	spinlock_unlock_irqrestore(&ctx->wqh.lock, flags);
+	file_unref(file);
+	return 0;
+}
+
+int64 sys_timerfd_create(clockid_t clockid, int32 flags) { return do_timerfd_create(clockid, flags); }
+
+int64 sys_timerfd_settime(int32 fd, int32 flags, const struct itimerspec __user* new_value,
+                          struct itimerspec __user* old_value) {
+	struct itimerspec knew, kold;
+	int32 ret;
+
+	if (copy_from_user(&knew, new_value, sizeof(knew))) return -EFAULT;
+	ret = do_timerfd_settime(fd, flags, &knew, old_value ? &kold : NULL);
+	if (ret < 0) return ret;
+	if (old_value && copy_to_user(old_value, &kold, sizeof(kold))) return -EFAULT;
+	return 0;
+}
+
+int64 sys_timerfd_gettime(int32 fd, struct itimerspec __user* curr_value) {
+	struct itimerspec kcur;
+	int32 ret = do_timerfd_gettime(fd, &kcur);
+
+	if (ret < 0) return ret;
+	if (copy_to_user(curr_value, &kcur, sizeof(kcur))) return -EFAULT;
+	return 0;
+}
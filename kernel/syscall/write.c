@@ -47,9 +47,14 @@ ssize_t file_write(struct file *filp, const char *buf, size_t count, loff_t *ppo
 		return -EBADF;
 
 	// If the file has a write method, call it
-	if (filp->f_op->write)
+	// 普通文件的写入与同一 inode 上的其他读写互斥；设备文件可能长时间阻塞，不加锁
+	if (filp->f_op->write) {
+		struct inode* inode = filp->f_inode;
+		int32 locked = inode && is_file(inode->i_mode);
+		if (locked) down_write(&inode->i_rwsem);
 		ret = filp->f_op->write(filp, buf, count, ppos);
-	else {
+		if (locked) up_write(&inode->i_rwsem);
+	} else {
 		ret = -EINVAL;
 	}
 
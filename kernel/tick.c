@@ -0,0 +1,127 @@
+/*
+ * 时钟节拍与 NO_HZ 空闲，见 include/kernel/tick.h
+ */
+
+#include <kernel/hrtimer.h>
+#include <kernel/sched.h>
+#include <kernel/tick.h>
+#include <kernel/timer.h>
+#include <kernel/util.h>
+#include <kernel/util/klog.h>
+
+struct tick_sched {
+	struct hrtimer timer;
+	int32 stopped; // 空闲中，节拍被推迟到了下一个定时器
+};
+
+static DEFINE_PER_CPU(struct tick_sched, tick_cpu_sched);
+
+static spinlock_t jiffies_lock = SPINLOCK_INIT;
+static uint64 tick_base;        // jiffies 为 0 的时刻，所有 hart 的节拍对齐到它之后的整数个 TICK_NSEC
+static uint64 tick_next_period; // jiffies 下一次加一的时刻
+
+static inline uint64 jiffies_to_ktime(uint64 j) {
+	if (j >= (KTIME_MAX - tick_base) / TICK_NSEC) return KTIME_MAX;
+	return tick_base + j * TICK_NSEC;
+}
+
+// now 之后的第一个节拍时刻
+static inline uint64 tick_next_boundary(uint64 now) {
+	return tick_base + ((now - tick_base) / TICK_NSEC + 1) * TICK_NSEC;
+}
+
+/*
+ * 按 now 推进 jiffies，关中断调用
+ *
+ * Returns: 1 表示这次调用推进了 jiffies
+ */
+static int32 tick_do_update_jiffies(uint64 now) {
+	int32 updated = 0;
+
+	// 同一个节拍里其他 hart 多半已经推进过了，不用抢锁
+	if (now < READ_ONCE(tick_next_period)) return 0;
+
+	spinlock_lock(&jiffies_lock);
+	if (now >= tick_next_period) {
+		uint64 ticks = (now - tick_next_period) / TICK_NSEC + 1;
+		WRITE_ONCE(jiffies, jiffies + ticks);
+		WRITE_ONCE(tick_next_period, tick_next_period + ticks * TICK_NSEC);
+		updated = 1;
+	}
+	spinlock_unlock(&jiffies_lock);
+	return updated;
+}
+
+// 推进了 jiffies 的 hart 检查时间轮
+static void tick_do_timer(uint64 now) {
+	if (!tick_do_update_jiffies(now)) return;
+	run_timers();
+	// idle 长时间得不到运行时，在节拍中补一次日志排空
+	if (klog_console_pending()) klog_console_flush();
+	klog_wake_readers();
+}
+
+static enum hrtimer_restart tick_sched_timer(struct hrtimer* timer) {
+	uint64 now = ktime_get_ns();
+
+	tick_do_timer(now);
+	CURRENT->tick_count++;
+	scheduler_tick();
+
+	hrtimer_forward(timer, now, TICK_NSEC);
+	return HRTIMER_RESTART;
+}
+
+/**
+ * tick_init - 确定 jiffies 的起点，在 clocksource_init 之后由启动 hart 调用
+ */
+void tick_init(void) {
+	tick_base = ktime_get_ns();
+	tick_next_period = tick_base + TICK_NSEC;
+	jiffies = 0;
+}
+
+/**
+ * tick_setup_sched_timer - 在本 hart 上启动节拍，在 hrtimer_init_cpu 之后调用
+ */
+void tick_setup_sched_timer(void) {
+	struct tick_sched* ts = this_cpu_ptr(&tick_cpu_sched);
+
+	hrtimer_init(&ts->timer, CLOCK_MONOTONIC, tick_sched_timer);
+	ts->stopped = 0;
+	hrtimer_start(&ts->timer, tick_next_boundary(ktime_get_ns()), HRTIMER_MODE_ABS);
+}
+
+/**
+ * tick_nohz_idle_enter - 空闲前停掉节拍，在 idle_loop 中关中断调用
+ *
+ * 节拍定时器被推迟到时间轮上下一个定时器的 jiffy，时间轮为空时不再触发；
+ * 本 hart 的其他 hrtimer 不受影响，比较器会按最早的那个编程。
+ */
+void tick_nohz_idle_enter(void) {
+	struct tick_sched* ts = this_cpu_ptr(&tick_cpu_sched);
+	uint64 next = get_next_timer_interrupt();
+
+	// 下一个节拍就有定时器要处理，停了也省不下什么
+	if (next <= READ_ONCE(jiffies) + 1) return;
+
+	hrtimer_start(&ts->timer, jiffies_to_ktime(next), HRTIMER_MODE_ABS);
+	ts->stopped = 1;
+}
+
+/**
+ * tick_nohz_idle_exit - 离开空闲时恢复节拍，在 idle_loop 中关中断调用
+ *
+ * 所有 hart 都空闲时没有谁推进 jiffies，醒来的任务马上就可能用它计算超时，这里先补上。
+ */
+void tick_nohz_idle_exit(void) {
+	struct tick_sched* ts = this_cpu_ptr(&tick_cpu_sched);
+	uint64 now;
+
+	if (!ts->stopped) return;
+	ts->stopped = 0;
+
+	now = ktime_get_ns();
+	tick_do_timer(now);
+	hrtimer_start(&ts->timer, tick_next_boundary(now), HRTIMER_MODE_ABS);
+}
@@ -1,10 +1,90 @@
 #include <kernel/time.h>
+#include <kernel/boot/dtb.h>
+#include <kernel/clocksource.h>
+#include <kernel/config.h>
 #include <kernel/fs/vfs/superblock.h>
+#include <kernel/hrtimer.h>
+#include <kernel/riscv.h>
+#include <kernel/sched.h>
+#include <kernel/tick.h>
+#include <kernel/timer.h>
+#include <kernel/vdso.h>
 
-/* System time variables */
-static struct timespec system_time;
+/*
+ * Timekeeping
+ *
+ * CLOCK_MONOTONIC is the clocksource converted to nanoseconds.
+ * The other system clocks are fixed offsets from it: only the
+ * offsets change at run time, and each is a single 64-bit word,
+ * so readers in the kernel need no lock. Writers serialize on
+ * timekeeper_lock and republish the offsets to the vDSO data page.
+ */
+static spinlock_t timekeeper_lock = SPINLOCK_INIT;
+static int64 offs_real; /* CLOCK_REALTIME - CLOCK_MONOTONIC (ns) */
+static int64 offs_boot; /* CLOCK_BOOTTIME - CLOCK_MONOTONIC, no suspend yet */
 uint64 jiffies;
 
+uint64 ktime_get_ns(void)
+{
+    return clocksource_read_ns();
+}
+
+uint64 ktime_get_real_ns(void)
+{
+    return ktime_get_ns() + READ_ONCE(offs_real);
+}
+
+uint64 ktime_get_boot_ns(void)
+{
+    return ktime_get_ns() + READ_ONCE(offs_boot);
+}
+
+int64 ktime_get_offset(clockid_t which_clock)
+{
+    switch (which_clock) {
+    case CLOCK_REALTIME:
+        return READ_ONCE(offs_real);
+    case CLOCK_BOOTTIME:
+        return READ_ONCE(offs_boot);
+    default:
+        return 0;
+    }
+}
+
+/*
+ * CPU time of the calling thread, including the part of the current
+ * slice that has not been accounted yet.
+ */
+static uint64 thread_cputime_ns(struct task_struct *p)
+{
+    uint64 runtime = p->se.sum_exec_runtime;
+    int64 delta = sched_clock() - p->se.exec_start;
+    if (delta > 0)
+        runtime += delta;
+    return runtime;
+}
+
+/*
+ * CPU time of the whole thread group: live threads plus the threads
+ * that have already exited (accumulated on the leader). Threads
+ * running on other harts are counted up to their last tick.
+ */
+static uint64 process_cputime_ns(struct task_struct *tsk)
+{
+    struct task_struct *leader = tsk->group_leader, *t;
+    uint64 runtime;
+
+    spinlock_lock(&tasklist_lock);
+    runtime = leader->exit_runtime;
+    t = leader;
+    do {
+        runtime += t == tsk ? thread_cputime_ns(t) : t->se.sum_exec_runtime;
+        t = next_thread(t);
+    } while (t != leader);
+    spinlock_unlock(&tasklist_lock);
+    return runtime;
+}
+
 /**
  * current_time - Get current system time
  * @sb: Superblock (optional, can be NULL)
@@ -90,9 +170,7 @@ int32 do_gettimeofday(struct timeval *tv)
     if (!tv)
         return -EINVAL;
     
-    /* In a real system, we would read the hardware clock */
-    /* For now, just return the stored system time */
-    ts = system_time;
+    ns_to_timespec(&ts, ktime_get_real_ns());
     
     /* Convert to timeval */
     timespec_to_timeval(tv, &ts);
@@ -100,6 +178,22 @@ int32 do_gettimeofday(struct timeval *tv)
     return 0;
 }
 
+/**
+ * do_settimeofday - Set CLOCK_REALTIME
+ * @tv: New wall clock time
+ *
+ * Returns 0 on success, negative error code on failure
+ */
+int32 do_settimeofday(const struct timeval *tv)
+{
+    struct timespec ts;
+
+    if (!tv || tv->tv_usec < 0 || tv->tv_usec >= USEC_PER_SEC)
+        return -EINVAL;
+    timeval_to_timespec(&ts, tv);
+    return do_clock_settime(CLOCK_REALTIME, &ts);
+}
+
 /**
  * do_clock_gettime - Get time from a specific clock
  * @which_clock: Clock to read from
@@ -114,14 +208,23 @@ int32 do_clock_gettime(clockid_t which_clock, struct timespec *tp)
     
     switch (which_clock) {
     case CLOCK_REALTIME:
-        /* Copy the current system time */
-        *tp = system_time;
+    case CLOCK_REALTIME_COARSE:
+        ns_to_timespec(tp, ktime_get_real_ns());
         break;
     case CLOCK_MONOTONIC:
+    case CLOCK_MONOTONIC_RAW:
+    case CLOCK_MONOTONIC_COARSE:
+        /* No frequency adjustment, so RAW is the same clock */
+        ns_to_timespec(tp, ktime_get_ns());
+        break;
     case CLOCK_BOOTTIME:
-        /* In a real system, these would be different */
-        /* For now, just use system time */
-        *tp = system_time;
+        ns_to_timespec(tp, ktime_get_boot_ns());
+        break;
+    case CLOCK_PROCESS_CPUTIME_ID:
+        ns_to_timespec(tp, process_cputime_ns(CURRENT));
+        break;
+    case CLOCK_THREAD_CPUTIME_ID:
+        ns_to_timespec(tp, thread_cputime_ns(CURRENT));
         break;
     default:
         return -EINVAL;
@@ -130,36 +233,128 @@ int32 do_clock_gettime(clockid_t which_clock, struct timespec *tp)
     return 0;
 }
 
+/**
+ * do_clock_settime - Set time of a clock
+ * @which_clock: Only CLOCK_REALTIME can be set
+ * @tp: New time
+ *
+ * Moves the realtime offset; CLOCK_MONOTONIC is not affected.
+ *
+ * Returns 0 on success, negative error code on failure
+ */
+int32 do_clock_settime(clockid_t which_clock, const struct timespec *tp)
+{
+    if (!tp || tp->tv_sec < 0 || tp->tv_nsec < 0 || tp->tv_nsec >= NSEC_PER_SEC)
+        return -EINVAL;
+    if (which_clock != CLOCK_REALTIME)
+        return -EINVAL;
+
+    uint64 ns = (uint64)tp->tv_sec * NSEC_PER_SEC + tp->tv_nsec;
+    int64 flags = spinlock_lock_irqsave(&timekeeper_lock);
+    WRITE_ONCE(offs_real, (int64)(ns - ktime_get_ns()));
+    update_vsyscall(&riscv_clocksource, offs_real, offs_boot);
+    spinlock_unlock_irqrestore(&timekeeper_lock, flags);
+    return 0;
+}
+
+/**
+ * do_clock_getres - Get resolution of a clock
+ * @which_clock: Clock to query
+ * @tp: Timespec to fill, may be NULL
+ *
+ * Clocks read from the clocksource resolve one counter period; the
+ * coarse clocks advertise one tick like Linux does.
+ *
+ * Returns 0 on success, negative error code on failure
+ */
+int32 do_clock_getres(clockid_t which_clock, struct timespec *tp)
+{
+    uint64 res;
+
+    switch (which_clock) {
+    case CLOCK_REALTIME:
+    case CLOCK_MONOTONIC:
+    case CLOCK_MONOTONIC_RAW:
+    case CLOCK_BOOTTIME:
+    case CLOCK_PROCESS_CPUTIME_ID:
+    case CLOCK_THREAD_CPUTIME_ID:
+        res = (NSEC_PER_SEC + riscv_clocksource.freq - 1) / riscv_clocksource.freq;
+        break;
+    case CLOCK_REALTIME_COARSE:
+    case CLOCK_MONOTONIC_COARSE:
+        res = NSEC_PER_SEC / HZ;
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    if (tp)
+        ns_to_timespec(tp, res);
+    return 0;
+}
+
 /**
  * time_init - Initialize the time subsystem
+ *
+ * Called on the boot hart after the device tree has been parsed and
+ * before any hart starts its tick.
  */
 void time_init(void)
 {
-    /* Initialize system time to Unix epoch (1970-01-01) */
-    system_time.tv_sec = 0;
-    system_time.tv_nsec = 0;
+    clocksource_init(cpuInfo.timebase);
+    offs_boot = 0;
     
     /* Read initial time from hardware clock */
     update_sys_time_from_hw();
     
-    /* Initialize system jiffies */
-    jiffies = 0;
+    /* Initialize system jiffies and the timer wheel */
+    tick_init();
+    init_timers();
+}
+
+/**
+ * timer_init_hart - Start the timer interrupt on the calling hart
+ *
+ * Every hart has its own timer comparator, owned by its hrtimer
+ * queue. The tick is the first hrtimer queued on it.
+ */
+void timer_init_hart(void)
+{
+    /* Let user mode read the time CSR, the vDSO depends on it */
+    write_csr(scounteren, read_csr(scounteren) | SCOUNTEREN_TM);
+    hrtimer_init_cpu();
+    tick_setup_sched_timer();
+    write_csr(sie, read_csr(sie) | SIE_STIE);
 }
 
 /**
  * update_sys_time_from_hw - Update system time from hardware
  *
- * Reads the hardware clock and updates the system time.
- * In a real system, this would interact with an RTC.
+ * Sets the initial wall clock. There is no RTC driver yet, so
+ * CLOCK_REALTIME starts from a fixed date and advances with the
+ * clocksource; clock_settime() can correct it.
  */
 void update_sys_time_from_hw(void)
 {
-    /* In a real system, we would read from the RTC */
-    /* For a simplistic simulation, set time to a recent date */
-    
-    /* Set to January 1, 2023 00:00:00 UTC */
-    system_time.tv_sec = 1672531200;
-    system_time.tv_nsec = 0;
+    /* January 1, 2023 00:00:00 UTC */
+    struct timespec ts = {.tv_sec = 1672531200, .tv_nsec = 0};
+    do_clock_settime(CLOCK_REALTIME, &ts);
+}
+
+/**
+ * timespec_to_jiffies - Convert a time interval to jiffies
+ * @value: Non-negative interval
+ *
+ * Rounds up so that a sleep never ends early. Intervals too long
+ * to represent saturate at INT64_MAX.
+ */
+int64 timespec_to_jiffies(const struct timespec *value)
+{
+    const uint64 nsec_per_jiffy = 1000000000UL / HZ;
+    if ((uint64)value->tv_sec >= (uint64)INT64_MAX / 1000000000UL)
+        return INT64_MAX;
+    uint64 nsec = (uint64)value->tv_sec * 1000000000UL + value->tv_nsec;
+    return (nsec + nsec_per_jiffy - 1) / nsec_per_jiffy;
 }
 
 // ...existing code...
@@ -173,13 +368,13 @@ void update_sys_time_from_hw(void)
  */
 time_t do_time(time_t *timer)
 {
-    time_t current = system_time.tv_sec;
+    time_t now = ktime_get_real_ns() / NSEC_PER_SEC;
     
     /* Store the result in timer if it's not NULL */
     if (timer)
-        *timer = current;
+        *timer = now;
     
-    return current;
+    return now;
 }
 
 
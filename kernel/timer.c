@@ -0,0 +1,282 @@
+/*
+ * 内核定时器与 schedule_timeout，见 include/kernel/timer.h
+ */
+
+#include <kernel/sched.h>
+#include <kernel/time.h>
+#include <kernel/timer.h>
+#include <kernel/util.h>
+
+/*
+ * 分级时间轮
+ *
+ * 第 n 级的槽跨 LVL_GRAN(n) = 8^n 个 jiffy，接收间隔在 [LVL_START(n), LVL_START(n+1)) 的定时器。
+ * clk 是下一个要处理的 jiffy：每个 jiffy 处理第 0 级的一个槽，clk 是 8^n 的倍数时
+ * 再处理第 n 级的一个槽，所以第 n 级的槽 s 在 jiffy s << LVL_SHIFT(n) 被处理。
+ * 每级 64 个槽正好用一个字记录哪些槽非空，找最早的非空槽只需要每级一次移位和 ctz。
+ */
+#define LVL_CLK_SHIFT 3
+#define LVL_CLK_DIV (1ULL << LVL_CLK_SHIFT)
+#define LVL_CLK_MASK (LVL_CLK_DIV - 1)
+#define LVL_SHIFT(n) ((n) * LVL_CLK_SHIFT)
+#define LVL_GRAN(n) (1ULL << LVL_SHIFT(n))
+
+#define LVL_BITS 6
+#define LVL_SIZE (1ULL << LVL_BITS)
+#define LVL_MASK (LVL_SIZE - 1)
+#define LVL_OFFS(n) ((n) * LVL_SIZE)
+#define LVL_START(n) ((LVL_SIZE - 1) << (((n) - 1) * LVL_CLK_SHIFT))
+
+// HZ=100 时最后一级能覆盖约 15 天，更远的定时器在这个上限处到期
+#define LVL_DEPTH 8
+#define WHEEL_SIZE (LVL_SIZE * LVL_DEPTH)
+#define WHEEL_TIMEOUT_CUTOFF LVL_START(LVL_DEPTH)
+#define WHEEL_TIMEOUT_MAX (WHEEL_TIMEOUT_CUTOFF - LVL_GRAN(LVL_DEPTH - 1))
+
+// 时间轮为空时 get_next_timer_interrupt 返回 clk 加上它
+#define NEXT_TIMER_MAX_DELTA (1ULL << 62)
+
+static struct timer_wheel {
+	spinlock_t lock;
+	uint64 clk;                    // 下一个要处理的 jiffy
+	uint64 pending_map[LVL_DEPTH]; // 第 n 个字的第 i 位表示第 n 级的第 i 个槽非空
+	// 正在执行回调的定时器，del_timer_sync 等它执行完
+	struct timer_list* volatile running_timer;
+	int32 expiring; // 有 hart 正在 run_timers 中，回调只在一个 hart 上串行执行
+	struct list_head vectors[WHEEL_SIZE];
+} wheel = {.lock = {SPINLOCK_INIT}};
+
+void timer_setup(struct timer_list* timer, void (*function)(struct timer_list*)) {
+	INIT_LIST_HEAD(&timer->entry);
+	timer->expires = 0;
+	timer->function = function;
+	timer->idx = 0;
+}
+
+/*
+ * 到期时间按第 lvl 级的粒度向上取整后所在的槽
+ */
+static inline uint32 calc_index(uint64 expires, uint32 lvl) {
+	expires = (expires + LVL_GRAN(lvl) - 1) >> LVL_SHIFT(lvl);
+	return LVL_OFFS(lvl) + (expires & LVL_MASK);
+}
+
+static uint32 calc_wheel_index(uint64 expires, uint64 clk) {
+	uint64 delta = expires - clk;
+
+	// 已经过期的在下一个 jiffy 处理
+	if ((int64)delta < 0) return clk & LVL_MASK;
+	for (uint32 lvl = 0; lvl < LVL_DEPTH - 1; lvl++) {
+		if (delta < LVL_START(lvl + 1)) return calc_index(expires, lvl);
+	}
+	if (delta >= WHEEL_TIMEOUT_CUTOFF) expires = clk + WHEEL_TIMEOUT_MAX;
+	return calc_index(expires, LVL_DEPTH - 1);
+}
+
+// 以下函数的调用者都持有 wheel.lock
+static void enqueue_timer(struct timer_list* timer) {
+	uint32 idx = calc_wheel_index(timer->expires, wheel.clk);
+	timer->idx = idx;
+	list_add_tail(&timer->entry, &wheel.vectors[idx]);
+	wheel.pending_map[idx / LVL_SIZE] |= 1ULL << (idx % LVL_SIZE);
+}
+
+static void detach_timer(struct timer_list* timer) {
+	uint32 idx = timer->idx;
+	list_del_init(&timer->entry);
+	if (list_empty(&wheel.vectors[idx])) wheel.pending_map[idx / LVL_SIZE] &= ~(1ULL << (idx % LVL_SIZE));
+}
+
+/*
+ * 最早的非空槽被处理的 jiffy
+ *
+ * 第 n 级下一个要处理的槽是 clk 按该级粒度向上取整的位置，所有非空槽都在它之后的 64 个槽内，
+ * 把这一级的位图循环右移到从它开始，第一个置位的就是这一级最早的槽。
+ */
+static uint64 __next_timer_interrupt(void) {
+	uint64 next = wheel.clk + NEXT_TIMER_MAX_DELTA;
+
+	for (uint32 lvl = 0; lvl < LVL_DEPTH; lvl++) {
+		uint64 map = wheel.pending_map[lvl];
+		if (!map) continue;
+
+		uint64 slot = (wheel.clk + LVL_GRAN(lvl) - 1) >> LVL_SHIFT(lvl);
+		uint32 rot = slot & LVL_MASK;
+		if (rot) map = (map >> rot) | (map << (LVL_SIZE - rot));
+		uint64 expiry = (slot + __builtin_ctzll(map)) << LVL_SHIFT(lvl);
+		if (expiry < next) next = expiry;
+	}
+	return next;
+}
+
+/*
+ * NO_HZ 空闲时 jiffies 会一次前进很多，clk 直接跳到最早的非空槽（最多到 jiffies），
+ * 中间的 jiffy 没有要处理的槽；新挂入的定时器也按跳过之后的 clk 选级，不会因为 clk 落后而选得过粗
+ */
+static void forward_timer_wheel(void) {
+	uint64 now = READ_ONCE(jiffies);
+	if (now <= wheel.clk) return;
+
+	uint64 next = __next_timer_interrupt();
+	wheel.clk = next > now ? now : next;
+}
+
+/*
+ * 取出 clk 这个 jiffy 要处理的各级的槽，返回取出的链表数
+ */
+static int32 collect_expired_timers(struct list_head* heads) {
+	uint64 clk = wheel.clk;
+	int32 levels = 0;
+
+	for (uint32 lvl = 0; lvl < LVL_DEPTH; lvl++) {
+		uint32 idx = clk & LVL_MASK;
+		if (wheel.pending_map[lvl] & (1ULL << idx)) {
+			wheel.pending_map[lvl] &= ~(1ULL << idx);
+			INIT_LIST_HEAD(&heads[levels]);
+			list_splice_init(&wheel.vectors[LVL_OFFS(lvl) + idx], &heads[levels]);
+			levels++;
+		}
+		// 低一级还没有转完一圈，更高的级不用看
+		if (clk & LVL_CLK_MASK) break;
+		clk >>= LVL_CLK_SHIFT;
+	}
+	return levels;
+}
+
+static void expire_timers(struct list_head* heads, int32 levels) {
+	for (int32 i = 0; i < levels; i++) {
+		while (!list_empty(&heads[i])) {
+			struct timer_list* timer = list_first_entry(&heads[i], struct timer_list, entry);
+			list_del_init(&timer->entry);
+			wheel.running_timer = timer;
+			spinlock_unlock(&wheel.lock);
+			timer->function(timer);
+			spinlock_lock(&wheel.lock);
+			wheel.running_timer = NULL;
+		}
+	}
+}
+
+void add_timer(struct timer_list* timer) { mod_timer(timer, timer->expires); }
+
+/**
+ * mod_timer - 修改定时器的到期时间，未挂入时挂入
+ *
+ * Returns: 1 表示修改前定时器已经挂入
+ */
+int32 mod_timer(struct timer_list* timer, uint64 expires) {
+	int64 flags = spinlock_lock_irqsave(&wheel.lock);
+	int32 pending = timer_pending(timer);
+	if (pending && timer->expires == expires) goto out;
+	if (pending) detach_timer(timer);
+	forward_timer_wheel();
+	timer->expires = expires;
+	enqueue_timer(timer);
+out:
+	spinlock_unlock_irqrestore(&wheel.lock, flags);
+	return pending;
+}
+
+/**
+ * del_timer - 取消定时器，不等待正在执行的回调
+ *
+ * Returns: 1 表示取消了一个还没到期的定时器
+ */
+int32 del_timer(struct timer_list* timer) {
+	int64 flags = spinlock_lock_irqsave(&wheel.lock);
+	int32 pending = timer_pending(timer);
+	if (pending) detach_timer(timer);
+	spinlock_unlock_irqrestore(&wheel.lock, flags);
+	return pending;
+}
+
+/**
+ * del_timer_sync - 取消定时器并等待其他 hart 上正在执行的回调结束
+ *
+ * 返回后可以释放 timer。不能在它自己的回调中调用。
+ */
+int32 del_timer_sync(struct timer_list* timer) {
+	for (;;) {
+		int32 ret = del_timer(timer);
+		if (wheel.running_timer != timer) return ret;
+	}
+}
+
+/**
+ * run_timers - 处理到当前 jiffies 为止的所有槽，由推进了 jiffies 的 hart 在时钟节拍中调用
+ */
+void run_timers(void) {
+	struct list_head heads[LVL_DEPTH];
+	int64 flags = spinlock_lock_irqsave(&wheel.lock);
+
+	// 另一个 hart 正在处理，它会一直处理到最新的 jiffies
+	if (wheel.expiring) goto out;
+	wheel.expiring = 1;
+	while (wheel.clk <= READ_ONCE(jiffies)) {
+		forward_timer_wheel();
+		int32 levels = collect_expired_timers(heads);
+		wheel.clk++;
+		expire_timers(heads, levels);
+	}
+	wheel.expiring = 0;
+out:
+	spinlock_unlock_irqrestore(&wheel.lock, flags);
+}
+
+/**
+ * get_next_timer_interrupt - 时间轮上最早的定时器需要在哪个 jiffy 处理
+ *
+ * 时间轮为空时返回一个很远的值。NO_HZ 空闲据此决定节拍可以停多久。
+ */
+uint64 get_next_timer_interrupt(void) {
+	int64 flags = spinlock_lock_irqsave(&wheel.lock);
+	uint64 next = __next_timer_interrupt();
+	spinlock_unlock_irqrestore(&wheel.lock, flags);
+	return next;
+}
+
+/**
+ * init_timers - 初始化时间轮，在第一次使用定时器之前由启动 hart 调用
+ */
+void init_timers(void) {
+	for (int32 i = 0; i < WHEEL_SIZE; i++) INIT_LIST_HEAD(&wheel.vectors[i]);
+	wheel.clk = READ_ONCE(jiffies);
+}
+
+struct process_timer {
+	struct timer_list timer;
+	struct task_struct* task;
+};
+
+static void process_timeout(struct timer_list* timer) { wake_up_process(container_of(timer, struct process_timer, timer)->task); }
+
+/**
+ * schedule_timeout - 睡眠直到被唤醒或经过 timeout 个节拍
+ *
+ * 和 schedule() 一样，调用前要先设置好 CURRENT->state；
+ * timeout 为 MAX_SCHEDULE_TIMEOUT 时不设定时器。
+ *
+ * Returns: 剩余的节拍数，超时返回 0
+ */
+int64 schedule_timeout(int64 timeout) {
+	struct process_timer t;
+
+	if (timeout == MAX_SCHEDULE_TIMEOUT) {
+		schedule();
+		return timeout;
+	}
+	if (timeout <= 0) {
+		CURRENT->state = TASK_RUNNING;
+		return 0;
+	}
+
+	uint64 expire = READ_ONCE(jiffies) + timeout;
+	t.task = CURRENT;
+	timer_setup(&t.timer, process_timeout);
+	mod_timer(&t.timer, expire);
+	schedule();
+	del_timer_sync(&t.timer);
+
+	int64 left = (int64)(expire - READ_ONCE(jiffies));
+	return left < 0 ? 0 : left;
+}
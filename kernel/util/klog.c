@@ -0,0 +1,360 @@
+/*
+ * 内核日志环形缓冲区
+ *
+ * 写路径（kprintf/_log）只做一次格式化和一次本地缓冲区拷贝，
+ * 不再为每个字符陷入 M 态。控制台的输出被推迟到低优先级上下文。
+ */
+
+#include <kernel/device/interface.h>
+#include <kernel/clocksource.h>
+#include <kernel/percpu.h>
+#include <kernel/riscv.h>
+#include <kernel/sched.h>
+#include <kernel/sched/wait.h>
+#include <kernel/util/klog.h>
+#include <kernel/util/log.h>
+#include <kernel/util/print.h>
+#include <kernel/util/spinlock.h>
+#include <kernel/util/string.h>
+
+static struct klog_cpu_buf klog_bufs[NCPU];
+static volatile uint64 klog_next_seq = 1;
+
+// 控制台排空状态，由 pr_lock 保护。普通记录只 trylock，WARN 以上级别的写者会等锁
+extern spinlock_t pr_lock;
+static volatile int32 console_owner = -1; // 持有 pr_lock 正在排空的 hart
+static struct klog_iter console_iter;
+static volatile int32 console_loglevel = LOG_LEVEL_TRACE;
+static volatile int32 console_enabled = 1;
+
+// 启动早期没有 idle 上下文，先同步输出；调度器接管后再切到异步模式
+static volatile int32 klog_async = 0;
+
+// syslog 读游标和 CLEAR 之后的起始序号
+static spinlock_t syslog_lock = SPINLOCK_INIT;
+static struct klog_iter syslog_iter;
+static uint64 syslog_clear_seq = 0;
+// SYSLOG_ACTION_READ 在没有新记录时睡在这里，由节拍和 idle 上下文唤醒
+static struct wait_queue_head syslog_wait = __WAIT_QUEUE_HEAD_INITIALIZER(syslog_wait);
+static volatile uint64 syslog_woken_seq = 0;
+
+#define KLOG_SLOT_MASK (KLOG_SLOTS_PER_CPU - 1)
+// 本地积压超过该值时由写者自己排空，防止覆盖尚未输出的记录
+#define KLOG_HIGH_WATERMARK (KLOG_SLOTS_PER_CPU / 2)
+
+static void klog_append_one(int32 level, const char* text, size_t len) {
+	uint64 flags = disable_irqsave();
+	uint64 hartid = smp_processor_id();
+	struct klog_cpu_buf* kb = &klog_bufs[hartid];
+	uint64 pos = kb->head;
+	struct klog_record* r = &kb->slots[pos & KLOG_SLOT_MASK];
+
+	// 先作废旧记录，读者看到无效位置就知道这条已经被覆盖
+	WRITE_ONCE(r->pos, KLOG_POS_INVALID);
+	smp_wmb();
+
+	r->seq = __sync_fetch_and_add(&klog_next_seq, 1);
+	r->ts = read_csr(time);
+	r->level = level;
+	r->cpu = hartid;
+	r->len = len;
+	memcpy(r->text, text, len);
+
+	smp_wmb();
+	WRITE_ONCE(r->pos, pos);
+	smp_wmb();
+	WRITE_ONCE(kb->head, pos + 1);
+
+	enable_irqrestore(flags);
+}
+
+/**
+ * klog_append - 追加一条日志记录
+ * @level: 日志级别
+ * @text: 文本（不要求以 0 结尾）
+ * @len: 文本长度
+ *
+ * 超长的文本会被拆成多条连续记录。
+ */
+void klog_append(int32 level, const char* text, size_t len) {
+	while (len > 0) {
+		size_t n = MIN(len, (size_t)KLOG_TEXT_MAX);
+		klog_append_one(level, text, n);
+		text += n;
+		len -= n;
+	}
+
+	if (level <= LOG_LEVEL_WARN) {
+		klog_console_flush_sync();
+		return;
+	}
+	if (!klog_async) {
+		klog_console_flush();
+		return;
+	}
+
+	struct klog_cpu_buf* kb = &klog_bufs[smp_processor_id()];
+	if (kb->head - console_iter.pos[smp_processor_id()] >= KLOG_HIGH_WATERMARK) klog_console_flush();
+}
+
+/**
+ * klog_iter_init - 把游标放到当前仍然保留在缓冲区中的最旧记录
+ */
+void klog_iter_init(struct klog_iter* iter) {
+	for (int32 c = 0; c < NCPU; c++) {
+		uint64 head = READ_ONCE(klog_bufs[c].head);
+		iter->pos[c] = head > KLOG_SLOTS_PER_CPU ? head - KLOG_SLOTS_PER_CPU : 0;
+	}
+	iter->dropped = 0;
+}
+
+/**
+ * klog_iter_next - 按全局序号取出下一条记录
+ * @iter: 读游标，调用者负责串行化对同一游标的访问
+ * @out: 输出记录的拷贝
+ *
+ * 返回 1 表示取到记录，0 表示所有 hart 上都没有新记录。
+ * 读取过程中若记录被写者覆盖，则跳过并计入 dropped。
+ */
+int32 klog_iter_next(struct klog_iter* iter, struct klog_record* out) {
+	while (1) {
+		int32 best = -1;
+		uint64 best_seq = ~0ULL;
+
+		for (int32 c = 0; c < NCPU; c++) {
+			struct klog_cpu_buf* kb = &klog_bufs[c];
+			uint64 head = READ_ONCE(kb->head);
+			smp_rmb();
+			if (iter->pos[c] >= head) continue;
+			if (head - iter->pos[c] > KLOG_SLOTS_PER_CPU) {
+				iter->dropped += head - iter->pos[c] - KLOG_SLOTS_PER_CPU;
+				iter->pos[c] = head - KLOG_SLOTS_PER_CPU;
+			}
+			struct klog_record* r = &kb->slots[iter->pos[c] & KLOG_SLOT_MASK];
+			if (READ_ONCE(r->pos) != iter->pos[c]) {
+				// 已被覆盖，下一轮再看后面的记录
+				iter->pos[c]++;
+				iter->dropped++;
+				best = -2;
+				break;
+			}
+			smp_rmb();
+			if (r->seq < best_seq) {
+				best_seq = r->seq;
+				best = c;
+			}
+		}
+		if (best == -2) continue;
+		if (best < 0) return 0;
+
+		struct klog_record* r = &klog_bufs[best].slots[iter->pos[best] & KLOG_SLOT_MASK];
+		memcpy(out, r, sizeof(*out));
+		smp_rmb();
+		uint64 expect = iter->pos[best]++;
+		if (READ_ONCE(r->pos) != expect) {
+			iter->dropped++;
+			continue;
+		}
+		return 1;
+	}
+}
+
+/**
+ * klog_console_pending - 控制台是否还有没输出的记录
+ */
+int32 klog_console_pending(void) {
+	for (int32 c = 0; c < NCPU; c++) {
+		if (console_iter.pos[c] < READ_ONCE(klog_bufs[c].head)) return 1;
+	}
+	return 0;
+}
+
+/*
+ * 输出所有积压的记录后释放 pr_lock，调用者持有 pr_lock
+ */
+static void klog_console_drain_locked(void) {
+	struct klog_record rec;
+
+	WRITE_ONCE(console_owner, smp_processor_id());
+	while (klog_iter_next(&console_iter, &rec)) {
+		if (!console_enabled || rec.level > console_loglevel) continue;
+		cons_write(rec.text, rec.len);
+	}
+	WRITE_ONCE(console_owner, -1);
+	spinlock_unlock(&pr_lock);
+}
+
+/**
+ * klog_console_flush - 把积压的记录输出到控制台
+ *
+ * 同一时刻只有一个 hart 在排空，其他 hart 发现有人在排空就直接返回，
+ * 它们追加的记录会被正在排空的 hart 顺带输出。
+ */
+void klog_console_flush(void) {
+	do {
+		if (!spinlock_trylock(&pr_lock)) return;
+		klog_console_drain_locked();
+		// 释放锁和别的 hart 追加记录之间存在窗口，再检查一次
+	} while (klog_console_pending());
+}
+
+/**
+ * klog_console_flush_sync - 等到拿到 pr_lock 再排空，返回时调用者之前追加的记录都已输出
+ *
+ * 用于 WARN 以上级别：持锁的 hart 可能在输出完之前就让系统复位。
+ * 本 hart 正在排空时（例如排空过程中的中断又打印了警告）直接返回，由外层的排空顺带输出。
+ */
+void klog_console_flush_sync(void) {
+	if (READ_ONCE(console_owner) == smp_processor_id()) return;
+	spinlock_lock(&pr_lock);
+	klog_console_drain_locked();
+}
+
+/*
+ * syslog 读游标后面是否还有记录，不持锁，只作为睡眠条件的提示
+ */
+static int32 syslog_pending(void) {
+	for (int32 c = 0; c < NCPU; c++) {
+		if (READ_ONCE(syslog_iter.pos[c]) < READ_ONCE(klog_bufs[c].head)) return 1;
+	}
+	return 0;
+}
+
+/**
+ * klog_wake_readers - 有新记录时唤醒阻塞在 SYSLOG_ACTION_READ 上的读者
+ *
+ * klog_append 可能在持有运行队列锁或等待队列锁时被调用，不能直接唤醒，
+ * 唤醒推迟到节拍和 idle 这类不持锁的上下文。
+ */
+void klog_wake_readers(void) {
+	uint64 seq = READ_ONCE(klog_next_seq);
+	if (seq == READ_ONCE(syslog_woken_seq)) return;
+	// 与 prepare_to_wait_event 中的入队配对，避免漏掉刚开始睡眠的读者
+	smp_mb();
+	if (!waitqueue_active(&syslog_wait)) return;
+	WRITE_ONCE(syslog_woken_seq, seq);
+	wake_up_interruptible_all(&syslog_wait);
+}
+
+void klog_set_async(int32 async) {
+	klog_async = async;
+	if (!async) klog_console_flush();
+}
+
+/*
+ * 格式化记录头 "<level>[   sec.usec] "，返回头部长度
+ */
+static int32 klog_format_header(const struct klog_record* rec, char* hdr) {
+	uint64 usec = cycles_to_ns(rec->ts) / 1000;
+	// snprintf 不支持宽度和 l 修饰，头部改用 ksprintf 格式化，长度有上界
+	ksprintf(hdr, "<%d>[%5lu.%06lu] ", rec->level, usec / 1000000, usec % 1000000);
+	return strlen(hdr);
+}
+
+/*
+ * 将一条记录格式化为 "<level>[   sec.usec] text"
+ * 放不下时返回 -1；@truncate 非零则截断到 size 字节
+ */
+static int32 klog_format(const struct klog_record* rec, char* buf, int32 size, int32 truncate) {
+	char hdr[48];
+	int32 n = klog_format_header(rec, hdr);
+	int32 len = rec->len;
+	if (n + len > size) {
+		if (!truncate) return -1;
+		if (n > size) n = size;
+		len = size - n;
+	}
+	memcpy(buf, hdr, n);
+	memcpy(buf + n, rec->text, len);
+	return n + len;
+}
+
+static int64 syslog_read(struct klog_iter* iter, char* buf, int32 len) {
+	struct klog_record rec;
+	struct klog_iter saved;
+	int64 done = 0;
+
+	while (1) {
+		memcpy(&saved, iter, sizeof(saved));
+		if (!klog_iter_next(iter, &rec)) break;
+		if (rec.seq < syslog_clear_seq) continue;
+		// 第一条就放不下时截断输出，保证小缓冲区的读者也能前进
+		int32 n = klog_format(&rec, buf + done, len - done, done == 0);
+		if (n < 0) {
+			// 放不下了，把这条留给下一次读取
+			memcpy(iter, &saved, sizeof(saved));
+			break;
+		}
+		done += n;
+	}
+	return done;
+}
+
+/**
+ * do_syslog - syslog(2) 的内核实现
+ * @type: SYSLOG_ACTION_*
+ * @buf: 内核缓冲区（读取类动作使用）
+ * @len: 缓冲区长度或控制台级别
+ */
+int64 do_syslog(int32 type, char* buf, int32 len) {
+	struct klog_iter iter;
+	struct klog_record rec;
+	int64 ret = 0;
+
+	switch (type) {
+	case SYSLOG_ACTION_CLOSE:
+	case SYSLOG_ACTION_OPEN:
+		return 0;
+	case SYSLOG_ACTION_READ:
+		if (!buf || len < 0) return -EINVAL;
+		if (len == 0) return 0;
+		// CLEAR 之前的记录会被跳过而读不到东西，此时继续等待
+		do {
+			ret = wait_event_interruptible(syslog_wait, syslog_pending());
+			if (ret) return ret;
+			spinlock_lock(&syslog_lock);
+			ret = syslog_read(&syslog_iter, buf, len);
+			spinlock_unlock(&syslog_lock);
+		} while (ret == 0);
+		return ret;
+	case SYSLOG_ACTION_READ_ALL:
+	case SYSLOG_ACTION_READ_CLEAR:
+		if (!buf || len < 0) return -EINVAL;
+		spinlock_lock(&syslog_lock);
+		klog_iter_init(&iter);
+		ret = syslog_read(&iter, buf, len);
+		if (type == SYSLOG_ACTION_READ_CLEAR) syslog_clear_seq = klog_next_seq;
+		spinlock_unlock(&syslog_lock);
+		return ret;
+	case SYSLOG_ACTION_CLEAR:
+		spinlock_lock(&syslog_lock);
+		syslog_clear_seq = klog_next_seq;
+		spinlock_unlock(&syslog_lock);
+		return 0;
+	case SYSLOG_ACTION_CONSOLE_OFF:
+		console_enabled = 0;
+		return 0;
+	case SYSLOG_ACTION_CONSOLE_ON:
+		console_enabled = 1;
+		return 0;
+	case SYSLOG_ACTION_CONSOLE_LEVEL:
+		if (len < LOG_LEVEL_ERROR || len > LOG_LEVEL_TRACE) return -EINVAL;
+		console_loglevel = len;
+		return 0;
+	case SYSLOG_ACTION_SIZE_UNREAD: {
+		// 与 READ 的输出一致：每条记录都带格式化后的头部
+		char hdr[48];
+		spinlock_lock(&syslog_lock);
+		memcpy(&iter, &syslog_iter, sizeof(iter));
+		while (klog_iter_next(&iter, &rec)) {
+			if (rec.seq >= syslog_clear_seq) ret += klog_format_header(&rec, hdr) + rec.len;
+		}
+		spinlock_unlock(&syslog_lock);
+		return ret;
+	}
+	case SYSLOG_ACTION_SIZE_BUFFER:
+		return KLOG_BUF_SIZE;
+	default:
+		return -EINVAL;
+	}
+}
@@ -0,0 +1,144 @@
+/*
+ * 自旋锁竞争统计，见 include/kernel/util/lockstat.h
+ *
+ * 统计路径本身在自旋锁内部调用，这里只能使用原子操作，不能再加锁或打印。
+ */
+
+#include <kernel/clocksource.h>
+#include <kernel/device/char_device.h>
+#include <kernel/mm/kmalloc.h>
+#include <kernel/util.h>
+#include <kernel/util/lockstat.h>
+#include <kernel/util/seq_buf.h>
+
+#define LOCKSTAT_BUF_SIZE (64 * 1024)
+
+static struct lock_class_stat lock_classes[LOCKSTAT_CLASSES];
+static struct lock_class_stat lock_class_overflow = {.site = "(overflow)"};
+volatile int32 lockstat_enabled = 1;
+
+/**
+ * lockstat_class - 查找或登记 site 对应的锁类
+ *
+ * 开放定址，以 site 字符串的地址为键：同一个加锁位置总是同一个字面量。
+ * 空槽用 CAS 占用，不需要锁。
+ */
+struct lock_class_stat* lockstat_class(const char* site) {
+	uint64 h = ((uint64)site >> 3) * 0x9E3779B97F4A7C15UL;
+	for (int32 i = 0; i < LOCKSTAT_CLASSES; i++) {
+		struct lock_class_stat* class = &lock_classes[(h + i) % LOCKSTAT_CLASSES];
+		const char* cur = __atomic_load_n(&class->site, __ATOMIC_ACQUIRE);
+		if (cur == site) return class;
+		if (cur) continue;
+		if (__atomic_compare_exchange_n(&class->site, &cur, site, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return class;
+		// 被别的 hart 抢先占用，可能正是同一个位置
+		if (cur == site) return class;
+	}
+	return &lock_class_overflow;
+}
+
+static inline void stat_max(uint64* max, uint64 val) {
+	uint64 old = __atomic_load_n(max, __ATOMIC_RELAXED);
+	while (val > old && !__atomic_compare_exchange_n(max, &old, val, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+void lockstat_account_wait(struct lock_class_stat* class, uint64 wait, int32 contended) {
+	__atomic_fetch_add(&class->acquisitions, 1, __ATOMIC_RELAXED);
+	if (!contended) return;
+	__atomic_fetch_add(&class->contentions, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&class->wait_ticks, wait, __ATOMIC_RELAXED);
+	stat_max(&class->max_wait_ticks, wait);
+}
+
+void lockstat_account_hold(struct lock_class_stat* class, uint64 hold) {
+	__atomic_fetch_add(&class->hold_ticks, hold, __ATOMIC_RELAXED);
+	stat_max(&class->max_hold_ticks, hold);
+}
+
+/**
+ * lockstat_reset - 清零所有计数，保留已登记的锁类
+ *
+ * 与并发的统计没有同步，清零期间记下的少量数据可能丢失。
+ */
+void lockstat_reset(void) {
+	for (int32 i = 0; i <= LOCKSTAT_CLASSES; i++) {
+		struct lock_class_stat* class = i < LOCKSTAT_CLASSES ? &lock_classes[i] : &lock_class_overflow;
+		class->acquisitions = class->contentions = 0;
+		class->wait_ticks = class->max_wait_ticks = 0;
+		class->hold_ticks = class->max_hold_ticks = 0;
+	}
+}
+
+static void lockstat_render(struct seq_buf* s) {
+	seq_buf_printf(s, "compiled: %d enabled: %d\n\n", CONFIG_LOCKSTAT, lockstat_enabled);
+
+	struct lock_class_stat** sorted = kmalloc(sizeof(*sorted) * (LOCKSTAT_CLASSES + 1));
+	if (!sorted) return;
+	int32 n = 0;
+	for (int32 i = 0; i < LOCKSTAT_CLASSES; i++) {
+		if (lock_classes[i].site && lock_classes[i].acquisitions) sorted[n++] = &lock_classes[i];
+	}
+	if (lock_class_overflow.acquisitions) sorted[n++] = &lock_class_overflow;
+
+	// 按竞争次数降序，相同时按获取次数降序
+	for (int32 i = 1; i < n; i++) {
+		struct lock_class_stat* c = sorted[i];
+		int32 j = i - 1;
+		while (j >= 0 && (sorted[j]->contentions < c->contentions ||
+		                  (sorted[j]->contentions == c->contentions && sorted[j]->acquisitions < c->acquisitions))) {
+			sorted[j + 1] = sorted[j];
+			j--;
+		}
+		sorted[j + 1] = c;
+	}
+
+	seq_buf_printf(s, "%-40s %10s %10s %12s %10s %12s %10s\n", "site", "acquired", "contended", "wait_us", "wait_max_ns",
+	               "hold_us", "hold_max_ns");
+	for (int32 i = 0; i < n; i++) {
+		struct lock_class_stat* c = sorted[i];
+		seq_buf_printf(s, "%-40s %10lu %10lu %12lu %10lu %12lu %10lu\n", c->site, c->acquisitions, c->contentions,
+		               cycles_to_ns(c->wait_ticks) / 1000, cycles_to_ns(c->max_wait_ticks),
+		               cycles_to_ns(c->hold_ticks) / 1000, cycles_to_ns(c->max_hold_ticks));
+	}
+	if (s->overflow) seq_buf_printf(s, "...\n");
+	kfree(sorted);
+}
+
+static ssize_t lockstat_read(struct char_device* cdev, struct file* file, char* buf, size_t count, loff_t* ppos) {
+	struct seq_buf s;
+	char* text = kmalloc(LOCKSTAT_BUF_SIZE);
+	if (!text) return -ENOMEM;
+
+	seq_buf_init(&s, text, LOCKSTAT_BUF_SIZE);
+	lockstat_render(&s);
+	ssize_t ret = seq_buf_read(&s, buf, count, ppos);
+	kfree(text);
+	return ret;
+}
+
+/*
+ * 写入 "off" 暂停统计，"on" 恢复统计，其余任何内容都清零
+ */
+static ssize_t lockstat_write(struct char_device* cdev, struct file* file, const char* buf, size_t count, loff_t* ppos) {
+	if (count >= 3 && strncmp(buf, "off", 3) == 0) {
+		lockstat_enabled = 0;
+	} else if (count >= 2 && strncmp(buf, "on", 2) == 0) {
+		lockstat_enabled = 1;
+	} else {
+		lockstat_reset();
+	}
+	return count;
+}
+
+static const struct char_device_operations lockstat_ops = {
+    .read = lockstat_read,
+    .write = lockstat_write,
+};
+
+static struct char_device lockstat_cdev = {
+    .cd_dev = LOCKSTAT_DEV,
+    .cd_name = "lockstat",
+    .ops = &lockstat_ops,
+};
+
+void lockstat_init(void) { cdev_register(&lockstat_cdev); }
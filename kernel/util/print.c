@@ -1,13 +1,19 @@
+#include <kernel/device/char_device.h>
 #include <kernel/device/interface.h>
+#include <kernel/device/uart.h>
 #include <kernel/util.h>
 // #include <lock/mutex.h> // TODO: 暂时不实现 lock / mutex
 // #include <proc/thread.h>
 #include <kernel/riscv.h>
 #include <kernel/mmu.h>
+#include <kernel/percpu.h>
 #include <kernel/device/sbi.h>
 #include <kernel/types.h>
+#include <kernel/util/klog.h>
+#include <kernel/util/seq_buf.h>
 
-// 建立一个printf的锁，保证同一个printf中的数据都能在一次输出完毕
+// 控制台输出锁。kprintf 不再持有它，只有排空日志缓冲区的 hart 会 trylock 它，
+// 保证同一时刻只有一个 hart 在往串口写
 // mutex_t pr_lock;
 spinlock_t pr_lock = SPINLOCK_INIT;
 void printInit() {
@@ -24,29 +30,52 @@ static void outputToStr(void *data, const char *buf, size_t len) {
 	*strBuf += len;
 }
 
-static void output(void *data, const char *buf, size_t len) {
+// 一次打印先在栈上拼成一整条记录，再整体追加到日志缓冲区
+struct klog_line {
+	int32 level;
+	size_t len;
+	char buf[KLOG_TEXT_MAX];
+};
+
+static void outputToLine(void *data, const char *buf, size_t len) {
+	struct klog_line *line = (struct klog_line *)data;
 	for (int i = 0; i < len; i++) {
-		cons_putc(buf[i]);
+		if (line->len == KLOG_TEXT_MAX) {
+			klog_append(line->level, line->buf, line->len);
+			line->len = 0;
+		}
+		line->buf[line->len++] = buf[i];
 	}
 }
 
-static void printfNoLock(const char *fmt, ...) {
+static void linePrintf(struct klog_line *line, const char *fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	vprintfmt(outputToLine, line, fmt, ap);
+	va_end(ap);
+}
+
+static void lineFlush(struct klog_line *line) {
+	if (line->len) klog_append(line->level, line->buf, line->len);
+	line->len = 0;
+}
+
+static void printfLevel(int32 level, const char *fmt, ...) {
+	struct klog_line line = {.level = level, .len = 0};
 	va_list ap;
 	va_start(ap, fmt);
-	vprintfmt(output, NULL, fmt, ap);
+	vprintfmt(outputToLine, &line, fmt, ap);
 	va_end(ap);
+	lineFlush(&line);
 }
 
 void kprintf(const char *fmt, ...) {
-//void kprintf(const char *fmt, ...) {
+	struct klog_line line = {.level = LOG_LEVEL_INFO, .len = 0};
 	va_list ap;
 	va_start(ap, fmt);
 
-	// mtx_lock(&pr_lock); // todo lock
-	spinlock_lock(&pr_lock);
-	vprintfmt(output, NULL, fmt, ap);
-	spinlock_unlock(&pr_lock);
-	// mtx_unlock(&pr_lock);
+	vprintfmt(outputToLine, &line, fmt, ap);
+	lineFlush(&line);
 
 	va_end(ap);
 }
@@ -62,18 +91,121 @@ void ksprintf(char *buf, const char *fmt, ...) {
 	va_end(ap);
 }
 
-// TODO: 加上时间戳、CPU编号等信息
-void _log(const char *file, int line, const char *func, const char *fmt, ...) {
+// 运行时日志子系统掩码，默认全部打开
+volatile uint32 log_subsys_mask = LOG_MASK_ALL;
+
+void log_subsys_enable(int32 sub) {
+	if (sub < 0 || sub >= LOG_SUB_MAX) return;
+	__sync_fetch_and_or(&log_subsys_mask, LOG_MASK(sub));
+}
+
+void log_subsys_disable(int32 sub) {
+	if (sub < 0 || sub >= LOG_SUB_MAX) return;
+	__sync_fetch_and_and(&log_subsys_mask, ~LOG_MASK(sub));
+}
+
+void log_set_mask(uint32 mask) { log_subsys_mask = mask & LOG_MASK_ALL; }
+
+static const char *log_subsys_name[LOG_SUB_MAX] = {
+    [LOG_SUB_CORE] = "core",
+    [LOG_SUB_BOOT] = "boot",
+    [LOG_SUB_MM] = "mm",
+    [LOG_SUB_SCHED] = "sched",
+    [LOG_SUB_TRAP] = "trap",
+    [LOG_SUB_SYSCALL] = "syscall",
+    [LOG_SUB_FS] = "fs",
+    [LOG_SUB_DEV] = "dev",
+    [LOG_SUB_TIME] = "time",
+};
+
+static ssize_t log_mask_read(struct char_device *cdev, struct file *file, char *buf, size_t count, loff_t *ppos) {
+	char text[32 + LOG_SUB_MAX * 16];
+	struct seq_buf s;
+	uint32 mask = log_subsys_mask;
+
+	seq_buf_init(&s, text, sizeof(text));
+	seq_buf_printf(&s, "mask: 0x%x\n", mask);
+	for (int32 sub = 0; sub < LOG_SUB_MAX; sub++)
+		seq_buf_printf(&s, "%-8s %s\n", log_subsys_name[sub], (mask & LOG_MASK(sub)) ? "on" : "off");
+	return seq_buf_read(&s, buf, count, ppos);
+}
+
+/*
+ * 写入 "+<子系统>" 打开、"-<子系统>" 关闭一个子系统，"0x<掩码>" 整体设置掩码
+ */
+static ssize_t log_mask_write(struct char_device *cdev, struct file *file, const char *buf, size_t count, loff_t *ppos) {
+	size_t len = count;
+	while (len && (buf[len - 1] == '\n' || buf[len - 1] == ' ')) len--;
+	if (len < 2) return -EINVAL;
+
+	if (buf[0] == '0' && (buf[1] == 'x' || buf[1] == 'X')) {
+		uint32 mask = 0;
+		for (size_t i = 2; i < len; i++) {
+			char c = buf[i];
+			if (c >= '0' && c <= '9')
+				mask = mask * 16 + (c - '0');
+			else if (c >= 'a' && c <= 'f')
+				mask = mask * 16 + (c - 'a' + 10);
+			else if (c >= 'A' && c <= 'F')
+				mask = mask * 16 + (c - 'A' + 10);
+			else
+				return -EINVAL;
+		}
+		log_set_mask(mask);
+		return count;
+	}
+	if (buf[0] != '+' && buf[0] != '-') return -EINVAL;
+	for (int32 sub = 0; sub < LOG_SUB_MAX; sub++) {
+		const char *name = log_subsys_name[sub];
+		if (strlen(name) != len - 1 || strncmp(buf + 1, name, len - 1)) continue;
+		if (buf[0] == '+')
+			log_subsys_enable(sub);
+		else
+			log_subsys_disable(sub);
+		return count;
+	}
+	return -EINVAL;
+}
+
+static const struct char_device_operations log_mask_ops = {
+    .read = log_mask_read,
+    .write = log_mask_write,
+};
+
+static struct char_device log_mask_cdev = {
+    .cd_dev = LOG_MASK_DEV,
+    .cd_name = "log_mask",
+    .ops = &log_mask_ops,
+};
+
+/**
+ * log_mask_init - 注册 /dev/log_mask，运行时查看和修改日志子系统掩码
+ */
+void log_mask_init(void) { cdev_register(&log_mask_cdev); }
+
+static const char *log_level_tag[] = {
+    [LOG_LEVEL_NONE] = "",
+    [LOG_LEVEL_ERROR] = FARM_ERROR "[ERROR]" SGR_RESET SGR_RED,
+    [LOG_LEVEL_WARN] = FARM_WARN "[WARN]" SGR_RESET SGR_YELLOW,
+    [LOG_LEVEL_INFO] = FARM_INFO "[INFO]" SGR_RESET SGR_BLUE,
+    [LOG_LEVEL_DEBUG] = FARM_INFO "[DEBUG]" SGR_RESET SGR_CYAN,
+    [LOG_LEVEL_TRACE] = FARM_INFO "[TRACE]" SGR_RESET SGR_FAINT,
+};
+
+// TODO: 加上时间戳
+void _log(int32 level, int32 sub, const char *file, int line, const char *func, const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
 
-	// mtx_lock(&pr_lock);
+	if (level < LOG_LEVEL_ERROR || level > LOG_LEVEL_TRACE) level = LOG_LEVEL_INFO;
+
+	struct klog_line out = {.level = level, .len = 0};
 	// 输出日志头
-	printfNoLock("%s %2d %12s:%-4d %12s()" SGR_RESET ": ",
-		     FARM_INFO "[INFO]" SGR_RESET SGR_BLUE, read_tp(), file, line, func);
+	linePrintf(&out, "%s %2d %12s:%-4d %12s()" SGR_RESET ": ",
+		   log_level_tag[level], smp_processor_id(), file, line, func);
 	// 输出实际内容
-	vprintfmt(output, NULL, fmt, ap);
-	// mtx_unlock(&pr_lock);
+	vprintfmt(outputToLine, &out, fmt, ap);
+	lineFlush(&out);
 
 	va_end(ap);
 }
@@ -82,13 +214,13 @@ void _warn(const char *file, int line, const char *func, const char *fmt, ...) {
 	va_list ap;
 	va_start(ap, fmt);
 
-	// mtx_lock(&pr_lock);
+	struct klog_line out = {.level = LOG_LEVEL_WARN, .len = 0};
 	// 输出日志头
-	printfNoLock("%s %2d %12s:%-4d %12s()" SGR_RESET ": ",
-		     FARM_WARN "[WARN]" SGR_RESET SGR_YELLOW, read_tp(), file, line, func);
+	linePrintf(&out, "%s %2d %12s:%-4d %12s()" SGR_RESET ": ",
+		   FARM_WARN "[WARN]" SGR_RESET SGR_YELLOW, smp_processor_id(), file, line, func);
 	// 输出实际内容
-	vprintfmt(output, NULL, fmt, ap);
-	// mtx_unlock(&pr_lock);
+	vprintfmt(outputToLine, &out, fmt, ap);
+	lineFlush(&out);
 
 	va_end(ap);
 }
@@ -132,17 +264,19 @@ void _error(const char *file, int line, const char *func, const char *fmt, ...)
 	asm volatile("mv %0, sp" : "=r"(sp));
 	// print_stack(sp); //TODO: 打印栈信息（感觉貌似还挺有用的？）
 
-	// mtx_lock(&pr_lock);
+	struct klog_line out = {.level = LOG_LEVEL_ERROR, .len = 0};
 	// 输出日志头
-	printfNoLock("%s %2d %12s:%-4d %12s()  !TEST FINISH! " SGR_RESET ": ",
-		     FARM_ERROR "[ERROR]" SGR_RESET SGR_RED, read_tp(), file, line, func);
+	linePrintf(&out, "%s %2d %12s:%-4d %12s()  !TEST FINISH! " SGR_RESET ": ",
+		   FARM_ERROR "[ERROR]" SGR_RESET SGR_RED, smp_processor_id(), file, line, func);
 	// 输出实际内容
-	vprintfmt(output, NULL, fmt, ap);
-	printfNoLock("\n\n");
-	// mtx_unlock(&pr_lock);
-
+	vprintfmt(outputToLine, &out, fmt, ap);
+	linePrintf(&out, "\n\n");
+	lineFlush(&out);
 	va_end(ap);
 
+	// 记录排空到串口后可能还在发送环里，中断模式下不会在复位前发出去：切回同步模式并排空
+	uart_panic_flush();
+
 	// cpu_halt();
 	intr_off();
 	SBI_SYSTEM_RESET(0, 0);
@@ -157,37 +291,37 @@ void _error(const char *file, int line, const char *func, const char *fmt, ...)
 void printReg(struct trapframe *tf) {
 	// mtx_lock(&pr_lock);
 
-	printfNoLock("ra  = 0x%016lx\t", tf->regs.ra);
-	printfNoLock("sp  = 0x%016lx\t", tf->regs.sp);
-	printfNoLock("gp  = 0x%016lx\n", tf->regs.gp);
-	printfNoLock("tp  = 0x%016lx\t", tf->regs.tp);
-	printfNoLock("t0  = 0x%016lx\t", tf->regs.t0);
-	printfNoLock("t1  = 0x%016lx\n", tf->regs.t1);
-	printfNoLock("t2  = 0x%016lx\t", tf->regs.t2);
-	printfNoLock("s0  = 0x%016lx\t", tf->regs.s0);
-	printfNoLock("s1  = 0x%016lx\n", tf->regs.s1);
-	printfNoLock("a0  = 0x%016lx\t", tf->regs.a0);
-	printfNoLock("a1  = 0x%016lx\t", tf->regs.a1);
-	printfNoLock("a2  = 0x%016lx\n", tf->regs.a2);
-	printfNoLock("a3  = 0x%016lx\t", tf->regs.a3);
-	printfNoLock("a4  = 0x%016lx\t", tf->regs.a4);
-	printfNoLock("a5  = 0x%016lx\n", tf->regs.a5);
-	printfNoLock("a6  = 0x%016lx\t", tf->regs.a6);
-	printfNoLock("a7  = 0x%016lx\t", tf->regs.a7);
-	printfNoLock("s2  = 0x%016lx\n", tf->regs.s2);
-	printfNoLock("s3  = 0x%016lx\t", tf->regs.s3);
-	printfNoLock("s4  = 0x%016lx\t", tf->regs.s4);
-	printfNoLock("s5  = 0x%016lx\n", tf->regs.s5);
-	printfNoLock("s6  = 0x%016lx\t", tf->regs.s6);
-	printfNoLock("s7  = 0x%016lx\t", tf->regs.s7);
-	printfNoLock("s8  = 0x%016lx\n", tf->regs.s8);
-	printfNoLock("s9  = 0x%016lx\t", tf->regs.s9);
-	printfNoLock("s10 = 0x%016lx\t", tf->regs.s10);
-	printfNoLock("s11 = 0x%016lx\n", tf->regs.s11);
-	printfNoLock("t3  = 0x%016lx\t", tf->regs.t3);
-	printfNoLock("t4  = 0x%016lx\t", tf->regs.t4);
-	printfNoLock("t5  = 0x%016lx\n", tf->regs.t5);
-	printfNoLock("t6  = 0x%016lx\n", tf->regs.t6);
+	printfLevel(LOG_LEVEL_ERROR, "ra  = 0x%016lx\t", tf->regs.ra);
+	printfLevel(LOG_LEVEL_ERROR, "sp  = 0x%016lx\t", tf->regs.sp);
+	printfLevel(LOG_LEVEL_ERROR, "gp  = 0x%016lx\n", tf->regs.gp);
+	printfLevel(LOG_LEVEL_ERROR, "tp  = 0x%016lx\t", tf->regs.tp);
+	printfLevel(LOG_LEVEL_ERROR, "t0  = 0x%016lx\t", tf->regs.t0);
+	printfLevel(LOG_LEVEL_ERROR, "t1  = 0x%016lx\n", tf->regs.t1);
+	printfLevel(LOG_LEVEL_ERROR, "t2  = 0x%016lx\t", tf->regs.t2);
+	printfLevel(LOG_LEVEL_ERROR, "s0  = 0x%016lx\t", tf->regs.s0);
+	printfLevel(LOG_LEVEL_ERROR, "s1  = 0x%016lx\n", tf->regs.s1);
+	printfLevel(LOG_LEVEL_ERROR, "a0  = 0x%016lx\t", tf->regs.a0);
+	printfLevel(LOG_LEVEL_ERROR, "a1  = 0x%016lx\t", tf->regs.a1);
+	printfLevel(LOG_LEVEL_ERROR, "a2  = 0x%016lx\n", tf->regs.a2);
+	printfLevel(LOG_LEVEL_ERROR, "a3  = 0x%016lx\t", tf->regs.a3);
+	printfLevel(LOG_LEVEL_ERROR, "a4  = 0x%016lx\t", tf->regs.a4);
+	printfLevel(LOG_LEVEL_ERROR, "a5  = 0x%016lx\n", tf->regs.a5);
+	printfLevel(LOG_LEVEL_ERROR, "a6  = 0x%016lx\t", tf->regs.a6);
+	printfLevel(LOG_LEVEL_ERROR, "a7  = 0x%016lx\t", tf->regs.a7);
+	printfLevel(LOG_LEVEL_ERROR, "s2  = 0x%016lx\n", tf->regs.s2);
+	printfLevel(LOG_LEVEL_ERROR, "s3  = 0x%016lx\t", tf->regs.s3);
+	printfLevel(LOG_LEVEL_ERROR, "s4  = 0x%016lx\t", tf->regs.s4);
+	printfLevel(LOG_LEVEL_ERROR, "s5  = 0x%016lx\n", tf->regs.s5);
+	printfLevel(LOG_LEVEL_ERROR, "s6  = 0x%016lx\t", tf->regs.s6);
+	printfLevel(LOG_LEVEL_ERROR, "s7  = 0x%016lx\t", tf->regs.s7);
+	printfLevel(LOG_LEVEL_ERROR, "s8  = 0x%016lx\n", tf->regs.s8);
+	printfLevel(LOG_LEVEL_ERROR, "s9  = 0x%016lx\t", tf->regs.s9);
+	printfLevel(LOG_LEVEL_ERROR, "s10 = 0x%016lx\t", tf->regs.s10);
+	printfLevel(LOG_LEVEL_ERROR, "s11 = 0x%016lx\n", tf->regs.s11);
+	printfLevel(LOG_LEVEL_ERROR, "t3  = 0x%016lx\t", tf->regs.t3);
+	printfLevel(LOG_LEVEL_ERROR, "t4  = 0x%016lx\t", tf->regs.t4);
+	printfLevel(LOG_LEVEL_ERROR, "t5  = 0x%016lx\n", tf->regs.t5);
+	printfLevel(LOG_LEVEL_ERROR, "t6  = 0x%016lx\n", tf->regs.t6);
 
 	// mtx_unlock(&pr_lock);
 }
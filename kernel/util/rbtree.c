@@ -0,0 +1,236 @@
+/*
+ * 红黑树的着色与旋转，算法见《算法导论》第 13 章，空叶子用 NULL 表示（视为黑色）
+ */
+
+#include <kernel/util/rbtree.h>
+
+#define rb_is_black(node) (!(node) || (node)->rb_color == RB_COLOR_BLACK)
+#define rb_is_red(node) (!rb_is_black(node))
+
+static void rb_rotate_left(struct rb_node* x, struct rb_root* root) {
+	struct rb_node* y = x->rb_right;
+
+	x->rb_right = y->rb_left;
+	if (y->rb_left) y->rb_left->rb_parent = x;
+	y->rb_parent = x->rb_parent;
+	if (!x->rb_parent)
+		root->rb_node = y;
+	else if (x == x->rb_parent->rb_left)
+		x->rb_parent->rb_left = y;
+	else
+		x->rb_parent->rb_right = y;
+	y->rb_left = x;
+	x->rb_parent = y;
+}
+
+static void rb_rotate_right(struct rb_node* x, struct rb_root* root) {
+	struct rb_node* y = x->rb_left;
+
+	x->rb_left = y->rb_right;
+	if (y->rb_right) y->rb_right->rb_parent = x;
+	y->rb_parent = x->rb_parent;
+	if (!x->rb_parent)
+		root->rb_node = y;
+	else if (x == x->rb_parent->rb_right)
+		x->rb_parent->rb_right = y;
+	else
+		x->rb_parent->rb_left = y;
+	y->rb_right = x;
+	x->rb_parent = y;
+}
+
+/**
+ * rb_insert_color - 在 rb_link_node 之后恢复红黑性质
+ */
+void rb_insert_color(struct rb_node* node, struct rb_root* root) {
+	struct rb_node *parent, *gparent, *uncle;
+
+	while ((parent = node->rb_parent) && parent->rb_color == RB_COLOR_RED) {
+		// 父节点为红色，说明它不是根，祖父节点一定存在
+		gparent = parent->rb_parent;
+		if (parent == gparent->rb_left) {
+			uncle = gparent->rb_right;
+			if (rb_is_red(uncle)) {
+				parent->rb_color = uncle->rb_color = RB_COLOR_BLACK;
+				gparent->rb_color = RB_COLOR_RED;
+				node = gparent;
+				continue;
+			}
+			if (node == parent->rb_right) {
+				rb_rotate_left(parent, root);
+				node = parent;
+				parent = node->rb_parent;
+			}
+			parent->rb_color = RB_COLOR_BLACK;
+			gparent->rb_color = RB_COLOR_RED;
+			rb_rotate_right(gparent, root);
+		} else {
+			uncle = gparent->rb_left;
+			if (rb_is_red(uncle)) {
+				parent->rb_color = uncle->rb_color = RB_COLOR_BLACK;
+				gparent->rb_color = RB_COLOR_RED;
+				node = gparent;
+				continue;
+			}
+			if (node == parent->rb_left) {
+				rb_rotate_right(parent, root);
+				node = parent;
+				parent = node->rb_parent;
+			}
+			parent->rb_color = RB_COLOR_BLACK;
+			gparent->rb_color = RB_COLOR_RED;
+			rb_rotate_left(gparent, root);
+		}
+	}
+	root->rb_node->rb_color = RB_COLOR_BLACK;
+}
+
+// 用 v 替换 u 在父节点中的位置
+static void rb_transplant(struct rb_node* u, struct rb_node* v, struct rb_root* root) {
+	if (!u->rb_parent)
+		root->rb_node = v;
+	else if (u == u->rb_parent->rb_left)
+		u->rb_parent->rb_left = v;
+	else
+		u->rb_parent->rb_right = v;
+	if (v) v->rb_parent = u->rb_parent;
+}
+
+// node 可能为 NULL，所以需要单独传入它的父节点
+static void rb_erase_color(struct rb_node* node, struct rb_node* parent, struct rb_root* root) {
+	struct rb_node* sibling;
+
+	while (node != root->rb_node && rb_is_black(node)) {
+		if (node == parent->rb_left) {
+			sibling = parent->rb_right;
+			if (rb_is_red(sibling)) {
+				sibling->rb_color = RB_COLOR_BLACK;
+				parent->rb_color = RB_COLOR_RED;
+				rb_rotate_left(parent, root);
+				sibling = parent->rb_right;
+			}
+			if (rb_is_black(sibling->rb_left) && rb_is_black(sibling->rb_right)) {
+				sibling->rb_color = RB_COLOR_RED;
+				node = parent;
+				parent = node->rb_parent;
+			} else {
+				if (rb_is_black(sibling->rb_right)) {
+					sibling->rb_left->rb_color = RB_COLOR_BLACK;
+					sibling->rb_color = RB_COLOR_RED;
+					rb_rotate_right(sibling, root);
+					sibling = parent->rb_right;
+				}
+				sibling->rb_color = parent->rb_color;
+				parent->rb_color = RB_COLOR_BLACK;
+				sibling->rb_right->rb_color = RB_COLOR_BLACK;
+				rb_rotate_left(parent, root);
+				node = root->rb_node;
+				break;
+			}
+		} else {
+			sibling = parent->rb_left;
+			if (rb_is_red(sibling)) {
+				sibling->rb_color = RB_COLOR_BLACK;
+				parent->rb_color = RB_COLOR_RED;
+				rb_rotate_right(parent, root);
+				sibling = parent->rb_left;
+			}
+			if (rb_is_black(sibling->rb_left) && rb_is_black(sibling->rb_right)) {
+				sibling->rb_color = RB_COLOR_RED;
+				node = parent;
+				parent = node->rb_parent;
+			} else {
+				if (rb_is_black(sibling->rb_left)) {
+					sibling->rb_right->rb_color = RB_COLOR_BLACK;
+					sibling->rb_color = RB_COLOR_RED;
+					rb_rotate_left(sibling, root);
+					sibling = parent->rb_left;
+				}
+				sibling->rb_color = parent->rb_color;
+				parent->rb_color = RB_COLOR_BLACK;
+				sibling->rb_left->rb_color = RB_COLOR_BLACK;
+				rb_rotate_right(parent, root);
+				node = root->rb_node;
+				break;
+			}
+		}
+	}
+	if (node) node->rb_color = RB_COLOR_BLACK;
+}
+
+/**
+ * rb_erase - 从树中删除节点，删除后节点处于 RB_EMPTY_NODE 状态
+ */
+void rb_erase(struct rb_node* node, struct rb_root* root) {
+	struct rb_node *child, *parent, *succ;
+	int32 color = node->rb_color;
+
+	if (!node->rb_left) {
+		child = node->rb_right;
+		parent = node->rb_parent;
+		rb_transplant(node, child, root);
+	} else if (!node->rb_right) {
+		child = node->rb_left;
+		parent = node->rb_parent;
+		rb_transplant(node, child, root);
+	} else {
+		// 用后继节点顶替被删除节点的位置和颜色
+		succ = node->rb_right;
+		while (succ->rb_left) succ = succ->rb_left;
+		color = succ->rb_color;
+		child = succ->rb_right;
+		if (succ->rb_parent == node) {
+			parent = succ;
+		} else {
+			parent = succ->rb_parent;
+			rb_transplant(succ, child, root);
+			succ->rb_right = node->rb_right;
+			succ->rb_right->rb_parent = succ;
+		}
+		rb_transplant(node, succ, root);
+		succ->rb_left = node->rb_left;
+		succ->rb_left->rb_parent = succ;
+		succ->rb_color = node->rb_color;
+	}
+
+	if (color == RB_COLOR_BLACK) rb_erase_color(child, parent, root);
+	RB_CLEAR_NODE(node);
+}
+
+struct rb_node* rb_first(const struct rb_root* root) {
+	struct rb_node* n = root->rb_node;
+	if (!n) return NULL;
+	while (n->rb_left) n = n->rb_left;
+	return n;
+}
+
+struct rb_node* rb_last(const struct rb_root* root) {
+	struct rb_node* n = root->rb_node;
+	if (!n) return NULL;
+	while (n->rb_right) n = n->rb_right;
+	return n;
+}
+
+struct rb_node* rb_next(const struct rb_node* node) {
+	struct rb_node* parent;
+
+	if (node->rb_right) {
+		node = node->rb_right;
+		while (node->rb_left) node = node->rb_left;
+		return (struct rb_node*)node;
+	}
+	while ((parent = node->rb_parent) && node == parent->rb_right) node = parent;
+	return parent;
+}
+
+struct rb_node* rb_prev(const struct rb_node* node) {
+	struct rb_node* parent;
+
+	if (node->rb_left) {
+		node = node->rb_left;
+		while (node->rb_right) node = node->rb_right;
+		return (struct rb_node*)node;
+	}
+	while ((parent = node->rb_parent) && node == parent->rb_left) node = parent;
+	return parent;
+}
@@ -0,0 +1,49 @@
+#include <kernel/util/seq_buf.h>
+#include <kernel/util/string.h>
+#include <kernel/util/vprint.h>
+
+void seq_buf_init(struct seq_buf* s, char* buf, size_t size) {
+	s->buf = buf;
+	s->size = size;
+	s->len = 0;
+	s->overflow = 0;
+	if (size) buf[0] = '\0';
+}
+
+static void outputToSeqBuf(void* data, const char* buf, size_t len) {
+	struct seq_buf* s = data;
+	// 保留一个字节放结尾的 '\0'
+	size_t room = s->size - 1 - s->len;
+	if (len > room) {
+		len = room;
+		s->overflow = 1;
+	}
+	memcpy(s->buf + s->len, buf, len);
+	s->len += len;
+	s->buf[s->len] = '\0';
+}
+
+void seq_buf_printf(struct seq_buf* s, const char* fmt, ...) {
+	va_list ap;
+	if (s->size == 0) return;
+	va_start(ap, fmt);
+	vprintfmt(outputToSeqBuf, s, fmt, ap);
+	va_end(ap);
+}
+
+/**
+ * seq_buf_read - 按文件偏移把渲染好的文本拷贝给读者
+ * @s: 已渲染的文本
+ * @dst: 内核缓冲区
+ * @count: 最多拷贝的字节数
+ * @ppos: 文件偏移，拷贝后前移
+ */
+ssize_t seq_buf_read(struct seq_buf* s, char* dst, size_t count, loff_t* ppos) {
+	if (*ppos < 0) return -EINVAL;
+	if ((size_t)*ppos >= s->len) return 0;
+
+	size_t n = MIN(count, s->len - (size_t)*ppos);
+	memcpy(dst, s->buf + *ppos, n);
+	*ppos += n;
+	return n;
+}